@@ -0,0 +1,549 @@
+#define _GNU_SOURCE
+
+#include "sim.h"
+
+#include "crc.h"
+#include "thermometer.h"
+#include "one_wire_slots.h"
+#include "usb.h"
+#include "pool.h"
+#include "usb_istr.h"
+#include "sample_codec.h"
+
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//----------------------------------------------------------------//
+//        Микробенчмарки чистых функций прошивки на хосте         //
+//----------------------------------------------------------------//
+// Каждый случай калибруется так, чтобы одна повторность длилась не
+// меньше --min-time мс, и повторяется --repetitions раз. В вывод идут
+// минимум, медиана, среднее и СКО времени операции и пропускная
+// способность по медиане - CSV или JSON Lines для сравнения версий
+// (tools/bench_compare.py).
+
+typedef struct Benchmark
+{
+    const char *m_name;
+    uint32_t (*m_prepare)(void);   // готовит данные, возвращает байт на операцию
+    void (*m_run)(const uint64_t iterations);
+} Benchmark;
+
+typedef struct BenchmarkResult
+{
+    uint32_t bytes;
+    uint64_t iterations;
+    double minimum;
+    double median;
+    double mean;
+    double deviation;
+} BenchmarkResult;
+
+typedef struct BenchOptions
+{
+    uint32_t repetitions;
+    double minTime;
+    const char *filter;
+    bool isJson;
+    const char *trace;   // CSV seq,ms,sensor,mC (host/history_decode)
+} BenchOptions;
+
+static BenchOptions benchOptions = { 15, 20.0, 0, false, 0 };
+
+// Результат операций уходит сюда, чтобы компилятор не выбросил работу
+static volatile uint32_t benchSink = 0;
+
+//----------------------------------------------------------------//
+//                     Реалистичные входные данные                //
+//----------------------------------------------------------------//
+// Блокноты DS18B20: после включения, +25.0625, -10.125, +85 (9 бит)
+static const uint8_t bench_scratchpads[][NUMBER_OF_REGISTERS] =
+{
+    { 0x50, 0x05, 0x4B, 0x46, 0x7F, 0xFF, 0x0C, 0x10, 0x1C },
+    { 0x91, 0x01, 0x19, 0x0F, 0x7F, 0xFF, 0x0F, 0x10, 0x7F },
+    { 0x5E, 0xFF, 0x19, 0x0F, 0x7F, 0xFF, 0x02, 0x10, 0xEC },
+    { 0x50, 0x05, 0x19, 0x0F, 0x1F, 0xFF, 0x10, 0x10, 0x77 }
+};
+
+#define BENCH_SCRATCHPADS (sizeof(bench_scratchpads) / sizeof(bench_scratchpads[0]))
+
+static const uint8_t bench_rom[8] = { 0x28, 0x51, 0xA2, 0x6C, 0x05, 0x00, 0x00, 0x00 };
+
+static const uint16_t bench_temperatures[] =
+{
+    0x0550, 0x0191, 0xFF5E, 0x0000, 0x07D0, 0xFC90, 0x0168, 0x0008
+};
+
+#define BENCH_TEMPERATURES (sizeof(bench_temperatures) / sizeof(bench_temperatures[0]))
+
+static const ThermometerName bench_name = "thermometer_1";
+
+// Пакеты от терминала: команды с CRLF, строка длиннее сообщения, куски строк
+static const char *const bench_packets[] =
+{
+    "stats\r\n",
+    "loop\r\nstack\r\n",
+    "hello, this line is echoed back by the firmware without a command\r\n",
+    "0123456789012345678901234567890123456789012345678901234567890123",
+    "4567890123456789\n"
+};
+
+#define BENCH_PACKETS (sizeof(bench_packets) / sizeof(bench_packets[0]))
+
+static uint8_t benchBlock[64];
+
+//----------------------------------------------------------------//
+//                         Случаи: CRC8                           //
+//----------------------------------------------------------------//
+static uint32_t prepareScratchpad(void)
+{
+    return NUMBER_OF_REGISTERS;
+}
+
+static uint32_t prepareRom(void)
+{
+    return sizeof(bench_rom);
+}
+
+static void runCrc8Scratchpad(const uint64_t iterations)
+{
+    uint32_t sink = 0;
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        sink += crc8((const char *)bench_scratchpads[i % BENCH_SCRATCHPADS], NUMBER_OF_REGISTERS);
+    }
+    benchSink = sink;
+}
+
+static void runCrc8Rom(const uint64_t iterations)
+{
+    uint32_t sink = 0;
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        sink += crc8((const char *)bench_rom, sizeof(bench_rom));
+    }
+    benchSink = sink;
+}
+
+static uint32_t prepareCrc8Block(void)
+{
+    for (uint32_t i = 0; i < sizeof(benchBlock); i++)
+    {
+        benchBlock[i] = (uint8_t)(i * 37 + 11);
+    }
+
+    return sizeof(benchBlock);
+}
+
+static void runCrc8Block(const uint64_t iterations)
+{
+    uint32_t sink = 0;
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        sink += crc8((const char *)benchBlock, sizeof(benchBlock));
+    }
+    benchSink = sink;
+}
+
+//----------------------------------------------------------------//
+//                 Случай: строка телеметрии                      //
+//----------------------------------------------------------------//
+static uint32_t prepareFormatTemperature(void)
+{
+    char message[POOL_BLOCK_SIZE];
+    return formatThermometerMessage(message, sizeof(message), bench_name, bench_temperatures[1]);
+}
+
+static void runFormatTemperature(const uint64_t iterations)
+{
+    char message[POOL_BLOCK_SIZE];
+    uint32_t sink = 0;
+
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        sink += formatThermometerMessage(message, sizeof(message), bench_name,
+                                         bench_temperatures[i % BENCH_TEMPERATURES]);
+    }
+    benchSink = sink;
+}
+
+//----------------------------------------------------------------//
+//             Случай: сборка строк из пакетов EP3 OUT            //
+//----------------------------------------------------------------//
+static uint32_t prepareUsbLines(void)
+{
+    uint32_t packetBytes = 0;
+    for (uint32_t i = 0; i < BENCH_PACKETS; i++)
+    {
+        packetBytes += strlen(bench_packets[i]);
+    }
+
+    return packetBytes;
+}
+
+static void runUsbLines(const uint64_t iterations)
+{
+    uint32_t sink = 0;
+
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        // Одна операция - полный набор пакетов и разбор очереди строк
+        for (uint32_t j = 0; j < BENCH_PACKETS; j++)
+        {
+            injectSimUsbPacket((const uint8_t *)bench_packets[j], strlen(bench_packets[j]));
+            EP3_OUT_Callback();
+        }
+
+        BufferHandle buffer = getUsb()->receive();
+        while (buffer != NO_BUFFER)
+        {
+            sink += getBufferSize(buffer);
+            releaseBuffer(buffer);
+            buffer = getUsb()->receive();
+        }
+    }
+    benchSink = sink;
+}
+
+//----------------------------------------------------------------//
+//           Случаи: кодирование и декодирование слотов 1-Wire    //
+//----------------------------------------------------------------//
+static void runSlotEncode(const uint64_t iterations)
+{
+    uint16_t slots[NUMBER_OF_REGISTERS][CHAR_BIT];
+    uint32_t sink = 0;
+
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        const uint8_t *scratchpad = bench_scratchpads[i % BENCH_SCRATCHPADS];
+        for (uint32_t j = 0; j < NUMBER_OF_REGISTERS; j++)
+        {
+            encodeOneWireSlots(scratchpad[j], slots[j]);
+        }
+        sink += slots[i % NUMBER_OF_REGISTERS][i % CHAR_BIT];
+    }
+    benchSink = sink;
+}
+
+static uint16_t benchEchoes[BENCH_SCRATCHPADS][NUMBER_OF_REGISTERS][CHAR_BIT];
+
+static uint32_t prepareSlotDecode(void)
+{
+    // Эхо слотов чтения: 0xFF для единицы, 0xF0 - линию держит датчик
+    for (uint32_t i = 0; i < BENCH_SCRATCHPADS; i++)
+    {
+        for (uint32_t j = 0; j < NUMBER_OF_REGISTERS; j++)
+        {
+            for (uint32_t k = 0; k < CHAR_BIT; k++)
+            {
+                benchEchoes[i][j][k] = (bench_scratchpads[i][j] >> k) & 1 ? 0xFF : 0xF0;
+            }
+        }
+    }
+
+    return NUMBER_OF_REGISTERS;
+}
+
+static void runSlotDecode(const uint64_t iterations)
+{
+    uint8_t scratchpad[NUMBER_OF_REGISTERS];
+    uint32_t sink = 0;
+
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        for (uint32_t j = 0; j < NUMBER_OF_REGISTERS; j++)
+        {
+            scratchpad[j] = decodeOneWireSlots(benchEchoes[i % BENCH_SCRATCHPADS][j]);
+        }
+        sink += scratchpad[i % NUMBER_OF_REGISTERS];
+    }
+    benchSink = sink;
+}
+
+//----------------------------------------------------------------//
+//         Случаи: сжатие ряда отсчётов (sample_codec.h)          //
+//----------------------------------------------------------------//
+// Ряд записан декодером журнала (--trace) или построен как у модели
+// датчика симулятора: синусоида 20..24 °C с периодом 60 с, опрос раз в
+// 757 мс с разбросом в пару мс. Одна операция - весь ряд; размер
+// операции - сжатый размер ряда, степень сжатия выводится в stderr
+#define BENCH_TRACE_MAX 16384
+
+static uint32_t benchTraceTimes[BENCH_TRACE_MAX];
+static int16_t benchTraceValues[BENCH_TRACE_MAX];
+static uint32_t benchTraceSize = 0;
+static uint8_t benchEncoded[BENCH_TRACE_MAX * SAMPLE_CODEC_MAX_SIZE];
+
+static void loadBenchTrace(void)
+{
+    FILE *file = benchOptions.trace != 0 ? fopen(benchOptions.trace, "r") : 0;
+    if (benchOptions.trace != 0 && file == 0)
+    {
+        perror(benchOptions.trace);
+        exit(EXIT_FAILURE);
+    }
+
+    if (file != 0)
+    {
+        unsigned sequence = 0, time = 0, sensor = 0;
+        int millidegrees = 0;
+        while (benchTraceSize < BENCH_TRACE_MAX &&
+               fscanf(file, "%u,%u,%u,%d", &sequence, &time, &sensor, &millidegrees) == 4)
+        {
+            benchTraceTimes[benchTraceSize] = time;
+            benchTraceValues[benchTraceSize++] = (int16_t)(millidegrees * 2 / 125);
+        }
+        fclose(file);
+        return;
+    }
+
+    uint32_t time = 129;
+    for (benchTraceSize = 0; benchTraceSize < 4096; benchTraceSize++)
+    {
+        double celsius = 22.0 + 2.0 * sin(2.0 * M_PI * time / 60000.0);
+        benchTraceTimes[benchTraceSize] = time;
+        benchTraceValues[benchTraceSize] = (int16_t)lround(celsius * 16.0);
+        time += 757 + (benchTraceSize * 7919) % 5 - 2;
+    }
+}
+
+static uint32_t encodeBenchTrace(void)
+{
+    SampleCodec codec;
+    initSampleCodec(&codec, 0);
+
+    uint32_t size = 0;
+    for (uint32_t i = 0; i < benchTraceSize; i++)
+    {
+        size += encodeSample(&codec, benchTraceTimes[i], benchTraceValues[i], benchEncoded + size);
+    }
+
+    return size;
+}
+
+static uint32_t prepareCodecTrace(void)
+{
+    if (benchTraceSize == 0)
+    {
+        loadBenchTrace();
+    }
+
+    uint32_t size = encodeBenchTrace();
+    fprintf(stderr, "codec: %u samples, %.2f B/sample, x%.2f vs 8-byte records\n",
+            benchTraceSize, (double)size / benchTraceSize, 8.0 * benchTraceSize / size);
+    return size;
+}
+
+static void runCodecEncode(const uint64_t iterations)
+{
+    uint32_t sink = 0;
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        sink += encodeBenchTrace();
+    }
+    benchSink = sink;
+}
+
+static void runCodecDecode(const uint64_t iterations)
+{
+    uint32_t encodedSize = encodeBenchTrace();
+    uint32_t sink = 0;
+
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        SampleCodec codec;
+        initSampleCodec(&codec, 0);
+
+        uint32_t offset = 0;
+        for (uint32_t j = 0; j < benchTraceSize && offset < encodedSize; j++)
+        {
+            uint32_t time = 0;
+            int16_t value = 0;
+            offset += decodeSample(&codec, benchEncoded + offset, encodedSize - offset, &time, &value);
+            sink += (uint32_t)value;
+        }
+    }
+    benchSink = sink;
+}
+
+//----------------------------------------------------------------//
+//                         Таблица случаев                        //
+//----------------------------------------------------------------//
+static const Benchmark benchmarks[] =
+{
+    { "crc8/scratchpad", prepareScratchpad, runCrc8Scratchpad },
+    { "crc8/rom", prepareRom, runCrc8Rom },
+    { "crc8/block64", prepareCrc8Block, runCrc8Block },
+    { "format/temperature", prepareFormatTemperature, runFormatTemperature },
+    { "usb/rx_lines", prepareUsbLines, runUsbLines },
+    { "one_wire/encode_scratchpad", prepareScratchpad, runSlotEncode },
+    { "one_wire/decode_scratchpad", prepareSlotDecode, runSlotDecode },
+    { "codec/encode_trace", prepareCodecTrace, runCodecEncode },
+    { "codec/decode_trace", prepareCodecTrace, runCodecDecode }
+};
+
+#define BENCHMARK_COUNT (sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+//----------------------------------------------------------------//
+//                   Замер времени и статистика                   //
+//----------------------------------------------------------------//
+static double getBenchTime(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+static int compareDoubles(const void *left, const void *right)
+{
+    double difference = *(const double *)left - *(const double *)right;
+    return (difference > 0) - (difference < 0);
+}
+
+static uint64_t calibrateBenchmark(const Benchmark *benchmark)
+{
+    uint64_t iterations = 1;
+
+    for (;;)
+    {
+        double startTime = getBenchTime();
+        benchmark->m_run(iterations);
+        double elapsed = getBenchTime() - startTime;
+
+        if (elapsed >= benchOptions.minTime * 1e6 || iterations >= (1ULL << 40))
+        {
+            return iterations;
+        }
+
+        // Рост не больше чем в 10 раз за шаг, с запасом до целевого времени
+        double scale = elapsed > 0 ? benchOptions.minTime * 1e6 * 1.2 / elapsed : 10;
+        iterations = (uint64_t)((double)iterations * (scale < 10 ? (scale > 2 ? scale : 2) : 10));
+    }
+}
+
+static BenchmarkResult runBenchmark(const Benchmark *benchmark)
+{
+    BenchmarkResult result = { 0 };
+    double samples[benchOptions.repetitions];
+
+    result.bytes = benchmark->m_prepare();
+    result.iterations = calibrateBenchmark(benchmark);
+
+    for (uint32_t i = 0; i < benchOptions.repetitions; i++)
+    {
+        double startTime = getBenchTime();
+        benchmark->m_run(result.iterations);
+        samples[i] = (getBenchTime() - startTime) / (double)result.iterations;
+        result.mean += samples[i];
+    }
+    result.mean /= benchOptions.repetitions;
+
+    for (uint32_t i = 0; i < benchOptions.repetitions; i++)
+    {
+        result.deviation += (samples[i] - result.mean) * (samples[i] - result.mean);
+    }
+    result.deviation = benchOptions.repetitions > 1 ? sqrt(result.deviation / (benchOptions.repetitions - 1)) : 0;
+
+    qsort(samples, benchOptions.repetitions, sizeof(double), compareDoubles);
+    result.minimum = samples[0];
+    result.median = benchOptions.repetitions % 2 != 0
+                  ? samples[benchOptions.repetitions / 2]
+                  : (samples[benchOptions.repetitions / 2 - 1] + samples[benchOptions.repetitions / 2]) / 2;
+
+    return result;
+}
+
+static void printBenchmark(const Benchmark *benchmark, const BenchmarkResult *result)
+{
+    uint32_t bytes = result->bytes;
+    double megabytes = bytes > 0 && result->median > 0 ? bytes * 1e3 / result->median : 0;
+
+    if (benchOptions.isJson == true)
+    {
+        printf("{\"benchmark\":\"%s\",\"bytes_per_op\":%u,\"repetitions\":%u,\"iterations\":%llu,"
+               "\"ns_per_op_min\":%.3f,\"ns_per_op_median\":%.3f,\"ns_per_op_mean\":%.3f,"
+               "\"ns_per_op_stddev\":%.3f,\"mbytes_per_s\":%.3f}\n",
+               benchmark->m_name, bytes, benchOptions.repetitions, (unsigned long long)result->iterations,
+               result->minimum, result->median, result->mean, result->deviation, megabytes);
+        return;
+    }
+
+    printf("%s,%u,%u,%llu,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+           benchmark->m_name, bytes, benchOptions.repetitions, (unsigned long long)result->iterations,
+           result->minimum, result->median, result->mean, result->deviation, megabytes);
+}
+
+//----------------------------------------------------------------//
+//                    Разбор параметров и запуск                  //
+//----------------------------------------------------------------//
+static void parseBenchOptions(int argc, char **argv)
+{
+    static const struct option options[] =
+    {
+        { "repetitions", required_argument, 0, 'r' },
+        { "min-time", required_argument, 0, 't' },
+        { "filter", required_argument, 0, 'f' },
+        { "json", no_argument, 0, 'j' },
+        { "trace", required_argument, 0, 'c' },
+        { "help", no_argument, 0, 'h' },
+        { 0, 0, 0, 0 }
+    };
+
+    int option = 0;
+    while ((option = getopt_long(argc, argv, "h", options, 0)) != -1)
+    {
+        switch (option)
+        {
+            case 'r': benchOptions.repetitions = (uint32_t)atoi(optarg); break;
+            case 't': benchOptions.minTime = atof(optarg); break;
+            case 'f': benchOptions.filter = optarg; break;
+            case 'j': benchOptions.isJson = true; break;
+            case 'c': benchOptions.trace = optarg; break;
+            default:
+                fprintf(stderr,
+                        "usage: %s [--repetitions N] [--min-time MS] [--filter SUBSTRING] [--json]\n"
+                        "          [--trace CSV]\n"
+                        "  CSV (default) or JSON Lines on stdout, one row per benchmark;\n"
+                        "  --trace: samples seq,ms,sensor,mC for codec/* (history_decode output)\n",
+                        argv[0]);
+                exit(option == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+
+    benchOptions.repetitions = benchOptions.repetitions > 0 ? benchOptions.repetitions : 1;
+}
+
+int main(int argc, char **argv)
+{
+    parseBenchOptions(argc, argv);
+
+    // Модель периферии без псевдотерминала: USB не подключается
+    simOptions.isStdio = true;
+    simOptions.isAutoConnect = false;
+    simOptions.speed = 0;
+    startSim();
+
+    if (benchOptions.isJson == false)
+    {
+        printf("benchmark,bytes_per_op,repetitions,iterations,ns_per_op_min,ns_per_op_median,"
+               "ns_per_op_mean,ns_per_op_stddev,mbytes_per_s\n");
+    }
+
+    for (uint32_t i = 0; i < BENCHMARK_COUNT; i++)
+    {
+        if (benchOptions.filter != 0 && strstr(benchmarks[i].m_name, benchOptions.filter) == 0)
+        {
+            continue;
+        }
+
+        BenchmarkResult result = runBenchmark(&benchmarks[i]);
+        printBenchmark(&benchmarks[i], &result);
+        fflush(stdout);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,338 @@
+#define _GNU_SOURCE
+
+#include "history.h"
+#include "sample_codec.h"
+#include "crc.h"
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//----------------------------------------------------------------//
+//         Декодер журнала отсчётов (src/main/history.h)          //
+//----------------------------------------------------------------//
+// Два источника: запись потока CDC с кадрами "history bin" (файл или
+// stdin, например cat /dev/ttyACM0 > capture.bin) и образ flash МК
+// (firmware_sim --flash или st-flash read), из которого читается кольцо
+// страниц журнала. Отсчёты выводятся в stdout как CSV
+// "seq,ms,sensor,mC", где ms - полное время в мс Unix: в образе flash
+// старшие биты берутся из заголовка страницы, в потоке - ближайшие к
+// часам хоста (запись должна быть моложе 24 суток). Остальные строки потока с --text уходят в
+// stderr. С --stats в stderr выводится размер сжатых данных на отсчёт
+// и сравнение с записью по 8 байт и строкой "history dump".
+
+#define FLASH_BASE_ADDRESS 0x08000000UL
+
+typedef struct DecodeOptions
+{
+    const char *flash;
+    const char *input;
+    bool isText;
+    bool isStats;
+} DecodeOptions;
+
+static DecodeOptions decodeOptions = { 0, 0, false, false };
+
+// Итоги для --stats
+typedef struct DecodeStatistics
+{
+    uint64_t samples;
+    uint64_t encodedBytes;   // сжатые отсчёты без заголовков
+    uint64_t framedBytes;    // с заголовками кадров или страниц
+    uint64_t textBytes;      // те же отсчёты строками "history dump"
+    uint64_t units;          // кадры или страницы
+    uint64_t errors;
+} DecodeStatistics;
+
+static DecodeStatistics statistics = { 0 };
+
+//----------------------------------------------------------------//
+//                      Чтение входа целиком                      //
+//----------------------------------------------------------------//
+static uint8_t *readInput(const char *path, size_t *size)
+{
+    FILE *file = path != 0 ? fopen(path, "rb") : stdin;
+    if (file == 0)
+    {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+
+    size_t capacity = 1 << 16;
+    uint8_t *data = malloc(capacity);
+    *size = 0;
+    for (;;)
+    {
+        if (*size == capacity)
+        {
+            capacity *= 2;
+            data = realloc(data, capacity);
+        }
+
+        size_t count = fread(data + *size, 1, capacity - *size, file);
+        if (count == 0)
+        {
+            break;
+        }
+        *size += count;
+    }
+
+    if (file != stdin)
+    {
+        fclose(file);
+    }
+    return data;
+}
+
+// Старшие биты мс Unix, ближайшие к текущему времени хоста
+static uint32_t getHostTimeHigh(const uint32_t time)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    uint64_t milliseconds = (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+
+    uint32_t high = (uint32_t)(milliseconds >> 32);
+    int32_t delta = (int32_t)(time - (uint32_t)milliseconds);
+    if (delta < 0 && time > (uint32_t)milliseconds)
+    {
+        high--;
+    }
+    else if (delta > 0 && time < (uint32_t)milliseconds)
+    {
+        high++;
+    }
+    return high;
+}
+
+static void printSample(const uint32_t sequence, const uint64_t time, const uint32_t sensor, const int16_t value)
+{
+    int32_t millidegrees = (int32_t)value * 125 / 2;
+    printf("%" PRIu32 ",%" PRIu64 ",%" PRIu32 ",%" PRIi32 "\n", sequence, time, sensor, millidegrees);
+
+    char line[48];
+    statistics.textBytes += (uint64_t)snprintf(line, sizeof(line), "%" PRIu32 " %" PRIu32 " %" PRIu32 " %" PRIi32 "\n",
+                                               sequence, (uint32_t)time, sensor, millidegrees);
+    statistics.samples++;
+}
+
+// Декодирует count отсчётов; false - данные не сходятся с заголовком.
+// timeHigh - старшие биты времени первого отсчёта, переход младших
+// 32 бит через ноль внутри кадра или страницы учитывается
+static bool decodeSamples(const uint8_t *data, const uint32_t size, const uint32_t count,
+                          const uint32_t firstSequence, const uint32_t sensor, uint32_t timeHigh)
+{
+    SampleCodec codec;
+    initSampleCodec(&codec, 0);
+
+    uint32_t offset = 0;
+    uint32_t lastTime = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t time = 0;
+        int16_t value = 0;
+        uint32_t sampleSize = decodeSample(&codec, data + offset, size - offset, &time, &value);
+        if (sampleSize == 0)
+        {
+            return false;
+        }
+
+        if (i != 0 && time < lastTime && (int32_t)(time - lastTime) > 0)
+        {
+            timeHigh++;
+        }
+        lastTime = time;
+
+        printSample(firstSequence + i, ((uint64_t)timeHigh << 32) | time, sensor, value);
+        offset += sampleSize;
+    }
+
+    statistics.encodedBytes += offset;
+    return offset == size;
+}
+
+//----------------------------------------------------------------//
+//                        Кадры потока CDC                        //
+//----------------------------------------------------------------//
+// Время первого отсчёта кадра нужно до декодирования: старшие биты
+// выбираются по нему
+static bool decodeStreamFrame(const uint8_t *frame, const uint32_t payloadSize, const uint32_t sequence)
+{
+    SampleCodec codec;
+    initSampleCodec(&codec, 0);
+
+    uint32_t time = 0;
+    int16_t value = 0;
+    if (frame[3] != 0 &&
+        decodeSample(&codec, frame + HISTORY_FRAME_HEADER_SIZE, payloadSize, &time, &value) == 0)
+    {
+        return false;
+    }
+
+    return decodeSamples(frame + HISTORY_FRAME_HEADER_SIZE, payloadSize, frame[3], sequence, frame[2],
+                         getHostTimeHigh(time));
+}
+
+static void decodeStream(const uint8_t *data, const size_t size)
+{
+    size_t offset = 0;
+    while (offset < size)
+    {
+        if (data[offset] == HISTORY_FRAME_MARK && offset + HISTORY_FRAME_HEADER_SIZE <= size)
+        {
+            const uint8_t *frame = data + offset;
+            uint32_t payloadSize = frame[1];
+            uint32_t sequence = frame[4] | (frame[5] << 8) | (frame[6] << 16) | ((uint32_t)frame[7] << 24);
+            if (offset + HISTORY_FRAME_HEADER_SIZE + payloadSize <= size &&
+                decodeStreamFrame(frame, payloadSize, sequence) == true)
+            {
+                statistics.framedBytes += HISTORY_FRAME_HEADER_SIZE + payloadSize;
+                statistics.units++;
+                offset += HISTORY_FRAME_HEADER_SIZE + payloadSize;
+                continue;
+            }
+
+            statistics.errors++;
+            fprintf(stderr, "history_decode: bad frame at offset %zu\n", offset);
+        }
+
+        // Текстовая строка до '\n'
+        const uint8_t *end = memchr(data + offset, '\n', size - offset);
+        size_t lineSize = end != 0 ? (size_t)(end - (data + offset)) + 1 : size - offset;
+        if (decodeOptions.isText == true && data[offset] != HISTORY_FRAME_MARK)
+        {
+            fwrite(data + offset, 1, lineSize, stderr);
+        }
+        offset += lineSize;
+    }
+}
+
+//----------------------------------------------------------------//
+//                 Кольцо страниц в образе flash                  //
+//----------------------------------------------------------------//
+static int compareHeaders(const void *left, const void *right)
+{
+    uint32_t leftSequence = ((const HistoryPageHeader *)left)->firstSequence;
+    uint32_t rightSequence = ((const HistoryPageHeader *)right)->firstSequence;
+    return (leftSequence > rightSequence) - (leftSequence < rightSequence);
+}
+
+static void decodeFlash(const uint8_t *image, const size_t size)
+{
+    size_t base = HISTORY_ADDRESS - FLASH_BASE_ADDRESS;
+    if (size < base + HISTORY_PAGE_COUNT * HISTORY_PAGE_SIZE)
+    {
+        fprintf(stderr, "history_decode: image is smaller than the history region\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Заголовки действующих страниц с номером страницы в reserved
+    HistoryPageHeader headers[HISTORY_PAGE_COUNT];
+    uint32_t pages = 0;
+    for (uint32_t page = 0; page < HISTORY_PAGE_COUNT; page++)
+    {
+        HistoryPageHeader header;
+        memcpy(&header, image + base + page * HISTORY_PAGE_SIZE, sizeof(header));
+        if (header.magic != HISTORY_PAGE_MAGIC || header.count == 0 || header.size > HISTORY_PAGE_DATA_SIZE)
+        {
+            continue;
+        }
+
+        header.reserved = (uint8_t)page;
+        headers[pages++] = header;
+    }
+    qsort(headers, pages, sizeof(headers[0]), compareHeaders);
+
+    for (uint32_t i = 0; i < pages; i++)
+    {
+        const uint8_t *data = image + base + headers[i].reserved * HISTORY_PAGE_SIZE + sizeof(HistoryPageHeader);
+        if (crc16((const char *)data, headers[i].size) != headers[i].crc ||
+            decodeSamples(data, headers[i].size, headers[i].count, headers[i].firstSequence, headers[i].sensor,
+                          headers[i].timeHigh) == false)
+        {
+            statistics.errors++;
+            fprintf(stderr, "history_decode: bad page %u\n", headers[i].reserved);
+            continue;
+        }
+
+        statistics.framedBytes += sizeof(HistoryPageHeader) + headers[i].size;
+        statistics.units++;
+    }
+}
+
+//----------------------------------------------------------------//
+//                   Разбор параметров и запуск                   //
+//----------------------------------------------------------------//
+static void parseDecodeOptions(int argc, char **argv)
+{
+    static const struct option options[] =
+    {
+        { "flash", required_argument, 0, 'f' },
+        { "text", no_argument, 0, 't' },
+        { "stats", no_argument, 0, 's' },
+        { "help", no_argument, 0, 'h' },
+        { 0, 0, 0, 0 }
+    };
+
+    int option = 0;
+    while ((option = getopt_long(argc, argv, "h", options, 0)) != -1)
+    {
+        switch (option)
+        {
+            case 'f': decodeOptions.flash = optarg; break;
+            case 't': decodeOptions.isText = true; break;
+            case 's': decodeOptions.isStats = true; break;
+            default:
+                fprintf(stderr,
+                        "usage: %s [--text] [--stats] [CAPTURE]\n"
+                        "       %s --flash IMAGE [--stats]\n"
+                        "  CAPTURE is a CDC stream with \"history bin\" frames (stdin by default),\n"
+                        "  IMAGE a 128 KB flash dump; CSV seq,ms,sensor,mC on stdout\n",
+                        argv[0], argv[0]);
+                exit(option == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+
+    decodeOptions.input = optind < argc ? argv[optind] : 0;
+}
+
+static void printStatistics(void)
+{
+    double samples = statistics.samples != 0 ? (double)statistics.samples : 1;
+    fprintf(stderr,
+            "history_decode: samples=%" PRIu64 " %s=%" PRIu64 " errors=%" PRIu64 "\n"
+            "  B/sample: codec=%.2f with headers=%.2f record=8 text=%.2f\n"
+            "  ratio: vs record x%.2f vs text x%.2f\n",
+            statistics.samples, decodeOptions.flash != 0 ? "pages" : "frames", statistics.units,
+            statistics.errors, statistics.encodedBytes / samples, statistics.framedBytes / samples,
+            statistics.textBytes / samples,
+            statistics.framedBytes != 0 ? 8.0 * samples / statistics.framedBytes : 0,
+            statistics.framedBytes != 0 ? statistics.textBytes / (double)statistics.framedBytes : 0);
+}
+
+int main(int argc, char **argv)
+{
+    parseDecodeOptions(argc, argv);
+
+    size_t size = 0;
+    uint8_t *data = readInput(decodeOptions.flash != 0 ? decodeOptions.flash : decodeOptions.input, &size);
+    if (decodeOptions.flash != 0)
+    {
+        decodeFlash(data, size);
+    }
+    else
+    {
+        decodeStream(data, size);
+    }
+    free(data);
+
+    if (decodeOptions.isStats == true)
+    {
+        printStatistics();
+    }
+    return statistics.errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
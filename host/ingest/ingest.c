@@ -0,0 +1,646 @@
+#define _GNU_SOURCE
+
+#include "history.h"
+#include "sample_codec.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+//----------------------------------------------------------------//
+//          Сбор телеметрии с нескольких плат через CDC           //
+//----------------------------------------------------------------//
+// Открывает до INGEST_MAX_BOARDS устройств /dev/ttyACM* (или
+// псевдотерминалов firmware_sim) без блокировки и ждёт данных через
+// epoll. Строки отсчётов идут по порту телеметрии платы, кадры
+// журнала - по управляющему (src/main/usb.h); порты задаются
+// отдельными путями. Строки "'<имя>': T = <град>.<доля> *C[ sof=...][ t=<мс>]"
+// и кадры "history bin" (src/main/history.h) разбираются прямо в
+// буфере чтения порта: без копирования строк, выделения памяти и
+// sscanf; переносится только незаконченный хвост. Момент приёма - одно
+// чтение CLOCK_REALTIME на read().
+//
+// Отсчёты пишутся в CSV "host_us,board,source,name,mC,device_ms,seq"
+// (stdout по умолчанию) и, с --ring, в кольцо записей в файле,
+// отображённом в память: читатель делает mmap того же файла и
+// сверяет счётчик written (см. IngestRingHeader).
+//
+// --bench-boards N запускает N процессов-писателей, которые выдают
+// в каналы по --bench-lines строк без пауз; в stderr выводится число
+// строк в секунду и на секунду процессорного времени сборщика.
+
+#define INGEST_MAX_BOARDS  64
+#define INGEST_BUFFER_SIZE 16384
+#define INGEST_NAME_SIZE   32
+#define INGEST_RING_MAGIC  0x52474E49UL   // "INGR"
+
+typedef struct IngestOptions
+{
+    const char *ring;
+    uint32_t records;      // записей в кольце
+    const char *csv;       // "-" - stdout, 0 - без CSV
+    bool isCsvSet;
+    uint32_t duration;     // с, 0 - до SIGINT или закрытия всех плат
+    uint32_t benchBoards;
+    uint32_t benchLines;
+} IngestOptions;
+
+static IngestOptions ingestOptions = { 0, 65536, "-", false, 0, 0, 1000000 };
+
+//----------------------------------------------------------------//
+//                     Кольцо записей в файле                     //
+//----------------------------------------------------------------//
+// Файл: заголовок, затем capacity записей. Запись номер n лежит в
+// ячейке n % capacity; written увеличивается после записи ячейки
+// (release). Читатель копирует ячейку и перечитывает written: если
+// сборщик ушёл вперёд больше чем на capacity - n, запись затёрта
+typedef struct IngestRingHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;
+    uint32_t capacity;
+    uint32_t reserved;
+    uint64_t written;      // записей с момента запуска сборщика
+} IngestRingHeader;
+
+typedef struct IngestRecord
+{
+    uint64_t hostTime;     // мкс CLOCK_REALTIME при приёме
+    uint32_t deviceTime;   // младшие 32 бита мс Unix кадра журнала, 0 - строка
+    uint32_t sequence;     // номер отсчёта журнала или строки платы
+    int32_t millidegrees;
+    uint16_t board;
+    uint8_t source;        // INGEST_SOURCE_*
+    uint8_t sensor;        // датчик кадра журнала
+    char name[INGEST_NAME_SIZE];
+} IngestRecord;
+
+enum
+{
+    INGEST_SOURCE_LINE = 0,
+    INGEST_SOURCE_HISTORY = 1
+};
+
+typedef struct IngestBoard
+{
+    const char *m_path;
+    int m_fd;
+    bool m_isOpen;
+    uint8_t m_buffer[INGEST_BUFFER_SIZE];
+    uint32_t m_size;
+
+    uint64_t m_bytes;
+    uint64_t m_lines;      // строки с температурой
+    uint64_t m_other;      // прочие строки (ответы на команды)
+    uint64_t m_frames;
+    uint64_t m_samples;    // отсчёты из кадров журнала
+    uint64_t m_errors;     // повреждённые кадры и переполнения буфера
+} IngestBoard;
+
+static IngestBoard ingestBoards[INGEST_MAX_BOARDS];
+static uint32_t ingestBoardCount = 0;
+static uint32_t ingestOpenCount = 0;
+static IngestRingHeader *ingestRing = 0;
+static IngestRecord *ingestRecords = 0;
+static FILE *ingestCsv = 0;
+static volatile sig_atomic_t isIngestStopped = 0;
+
+static uint64_t getIngestTime(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+}
+
+static void stopIngest(int signalNumber)
+{
+    (void)signalNumber;
+    isIngestStopped = 1;
+}
+
+static void openIngestRing(const char *path, const uint32_t capacity)
+{
+    size_t size = sizeof(IngestRingHeader) + (size_t)capacity * sizeof(IngestRecord);
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0 || ftruncate(fd, (off_t)size) != 0)
+    {
+        fprintf(stderr, "ingest: %s: %s\n", path, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    void *memory = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED)
+    {
+        fprintf(stderr, "ingest: mmap %s: %s\n", path, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    ingestRing = memory;
+    ingestRecords = (IngestRecord *)(ingestRing + 1);
+    ingestRing->magic = INGEST_RING_MAGIC;
+    ingestRing->version = 1;
+    ingestRing->recordSize = sizeof(IngestRecord);
+    ingestRing->capacity = capacity;
+    __atomic_store_n(&ingestRing->written, 0, __ATOMIC_RELEASE);
+}
+
+// Запись сразу в ячейку кольца и строка CSV из тех же полей
+static void addIngestRecord(const IngestBoard *board, const uint8_t source, const uint8_t sensor,
+                            const uint8_t *name, const uint32_t nameSize, const int32_t millidegrees,
+                            const uint32_t deviceTime, const uint32_t sequence, const uint64_t hostTime)
+{
+    uint32_t size = nameSize < INGEST_NAME_SIZE - 1 ? nameSize : INGEST_NAME_SIZE - 1;
+    uint16_t index = (uint16_t)(board - ingestBoards);
+
+    if (ingestRing != 0)
+    {
+        uint64_t written = ingestRing->written;
+        IngestRecord *record = &ingestRecords[written % ingestRing->capacity];
+        record->hostTime = hostTime;
+        record->deviceTime = deviceTime;
+        record->sequence = sequence;
+        record->millidegrees = millidegrees;
+        record->board = index;
+        record->source = source;
+        record->sensor = sensor;
+        memcpy(record->name, name, size);
+        memset(record->name + size, 0, INGEST_NAME_SIZE - size);
+        __atomic_store_n(&ingestRing->written, written + 1, __ATOMIC_RELEASE);
+    }
+
+    if (ingestCsv != 0)
+    {
+        fprintf(ingestCsv, "%" PRIu64 ",%u,%c,%.*s,%" PRIi32 ",%" PRIu32 ",%" PRIu32 "\n",
+                hostTime, index, source == INGEST_SOURCE_LINE ? 't' : 'h', (int)size, (const char *)name,
+                millidegrees, deviceTime, sequence);
+    }
+}
+
+//----------------------------------------------------------------//
+//                 Разбор строк и кадров журнала                  //
+//----------------------------------------------------------------//
+// Прошивка печатает целую часть как (int8_t)(raw >> 4), а долю - как
+// (raw & 0x0F) * 625, поэтому -0,5 °C приходит строкой "-1.5000":
+// значение - целая часть плюс неотрицательная доля
+static bool parseIngestTemperature(const uint8_t *text, const uint8_t *end, int32_t *millidegrees)
+{
+    bool isNegative = text < end && *text == '-';
+    text += isNegative == true ? 1 : 0;
+
+    int32_t integer = 0;
+    const uint8_t *digits = text;
+    while (text < end && *text >= '0' && *text <= '9')
+    {
+        integer = integer * 10 + (*text++ - '0');
+    }
+    if (text == digits || text + 5 > end || *text != '.')
+    {
+        return false;
+    }
+
+    int32_t fraction = 0;
+    for (uint32_t i = 1; i <= 4; i++)
+    {
+        if (text[i] < '0' || text[i] > '9')
+        {
+            return false;
+        }
+        fraction = fraction * 10 + (text[i] - '0');
+    }
+
+    *millidegrees = (isNegative == true ? -integer : integer) * 1000 + fraction / 10;
+    return true;
+}
+
+// Метка " t=<мс>" - младшие 32 бита мс Unix платы; без неё 0
+static uint32_t parseIngestTime(const uint8_t *text, const uint8_t *end)
+{
+    static const char marker[] = " t=";
+
+    const uint8_t *stamp = memmem(text, (size_t)(end - text), marker, sizeof(marker) - 1);
+    uint32_t time = 0;
+    for (text = stamp != 0 ? stamp + sizeof(marker) - 1 : end; text < end && *text >= '0' && *text <= '9'; text++)
+    {
+        time = time * 10 + (uint32_t)(*text - '0');
+    }
+    return time;
+}
+
+static void parseIngestLine(IngestBoard *board, const uint8_t *line, const uint8_t *end, const uint64_t hostTime)
+{
+    static const char marker[] = "': T = ";
+
+    const uint8_t *nameEnd = line < end && *line == '\'' ? memmem(line, (size_t)(end - line), marker, sizeof(marker) - 1) : 0;
+    int32_t millidegrees = 0;
+    if (nameEnd == 0 || parseIngestTemperature(nameEnd + sizeof(marker) - 1, end, &millidegrees) == false)
+    {
+        board->m_other++;
+        return;
+    }
+
+    addIngestRecord(board, INGEST_SOURCE_LINE, 0, line + 1, (uint32_t)(nameEnd - line - 1), millidegrees,
+                    parseIngestTime(nameEnd, end), (uint32_t)board->m_lines, hostTime);
+    board->m_lines++;
+}
+
+// false - кадр повреждён; отсчёты до ошибки уже записаны
+static bool parseIngestFrame(IngestBoard *board, const uint8_t *frame, const uint64_t hostTime)
+{
+    uint32_t payloadSize = frame[1];
+    uint32_t sequence = frame[4] | (frame[5] << 8) | (frame[6] << 16) | ((uint32_t)frame[7] << 24);
+    const uint8_t *data = frame + HISTORY_FRAME_HEADER_SIZE;
+
+    SampleCodec codec;
+    initSampleCodec(&codec, 0);
+
+    uint8_t name[4] = { 0 };
+    uint32_t nameSize = (uint32_t)snprintf((char *)name, sizeof(name), "%u", frame[2]);
+
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < frame[3]; i++)
+    {
+        uint32_t time = 0;
+        int16_t value = 0;
+        uint32_t sampleSize = decodeSample(&codec, data + offset, payloadSize - offset, &time, &value);
+        if (sampleSize == 0)
+        {
+            return false;
+        }
+
+        addIngestRecord(board, INGEST_SOURCE_HISTORY, frame[2], name, nameSize, (int32_t)value * 125 / 2,
+                        time, sequence + i, hostTime);
+        offset += sampleSize;
+        board->m_samples++;
+    }
+
+    board->m_frames++;
+    return offset == payloadSize;
+}
+
+// Разбирает всё законченное в буфере и сдвигает к началу хвост
+static void parseIngestBuffer(IngestBoard *board, const uint64_t hostTime)
+{
+    const uint8_t *data = board->m_buffer;
+    const uint8_t *end = board->m_buffer + board->m_size;
+    while (data < end)
+    {
+        if (*data == HISTORY_FRAME_MARK)
+        {
+            if (end - data < HISTORY_FRAME_HEADER_SIZE || end - data < HISTORY_FRAME_HEADER_SIZE + data[1])
+            {
+                break;
+            }
+
+            if (parseIngestFrame(board, data, hostTime) == false)
+            {
+                board->m_errors++;
+            }
+            data += HISTORY_FRAME_HEADER_SIZE + data[1];
+            continue;
+        }
+
+        const uint8_t *lineEnd = memchr(data, '\n', (size_t)(end - data));
+        if (lineEnd == 0)
+        {
+            break;
+        }
+
+        parseIngestLine(board, data, lineEnd, hostTime);
+        data = lineEnd + 1;
+    }
+
+    board->m_size = (uint32_t)(end - data);
+    if (board->m_size == INGEST_BUFFER_SIZE)
+    {
+        // Строка длиннее буфера: отбрасываем накопленное
+        board->m_errors++;
+        board->m_size = 0;
+    }
+    else if (board->m_size != 0 && data != board->m_buffer)
+    {
+        memmove(board->m_buffer, data, board->m_size);
+    }
+}
+
+//----------------------------------------------------------------//
+//                    Устройства и цикл epoll                     //
+//----------------------------------------------------------------//
+static void openIngestBoard(const char *path, const int epoll)
+{
+    IngestBoard *board = &ingestBoards[ingestBoardCount];
+    board->m_path = path;
+    board->m_fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (board->m_fd < 0)
+    {
+        fprintf(stderr, "ingest: %s: %s\n", path, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    struct termios settings;
+    if (tcgetattr(board->m_fd, &settings) == 0)
+    {
+        cfmakeraw(&settings);
+        tcsetattr(board->m_fd, TCSANOW, &settings);
+    }
+
+    struct epoll_event event = { .events = EPOLLIN, .data.u32 = ingestBoardCount };
+    epoll_ctl(epoll, EPOLL_CTL_ADD, board->m_fd, &event);
+    board->m_isOpen = true;
+    ingestBoardCount++;
+    ingestOpenCount++;
+}
+
+static void closeIngestBoard(IngestBoard *board)
+{
+    close(board->m_fd);
+    board->m_isOpen = false;
+    ingestOpenCount--;
+}
+
+// Один read() на событие: при потоке с многих плат очередь epoll
+// обходит их по кругу, и ни одна не задерживает остальные
+static void readIngestBoard(IngestBoard *board)
+{
+    ssize_t received = read(board->m_fd, board->m_buffer + board->m_size, INGEST_BUFFER_SIZE - board->m_size);
+    if (received <= 0)
+    {
+        if (received == 0 || (errno != EAGAIN && errno != EINTR))
+        {
+            // Плата отключена (EIO у tty) или писатель замера завершился
+            closeIngestBoard(board);
+        }
+        return;
+    }
+
+    board->m_size += (uint32_t)received;
+    board->m_bytes += (uint64_t)received;
+    parseIngestBuffer(board, getIngestTime());
+}
+
+//----------------------------------------------------------------//
+//                         Замер скорости                         //
+//----------------------------------------------------------------//
+// Писатель: блок строк телеметрии с кадром журнала на каждые 64 строки
+static void runIngestWriter(const int fd, const uint32_t board, const uint32_t lines)
+{
+    static uint8_t block[64 * 64 + HISTORY_FRAME_SIZE];
+    uint32_t size = 0;
+    for (uint32_t i = 0; i < 64; i++)
+    {
+        int16_t raw = (int16_t)(i * 7 - 200);
+        size += (uint32_t)snprintf((char *)block + size, sizeof(block) - size, "'board%u_sensor%u': T = %i.%04i *C sof=%u+%u t=%u\n",
+                                   board, i % 4, raw >> 4, (raw & 0x0F) * 10000 / 16, i * 31 % 2048, i * 13 % 1000, i * 750);
+    }
+
+    uint8_t *frame = block + size;
+    SampleCodec codec;
+    initSampleCodec(&codec, 0);
+    uint32_t payloadSize = 0;
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        payloadSize += encodeSample(&codec, 1000 + i * 750, (int16_t)(350 + i), frame + HISTORY_FRAME_HEADER_SIZE + payloadSize);
+    }
+    frame[0] = HISTORY_FRAME_MARK;
+    frame[1] = (uint8_t)payloadSize;
+    frame[2] = 0;
+    frame[3] = 16;
+    memset(frame + 4, 0, 4);
+    size += HISTORY_FRAME_HEADER_SIZE + payloadSize;
+
+    for (uint32_t written = 0; written < lines; written += 64)
+    {
+        for (uint32_t offset = 0; offset < size; )
+        {
+            ssize_t count = write(fd, block + offset, size - offset);
+            if (count <= 0)
+            {
+                _exit(EXIT_FAILURE);
+            }
+            offset += (uint32_t)count;
+        }
+    }
+    _exit(EXIT_SUCCESS);
+}
+
+static void startIngestBench(const int epoll)
+{
+    static char paths[INGEST_MAX_BOARDS][24];
+    for (uint32_t i = 0; i < ingestOptions.benchBoards; i++)
+    {
+        int pipes[2];
+        if (pipe(pipes) != 0)
+        {
+            perror("ingest: pipe");
+            exit(EXIT_FAILURE);
+        }
+
+        fcntl(pipes[1], F_SETPIPE_SZ, 1 << 20);
+        if (fork() == 0)
+        {
+            close(pipes[0]);
+            runIngestWriter(pipes[1], i, ingestOptions.benchLines);
+        }
+        close(pipes[1]);
+
+        // Канал открыт заранее: путь только для отчёта
+        snprintf(paths[i], sizeof(paths[i]), "bench:%u", i);
+        fcntl(pipes[0], F_SETFL, O_NONBLOCK);
+        IngestBoard *board = &ingestBoards[ingestBoardCount];
+        board->m_path = paths[i];
+        board->m_fd = pipes[0];
+        board->m_isOpen = true;
+
+        struct epoll_event event = { .events = EPOLLIN, .data.u32 = ingestBoardCount };
+        epoll_ctl(epoll, EPOLL_CTL_ADD, board->m_fd, &event);
+        ingestBoardCount++;
+        ingestOpenCount++;
+    }
+}
+
+//----------------------------------------------------------------//
+//                      Итог сбора в stderr                       //
+//----------------------------------------------------------------//
+static void reportIngest(const uint64_t elapsed)
+{
+    uint64_t lines = 0, samples = 0, bytes = 0;
+    for (uint32_t i = 0; i < ingestBoardCount; i++)
+    {
+        const IngestBoard *board = &ingestBoards[i];
+        fprintf(stderr, "ingest: [%u] %s bytes=%" PRIu64 " lines=%" PRIu64 " other=%" PRIu64 " frames=%" PRIu64
+                " samples=%" PRIu64 " errors=%" PRIu64 "\n", i, board->m_path, board->m_bytes, board->m_lines,
+                board->m_other, board->m_frames, board->m_samples, board->m_errors);
+        lines += board->m_lines;
+        samples += board->m_samples;
+        bytes += board->m_bytes;
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    double cpu = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+    double seconds = elapsed / 1e6;
+    fprintf(stderr, "ingest: %.3f s cpu=%.3f s lines/s=%.0f lines/cpu_s=%.0f samples/s=%.0f MB/s=%.1f\n",
+            seconds, cpu, seconds > 0 ? lines / seconds : 0, cpu > 0 ? lines / cpu : 0,
+            seconds > 0 ? samples / seconds : 0, seconds > 0 ? bytes / seconds / 1e6 : 0);
+}
+
+//----------------------------------------------------------------//
+//                   Разбор параметров и запуск                   //
+//----------------------------------------------------------------//
+static void parseIngestOptions(int argc, char **argv)
+{
+    static const struct option options[] =
+    {
+        { "ring", required_argument, 0, 'r' },
+        { "records", required_argument, 0, 'n' },
+        { "csv", required_argument, 0, 'c' },
+        { "no-csv", no_argument, 0, 'C' },
+        { "duration", required_argument, 0, 'd' },
+        { "bench-boards", required_argument, 0, 'b' },
+        { "bench-lines", required_argument, 0, 'l' },
+        { "help", no_argument, 0, 'h' },
+        { 0, 0, 0, 0 }
+    };
+
+    int option = 0;
+    while ((option = getopt_long(argc, argv, "h", options, 0)) != -1)
+    {
+        switch (option)
+        {
+            case 'r': ingestOptions.ring = optarg; break;
+            case 'n': ingestOptions.records = (uint32_t)atoi(optarg); break;
+            case 'c': ingestOptions.csv = optarg; ingestOptions.isCsvSet = true; break;
+            case 'C': ingestOptions.csv = 0; ingestOptions.isCsvSet = true; break;
+            case 'd': ingestOptions.duration = (uint32_t)atoi(optarg); break;
+            case 'b': ingestOptions.benchBoards = (uint32_t)atoi(optarg); break;
+            case 'l': ingestOptions.benchLines = (uint32_t)atoi(optarg); break;
+            default:
+                fprintf(stderr,
+                        "usage: %s [--ring PATH [--records N]] [--csv PATH | --no-csv] [--duration S] PATH...\n"
+                        "       %s --bench-boards N [--bench-lines N] [--ring PATH] [--csv PATH]\n"
+                        "  PATH is a /dev/ttyACM* port or a pty link of firmware_sim (--telemetry-link for\n"
+                        "  samples, --link for \"history bin\" frames), up to %u ports;\n"
+                        "  CSV host_us,board,source,name,mC,device_ms,seq on stdout by default\n"
+                        "  (the benchmark writes no CSV unless --csv is given)\n",
+                        argv[0], argv[0], INGEST_MAX_BOARDS);
+                exit(option == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+
+    uint32_t boards = ingestOptions.benchBoards != 0 ? ingestOptions.benchBoards : (uint32_t)(argc - optind);
+    if (boards == 0 || boards > INGEST_MAX_BOARDS || (ingestOptions.benchBoards != 0 && optind != argc))
+    {
+        fprintf(stderr, "ingest: 1 to %u devices or --bench-boards are required\n", INGEST_MAX_BOARDS);
+        exit(EXIT_FAILURE);
+    }
+    if (ingestOptions.records == 0)
+    {
+        fprintf(stderr, "ingest: --records must be positive\n");
+        exit(EXIT_FAILURE);
+    }
+    if (ingestOptions.benchBoards != 0 && ingestOptions.isCsvSet == false)
+    {
+        ingestOptions.csv = 0;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    parseIngestOptions(argc, argv);
+
+    signal(SIGINT, stopIngest);
+    signal(SIGTERM, stopIngest);
+
+    if (ingestOptions.ring != 0)
+    {
+        openIngestRing(ingestOptions.ring, ingestOptions.records);
+    }
+    if (ingestOptions.csv != 0)
+    {
+        ingestCsv = strcmp(ingestOptions.csv, "-") == 0 ? stdout : fopen(ingestOptions.csv, "w");
+        if (ingestCsv == 0)
+        {
+            perror(ingestOptions.csv);
+            exit(EXIT_FAILURE);
+        }
+        setvbuf(ingestCsv, 0, _IOFBF, 1 << 16);
+    }
+
+    int epoll = epoll_create1(EPOLL_CLOEXEC);
+    if (ingestOptions.benchBoards != 0)
+    {
+        startIngestBench(epoll);
+    }
+    else
+    {
+        for (int i = optind; i < argc; i++)
+        {
+            openIngestBoard(argv[i], epoll);
+        }
+    }
+
+    struct timespec monotonic;
+    clock_gettime(CLOCK_MONOTONIC, &monotonic);
+    uint64_t start = (uint64_t)monotonic.tv_sec * 1000000 + (uint64_t)monotonic.tv_nsec / 1000;
+    uint64_t now = start;
+
+    struct epoll_event events[INGEST_MAX_BOARDS];
+    while (isIngestStopped == 0 && ingestOpenCount != 0)
+    {
+        if (ingestOptions.duration != 0 && now - start >= (uint64_t)ingestOptions.duration * 1000000)
+        {
+            break;
+        }
+
+        int count = epoll_wait(epoll, events, INGEST_MAX_BOARDS, 200);
+        for (int i = 0; i < count; i++)
+        {
+            IngestBoard *board = &ingestBoards[events[i].data.u32];
+            if (board->m_isOpen == true)
+            {
+                readIngestBoard(board);
+            }
+        }
+
+        // CSV сбрасывается, когда поток затих, а не на каждой строке
+        if (count <= 0 && ingestCsv != 0)
+        {
+            fflush(ingestCsv);
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &monotonic);
+        now = (uint64_t)monotonic.tv_sec * 1000000 + (uint64_t)monotonic.tv_nsec / 1000;
+    }
+
+    if (ingestCsv != 0)
+    {
+        fflush(ingestCsv);
+    }
+    reportIngest(now - start);
+    for (uint32_t i = 0; i < ingestBoardCount; i++)
+    {
+        if (ingestBoards[i].m_isOpen == true)
+        {
+            closeIngestBoard(&ingestBoards[i]);
+        }
+    }
+    while (wait(0) > 0)
+    {
+    }
+    return EXIT_SUCCESS;
+}
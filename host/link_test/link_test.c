@@ -0,0 +1,401 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+//----------------------------------------------------------------//
+//        Измеритель пропускной способности и задержки CDC        //
+//----------------------------------------------------------------//
+// Работает с прошивкой в режимах "link stream" и "link ping"
+// (src/main/link_test.h) через /dev/ttyACM* или псевдотерминал
+// симулятора (firmware_sim --link). Итог - одна строка key=value на
+// режим в stdout, ход замера и ошибки - в stderr.
+
+// Строка потока прошивки: 8 hex-цифр, пробел, шаблон (без '\n')
+#define LINK_LINE_SIZE    63
+#define LINK_PATTERN_SIZE 54
+#define LINK_MAX_PINGS    100000
+
+typedef struct LinkOptions
+{
+    const char *device;
+    uint32_t streamTime;   // с, 0 - без потока
+    uint32_t pings;        // 0 - без эхо-запросов
+    uint32_t interval;     // пауза между эхо-запросами, мс
+    uint32_t timeout;      // ожидание ответа, мс
+} LinkOptions;
+
+static LinkOptions linkOptions = { 0, 0, 0, 0, 1000 };
+
+typedef struct LinkReader
+{
+    int m_fd;
+    char m_buffer[4096];
+    uint32_t m_size;
+} LinkReader;
+
+static uint64_t getLinkTime(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+}
+
+//----------------------------------------------------------------//
+//                 Открытие устройства и обмен строками           //
+//----------------------------------------------------------------//
+static int openLinkDevice(const char *path)
+{
+    int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0)
+    {
+        fprintf(stderr, "link_test: %s: %s\n", path, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    struct termios settings;
+    if (tcgetattr(fd, &settings) == 0)
+    {
+        cfmakeraw(&settings);
+        tcsetattr(fd, TCSANOW, &settings);
+        tcflush(fd, TCIOFLUSH);
+    }
+
+    return fd;
+}
+
+static void writeLinkLine(const int fd, const char *line)
+{
+    uint32_t size = strlen(line);
+    uint32_t offset = 0;
+
+    while (offset < size)
+    {
+        ssize_t written = write(fd, line + offset, size - offset);
+        if (written > 0)
+        {
+            offset += (uint32_t)written;
+            continue;
+        }
+        if (written < 0 && errno != EAGAIN && errno != EINTR)
+        {
+            fprintf(stderr, "link_test: write: %s\n", strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+
+        struct pollfd request = { fd, POLLOUT, 0 };
+        poll(&request, 1, 100);
+    }
+}
+
+// Строка без '\n' или -1, если до deadline (мкс CLOCK_MONOTONIC) её нет
+static int readLinkLine(LinkReader *reader, char *line, const uint32_t lineSize, const uint64_t deadline)
+{
+    while (1)
+    {
+        char *end = memchr(reader->m_buffer, '\n', reader->m_size);
+        if (end != 0)
+        {
+            uint32_t size = (uint32_t)(end - reader->m_buffer);
+            uint32_t copySize = size < lineSize - 1 ? size : lineSize - 1;
+            memcpy(line, reader->m_buffer, copySize);
+            line[copySize] = '\0';
+
+            reader->m_size -= size + 1;
+            memmove(reader->m_buffer, end + 1, reader->m_size);
+            return (int)copySize;
+        }
+
+        if (reader->m_size == sizeof(reader->m_buffer))
+        {
+            // Строка длиннее буфера: отбрасываем накопленное
+            reader->m_size = 0;
+        }
+
+        uint64_t now = getLinkTime();
+        if (now >= deadline)
+        {
+            return -1;
+        }
+
+        struct pollfd request = { reader->m_fd, POLLIN, 0 };
+        int timeout = (int)((deadline - now + 999) / 1000);
+        if (poll(&request, 1, timeout) <= 0)
+        {
+            continue;
+        }
+
+        ssize_t received = read(reader->m_fd, reader->m_buffer + reader->m_size,
+                                sizeof(reader->m_buffer) - reader->m_size);
+        if (received > 0)
+        {
+            reader->m_size += (uint32_t)received;
+        }
+        else if (received == 0 || (errno != EAGAIN && errno != EINTR))
+        {
+            fprintf(stderr, "link_test: device closed\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+static bool waitLinkLine(LinkReader *reader, const char *expected, const uint32_t timeout)
+{
+    char line[256];
+    uint64_t deadline = getLinkTime() + (uint64_t)timeout * 1000;
+
+    while (readLinkLine(reader, line, sizeof(line), deadline) >= 0)
+    {
+        if (strncmp(line, expected, strlen(expected)) == 0)
+        {
+            return true;
+        }
+    }
+
+    fprintf(stderr, "link_test: no '%s' from the device\n", expected);
+    return false;
+}
+
+//----------------------------------------------------------------//
+//                  Поток: МБ/с, пропуски, порча                  //
+//----------------------------------------------------------------//
+static bool isLinkPatternValid(const char *line, const uint32_t sequence)
+{
+    for (uint32_t i = 0; i < LINK_PATTERN_SIZE; i++)
+    {
+        if (line[9 + i] != (char)('A' + (sequence + i) % 26))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void measureLinkStream(LinkReader *reader)
+{
+    char command[32];
+    snprintf(command, sizeof(command), "link stream %u\n", linkOptions.streamTime);
+    writeLinkLine(reader->m_fd, command);
+    if (waitLinkLine(reader, "link: stream", linkOptions.timeout) == false)
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    uint64_t lines = 0, gaps = 0, lost = 0, reordered = 0, corrupt = 0, deviceLines = 0;
+    uint64_t firstTime = 0, lastTime = 0;
+    uint32_t expected = 0;
+    bool isDone = false;
+
+    char line[256];
+    uint64_t deadline = getLinkTime() + ((uint64_t)linkOptions.streamTime + 5) * 1000000;
+    int size = 0;
+    while ((size = readLinkLine(reader, line, sizeof(line), deadline)) >= 0)
+    {
+        unsigned long long deviceCount = 0;
+        if (sscanf(line, "link: done n=%llu", &deviceCount) == 1)
+        {
+            deviceLines = deviceCount;
+            isDone = true;
+            break;
+        }
+
+        char *end = 0;
+        uint32_t sequence = (uint32_t)strtoul(line, &end, 16);
+        if (size != LINK_LINE_SIZE || end != line + 8 || line[8] != ' ')
+        {
+            continue;
+        }
+
+        lastTime = getLinkTime();
+        firstTime = lines == 0 ? lastTime : firstTime;
+        lines++;
+
+        if (isLinkPatternValid(line, sequence) == false)
+        {
+            corrupt++;
+        }
+        if (sequence > expected)
+        {
+            gaps++;
+            lost += sequence - expected;
+        }
+        else if (sequence < expected)
+        {
+            reordered++;
+            continue;
+        }
+        expected = sequence + 1;
+    }
+
+    if (isDone == false)
+    {
+        fprintf(stderr, "link_test: stream did not finish in time\n");
+    }
+    else if (deviceLines > expected)
+    {
+        // Хвост потока, не дошедший до хоста
+        gaps++;
+        lost += deviceLines - expected;
+    }
+
+    double seconds = lines > 1 ? (lastTime - firstTime) / 1e6 : 0;
+    double bytes = (double)(lines > 1 ? lines - 1 : 0) * (LINK_LINE_SIZE + 1);
+    printf("stream lines=%llu device_lines=%llu seconds=%.3f mbytes_per_s=%.4f "
+           "gaps=%llu lost=%llu reordered=%llu corrupt=%llu\n",
+           (unsigned long long)lines, (unsigned long long)deviceLines, seconds,
+           seconds > 0 ? bytes / seconds / 1e6 : 0.0, (unsigned long long)gaps,
+           (unsigned long long)lost, (unsigned long long)reordered, (unsigned long long)corrupt);
+}
+
+//----------------------------------------------------------------//
+//              Эхо-запросы: распределение задержки               //
+//----------------------------------------------------------------//
+static int compareLinkTimes(const void *left, const void *right)
+{
+    uint64_t a = *(const uint64_t *)left;
+    uint64_t b = *(const uint64_t *)right;
+    return a < b ? -1 : a > b;
+}
+
+static uint64_t getLinkPercentile(const uint64_t *times, const uint32_t count, const double percentile)
+{
+    uint32_t index = (uint32_t)(percentile / 100.0 * (count - 1) + 0.5);
+    return times[index];
+}
+
+static void measureLinkPing(LinkReader *reader)
+{
+    writeLinkLine(reader->m_fd, "link ping\n");
+    if (waitLinkLine(reader, "link: ping", linkOptions.timeout) == false)
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    uint32_t count = linkOptions.pings < LINK_MAX_PINGS ? linkOptions.pings : LINK_MAX_PINGS;
+    uint64_t *times = calloc(count, sizeof(uint64_t));
+    uint32_t received = 0;
+    uint64_t sum = 0;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        char request[64], expected[32], line[256];
+        uint64_t sendTime = getLinkTime();
+        snprintf(request, sizeof(request), "ping %u %llu\n", i, (unsigned long long)sendTime);
+        snprintf(expected, sizeof(expected), "pong %u ", i);
+        writeLinkLine(reader->m_fd, request);
+
+        uint64_t deadline = sendTime + (uint64_t)linkOptions.timeout * 1000;
+        while (readLinkLine(reader, line, sizeof(line), deadline) >= 0)
+        {
+            if (strncmp(line, expected, strlen(expected)) == 0)
+            {
+                times[received] = getLinkTime() - sendTime;
+                sum += times[received++];
+                break;
+            }
+        }
+
+        if (linkOptions.interval > 0)
+        {
+            usleep(linkOptions.interval * 1000);
+        }
+    }
+
+    writeLinkLine(reader->m_fd, "link off\n");
+
+    if (received == 0)
+    {
+        printf("ping sent=%u received=0 lost=%u\n", count, count);
+        free(times);
+        return;
+    }
+
+    qsort(times, received, sizeof(uint64_t), compareLinkTimes);
+    printf("ping sent=%u received=%u lost=%u rtt_us_min=%llu rtt_us_p50=%llu rtt_us_p90=%llu "
+           "rtt_us_p99=%llu rtt_us_max=%llu rtt_us_mean=%.1f\n",
+           count, received, count - received, (unsigned long long)times[0],
+           (unsigned long long)getLinkPercentile(times, received, 50),
+           (unsigned long long)getLinkPercentile(times, received, 90),
+           (unsigned long long)getLinkPercentile(times, received, 99),
+           (unsigned long long)times[received - 1], (double)sum / received);
+    free(times);
+}
+
+//----------------------------------------------------------------//
+//                    Разбор параметров и запуск                  //
+//----------------------------------------------------------------//
+static void parseLinkOptions(int argc, char **argv)
+{
+    static const struct option options[] =
+    {
+        { "device", required_argument, 0, 'd' },
+        { "stream", required_argument, 0, 's' },
+        { "ping", required_argument, 0, 'p' },
+        { "interval", required_argument, 0, 'i' },
+        { "timeout", required_argument, 0, 't' },
+        { "help", no_argument, 0, 'h' },
+        { 0, 0, 0, 0 }
+    };
+
+    int option = 0;
+    while ((option = getopt_long(argc, argv, "h", options, 0)) != -1)
+    {
+        switch (option)
+        {
+            case 'd': linkOptions.device = optarg; break;
+            case 's': linkOptions.streamTime = (uint32_t)atoi(optarg); break;
+            case 'p': linkOptions.pings = (uint32_t)atoi(optarg); break;
+            case 'i': linkOptions.interval = (uint32_t)atoi(optarg); break;
+            case 't': linkOptions.timeout = (uint32_t)atoi(optarg); break;
+            default:
+                fprintf(stderr,
+                        "usage: %s --device PATH [--stream SECONDS] [--ping COUNT]\n"
+                        "          [--interval MS] [--timeout MS]\n"
+                        "  PATH is /dev/ttyACM* or the pty link of firmware_sim --link\n",
+                        argv[0]);
+                exit(option == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+
+    if (linkOptions.device == 0 || (linkOptions.streamTime == 0 && linkOptions.pings == 0))
+    {
+        fprintf(stderr, "link_test: --device and --stream or --ping are required\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    parseLinkOptions(argc, argv);
+
+    static LinkReader reader;
+    reader.m_fd = openLinkDevice(linkOptions.device);
+    reader.m_size = 0;
+
+    // Прошивка могла остаться в режиме проверки после прерванного запуска
+    writeLinkLine(reader.m_fd, "link off\n");
+    waitLinkLine(&reader, "link: off", linkOptions.timeout);
+
+    if (linkOptions.streamTime > 0)
+    {
+        measureLinkStream(&reader);
+    }
+    if (linkOptions.pings > 0)
+    {
+        measureLinkPing(&reader);
+    }
+
+    close(reader.m_fd);
+    return EXIT_SUCCESS;
+}
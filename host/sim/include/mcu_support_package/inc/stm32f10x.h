@@ -0,0 +1,356 @@
+#pragma once
+
+//----------------------------------------------------------------//
+//    Заменитель stm32f10x.h для сборки прошивки на хосте Linux   //
+//----------------------------------------------------------------//
+// Каталог host/sim/include стоит первым в пути поиска, поэтому
+// src/main/*.c получают этот файл вместо настоящего заголовка.
+// Периферия - обычные структуры в памяти; поведение, зависящее от
+// записи в регистр, реализует симулятор (host/sim/*.c) через функции
+// SPL и точку расширения HOST_SIMULATOR в hal.h.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define __IO volatile
+#define __I  volatile const
+#define __O  volatile
+
+typedef enum { RESET = 0, SET = !RESET } FlagStatus, ITStatus;
+typedef enum { DISABLE = 0, ENABLE = !DISABLE } FunctionalState;
+typedef enum { ERROR = 0, SUCCESS = !ERROR } ErrorStatus;
+
+#define IS_FUNCTIONAL_STATE(STATE) (((STATE) == DISABLE) || ((STATE) == ENABLE))
+#define assert_param(expr) ((void)0)
+
+//----------------------------------------------------------------//
+//                      Номера прерываний                         //
+//----------------------------------------------------------------//
+typedef enum IRQn
+{
+    RTC_IRQn             = 3,
+    EXTI4_IRQn           = 10,
+    TIM2_IRQn            = 28,
+    TIM3_IRQn            = 29,
+    TIM4_IRQn            = 30,
+    USART3_IRQn          = 39,
+    USB_LP_CAN1_RX0_IRQn = 20,
+    USBWakeUp_IRQn       = 42
+} IRQn_Type;
+
+//----------------------------------------------------------------//
+//                     Регистры периферии                         //
+//----------------------------------------------------------------//
+typedef struct
+{
+    __IO uint32_t CRL;
+    __IO uint32_t CRH;
+    __IO uint32_t IDR;
+    __IO uint32_t ODR;
+    __IO uint32_t BSRR;
+    __IO uint32_t BRR;
+    __IO uint32_t LCKR;
+} GPIO_TypeDef;
+
+typedef struct
+{
+    __IO uint16_t SR;
+    __IO uint16_t DR;
+    __IO uint16_t BRR;
+    __IO uint16_t CR1;
+    __IO uint16_t CR2;
+    __IO uint16_t CR3;
+    __IO uint16_t GTPR;
+} USART_TypeDef;
+
+typedef struct
+{
+    __IO uint16_t CR1;
+    __IO uint16_t DIER;
+    __IO uint16_t SR;
+    __IO uint16_t CNT;
+    __IO uint16_t PSC;
+    __IO uint16_t ARR;
+} TIM_TypeDef;
+
+extern GPIO_TypeDef simGpioA;
+extern GPIO_TypeDef simGpioB;
+extern GPIO_TypeDef simGpioC;
+extern USART_TypeDef simUsart1;
+extern USART_TypeDef simUsart3;
+extern TIM_TypeDef simTim2;
+extern TIM_TypeDef simTim3;
+extern TIM_TypeDef simTim4;
+
+#define GPIOA  (&simGpioA)
+#define GPIOB  (&simGpioB)
+#define GPIOC  (&simGpioC)
+#define USART1 (&simUsart1)
+#define USART3 (&simUsart3)
+#define TIM2   (&simTim2)
+#define TIM3   (&simTim3)
+#define TIM4   (&simTim4)
+
+#define USART_SR_TC   ((uint16_t)0x0040)
+#define USART_SR_RXNE ((uint16_t)0x0020)
+#define USART_CR1_UE  ((uint16_t)0x2000)
+#define USART_CR3_HDSEL ((uint16_t)0x0008)
+#define TIM_CR1_CEN   ((uint16_t)0x0001)
+#define TIM_SR_UIF    ((uint16_t)0x0001)
+#define TIM_DIER_UIE  ((uint16_t)0x0001)
+
+//----------------------------------------------------------------//
+//                  Ядро: DWT, CoreDebug, PRIMASK                 //
+//----------------------------------------------------------------//
+typedef struct
+{
+    __IO uint32_t CTRL;
+    __IO uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct
+{
+    __IO uint32_t DEMCR;
+} CoreDebug_Type;
+
+// Чтение DWT продвигает виртуальное время на квант исполнения кода
+DWT_Type *getSimDwt(void);
+extern CoreDebug_Type simCoreDebug;
+
+#define DWT       (getSimDwt())
+#define CoreDebug (&simCoreDebug)
+
+#define DWT_CTRL_CYCCNTENA_Msk      (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk  (1UL << 24)
+
+extern uint32_t SystemCoreClock;
+void SystemInit(void);
+
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t priMask);
+void __disable_irq(void);
+void __enable_irq(void);
+uint32_t __get_MSP(void);
+void __WFI(void);
+
+#define __NOP()   ((void)0)
+#define __BKPT(value) __builtin_trap()
+
+static inline uint8_t __CLZ(uint32_t value)
+{
+    return value == 0 ? 32 : (uint8_t)__builtin_clz(value);
+}
+
+void NVIC_EnableIRQ(IRQn_Type IRQn);
+void NVIC_DisableIRQ(IRQn_Type IRQn);
+void NVIC_SetPendingIRQ(IRQn_Type IRQn);
+
+//----------------------------------------------------------------//
+//                         RCC (SPL)                              //
+//----------------------------------------------------------------//
+typedef struct
+{
+    uint32_t SYSCLK_Frequency;
+    uint32_t HCLK_Frequency;
+    uint32_t PCLK1_Frequency;
+    uint32_t PCLK2_Frequency;
+    uint32_t ADCCLK_Frequency;
+} RCC_ClocksTypeDef;
+
+#define RCC_APB2Periph_AFIO   ((uint32_t)0x00000001)
+#define RCC_APB2Periph_GPIOA  ((uint32_t)0x00000004)
+#define RCC_APB2Periph_GPIOB  ((uint32_t)0x00000008)
+#define RCC_APB2Periph_GPIOC  ((uint32_t)0x00000010)
+#define RCC_APB1Periph_TIM2   ((uint32_t)0x00000001)
+#define RCC_APB1Periph_TIM3   ((uint32_t)0x00000002)
+#define RCC_APB1Periph_TIM4   ((uint32_t)0x00000004)
+#define RCC_APB1Periph_USART3 ((uint32_t)0x00040000)
+#define RCC_APB1Periph_USB    ((uint32_t)0x00800000)
+#define RCC_APB1Periph_BKP    ((uint32_t)0x08000000)
+#define RCC_APB1Periph_PWR    ((uint32_t)0x10000000)
+#define RCC_USBCLKSource_PLLCLK_1Div5 ((uint8_t)0x00)
+#define RCC_LSE_OFF           ((uint8_t)0x00)
+#define RCC_LSE_ON            ((uint8_t)0x01)
+#define RCC_RTCCLKSource_LSE  ((uint32_t)0x00000100)
+#define RCC_RTCCLKSource_LSI  ((uint32_t)0x00000200)
+#define RCC_FLAG_LSERDY       ((uint8_t)0x41)
+#define RCC_FLAG_LSIRDY       ((uint8_t)0x61)
+
+void RCC_APB1PeriphClockCmd(uint32_t RCC_APB1Periph, FunctionalState NewState);
+void RCC_APB2PeriphClockCmd(uint32_t RCC_APB2Periph, FunctionalState NewState);
+void RCC_GetClocksFreq(RCC_ClocksTypeDef *RCC_Clocks);
+void RCC_USBCLKConfig(uint32_t RCC_USBCLKSource);
+void RCC_LSEConfig(uint8_t RCC_LSE);
+void RCC_LSICmd(FunctionalState NewState);
+void RCC_RTCCLKConfig(uint32_t RCC_RTCCLKSource);
+void RCC_RTCCLKCmd(FunctionalState NewState);
+FlagStatus RCC_GetFlagStatus(uint8_t RCC_FLAG);
+
+//----------------------------------------------------------------//
+//                      PWR, BKP, RTC (SPL)                       //
+//----------------------------------------------------------------//
+#define BKP_DR1 ((uint16_t)0x0004)
+#define BKP_DR2 ((uint16_t)0x0008)
+#define BKP_DR3 ((uint16_t)0x000C)
+#define BKP_DR4 ((uint16_t)0x0010)
+
+#define RTC_IT_SEC ((uint16_t)0x0001)
+
+void PWR_BackupAccessCmd(FunctionalState NewState);
+void BKP_DeInit(void);
+void BKP_WriteBackupRegister(uint16_t BKP_DR, uint16_t Data);
+uint16_t BKP_ReadBackupRegister(uint16_t BKP_DR);
+void BKP_SetRTCCalibrationValue(uint8_t CalibrationValue);
+void RTC_ITConfig(uint16_t RTC_IT, FunctionalState NewState);
+uint32_t RTC_GetCounter(void);
+void RTC_SetCounter(uint32_t CounterValue);
+void RTC_SetPrescaler(uint32_t PrescalerValue);
+void RTC_WaitForLastTask(void);
+void RTC_WaitForSynchro(void);
+ITStatus RTC_GetITStatus(uint16_t RTC_IT);
+void RTC_ClearITPendingBit(uint16_t RTC_IT);
+
+//----------------------------------------------------------------//
+//                         GPIO (SPL)                             //
+//----------------------------------------------------------------//
+typedef enum
+{
+    GPIO_Speed_10MHz = 1,
+    GPIO_Speed_2MHz,
+    GPIO_Speed_50MHz
+} GPIOSpeed_TypeDef;
+
+typedef enum
+{
+    GPIO_Mode_AIN = 0x0,
+    GPIO_Mode_IN_FLOATING = 0x04,
+    GPIO_Mode_IPD = 0x28,
+    GPIO_Mode_IPU = 0x48,
+    GPIO_Mode_Out_OD = 0x14,
+    GPIO_Mode_Out_PP = 0x10,
+    GPIO_Mode_AF_OD = 0x1C,
+    GPIO_Mode_AF_PP = 0x18
+} GPIOMode_TypeDef;
+
+typedef struct
+{
+    uint16_t GPIO_Pin;
+    GPIOSpeed_TypeDef GPIO_Speed;
+    GPIOMode_TypeDef GPIO_Mode;
+} GPIO_InitTypeDef;
+
+#define GPIO_Pin_0   ((uint16_t)0x0001)
+#define GPIO_Pin_10  ((uint16_t)0x0400)
+#define GPIO_Pin_11  ((uint16_t)0x0800)
+#define GPIO_Pin_12  ((uint16_t)0x1000)
+
+void GPIO_StructInit(GPIO_InitTypeDef *GPIO_InitStruct);
+void GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_InitStruct);
+void GPIO_SetBits(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void GPIO_ResetBits(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+
+//----------------------------------------------------------------//
+//                         USART (SPL)                            //
+//----------------------------------------------------------------//
+typedef struct
+{
+    uint32_t USART_BaudRate;
+    uint16_t USART_WordLength;
+    uint16_t USART_StopBits;
+    uint16_t USART_Parity;
+    uint16_t USART_Mode;
+    uint16_t USART_HardwareFlowControl;
+} USART_InitTypeDef;
+
+#define USART_FLAG_TC   ((uint16_t)0x0040)
+#define USART_FLAG_RXNE ((uint16_t)0x0020)
+
+void USART_StructInit(USART_InitTypeDef *USART_InitStruct);
+void USART_Init(USART_TypeDef *USARTx, USART_InitTypeDef *USART_InitStruct);
+void USART_Cmd(USART_TypeDef *USARTx, FunctionalState NewState);
+void USART_HalfDuplexCmd(USART_TypeDef *USARTx, FunctionalState NewState);
+void USART_SendData(USART_TypeDef *USARTx, uint16_t Data);
+uint16_t USART_ReceiveData(USART_TypeDef *USARTx);
+FlagStatus USART_GetFlagStatus(USART_TypeDef *USARTx, uint16_t USART_FLAG);
+
+//----------------------------------------------------------------//
+//                         TIM (SPL)                              //
+//----------------------------------------------------------------//
+typedef struct
+{
+    uint16_t TIM_Prescaler;
+    uint16_t TIM_CounterMode;
+    uint16_t TIM_Period;
+    uint16_t TIM_ClockDivision;
+    uint8_t TIM_RepetitionCounter;
+} TIM_TimeBaseInitTypeDef;
+
+#define TIM_CounterMode_Up ((uint16_t)0x0000)
+#define TIM_IT_Update      ((uint16_t)0x0001)
+
+void TIM_TimeBaseStructInit(TIM_TimeBaseInitTypeDef *TIM_TimeBaseInitStruct);
+void TIM_TimeBaseInit(TIM_TypeDef *TIMx, TIM_TimeBaseInitTypeDef *TIM_TimeBaseInitStruct);
+void TIM_Cmd(TIM_TypeDef *TIMx, FunctionalState NewState);
+void TIM_ITConfig(TIM_TypeDef *TIMx, uint16_t TIM_IT, FunctionalState NewState);
+
+//----------------------------------------------------------------//
+//                      NVIC и EXTI (SPL)                         //
+//----------------------------------------------------------------//
+typedef struct
+{
+    uint8_t NVIC_IRQChannel;
+    uint8_t NVIC_IRQChannelPreemptionPriority;
+    uint8_t NVIC_IRQChannelSubPriority;
+    FunctionalState NVIC_IRQChannelCmd;
+} NVIC_InitTypeDef;
+
+#define NVIC_PriorityGroup_2 ((uint32_t)0x500)
+
+void NVIC_PriorityGroupConfig(uint32_t NVIC_PriorityGroup);
+void NVIC_Init(NVIC_InitTypeDef *NVIC_InitStruct);
+
+typedef enum
+{
+    EXTI_Mode_Interrupt = 0x00,
+    EXTI_Mode_Event = 0x04
+} EXTIMode_TypeDef;
+
+typedef enum
+{
+    EXTI_Trigger_Rising = 0x08,
+    EXTI_Trigger_Falling = 0x0C,
+    EXTI_Trigger_Rising_Falling = 0x10
+} EXTITrigger_TypeDef;
+
+typedef struct
+{
+    uint32_t EXTI_Line;
+    EXTIMode_TypeDef EXTI_Mode;
+    EXTITrigger_TypeDef EXTI_Trigger;
+    FunctionalState EXTI_LineCmd;
+} EXTI_InitTypeDef;
+
+#define EXTI_Line18 ((uint32_t)0x40000)
+
+void EXTI_StructInit(EXTI_InitTypeDef *EXTI_InitStruct);
+void EXTI_Init(EXTI_InitTypeDef *EXTI_InitStruct);
+void EXTI_ClearITPendingBit(uint32_t EXTI_Line);
+
+//----------------------------------------------------------------//
+//                          FLASH (SPL)                           //
+//----------------------------------------------------------------//
+#define FLASH_BASE ((uint32_t)0x08000000)
+
+typedef enum
+{
+    FLASH_BUSY = 1,
+    FLASH_ERROR_PG,
+    FLASH_ERROR_WRP,
+    FLASH_COMPLETE,
+    FLASH_TIMEOUT
+} FLASH_Status;
+
+void FLASH_Unlock(void);
+void FLASH_Lock(void);
+FLASH_Status FLASH_ErasePage(uint32_t Page_Address);
+FLASH_Status FLASH_ProgramHalfWord(uint32_t Address, uint16_t Data);
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "mcu_support_package/inc/stm32f10x.h"
+
+//----------------------------------------------------------------//
+//       Конфигурация платы STM32-P103 для симулятора на хосте    //
+//----------------------------------------------------------------//
+#define USB_DISCONNECT                  GPIOC
+#define USB_DISCONNECT_PIN              GPIO_Pin_11
+#define RCC_APB2Periph_GPIO_DISCONNECT  RCC_APB2Periph_GPIOC
+
+// Уникальный идентификатор кристалла: в симуляторе - массив в памяти
+extern uint32_t simUniqueId[3];
+
+#define ID1 ((uintptr_t)&simUniqueId[0])
+#define ID2 ((uintptr_t)&simUniqueId[1])
+#define ID3 ((uintptr_t)&simUniqueId[2])
+
+void configUsbDisconnectPin(void);
+void configUsbClock(void);
+void configUsbInterrupts(void);
+void configUsbCable(FunctionalState NewState);
+void enterLowPowerMode(void);
+void leaveLowPowerMode(void);
+void getSerialNumber(void);
+void setUsbControlLineState(uint8_t interface, uint16_t state);
+void intToUnicode(uint32_t value, uint8_t *pbuf, uint8_t len);
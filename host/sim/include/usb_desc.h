@@ -0,0 +1,9 @@
+#pragma once
+
+#include <stdint.h>
+
+#define VIRTUAL_COM_PORT_DATA_SIZE          64
+#define VIRTUAL_COM_PORT_INT_SIZE           8
+#define VIRTUAL_COM_PORT_SIZ_STRING_SERIAL  26
+
+extern uint8_t Virtual_Com_Port_StringSerial[VIRTUAL_COM_PORT_SIZ_STRING_SERIAL];
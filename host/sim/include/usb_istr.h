@@ -0,0 +1,9 @@
+#pragma once
+
+void USB_Istr(void);
+
+void EP1_IN_Callback(void);
+void EP3_OUT_Callback(void);
+void EP4_IN_Callback(void);
+void EP4_OUT_Callback(void);
+void SOF_Callback(void);
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "mcu_support_package/inc/stm32f10x.h"
+
+#include <stdbool.h>
+
+//----------------------------------------------------------------//
+//    Заменитель библиотеки USB-FS: конечные точки Virtual COM    //
+//----------------------------------------------------------------//
+// Симулятор (host/sim/sim_usb.c) передаёт пакеты EP1 IN и EP4 IN в
+// псевдотерминалы портов и вызывает EP3_OUT_Callback при появлении
+// данных от хоста.
+
+#define EP1_IN   ((uint8_t)0x81)
+#define EP3_OUT  ((uint8_t)0x03)
+#define EP4_OUT  ((uint8_t)0x04)
+#define EP4_IN   ((uint8_t)0x84)
+
+#define ENDP0    ((uint8_t)0)
+#define ENDP1    ((uint8_t)1)
+#define ENDP2    ((uint8_t)2)
+#define ENDP3    ((uint8_t)3)
+#define ENDP4    ((uint8_t)4)
+#define ENDP5    ((uint8_t)5)
+
+// Последний буфер конечных точек в PMA (src/usb/inc/usb_conf.h)
+#define ENDP5_TXADDR (0x1D0)
+
+#define EP_TX_DIS   (0x0000)
+#define EP_TX_STALL (0x0010)
+#define EP_TX_NAK   (0x0020)
+#define EP_TX_VALID (0x0030)
+
+// Номер кадра последнего SOF
+#define FNR_FN     (0x07FF)
+#define _GetFNR()  GetFNR()
+
+// Слова запроса SETUP хранятся как в usb_core.h: Setup0_Process
+// переставляет байты wValue и wIndex (ByteSwap), и младший байт поля
+// оказывается в bb0
+typedef union
+{
+    uint16_t w;
+    struct BW
+    {
+        uint8_t bb1;
+        uint8_t bb0;
+    }
+    bw;
+} uint16_t_uint8_t;
+
+typedef struct _DEVICE_INFO
+{
+    uint8_t USBbmRequestType;
+    uint8_t USBbRequest;
+    uint16_t_uint8_t USBwValues;
+    uint16_t_uint8_t USBwIndexs;
+    uint16_t_uint8_t USBwLengths;
+    uint8_t Current_Configuration;
+    uint8_t Current_Interface;
+    uint8_t Current_AlternateSetting;
+} DEVICE_INFO;
+
+#define USBwValue USBwValues.w
+#define USBwValue0 USBwValues.bw.bb0
+#define USBwValue1 USBwValues.bw.bb1
+#define USBwIndex USBwIndexs.w
+#define USBwIndex0 USBwIndexs.bw.bb0
+#define USBwIndex1 USBwIndexs.bw.bb1
+#define USBwLength USBwLengths.w
+
+#define REQUEST_TYPE        0x60
+#define RECIPIENT           0x1F
+#define CLASS_REQUEST       0x20
+#define INTERFACE_RECIPIENT 0x01
+#define Type_Recipient (pInformation->USBbmRequestType & (REQUEST_TYPE | RECIPIENT))
+
+extern DEVICE_INFO Device_Info;
+extern DEVICE_INFO *pInformation;
+
+uint16_t ByteSwap(uint16_t wSwW);
+
+void USB_Init(void);
+uint32_t USB_SIL_Write(uint8_t bEpAddr, uint8_t *pBufferPointer, uint32_t wBufferSize);
+uint32_t USB_SIL_Read(uint8_t bEpAddr, uint8_t *pBufferPointer);
+void SetEPTxValid(uint8_t bEpNum);
+void SetEPRxValid(uint8_t bEpNum);
+uint16_t GetEPTxStatus(uint8_t bEpNum);
+uint16_t GetFNR(void);
+void UserToPMABufferCopy(uint8_t *pbUsrBuf, uint16_t wPMABufAddr, uint16_t wNBytes);
+void PMAToUserBufferCopy(uint8_t *pbUsrBuf, uint16_t wPMABufAddr, uint16_t wNBytes);
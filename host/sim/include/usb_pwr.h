@@ -0,0 +1,15 @@
+#pragma once
+
+#include "mcu_support_package/inc/stm32f10x.h"
+
+typedef enum _DEVICE_STATE
+{
+    UNCONNECTED,
+    ATTACHED,
+    POWERED,
+    SUSPENDED,
+    ADDRESSED,
+    CONFIGURED
+} DEVICE_STATE;
+
+extern __IO uint32_t bDeviceState;
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "mcu_support_package/inc/stm32f10x.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//----------------------------------------------------------------//
+//                  Виртуальное время симулятора                  //
+//----------------------------------------------------------------//
+// Единица времени - такт ядра (SystemCoreClock = 72 МГц). Время идёт
+// только вперёд: при чтении DWT, передаче кадра USART и в __WFI.
+#define SIM_CORE_CLOCK 72000000ULL
+
+uint64_t getSimTime(void);
+void advanceSimTime(const uint64_t cycles);
+void raiseSimInterrupt(const IRQn_Type irq);
+
+// Инициализация моделей по simOptions; stopSim завершает работу с отчётом
+void startSim(void);
+void stopSim(void);
+
+static inline uint64_t simMicroseconds(const uint64_t microseconds)
+{
+    return microseconds * (SIM_CORE_CLOCK / 1000000);
+}
+
+static inline double simCyclesToMilliseconds(const uint64_t cycles)
+{
+    return (double)cycles * 1000.0 / (double)SIM_CORE_CLOCK;
+}
+
+//----------------------------------------------------------------//
+//                        Параметры запуска                       //
+//----------------------------------------------------------------//
+#define SIM_TELEMETRY_TOGGLES 8
+
+typedef struct SimOptions
+{
+    double duration;          // виртуальные секунды, 0 - без ограничения
+    double speed;             // 1 - реальное время, 0 - максимально быстро
+    bool isStdio;             // stdin/stdout вместо псевдотерминала
+    const char *link;         // символическая ссылка на ведомый pty
+    const char *telemetryLink; // то же для порта телеметрии
+    // Моменты закрытия и повторного открытия порта телеметрии на хосте
+    // (смена DTR), с; до первого порт открыт
+    double telemetryToggles[SIM_TELEMETRY_TOGGLES];
+    uint32_t telemetryToggleCount;
+    bool isAutoConnect;       // нажать кнопку после старта
+    uint32_t sensors;         // количество DS18B20 на шине
+    double temperature;       // базовая температура, *C
+    double amplitude;         // амплитуда синусоиды, *C
+    double period;            // период синусоиды, с
+    double presenceFault;     // вероятность пропуска импульса присутствия
+    double bitFault;          // вероятность искажения бита при чтении
+    double disconnectAt;      // отключение датчиков, с (0 - нет)
+    bool isParasite;          // паразитное питание датчиков
+    const char *flash;        // файл образа flash, 0 - без сохранения
+    double lsePpm;            // ошибка частоты кварца LSE, ppm
+    bool isLseFailed;         // LSE не запускается
+    uint32_t seed;
+} SimOptions;
+
+extern SimOptions simOptions;
+
+//----------------------------------------------------------------//
+//             Обработчики прерываний прошивки (src/main)         //
+//----------------------------------------------------------------//
+void TIM2_IRQHandler(void);
+void TIM3_IRQHandler(void);
+void TIM4_IRQHandler(void);
+void RTC_IRQHandler(void);
+
+//----------------------------------------------------------------//
+//                       Модели периферии                         //
+//----------------------------------------------------------------//
+void initSimOneWire(void);
+void reportSimOneWire(void);
+uint64_t getSimSampleTime(void);
+
+void initSimUsb(void);
+void connectSimUsb(const bool isConnected);
+void runSimUsbEvents(void);
+uint64_t getSimUsbEventTime(void);
+void reportSimUsb(const double seconds);
+void injectSimUsbPacket(const uint8_t *packet, const uint32_t packetSize);
+
+void initSimFlash(void);
+void reportSimFlash(void);
+
+uint64_t getSimRtcEventTime(void);
+void runSimRtcEvents(void);
+void reportSimRtc(void);
+
+double getSimRandom(void);
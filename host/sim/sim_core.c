@@ -0,0 +1,610 @@
+#define _GNU_SOURCE
+
+#include "sim.h"
+
+#include "platform_config.h"
+#include "usb_istr.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//----------------------------------------------------------------//
+//              Регистры периферии и ядра в памяти                //
+//----------------------------------------------------------------//
+GPIO_TypeDef simGpioA = { 0 };
+GPIO_TypeDef simGpioB = { 0 };
+GPIO_TypeDef simGpioC = { 0 };
+USART_TypeDef simUsart1 = { 0 };
+USART_TypeDef simUsart3 = { 0 };
+TIM_TypeDef simTim2 = { 0 };
+TIM_TypeDef simTim3 = { 0 };
+TIM_TypeDef simTim4 = { 0 };
+CoreDebug_Type simCoreDebug = { 0 };
+uint32_t simUniqueId[3] = { 0x0667FF31UL, 0x34385850UL, 0x43156543UL };
+uint32_t SystemCoreClock = SIM_CORE_CLOCK;
+
+static DWT_Type simDwt = { 0 };
+
+SimOptions simOptions =
+{
+    .duration = 0,
+    .speed = 1,
+    .isStdio = false,
+    .link = 0,
+    .telemetryLink = 0,
+    .telemetryToggles = { 0 },
+    .telemetryToggleCount = 0,
+    .isAutoConnect = true,
+    .sensors = 1,
+    .temperature = 22,
+    .amplitude = 2,
+    .period = 60,
+    .presenceFault = 0,
+    .bitFault = 0,
+    .disconnectAt = 0,
+    .isParasite = false,
+    .flash = 0,
+    .lsePpm = 0,
+    .isLseFailed = false,
+    .seed = 1
+};
+
+//----------------------------------------------------------------//
+//       Квант исполнения кода между двумя чтениями DWT, такты    //
+//----------------------------------------------------------------//
+static const uint64_t sim_code_quantum = 200;
+static const uint64_t sim_button_press_time = 200;   // мс
+static const uint64_t sim_button_release_time = 400; // мс
+
+//----------------------------------------------------------------//
+//                     Таймеры общего назначения                  //
+//----------------------------------------------------------------//
+typedef struct SimTimer
+{
+    TIM_TypeDef *m_timer;
+    IRQn_Type m_irq;
+    uint64_t m_nextUpdate;
+} SimTimer;
+
+static SimTimer simTimers[] =
+{
+    { TIM2, TIM2_IRQn, 0 },
+    { TIM3, TIM3_IRQn, 0 },
+    { TIM4, TIM4_IRQn, 0 }
+};
+
+#define SIM_TIMER_COUNT (sizeof(simTimers) / sizeof(simTimers[0]))
+
+//----------------------------------------------------------------//
+//                Состояние ядра: время и прерывания              //
+//----------------------------------------------------------------//
+#define SIM_IRQ_COUNT 64
+
+static uint64_t simTime = 0;
+static uint32_t simPrimask = 0;
+static uint32_t simIsrDepth = 0;
+static bool simIrqEnabled[SIM_IRQ_COUNT] = { false };
+static bool simIrqPending[SIM_IRQ_COUNT] = { false };
+static uint64_t simEndTime = 0;
+static struct timespec simWallStart;
+static volatile sig_atomic_t isSimInterrupted = 0;
+
+void USB_LP_CAN1_RX0_IRQHandler(void);
+// Определён только в образе замеров (src/main/benchmark.c)
+void EXTI4_IRQHandler(void) __attribute__((weak));
+
+static void (*getSimIrqHandler(const IRQn_Type irq))(void)
+{
+    switch (irq)
+    {
+        case TIM2_IRQn:
+            return TIM2_IRQHandler;
+        case TIM3_IRQn:
+            return TIM3_IRQHandler;
+        case TIM4_IRQn:
+            return TIM4_IRQHandler;
+        case RTC_IRQn:
+            return RTC_IRQHandler;
+        case USB_LP_CAN1_RX0_IRQn:
+            return USB_LP_CAN1_RX0_IRQHandler;
+        case EXTI4_IRQn:
+            return EXTI4_IRQHandler;
+        default:
+            return 0;
+    }
+}
+
+//----------------------------------------------------------------//
+//      Обслуживание ожидающих прерываний (без вложенности)       //
+//----------------------------------------------------------------//
+static void serviceSimInterrupts(void)
+{
+    if (simPrimask != 0 || simIsrDepth != 0)
+    {
+        return;
+    }
+
+    for (uint32_t irq = 0; irq < SIM_IRQ_COUNT; irq++)
+    {
+        if (simIrqPending[irq] == false || simIrqEnabled[irq] == false)
+        {
+            continue;
+        }
+
+        void (*handler)(void) = getSimIrqHandler((IRQn_Type)irq);
+        simIrqPending[irq] = false;
+        if (handler != 0)
+        {
+            simIsrDepth++;
+            handler();
+            simIsrDepth--;
+        }
+    }
+}
+
+void raiseSimInterrupt(const IRQn_Type irq)
+{
+    simIrqPending[irq] = true;
+    serviceSimInterrupts();
+}
+
+static uint64_t getSimTimerPeriod(const TIM_TypeDef *timer)
+{
+    return ((uint64_t)timer->PSC + 1) * ((uint64_t)timer->ARR + 1);
+}
+
+static uint64_t getSimButtonTime(const uint64_t milliseconds)
+{
+    return milliseconds * (SIM_CORE_CLOCK / 1000);
+}
+
+//----------------------------------------------------------------//
+//    Ближайшее событие: таймер, кадр USB, RTC, кнопка, конец     //
+//----------------------------------------------------------------//
+static uint64_t getSimNextEvent(void)
+{
+    uint64_t next = UINT64_MAX;
+
+    for (uint32_t i = 0; i < SIM_TIMER_COUNT; i++)
+    {
+        if ((simTimers[i].m_timer->CR1 & TIM_CR1_CEN) != 0 && simTimers[i].m_nextUpdate < next)
+        {
+            next = simTimers[i].m_nextUpdate;
+        }
+    }
+
+    uint64_t usbEvent = getSimUsbEventTime();
+    next = usbEvent < next ? usbEvent : next;
+
+    uint64_t rtcEvent = getSimRtcEventTime();
+    next = rtcEvent < next ? rtcEvent : next;
+
+    if (simOptions.isAutoConnect == true)
+    {
+        uint64_t pressTime = getSimButtonTime(sim_button_press_time);
+        uint64_t releaseTime = getSimButtonTime(sim_button_release_time);
+        if (simTime < pressTime && pressTime < next)
+        {
+            next = pressTime;
+        }
+        else if (simTime < releaseTime && releaseTime < next)
+        {
+            next = releaseTime;
+        }
+    }
+
+    if (simEndTime != 0 && simEndTime < next)
+    {
+        next = simEndTime;
+    }
+
+    return next;
+}
+
+static void runSimEvents(void)
+{
+    for (uint32_t i = 0; i < SIM_TIMER_COUNT; i++)
+    {
+        SimTimer *timer = &simTimers[i];
+        if ((timer->m_timer->CR1 & TIM_CR1_CEN) == 0 || timer->m_nextUpdate > simTime)
+        {
+            continue;
+        }
+
+        timer->m_nextUpdate += getSimTimerPeriod(timer->m_timer);
+        timer->m_timer->SR |= TIM_SR_UIF;
+        if ((timer->m_timer->DIER & TIM_DIER_UIE) != 0)
+        {
+            raiseSimInterrupt(timer->m_irq);
+        }
+    }
+
+    if (getSimUsbEventTime() <= simTime)
+    {
+        runSimUsbEvents();
+    }
+
+    if (getSimRtcEventTime() <= simTime)
+    {
+        runSimRtcEvents();
+    }
+
+    if (simOptions.isAutoConnect == true)
+    {
+        if (simTime >= getSimButtonTime(sim_button_press_time) &&
+            simTime < getSimButtonTime(sim_button_release_time))
+        {
+            simGpioA.IDR |= GPIO_Pin_0;
+        }
+        else
+        {
+            simGpioA.IDR &= ~GPIO_Pin_0;
+        }
+    }
+}
+
+//----------------------------------------------------------------//
+//                Итоговый отчёт и завершение работы              //
+//----------------------------------------------------------------//
+static double getSimWallTime(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - simWallStart.tv_sec) + (double)(now.tv_nsec - simWallStart.tv_nsec) / 1e9;
+}
+
+static void finishSim(void)
+{
+    double seconds = (double)simTime / (double)SIM_CORE_CLOCK;
+    double wallTime = getSimWallTime();
+
+    fprintf(stderr, "sim: virtual %.3f s, wall %.3f s (x%.1f)\n",
+            seconds, wallTime, wallTime > 0 ? seconds / wallTime : 0);
+    reportSimOneWire();
+    reportSimUsb(seconds);
+    reportSimFlash();
+    reportSimRtc();
+    exit(EXIT_SUCCESS);
+}
+
+static void paceSim(void)
+{
+    if (simOptions.speed <= 0)
+    {
+        return;
+    }
+
+    // Виртуальное время не обгоняет реальное больше чем на 2 мс
+    double ahead = (double)simTime / (double)SIM_CORE_CLOCK / simOptions.speed - getSimWallTime();
+    if (ahead > 0.002)
+    {
+        struct timespec delay = { (time_t)ahead, (long)((ahead - (time_t)ahead) * 1e9) };
+        nanosleep(&delay, 0);
+    }
+}
+
+//----------------------------------------------------------------//
+//                   Продвижение виртуального времени             //
+//----------------------------------------------------------------//
+uint64_t getSimTime(void)
+{
+    return simTime;
+}
+
+void advanceSimTime(const uint64_t cycles)
+{
+    uint64_t target = simTime + cycles;
+
+    // Внутри обработчика события откладываются до выхода из него
+    if (simIsrDepth == 0)
+    {
+        for (uint64_t next = getSimNextEvent(); next <= target; next = getSimNextEvent())
+        {
+            simTime = next > simTime ? next : simTime;
+            runSimEvents();
+
+            if (simEndTime != 0 && simTime >= simEndTime)
+            {
+                finishSim();
+            }
+        }
+    }
+
+    simTime = target;
+
+    if (isSimInterrupted != 0)
+    {
+        finishSim();
+    }
+    paceSim();
+}
+
+//----------------------------------------------------------------//
+//                     Ядро Cortex-M3 (CMSIS)                     //
+//----------------------------------------------------------------//
+DWT_Type *getSimDwt(void)
+{
+    advanceSimTime(sim_code_quantum);
+    simDwt.CYCCNT = (uint32_t)simTime;
+    return &simDwt;
+}
+
+void SystemInit(void)
+{
+}
+
+uint32_t __get_PRIMASK(void)
+{
+    return simPrimask;
+}
+
+void __set_PRIMASK(uint32_t priMask)
+{
+    simPrimask = priMask & 1;
+    serviceSimInterrupts();
+}
+
+void __disable_irq(void)
+{
+    simPrimask = 1;
+}
+
+void __enable_irq(void)
+{
+    __set_PRIMASK(0);
+}
+
+uint32_t __get_MSP(void)
+{
+    return 0;
+}
+
+void __WFI(void)
+{
+    uint64_t next = getSimNextEvent();
+    advanceSimTime(next > simTime ? next - simTime : sim_code_quantum);
+}
+
+void NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+    simIrqEnabled[IRQn] = true;
+    serviceSimInterrupts();
+}
+
+void NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+    simIrqEnabled[IRQn] = false;
+}
+
+void NVIC_SetPendingIRQ(IRQn_Type IRQn)
+{
+    raiseSimInterrupt(IRQn);
+}
+
+void NVIC_PriorityGroupConfig(uint32_t NVIC_PriorityGroup)
+{
+    (void)NVIC_PriorityGroup;
+}
+
+void NVIC_Init(NVIC_InitTypeDef *NVIC_InitStruct)
+{
+    simIrqEnabled[NVIC_InitStruct->NVIC_IRQChannel] = NVIC_InitStruct->NVIC_IRQChannelCmd == ENABLE;
+}
+
+//----------------------------------------------------------------//
+//                      RCC, GPIO, EXTI (SPL)                     //
+//----------------------------------------------------------------//
+void RCC_APB1PeriphClockCmd(uint32_t RCC_APB1Periph, FunctionalState NewState)
+{
+    (void)RCC_APB1Periph;
+    (void)NewState;
+}
+
+void RCC_APB2PeriphClockCmd(uint32_t RCC_APB2Periph, FunctionalState NewState)
+{
+    (void)RCC_APB2Periph;
+    (void)NewState;
+}
+
+void RCC_GetClocksFreq(RCC_ClocksTypeDef *RCC_Clocks)
+{
+    RCC_Clocks->SYSCLK_Frequency = SIM_CORE_CLOCK;
+    RCC_Clocks->HCLK_Frequency = SIM_CORE_CLOCK;
+    RCC_Clocks->PCLK1_Frequency = SIM_CORE_CLOCK / 2;
+    RCC_Clocks->PCLK2_Frequency = SIM_CORE_CLOCK;
+    RCC_Clocks->ADCCLK_Frequency = SIM_CORE_CLOCK / 6;
+}
+
+void RCC_USBCLKConfig(uint32_t RCC_USBCLKSource)
+{
+    (void)RCC_USBCLKSource;
+}
+
+void GPIO_StructInit(GPIO_InitTypeDef *GPIO_InitStruct)
+{
+    GPIO_InitStruct->GPIO_Pin = 0xFFFF;
+    GPIO_InitStruct->GPIO_Speed = GPIO_Speed_2MHz;
+    GPIO_InitStruct->GPIO_Mode = GPIO_Mode_IN_FLOATING;
+}
+
+void GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_InitStruct)
+{
+    (void)GPIOx;
+    (void)GPIO_InitStruct;
+}
+
+void GPIO_SetBits(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+    GPIOx->ODR |= GPIO_Pin;
+
+    if (GPIOx == USB_DISCONNECT && (GPIO_Pin & USB_DISCONNECT_PIN) != 0)
+    {
+        connectSimUsb(false);
+    }
+}
+
+void GPIO_ResetBits(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+    GPIOx->ODR &= ~(uint32_t)GPIO_Pin;
+
+    // Подтяжка D+ включается низким уровнем на USB_DISCONNECT
+    if (GPIOx == USB_DISCONNECT && (GPIO_Pin & USB_DISCONNECT_PIN) != 0)
+    {
+        connectSimUsb(true);
+    }
+}
+
+void EXTI_StructInit(EXTI_InitTypeDef *EXTI_InitStruct)
+{
+    memset(EXTI_InitStruct, 0, sizeof(EXTI_InitTypeDef));
+}
+
+void EXTI_Init(EXTI_InitTypeDef *EXTI_InitStruct)
+{
+    (void)EXTI_InitStruct;
+}
+
+void EXTI_ClearITPendingBit(uint32_t EXTI_Line)
+{
+    (void)EXTI_Line;
+}
+
+//----------------------------------------------------------------//
+//                          TIM (SPL)                             //
+//----------------------------------------------------------------//
+void TIM_TimeBaseStructInit(TIM_TimeBaseInitTypeDef *TIM_TimeBaseInitStruct)
+{
+    memset(TIM_TimeBaseInitStruct, 0, sizeof(TIM_TimeBaseInitTypeDef));
+    TIM_TimeBaseInitStruct->TIM_Period = 0xFFFF;
+}
+
+void TIM_TimeBaseInit(TIM_TypeDef *TIMx, TIM_TimeBaseInitTypeDef *TIM_TimeBaseInitStruct)
+{
+    TIMx->PSC = TIM_TimeBaseInitStruct->TIM_Prescaler;
+    TIMx->ARR = TIM_TimeBaseInitStruct->TIM_Period;
+}
+
+void TIM_Cmd(TIM_TypeDef *TIMx, FunctionalState NewState)
+{
+    for (uint32_t i = 0; i < SIM_TIMER_COUNT; i++)
+    {
+        if (simTimers[i].m_timer != TIMx)
+        {
+            continue;
+        }
+
+        if (NewState == ENABLE && (TIMx->CR1 & TIM_CR1_CEN) == 0)
+        {
+            simTimers[i].m_nextUpdate = simTime + getSimTimerPeriod(TIMx);
+        }
+    }
+
+    if (NewState == ENABLE)
+    {
+        TIMx->CR1 |= TIM_CR1_CEN;
+    }
+    else
+    {
+        TIMx->CR1 &= ~TIM_CR1_CEN;
+    }
+}
+
+void TIM_ITConfig(TIM_TypeDef *TIMx, uint16_t TIM_IT, FunctionalState NewState)
+{
+    if (NewState == ENABLE)
+    {
+        TIMx->DIER |= TIM_IT;
+    }
+    else
+    {
+        TIMx->DIER &= ~TIM_IT;
+    }
+}
+
+//----------------------------------------------------------------//
+//                         USART (SPL)                            //
+//----------------------------------------------------------------//
+void USART_StructInit(USART_InitTypeDef *USART_InitStruct)
+{
+    memset(USART_InitStruct, 0, sizeof(USART_InitTypeDef));
+    USART_InitStruct->USART_BaudRate = 9600;
+}
+
+void USART_Init(USART_TypeDef *USARTx, USART_InitTypeDef *USART_InitStruct)
+{
+    uint32_t apbClock = USARTx == USART1 ? SIM_CORE_CLOCK : SIM_CORE_CLOCK / 2;
+    uint32_t integerDivider = (25 * apbClock) / (4 * USART_InitStruct->USART_BaudRate);
+    uint32_t mantissa = integerDivider / 100;
+    uint32_t fraction = ((integerDivider - 100 * mantissa) * 16 + 50) / 100;
+
+    USARTx->BRR = (uint16_t)((mantissa << 4) | (fraction & 0x0F));
+    USARTx->SR = USART_SR_TC;
+}
+
+void USART_Cmd(USART_TypeDef *USARTx, FunctionalState NewState)
+{
+    if (NewState == ENABLE)
+    {
+        USARTx->CR1 |= USART_CR1_UE;
+    }
+    else
+    {
+        USARTx->CR1 &= ~USART_CR1_UE;
+    }
+}
+
+void USART_HalfDuplexCmd(USART_TypeDef *USARTx, FunctionalState NewState)
+{
+    if (NewState == ENABLE)
+    {
+        USARTx->CR3 |= USART_CR3_HDSEL;
+    }
+    else
+    {
+        USARTx->CR3 &= ~USART_CR3_HDSEL;
+    }
+}
+
+void writeUsartData(USART_TypeDef *usartN, const uint16_t data);
+
+void USART_SendData(USART_TypeDef *USARTx, uint16_t Data)
+{
+    writeUsartData(USARTx, Data);
+}
+
+uint16_t USART_ReceiveData(USART_TypeDef *USARTx)
+{
+    return USARTx->DR & 0x01FF;
+}
+
+FlagStatus USART_GetFlagStatus(USART_TypeDef *USARTx, uint16_t USART_FLAG)
+{
+    return (USARTx->SR & USART_FLAG) != 0 ? SET : RESET;
+}
+
+//----------------------------------------------------------------//
+//                 Запуск и остановка симулятора                  //
+//----------------------------------------------------------------//
+double getSimRandom(void)
+{
+    return (double)rand() / ((double)RAND_MAX + 1.0);
+}
+
+void startSim(void)
+{
+    srand(simOptions.seed);
+    simEndTime = (uint64_t)(simOptions.duration * (double)SIM_CORE_CLOCK);
+    clock_gettime(CLOCK_MONOTONIC, &simWallStart);
+
+    initSimOneWire();
+    initSimUsb();
+    initSimFlash();
+}
+
+void stopSim(void)
+{
+    isSimInterrupted = 1;
+}
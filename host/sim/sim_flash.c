@@ -0,0 +1,126 @@
+#include "sim.h"
+
+#include <stdio.h>
+#include <string.h>
+
+//----------------------------------------------------------------//
+//         Модель встроенной flash STM32F103RB (128 КБ)           //
+//----------------------------------------------------------------//
+// Стирание страницы даёт 0xFFFF, запись полуслова допустима только в
+// стёртую ячейку (или запись нуля), иначе FLASH_ERROR_PG, как у МК.
+// Ядро на время стирания и записи останавливается: время симулятора
+// сдвигается на типовые длительности из datasheet. С --flash образ
+// читается из файла при старте и сохраняется при завершении.
+#define SIM_FLASH_SIZE      (128 * 1024)
+#define SIM_FLASH_PAGE_SIZE 1024
+
+static const uint64_t sim_page_erase_time     = 20000; // мкс
+static const uint64_t sim_halfword_write_time = 52;    // мкс
+
+typedef struct SimFlash
+{
+    uint8_t m_memory[SIM_FLASH_SIZE];
+    bool m_isLocked;
+    uint32_t erases;
+    uint32_t writes;
+} SimFlash;
+
+static SimFlash simFlash = { .m_isLocked = true };
+
+void initSimFlash(void)
+{
+    memset(simFlash.m_memory, 0xFF, sizeof(simFlash.m_memory));
+    if (simOptions.flash == 0)
+    {
+        return;
+    }
+
+    FILE *file = fopen(simOptions.flash, "rb");
+    if (file != 0)
+    {
+        size_t size = fread(simFlash.m_memory, 1, sizeof(simFlash.m_memory), file);
+        fclose(file);
+        fprintf(stderr, "sim: flash image %s (%zu bytes)\n", simOptions.flash, size);
+    }
+}
+
+void reportSimFlash(void)
+{
+    fprintf(stderr, "sim: flash erases=%u writes=%u\n", simFlash.erases, simFlash.writes);
+    if (simOptions.flash == 0)
+    {
+        return;
+    }
+
+    FILE *file = fopen(simOptions.flash, "wb");
+    if (file == 0)
+    {
+        perror("sim: flash image");
+        return;
+    }
+    fwrite(simFlash.m_memory, 1, sizeof(simFlash.m_memory), file);
+    fclose(file);
+}
+
+static bool isSimFlashAddress(const uint32_t address, const uint32_t size)
+{
+    return address >= FLASH_BASE && address - FLASH_BASE + size <= SIM_FLASH_SIZE;
+}
+
+//----------------------------------------------------------------//
+//                  Чтение flash прошивкой (hal.h)                //
+//----------------------------------------------------------------//
+const uint8_t *getFlashPointer(const uint32_t address)
+{
+    return isSimFlashAddress(address, 1) == true ? &simFlash.m_memory[address - FLASH_BASE] : 0;
+}
+
+//----------------------------------------------------------------//
+//                  Стирание и запись (SPL FLASH)                 //
+//----------------------------------------------------------------//
+void FLASH_Unlock(void)
+{
+    simFlash.m_isLocked = false;
+}
+
+void FLASH_Lock(void)
+{
+    simFlash.m_isLocked = true;
+}
+
+FLASH_Status FLASH_ErasePage(uint32_t Page_Address)
+{
+    if (simFlash.m_isLocked == true || isSimFlashAddress(Page_Address, 1) == false)
+    {
+        return FLASH_ERROR_WRP;
+    }
+
+    uint32_t offset = (Page_Address - FLASH_BASE) & ~(uint32_t)(SIM_FLASH_PAGE_SIZE - 1);
+    memset(&simFlash.m_memory[offset], 0xFF, SIM_FLASH_PAGE_SIZE);
+    simFlash.erases++;
+
+    advanceSimTime(simMicroseconds(sim_page_erase_time));
+    return FLASH_COMPLETE;
+}
+
+FLASH_Status FLASH_ProgramHalfWord(uint32_t Address, uint16_t Data)
+{
+    if (simFlash.m_isLocked == true || isSimFlashAddress(Address, 2) == false || (Address & 1) != 0)
+    {
+        return FLASH_ERROR_WRP;
+    }
+
+    uint8_t *cell = &simFlash.m_memory[Address - FLASH_BASE];
+    uint16_t current = (uint16_t)(cell[0] | (cell[1] << 8));
+    advanceSimTime(simMicroseconds(sim_halfword_write_time));
+
+    if (current != 0xFFFF && Data != 0)
+    {
+        return FLASH_ERROR_PG;
+    }
+
+    cell[0] = (uint8_t)Data;
+    cell[1] = (uint8_t)(Data >> 8);
+    simFlash.writes++;
+    return FLASH_COMPLETE;
+}
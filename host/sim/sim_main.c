@@ -0,0 +1,127 @@
+#include "sim.h"
+
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// main() прошивки переименован при сборке main.c (-Dmain=firmwareMain)
+int firmwareMain(void);
+
+//----------------------------------------------------------------//
+//                    Разбор параметров и запуск                  //
+//----------------------------------------------------------------//
+static void onSimSignal(int signalNumber)
+{
+    (void)signalNumber;
+    stopSim();
+}
+
+static void printSimUsage(const char *program)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --duration S        stop after S virtual seconds (default: run forever)\n"
+            "  --speed X           virtual/real time ratio, 0 = as fast as possible (default 1)\n"
+            "  --stdio             CDC data of both ports on stdin/stdout instead of ptys\n"
+            "  --link PATH         symlink PATH to the control port pty slave\n"
+            "  --telemetry-link PATH  symlink PATH to the telemetry port pty slave\n"
+            "  --telemetry-toggle S[,S...]  the host closes and reopens the telemetry port\n"
+            "                      (drops and raises DTR) at S virtual seconds\n"
+            "  --no-autoconnect    do not press the button to attach USB\n"
+            "  --sensors N         DS18B20 devices on the bus (default 1)\n"
+            "  --temperature C     base temperature (default 22)\n"
+            "  --amplitude C       sine amplitude (default 2)\n"
+            "  --period S          sine period (default 60)\n"
+            "  --presence-fault P  probability of a missing presence pulse\n"
+            "  --bit-fault P       probability of a corrupted read bit\n"
+            "  --disconnect-at S   remove all sensors at S virtual seconds\n"
+            "  --parasite          sensors run on parasite power\n"
+            "  --seed N            random seed for fault injection\n"
+            "  --flash PATH        load the flash image from PATH and save it on exit\n"
+            "  --lse-ppm PPM       LSE crystal frequency error (default 0)\n"
+            "  --no-lse            the LSE crystal does not start, RTC runs from LSI\n",
+            program);
+}
+
+// Список моментов через запятую
+static void parseSimToggles(const char *list)
+{
+    simOptions.telemetryToggleCount = 0;
+    while (*list != '\0' && simOptions.telemetryToggleCount < SIM_TELEMETRY_TOGGLES)
+    {
+        char *end = 0;
+        simOptions.telemetryToggles[simOptions.telemetryToggleCount++] = strtod(list, &end);
+        list = *end == ',' ? end + 1 : end + strlen(end);
+    }
+}
+
+static void parseSimOptions(int argc, char **argv)
+{
+    static const struct option options[] =
+    {
+        { "duration", required_argument, 0, 'd' },
+        { "speed", required_argument, 0, 'x' },
+        { "stdio", no_argument, 0, 'i' },
+        { "link", required_argument, 0, 'l' },
+        { "telemetry-link", required_argument, 0, 'T' },
+        { "telemetry-toggle", required_argument, 0, 'g' },
+        { "no-autoconnect", no_argument, 0, 'n' },
+        { "sensors", required_argument, 0, 's' },
+        { "temperature", required_argument, 0, 't' },
+        { "amplitude", required_argument, 0, 'a' },
+        { "period", required_argument, 0, 'p' },
+        { "presence-fault", required_argument, 0, 'P' },
+        { "bit-fault", required_argument, 0, 'B' },
+        { "disconnect-at", required_argument, 0, 'D' },
+        { "parasite", no_argument, 0, 'r' },
+        { "seed", required_argument, 0, 'S' },
+        { "flash", required_argument, 0, 'f' },
+        { "lse-ppm", required_argument, 0, 'L' },
+        { "no-lse", no_argument, 0, 'N' },
+        { "help", no_argument, 0, 'h' },
+        { 0, 0, 0, 0 }
+    };
+
+    int option = 0;
+    while ((option = getopt_long(argc, argv, "h", options, 0)) != -1)
+    {
+        switch (option)
+        {
+            case 'd': simOptions.duration = atof(optarg); break;
+            case 'x': simOptions.speed = atof(optarg); break;
+            case 'i': simOptions.isStdio = true; break;
+            case 'l': simOptions.link = optarg; break;
+            case 'T': simOptions.telemetryLink = optarg; break;
+            case 'g': parseSimToggles(optarg); break;
+            case 'n': simOptions.isAutoConnect = false; break;
+            case 's': simOptions.sensors = (uint32_t)atoi(optarg); break;
+            case 't': simOptions.temperature = atof(optarg); break;
+            case 'a': simOptions.amplitude = atof(optarg); break;
+            case 'p': simOptions.period = atof(optarg); break;
+            case 'P': simOptions.presenceFault = atof(optarg); break;
+            case 'B': simOptions.bitFault = atof(optarg); break;
+            case 'D': simOptions.disconnectAt = atof(optarg); break;
+            case 'r': simOptions.isParasite = true; break;
+            case 'S': simOptions.seed = (uint32_t)atoi(optarg); break;
+            case 'f': simOptions.flash = optarg; break;
+            case 'L': simOptions.lsePpm = atof(optarg); break;
+            case 'N': simOptions.isLseFailed = true; break;
+            default:
+                printSimUsage(argv[0]);
+                exit(option == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    parseSimOptions(argc, argv);
+
+    signal(SIGINT, onSimSignal);
+    signal(SIGTERM, onSimSignal);
+    startSim();
+
+    return firmwareMain();
+}
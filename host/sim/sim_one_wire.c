@@ -0,0 +1,508 @@
+#include "sim.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//----------------------------------------------------------------//
+//         Поведенческая модель DS18B20 на шине USART3/PB10       //
+//----------------------------------------------------------------//
+// Кадр USART в полудуплексе - один временной слот 1-Wire: длительность
+// низкого уровня (старт-бит и младшие нулевые биты) определяет сброс,
+// запись 0 или запись 1/чтение. Эхо кадра - результат монтажного И
+// мастера и всех датчиков, как на реальной шине.
+#define SIM_MAX_SENSORS 8
+
+typedef enum SimSensorState
+{
+    SENSOR_INACTIVE,
+    SENSOR_ROM_COMMAND,
+    SENSOR_READ_ROM,
+    SENSOR_MATCH_ROM,
+    SENSOR_SEARCH_ROM,
+    SENSOR_FUNCTION_COMMAND,
+    SENSOR_WRITE_SCRATCHPAD,
+    SENSOR_READ_SCRATCHPAD,
+    SENSOR_STATUS,
+    SENSOR_READ_POWER
+} SimSensorState;
+
+typedef struct SimSensor
+{
+    uint8_t m_rom[8];
+    uint8_t m_scratchpad[9];
+    uint8_t m_eeprom[3];
+    SimSensorState m_state;
+    uint32_t m_bitIndex;
+    uint32_t m_searchPhase;
+    uint8_t m_shift;
+    uint64_t m_busyUntil;
+    uint64_t m_conversionEnd;
+    uint64_t m_sampleTime;
+    bool m_isConverting;
+    bool m_hasSample;
+} SimSensor;
+
+typedef struct SimBusStatistics
+{
+    uint32_t resets;
+    uint32_t presenceFaults;
+    uint32_t bitFaults;
+    uint32_t slots;
+    uint32_t conversions;
+    uint32_t scratchpadReads;
+    uint32_t scratchpadWrites;
+    uint32_t eepromWrites;
+} SimBusStatistics;
+
+static SimSensor simSensors[SIM_MAX_SENSORS];
+static uint32_t simSensorCount = 0;
+static SimBusStatistics simBus = { 0 };
+static uint64_t simSampleTime = 0;
+
+//----------------------------------------------------------------//
+//               Временные параметры DS18B20, мкс                 //
+//----------------------------------------------------------------//
+static const uint64_t sim_reset_low_time   = 480;
+static const uint64_t sim_write_zero_time  = 15;
+static const uint64_t sim_conversion_time  = 750000;
+static const uint64_t sim_eeprom_copy_time = 10000;
+
+static const uint8_t sim_family_code = 0x28;
+
+//----------------------------------------------------------------//
+//                 CRC8 Dallas (x^8 + x^5 + x^4 + 1)              //
+//----------------------------------------------------------------//
+static uint8_t getSimCrc8(const uint8_t *data, const uint32_t dataSize)
+{
+    uint8_t crc = 0;
+
+    for (uint32_t i = 0; i < dataSize; i++)
+    {
+        crc ^= data[i];
+        for (uint32_t j = 0; j < 8; j++)
+        {
+            crc = (crc & 1) != 0 ? (crc >> 1) ^ 0x8C : crc >> 1;
+        }
+    }
+
+    return crc;
+}
+
+static bool getSimBit(const uint8_t *data, const uint32_t bitIndex)
+{
+    return (data[bitIndex / 8] >> (bitIndex % 8)) & 1;
+}
+
+static bool isSimBusConnected(void)
+{
+    return simOptions.disconnectAt <= 0 ||
+           getSimTime() < (uint64_t)(simOptions.disconnectAt * (double)SIM_CORE_CLOCK);
+}
+
+//----------------------------------------------------------------//
+//                     Модель температуры среды                   //
+//----------------------------------------------------------------//
+static int16_t getSimTemperature(const uint32_t index, const uint64_t time, const uint8_t config)
+{
+    double seconds = (double)time / (double)SIM_CORE_CLOCK;
+    double temperature = simOptions.temperature + 0.5 * index;
+
+    if (simOptions.period > 0)
+    {
+        temperature += simOptions.amplitude * sin(2 * M_PI * seconds / simOptions.period);
+    }
+
+    temperature = temperature < -55 ? -55 : (temperature > 125 ? 125 : temperature);
+    int16_t raw = (int16_t)lround(temperature * 16);
+
+    // При разрешении ниже 12 бит младшие разряды не определены (нули)
+    uint32_t resolution = (config >> 5) & 0x03;
+    raw &= (int16_t)~((1 << (3 - resolution)) - 1);
+    return raw;
+}
+
+static uint64_t getSimConversionTime(const uint8_t config)
+{
+    uint32_t resolution = (config >> 5) & 0x03;
+    return simMicroseconds(sim_conversion_time >> (3 - resolution));
+}
+
+static void updateSimScratchpadCrc(SimSensor *sensor)
+{
+    sensor->m_scratchpad[8] = getSimCrc8(sensor->m_scratchpad, 8);
+}
+
+static void completeSimConversion(const uint32_t index)
+{
+    SimSensor *sensor = &simSensors[index];
+    if (sensor->m_isConverting == false || getSimTime() < sensor->m_conversionEnd)
+    {
+        return;
+    }
+
+    int16_t raw = getSimTemperature(index, sensor->m_conversionEnd, sensor->m_scratchpad[4]);
+    sensor->m_scratchpad[0] = (uint8_t)(raw & 0xFF);
+    sensor->m_scratchpad[1] = (uint8_t)((uint16_t)raw >> 8);
+    updateSimScratchpadCrc(sensor);
+
+    sensor->m_sampleTime = sensor->m_conversionEnd;
+    sensor->m_hasSample = true;
+    sensor->m_isConverting = false;
+}
+
+static bool isSimAlarm(const SimSensor *sensor)
+{
+    int8_t temperature = (int8_t)(((uint16_t)sensor->m_scratchpad[1] << 8 | sensor->m_scratchpad[0]) >> 4);
+    return temperature >= (int8_t)sensor->m_scratchpad[2] || temperature <= (int8_t)sensor->m_scratchpad[3];
+}
+
+//----------------------------------------------------------------//
+//                 Инициализация датчиков на шине                 //
+//----------------------------------------------------------------//
+void initSimOneWire(void)
+{
+    simSensorCount = simOptions.sensors < SIM_MAX_SENSORS ? simOptions.sensors : SIM_MAX_SENSORS;
+
+    for (uint32_t i = 0; i < simSensorCount; i++)
+    {
+        SimSensor *sensor = &simSensors[i];
+        memset(sensor, 0, sizeof(SimSensor));
+
+        uint8_t serial[6] = { (uint8_t)(0x51 + 0x11 * i), 0xA2, 0x6C, 0x05, 0x00, 0x00 };
+        sensor->m_rom[0] = sim_family_code;
+        memcpy(&sensor->m_rom[1], serial, sizeof(serial));
+        sensor->m_rom[7] = getSimCrc8(sensor->m_rom, 7);
+
+        // Состояние после включения питания
+        static const uint8_t power_on[8] = { 0x50, 0x05, 0x4B, 0x46, 0x7F, 0xFF, 0x0C, 0x10 };
+        memcpy(sensor->m_scratchpad, power_on, sizeof(power_on));
+        updateSimScratchpadCrc(sensor);
+        memcpy(sensor->m_eeprom, &sensor->m_scratchpad[2], sizeof(sensor->m_eeprom));
+        sensor->m_state = SENSOR_INACTIVE;
+    }
+
+    // Подтяжка линии: без датчиков шина в высоком уровне
+    simGpioB.IDR |= GPIO_Pin_10;
+}
+
+//----------------------------------------------------------------//
+//      Бит, который датчик выставляет в слоте чтения (-1 - нет)  //
+//----------------------------------------------------------------//
+static int getSimSensorOutput(const SimSensor *sensor)
+{
+    switch (sensor->m_state)
+    {
+        case SENSOR_READ_ROM:
+            return getSimBit(sensor->m_rom, sensor->m_bitIndex);
+        case SENSOR_SEARCH_ROM:
+        {
+            bool bit = getSimBit(sensor->m_rom, sensor->m_bitIndex);
+            return sensor->m_searchPhase == 0 ? bit : (sensor->m_searchPhase == 1 ? !bit : -1);
+        }
+        case SENSOR_READ_SCRATCHPAD:
+            return sensor->m_bitIndex < 72 ? getSimBit(sensor->m_scratchpad, sensor->m_bitIndex) : -1;
+        case SENSOR_STATUS:
+            // С паразитным питанием датчик не может сообщить о занятости
+            if (simOptions.isParasite == true)
+            {
+                return -1;
+            }
+            return getSimTime() < sensor->m_busyUntil ? 0 : 1;
+        case SENSOR_READ_POWER:
+            return simOptions.isParasite == true ? 0 : 1;
+        default:
+            return -1;
+    }
+}
+
+//----------------------------------------------------------------//
+//                 Команды ПЗУ и функциональные команды           //
+//----------------------------------------------------------------//
+static void runSimRomCommand(const uint32_t index, const uint8_t command)
+{
+    SimSensor *sensor = &simSensors[index];
+    sensor->m_bitIndex = 0;
+    sensor->m_searchPhase = 0;
+
+    switch (command)
+    {
+        case 0x33:
+            sensor->m_state = SENSOR_READ_ROM;
+            break;
+        case 0x55:
+            sensor->m_state = SENSOR_MATCH_ROM;
+            break;
+        case 0xCC:
+            sensor->m_state = SENSOR_FUNCTION_COMMAND;
+            break;
+        case 0xF0:
+            sensor->m_state = SENSOR_SEARCH_ROM;
+            break;
+        case 0xEC:
+            sensor->m_state = isSimAlarm(sensor) == true ? SENSOR_SEARCH_ROM : SENSOR_INACTIVE;
+            break;
+        default:
+            sensor->m_state = SENSOR_INACTIVE;
+            break;
+    }
+}
+
+static void runSimFunctionCommand(const uint32_t index, const uint8_t command)
+{
+    SimSensor *sensor = &simSensors[index];
+    sensor->m_bitIndex = 0;
+
+    switch (command)
+    {
+        case 0x44:
+        {
+            completeSimConversion(index);
+            sensor->m_conversionEnd = getSimTime() + getSimConversionTime(sensor->m_scratchpad[4]);
+            sensor->m_busyUntil = sensor->m_conversionEnd;
+            sensor->m_isConverting = true;
+            sensor->m_state = SENSOR_STATUS;
+            simBus.conversions++;
+            break;
+        }
+        case 0x4E:
+        {
+            sensor->m_state = SENSOR_WRITE_SCRATCHPAD;
+            break;
+        }
+        case 0xBE:
+        {
+            completeSimConversion(index);
+            sensor->m_state = SENSOR_READ_SCRATCHPAD;
+            if (sensor->m_hasSample == true)
+            {
+                simSampleTime = sensor->m_sampleTime;
+            }
+            simBus.scratchpadReads++;
+            break;
+        }
+        case 0x48:
+        {
+            memcpy(sensor->m_eeprom, &sensor->m_scratchpad[2], sizeof(sensor->m_eeprom));
+            sensor->m_busyUntil = getSimTime() + simMicroseconds(sim_eeprom_copy_time);
+            sensor->m_state = SENSOR_STATUS;
+            simBus.eepromWrites++;
+            break;
+        }
+        case 0xB8:
+        {
+            memcpy(&sensor->m_scratchpad[2], sensor->m_eeprom, sizeof(sensor->m_eeprom));
+            updateSimScratchpadCrc(sensor);
+            sensor->m_busyUntil = getSimTime();
+            sensor->m_state = SENSOR_STATUS;
+            break;
+        }
+        case 0xB4:
+        {
+            sensor->m_state = SENSOR_READ_POWER;
+            break;
+        }
+        default:
+        {
+            sensor->m_state = SENSOR_INACTIVE;
+            break;
+        }
+    }
+}
+
+//----------------------------------------------------------------//
+//         Обработка датчиком завершённого слота записи/чтения    //
+//----------------------------------------------------------------//
+static void runSimSensorSlot(const uint32_t index, const bool writtenBit)
+{
+    SimSensor *sensor = &simSensors[index];
+
+    switch (sensor->m_state)
+    {
+        case SENSOR_ROM_COMMAND:
+        case SENSOR_FUNCTION_COMMAND:
+        case SENSOR_WRITE_SCRATCHPAD:
+        {
+            sensor->m_shift = (uint8_t)((sensor->m_shift >> 1) | (writtenBit ? 0x80 : 0x00));
+            sensor->m_bitIndex++;
+            if (sensor->m_bitIndex % 8 != 0)
+            {
+                return;
+            }
+
+            if (sensor->m_state == SENSOR_ROM_COMMAND)
+            {
+                runSimRomCommand(index, sensor->m_shift);
+            }
+            else if (sensor->m_state == SENSOR_FUNCTION_COMMAND)
+            {
+                runSimFunctionCommand(index, sensor->m_shift);
+            }
+            else
+            {
+                // TH, TL и регистр конфигурации (биты R1 R0)
+                uint32_t byte = sensor->m_bitIndex / 8 - 1;
+                uint8_t value = byte == 2 ? (uint8_t)((sensor->m_shift & 0x60) | 0x1F) : sensor->m_shift;
+                sensor->m_scratchpad[2 + byte] = value;
+                updateSimScratchpadCrc(sensor);
+                if (byte == 2)
+                {
+                    simBus.scratchpadWrites++;
+                    sensor->m_state = SENSOR_INACTIVE;
+                }
+            }
+            return;
+        }
+        case SENSOR_READ_ROM:
+        case SENSOR_MATCH_ROM:
+        {
+            if (sensor->m_state == SENSOR_MATCH_ROM && writtenBit != getSimBit(sensor->m_rom, sensor->m_bitIndex))
+            {
+                sensor->m_state = SENSOR_INACTIVE;
+                return;
+            }
+            if (++sensor->m_bitIndex == 64)
+            {
+                sensor->m_bitIndex = 0;
+                sensor->m_state = SENSOR_FUNCTION_COMMAND;
+            }
+            return;
+        }
+        case SENSOR_SEARCH_ROM:
+        {
+            if (sensor->m_searchPhase < 2)
+            {
+                sensor->m_searchPhase++;
+                return;
+            }
+
+            // Мастер выбрал ветвь: датчики с другим битом выходят из поиска
+            sensor->m_searchPhase = 0;
+            if (writtenBit != getSimBit(sensor->m_rom, sensor->m_bitIndex))
+            {
+                sensor->m_state = SENSOR_INACTIVE;
+                return;
+            }
+            if (++sensor->m_bitIndex == 64)
+            {
+                sensor->m_bitIndex = 0;
+                sensor->m_state = SENSOR_FUNCTION_COMMAND;
+            }
+            return;
+        }
+        case SENSOR_READ_SCRATCHPAD:
+        {
+            sensor->m_bitIndex++;
+            return;
+        }
+        default:
+        {
+            return;
+        }
+    }
+}
+
+//----------------------------------------------------------------//
+//                  Импульс сброса и присутствия                  //
+//----------------------------------------------------------------//
+static bool resetSimBus(void)
+{
+    simBus.resets++;
+    if (isSimBusConnected() == false || simSensorCount == 0)
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < simSensorCount; i++)
+    {
+        simSensors[i].m_state = SENSOR_ROM_COMMAND;
+        simSensors[i].m_bitIndex = 0;
+        simSensors[i].m_shift = 0;
+    }
+
+    if (getSimRandom() < simOptions.presenceFault)
+    {
+        simBus.presenceFaults++;
+        return false;
+    }
+
+    return true;
+}
+
+//----------------------------------------------------------------//
+//     Передача кадра USART: время кадра и эхо с линии 1-Wire     //
+//----------------------------------------------------------------//
+void writeUsartData(USART_TypeDef *usartN, const uint16_t data)
+{
+    uint8_t frame = (uint8_t)(data & 0xFF);
+    uint64_t apbDivider = usartN == USART1 ? 1 : 2;
+    uint64_t bitCycles = (uint64_t)usartN->BRR * apbDivider;
+
+    // Старт-бит, 8 бит данных, стоп-бит
+    usartN->SR &= ~USART_SR_TC;
+    advanceSimTime(10 * bitCycles);
+
+    uint16_t echo = frame;
+    bool isOneWire = usartN == USART3 && (usartN->CR1 & USART_CR1_UE) != 0 && (usartN->CR3 & USART_CR3_HDSEL) != 0;
+
+    if (isOneWire == true)
+    {
+        uint64_t lowBits = (uint64_t)__builtin_ctz((uint32_t)frame | 0x100) + 1;
+        uint64_t lowTime = lowBits * bitCycles;
+
+        if (lowTime >= simMicroseconds(sim_reset_low_time))
+        {
+            // Импульс присутствия накрывает старшие биты кадра 9600 бод
+            echo = resetSimBus() == true ? (uint16_t)(frame & 0xE0) : frame;
+        }
+        else
+        {
+            bool writtenBit = lowTime < simMicroseconds(sim_write_zero_time);
+            bool busBit = writtenBit;
+            bool isRead = false;
+            simBus.slots++;
+
+            for (uint32_t i = 0; i < simSensorCount && isSimBusConnected() == true; i++)
+            {
+                int output = getSimSensorOutput(&simSensors[i]);
+                isRead = isRead || output >= 0;
+                busBit = busBit && output != 0;
+            }
+
+            if (isRead == true && busBit == true && getSimRandom() < simOptions.bitFault)
+            {
+                simBus.bitFaults++;
+                busBit = false;
+            }
+
+            for (uint32_t i = 0; i < simSensorCount && isSimBusConnected() == true; i++)
+            {
+                runSimSensorSlot(i, writtenBit);
+            }
+
+            // Датчик удерживает линию около 30 мкс: младшие биты эха - нули
+            echo = (writtenBit == true && busBit == false) ? (uint16_t)(frame & 0xF0) : frame;
+        }
+    }
+
+    usartN->DR = echo;
+    usartN->SR |= USART_SR_TC | USART_SR_RXNE;
+}
+
+//----------------------------------------------------------------//
+//       Время окончания измерения последней прочитанной пробы    //
+//----------------------------------------------------------------//
+uint64_t getSimSampleTime(void)
+{
+    return simSampleTime;
+}
+
+void reportSimOneWire(void)
+{
+    fprintf(stderr,
+            "sim: 1-wire resets=%u slots=%u conversions=%u reads=%u writes=%u eeprom=%u "
+            "faults: presence=%u bit=%u\n",
+            simBus.resets, simBus.slots, simBus.conversions, simBus.scratchpadReads,
+            simBus.scratchpadWrites, simBus.eepromWrites, simBus.presenceFaults, simBus.bitFaults);
+}
@@ -0,0 +1,231 @@
+#include "sim.h"
+
+#include <stdio.h>
+#include <string.h>
+
+//----------------------------------------------------------------//
+//            Модель RTC, LSE/LSI и резервного домена             //
+//----------------------------------------------------------------//
+// RTC делит частоту LSE (32768 Гц с ошибкой --lse-ppm) или LSI на
+// PRL + 1 и выдаёт секундные прерывания; калибровка BKP_RTCCR
+// пропускает CAL импульсов из 2^20. С --no-lse кварц не запускается,
+// и прошивка переходит на LSI. Резервный домен после запуска пуст,
+// как после первой подачи VBAT.
+#define SIM_BKP_REGISTERS 10
+
+static const uint64_t sim_lse_startup_time = 300000; // мкс
+static const double sim_lse_frequency = 32768.0;
+static const double sim_lsi_frequency = 40000.0 * 1.02;
+
+typedef struct SimRtc
+{
+    bool m_isLseOn;
+    uint64_t m_lseReadyTime;
+    bool m_isLsiOn;
+    uint32_t m_source;
+    bool m_isEnabled;
+    uint32_t m_counter;
+    uint32_t m_prescaler;
+    uint32_t m_calibration;
+    bool m_isSecondEnabled;
+    bool m_isSecondPending;
+    uint64_t m_nextSecond;
+    uint16_t m_backup[SIM_BKP_REGISTERS];
+    uint32_t m_seconds;
+} SimRtc;
+
+static SimRtc simRtc = { .m_prescaler = 0x7FFF };
+
+static bool isSimLseReady(void)
+{
+    return simRtc.m_isLseOn == true && simOptions.isLseFailed == false && getSimTime() >= simRtc.m_lseReadyTime;
+}
+
+static bool isSimRtcRunning(void)
+{
+    if (simRtc.m_isEnabled == false)
+    {
+        return false;
+    }
+
+    return simRtc.m_source == RCC_RTCCLKSource_LSE ? isSimLseReady() :
+           simRtc.m_source == RCC_RTCCLKSource_LSI ? simRtc.m_isLsiOn : false;
+}
+
+// Длительность секунды RTC в тактах ядра при текущих настройках
+static uint64_t getSimRtcPeriod(void)
+{
+    double frequency = simRtc.m_source == RCC_RTCCLKSource_LSE ?
+                       sim_lse_frequency * (1.0 + simOptions.lsePpm * 1e-6) : sim_lsi_frequency;
+    frequency *= 1.0 - simRtc.m_calibration / 1048576.0;
+
+    return (uint64_t)((double)SIM_CORE_CLOCK * (simRtc.m_prescaler + 1) / frequency + 0.5);
+}
+
+static void startSimRtcSecond(void)
+{
+    if (isSimRtcRunning() == true && simRtc.m_nextSecond <= getSimTime())
+    {
+        simRtc.m_nextSecond = getSimTime() + getSimRtcPeriod();
+    }
+}
+
+uint64_t getSimRtcEventTime(void)
+{
+    if (simRtc.m_isLseOn == true && isSimLseReady() == false && simOptions.isLseFailed == false)
+    {
+        return simRtc.m_lseReadyTime;
+    }
+
+    return isSimRtcRunning() == true ? simRtc.m_nextSecond : UINT64_MAX;
+}
+
+void runSimRtcEvents(void)
+{
+    if (isSimRtcRunning() == false || getSimTime() < simRtc.m_nextSecond)
+    {
+        return;
+    }
+
+    simRtc.m_nextSecond += getSimRtcPeriod();
+    simRtc.m_counter++;
+    simRtc.m_seconds++;
+    simRtc.m_isSecondPending = true;
+    if (simRtc.m_isSecondEnabled == true)
+    {
+        raiseSimInterrupt(RTC_IRQn);
+    }
+}
+
+void reportSimRtc(void)
+{
+    fprintf(stderr, "sim: rtc source=%s seconds=%u counter=%u prl=%u cal=%u lse_ppm=%.1f\n",
+            simRtc.m_source == RCC_RTCCLKSource_LSE ? "lse" : simRtc.m_source == RCC_RTCCLKSource_LSI ? "lsi" : "none",
+            simRtc.m_seconds, simRtc.m_counter, simRtc.m_prescaler, simRtc.m_calibration, simOptions.lsePpm);
+}
+
+//----------------------------------------------------------------//
+//                     RCC: LSE, LSI, RTCCLK                      //
+//----------------------------------------------------------------//
+void RCC_LSEConfig(uint8_t RCC_LSE)
+{
+    if (RCC_LSE == RCC_LSE_ON && simRtc.m_isLseOn == false)
+    {
+        simRtc.m_lseReadyTime = getSimTime() + simMicroseconds(sim_lse_startup_time);
+    }
+    simRtc.m_isLseOn = RCC_LSE == RCC_LSE_ON;
+}
+
+void RCC_LSICmd(FunctionalState NewState)
+{
+    simRtc.m_isLsiOn = NewState == ENABLE;
+}
+
+void RCC_RTCCLKConfig(uint32_t RCC_RTCCLKSource)
+{
+    // RTCSEL записывается один раз после сброса резервного домена
+    if (simRtc.m_source == 0)
+    {
+        simRtc.m_source = RCC_RTCCLKSource;
+    }
+}
+
+void RCC_RTCCLKCmd(FunctionalState NewState)
+{
+    simRtc.m_isEnabled = NewState == ENABLE;
+    startSimRtcSecond();
+}
+
+FlagStatus RCC_GetFlagStatus(uint8_t RCC_FLAG)
+{
+    switch (RCC_FLAG)
+    {
+        case RCC_FLAG_LSERDY:
+            return isSimLseReady() == true ? SET : RESET;
+        case RCC_FLAG_LSIRDY:
+            return simRtc.m_isLsiOn == true ? SET : RESET;
+        default:
+            return RESET;
+    }
+}
+
+//----------------------------------------------------------------//
+//                           PWR и BKP                            //
+//----------------------------------------------------------------//
+void PWR_BackupAccessCmd(FunctionalState NewState)
+{
+    (void)NewState;
+}
+
+void BKP_DeInit(void)
+{
+    memset(simRtc.m_backup, 0, sizeof(simRtc.m_backup));
+    simRtc.m_isLseOn = false;
+    simRtc.m_source = 0;
+    simRtc.m_isEnabled = false;
+    simRtc.m_counter = 0;
+    simRtc.m_prescaler = 0x7FFF;
+    simRtc.m_calibration = 0;
+}
+
+void BKP_WriteBackupRegister(uint16_t BKP_DR, uint16_t Data)
+{
+    simRtc.m_backup[BKP_DR / 4 - 1] = Data;
+}
+
+uint16_t BKP_ReadBackupRegister(uint16_t BKP_DR)
+{
+    return simRtc.m_backup[BKP_DR / 4 - 1];
+}
+
+void BKP_SetRTCCalibrationValue(uint8_t CalibrationValue)
+{
+    simRtc.m_calibration = CalibrationValue & 0x7F;
+}
+
+//----------------------------------------------------------------//
+//                              RTC                               //
+//----------------------------------------------------------------//
+void RTC_ITConfig(uint16_t RTC_IT, FunctionalState NewState)
+{
+    if ((RTC_IT & RTC_IT_SEC) != 0)
+    {
+        simRtc.m_isSecondEnabled = NewState == ENABLE;
+    }
+}
+
+uint32_t RTC_GetCounter(void)
+{
+    return simRtc.m_counter;
+}
+
+void RTC_SetCounter(uint32_t CounterValue)
+{
+    simRtc.m_counter = CounterValue;
+}
+
+void RTC_SetPrescaler(uint32_t PrescalerValue)
+{
+    simRtc.m_prescaler = PrescalerValue & 0xFFFFF;
+}
+
+void RTC_WaitForLastTask(void)
+{
+}
+
+void RTC_WaitForSynchro(void)
+{
+}
+
+ITStatus RTC_GetITStatus(uint16_t RTC_IT)
+{
+    return (RTC_IT & RTC_IT_SEC) != 0 && simRtc.m_isSecondPending == true ? SET : RESET;
+}
+
+void RTC_ClearITPendingBit(uint16_t RTC_IT)
+{
+    if ((RTC_IT & RTC_IT_SEC) != 0)
+    {
+        simRtc.m_isSecondPending = false;
+    }
+}
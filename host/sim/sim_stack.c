@@ -0,0 +1,20 @@
+#include "stack_monitor.h"
+
+#include <string.h>
+
+//----------------------------------------------------------------//
+//   Заглушка монитора стека: на хосте нет областей линкера МК    //
+//----------------------------------------------------------------//
+void paintStack(void)
+{
+}
+
+void getStackUsage(StackUsage *usage)
+{
+    memset(usage, 0, sizeof(StackUsage));
+}
+
+bool isStackHeadroomLow(void)
+{
+    return false;
+}
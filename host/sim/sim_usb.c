@@ -0,0 +1,587 @@
+#define _GNU_SOURCE
+
+#include "sim.h"
+
+#include "platform_config.h"
+#include "usb_lib.h"
+#include "usb_desc.h"
+#include "usb_istr.h"
+#include "usb_pwr.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+//----------------------------------------------------------------//
+//   Модель USB-FS: два порта CDC (EP1 IN, EP3 OUT; EP4 IN), SOF  //
+//----------------------------------------------------------------//
+// Управляющий порт - ведущая сторона псевдотерминала (или
+// stdin/stdout): в неё пишутся данные EP1 IN, из неё раз в кадр
+// читаются данные для EP3 OUT. Данные порта телеметрии EP4 IN идут во
+// второй псевдотерминал (--telemetry-link), а с --stdio - тоже в
+// stdout. Если хост не читает и буфер pty полон, пакет остаётся VALID
+// (NAK), как на реальной шине, и другой порт это не задерживает.
+// Приём EP4 OUT не моделируется: прошивка его отбрасывает.
+// Хост выставляет DTR обоих портов сразу после нумерации, как
+// программы, открывшие порты заранее; --telemetry-toggle закрывает и
+// снова открывает порт телеметрии (SET_CONTROL_LINE_STATE в
+// прерывании USB), хотя pty продолжает принимать данные.
+DEVICE_INFO Device_Info = { 0 };
+DEVICE_INFO *pInformation = &Device_Info;
+__IO uint32_t bDeviceState = UNCONNECTED;
+uint8_t Virtual_Com_Port_StringSerial[VIRTUAL_COM_PORT_SIZ_STRING_SERIAL] = { 0 };
+
+#define SIM_USB_PORTS 2
+
+// Конечная точка IN одного порта
+typedef struct SimUsbIn
+{
+    uint8_t m_endpoint;
+    int m_output;
+    uint8_t m_packet[VIRTUAL_COM_PORT_DATA_SIZE];
+    uint32_t m_size;
+    uint16_t m_status;
+    uint64_t m_time;
+    bool m_isPending;
+    char m_line[128];         // строка для учёта телеметрии
+    uint32_t m_lineSize;
+} SimUsbIn;
+
+typedef struct SimUsb
+{
+    int m_input;
+    bool m_isInputOpened;
+    bool m_isAttached;
+    uint64_t m_enumerationTime;
+    uint64_t m_nextFrame;
+    uint16_t m_frameNumber;
+    SimUsbIn m_in[SIM_USB_PORTS];
+    uint8_t m_rxPacket[VIRTUAL_COM_PORT_DATA_SIZE];
+    uint32_t m_rxSize;
+    bool m_isRxValid;
+    bool m_isFramePending;
+    bool m_isRxPending;
+    bool m_isDtr[SIM_USB_PORTS];  // состояние, известное прошивке
+    bool m_isLineStatePending;
+} SimUsb;
+
+typedef struct SimUsbStatistics
+{
+    uint64_t bytes;
+    uint32_t lines;
+    uint32_t samples;
+    uint32_t naks;
+    uint64_t firstSample;
+    uint64_t lastSample;
+    double latencySum;
+    double latencyMin;
+    double latencyMax;
+} SimUsbStatistics;
+
+static SimUsb simUsb = { .m_in = { { .m_endpoint = ENDP1 }, { .m_endpoint = ENDP4 } } };
+static SimUsbStatistics simUsbStatistics = { 0 };
+// Память пакетов USB (PMA): 512 байт
+static uint8_t simPma[512] = { 0 };
+
+//----------------------------------------------------------------//
+//           Временные параметры шины, микросекунды / такты       //
+//----------------------------------------------------------------//
+static const uint64_t sim_frame_time       = 1000;
+static const uint64_t sim_enumeration_time = 50000;
+// Полная скорость 12 Мбит/с: 6 тактов ядра на бит, ~13 байт служебных
+static const uint64_t sim_bit_cycles       = SIM_CORE_CLOCK / 12000000;
+static const uint64_t sim_packet_overhead  = 13;
+
+// Интерфейсы управления функций CDC (src/usb/src/usb_desc.c)
+static const uint8_t sim_port_interfaces[SIM_USB_PORTS] = { 0, 2 };
+
+static void removeSimLink(void)
+{
+    if (simOptions.link != 0)
+    {
+        unlink(simOptions.link);
+    }
+    if (simOptions.telemetryLink != 0)
+    {
+        unlink(simOptions.telemetryLink);
+    }
+}
+
+static SimUsbIn *getSimUsbIn(const uint8_t endpoint)
+{
+    for (uint32_t i = 0; i < SIM_USB_PORTS; i++)
+    {
+        if (simUsb.m_in[i].m_endpoint == endpoint)
+        {
+            return &simUsb.m_in[i];
+        }
+    }
+    return 0;
+}
+
+//----------------------------------------------------------------//
+//          Псевдотерминал в роли /dev/ttyACM устройства          //
+//----------------------------------------------------------------//
+// Возвращает ведущую сторону; link - символическая ссылка на ведомую
+static int openSimPty(const char *link, const char *title)
+{
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+    {
+        perror("sim: posix_openpt");
+        exit(EXIT_FAILURE);
+    }
+
+    const char *name = ptsname(master);
+
+    // Ведомая сторона остаётся открытой: без читателя данные копятся в pty
+    int slave = open(name, O_RDWR | O_NOCTTY);
+    struct termios settings;
+    if (slave < 0 || tcgetattr(slave, &settings) != 0)
+    {
+        perror("sim: pty slave");
+        exit(EXIT_FAILURE);
+    }
+    cfmakeraw(&settings);
+    tcsetattr(slave, TCSANOW, &settings);
+
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+
+    if (link != 0)
+    {
+        unlink(link);
+        if (symlink(name, link) != 0)
+        {
+            perror("sim: symlink");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    fprintf(stderr, "sim: CDC ACM %s on %s\n", title, link != 0 ? link : name);
+    return master;
+}
+
+void initSimUsb(void)
+{
+    if (simOptions.isStdio == true)
+    {
+        simUsb.m_input = STDIN_FILENO;
+        simUsb.m_in[0].m_output = STDOUT_FILENO;
+        simUsb.m_in[1].m_output = STDOUT_FILENO;
+        fcntl(STDIN_FILENO, F_SETFL, fcntl(STDIN_FILENO, F_GETFL) | O_NONBLOCK);
+    }
+    else
+    {
+        atexit(removeSimLink);
+        simUsb.m_input = openSimPty(simOptions.link, "control");
+        simUsb.m_in[0].m_output = simUsb.m_input;
+        simUsb.m_in[1].m_output = openSimPty(simOptions.telemetryLink, "telemetry");
+    }
+
+    simUsb.m_isInputOpened = true;
+    for (uint32_t i = 0; i < SIM_USB_PORTS; i++)
+    {
+        simUsb.m_in[i].m_status = EP_TX_NAK;
+    }
+    simUsbStatistics.latencyMin = 1e9;
+}
+
+//----------------------------------------------------------------//
+//       Подключение по подтяжке D+ и нумерация хостом            //
+//----------------------------------------------------------------//
+void connectSimUsb(const bool isConnected)
+{
+    simUsb.m_isAttached = isConnected;
+    simUsb.m_enumerationTime = getSimTime() + simMicroseconds(sim_enumeration_time);
+    simUsb.m_isRxValid = false;
+    for (uint32_t i = 0; i < SIM_USB_PORTS; i++)
+    {
+        simUsb.m_in[i].m_status = EP_TX_NAK;
+    }
+
+    // Сброс шины при нумерации снимает DTR (Virtual_Com_Port_Reset)
+    simUsb.m_isLineStatePending = false;
+    for (uint32_t i = 0; i < SIM_USB_PORTS; i++)
+    {
+        simUsb.m_isDtr[i] = false;
+        setUsbControlLineState(sim_port_interfaces[i], 0);
+    }
+
+    if (isConnected == false)
+    {
+        bDeviceState = UNCONNECTED;
+        Device_Info.Current_Configuration = 0;
+    }
+}
+
+//----------------------------------------------------------------//
+//        SET_CONTROL_LINE_STATE через разбор пакета SETUP        //
+//----------------------------------------------------------------//
+#define SIM_SET_CONTROL_LINE_STATE 0x22
+
+uint16_t ByteSwap(uint16_t wSwW)
+{
+    return (uint16_t)((wSwW >> 8) | (wSwW << 8));
+}
+
+// Пакет в порядке байтов шины разбирается как в Setup0_Process
+// (src/usb/src/usb_core.c): слова читаются из PMA и переставляются
+// ByteSwap. Обработчик повторяет Virtual_Com_Port_NoData_Setup
+// (src/usb/src/usb_prop.c) и берёт младшие байты wIndex и wValue
+static void processSimSetup(const uint8_t setup[8])
+{
+    uint16_t words[3];
+    memcpy(words, setup + 2, sizeof(words));
+
+    pInformation->USBbmRequestType = setup[0];
+    pInformation->USBbRequest = setup[1];
+    pInformation->USBwValue = ByteSwap(words[0]);
+    pInformation->USBwIndex = ByteSwap(words[1]);
+    pInformation->USBwLength = words[2];
+
+    if (Type_Recipient == (CLASS_REQUEST | INTERFACE_RECIPIENT) &&
+        pInformation->USBbRequest == SIM_SET_CONTROL_LINE_STATE)
+    {
+        setUsbControlLineState(pInformation->USBwIndex0, pInformation->USBwValue0);
+    }
+}
+
+static void sendSimControlLineState(const uint8_t interface, const uint16_t state)
+{
+    const uint8_t setup[8] =
+    {
+        CLASS_REQUEST | INTERFACE_RECIPIENT, SIM_SET_CONTROL_LINE_STATE,
+        (uint8_t)state, (uint8_t)(state >> 8), interface, 0, 0, 0
+    };
+    processSimSetup(setup);
+}
+
+// Порт телеметрии открыт, если к моменту now он закрывался и
+// открывался чётное число раз
+static bool isSimTelemetryOpened(const uint64_t now)
+{
+    uint32_t toggles = 0;
+    for (uint32_t i = 0; i < simOptions.telemetryToggleCount; i++)
+    {
+        if (now >= (uint64_t)(simOptions.telemetryToggles[i] * (double)SIM_CORE_CLOCK))
+        {
+            toggles++;
+        }
+    }
+    return toggles % 2 == 0;
+}
+
+uint64_t getSimUsbEventTime(void)
+{
+    if (simUsb.m_isAttached == false)
+    {
+        return UINT64_MAX;
+    }
+
+    if (bDeviceState != CONFIGURED && bDeviceState != SUSPENDED)
+    {
+        return simUsb.m_enumerationTime;
+    }
+
+    uint64_t next = simUsb.m_nextFrame;
+    for (uint32_t i = 0; i < SIM_USB_PORTS; i++)
+    {
+        if (simUsb.m_in[i].m_status == EP_TX_VALID && simUsb.m_in[i].m_time < next)
+        {
+            next = simUsb.m_in[i].m_time;
+        }
+    }
+
+    return next;
+}
+
+//----------------------------------------------------------------//
+//    Учёт строк телеметрии: частота проб и задержка до хоста     //
+//----------------------------------------------------------------//
+static void countSimUsbData(SimUsbIn *in, const uint8_t *data, const uint32_t dataSize)
+{
+    simUsbStatistics.bytes += dataSize;
+
+    for (uint32_t i = 0; i < dataSize; i++)
+    {
+        if (data[i] != '\n')
+        {
+            if (in->m_lineSize + 1 < sizeof(in->m_line))
+            {
+                in->m_line[in->m_lineSize++] = (char)data[i];
+            }
+            continue;
+        }
+
+        in->m_line[in->m_lineSize] = '\0';
+        in->m_lineSize = 0;
+        simUsbStatistics.lines++;
+
+        uint64_t sampleTime = getSimSampleTime();
+        if (strstr(in->m_line, ": T = ") == 0 || sampleTime == 0)
+        {
+            continue;
+        }
+
+        double latency = simCyclesToMilliseconds(getSimTime() - sampleTime);
+        simUsbStatistics.latencySum += latency;
+        simUsbStatistics.latencyMin = latency < simUsbStatistics.latencyMin ? latency : simUsbStatistics.latencyMin;
+        simUsbStatistics.latencyMax = latency > simUsbStatistics.latencyMax ? latency : simUsbStatistics.latencyMax;
+
+        if (simUsbStatistics.samples++ == 0)
+        {
+            simUsbStatistics.firstSample = getSimTime();
+        }
+        simUsbStatistics.lastSample = getSimTime();
+    }
+}
+
+//----------------------------------------------------------------//
+//               Кадр USB: SOF, опрос OUT, передача IN            //
+//----------------------------------------------------------------//
+static void pollSimUsbInput(void)
+{
+    if (simUsb.m_isInputOpened == false || simUsb.m_isRxValid == false || simUsb.m_isRxPending == true)
+    {
+        return;
+    }
+
+    ssize_t size = read(simUsb.m_input, simUsb.m_rxPacket, sizeof(simUsb.m_rxPacket));
+    if (size > 0)
+    {
+        simUsb.m_rxSize = (uint32_t)size;
+        simUsb.m_isRxValid = false;
+        simUsb.m_isRxPending = true;
+    }
+    else if (size == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EIO))
+    {
+        simUsb.m_isInputOpened = false;
+    }
+}
+
+static void transmitSimUsbPacket(SimUsbIn *in)
+{
+    ssize_t size = write(in->m_output, in->m_packet, in->m_size);
+    if (size < 0)
+    {
+        // Буфер хоста заполнен: NAK, повтор в следующем кадре
+        simUsbStatistics.naks++;
+        in->m_time = simUsb.m_nextFrame;
+        return;
+    }
+
+    countSimUsbData(in, in->m_packet, (uint32_t)size);
+    if ((uint32_t)size < in->m_size)
+    {
+        memmove(in->m_packet, in->m_packet + size, in->m_size - (uint32_t)size);
+        in->m_size -= (uint32_t)size;
+        in->m_time = simUsb.m_nextFrame;
+        return;
+    }
+
+    in->m_status = EP_TX_NAK;
+    in->m_isPending = true;
+}
+
+void runSimUsbEvents(void)
+{
+    uint64_t now = getSimTime();
+
+    if (bDeviceState != CONFIGURED && bDeviceState != SUSPENDED)
+    {
+        if (simUsb.m_isAttached == true && now >= simUsb.m_enumerationTime)
+        {
+            bDeviceState = CONFIGURED;
+            Device_Info.Current_Configuration = 1;
+            simUsb.m_isRxValid = true;
+            simUsb.m_nextFrame = now + simMicroseconds(sim_frame_time);
+            simUsb.m_frameNumber = (uint16_t)(now / simMicroseconds(sim_frame_time)) & FNR_FN;
+        }
+        return;
+    }
+
+    if (now >= simUsb.m_nextFrame)
+    {
+        simUsb.m_nextFrame += simMicroseconds(sim_frame_time);
+        simUsb.m_frameNumber = (simUsb.m_frameNumber + 1) & FNR_FN;
+        simUsb.m_isFramePending = true;
+        pollSimUsbInput();
+
+        // Запрос SET_CONTROL_LINE_STATE передаётся в начале кадра
+        if (simUsb.m_isDtr[0] == false || simUsb.m_isDtr[1] != isSimTelemetryOpened(now))
+        {
+            simUsb.m_isLineStatePending = true;
+        }
+    }
+
+    bool isTxPending = false;
+    for (uint32_t i = 0; i < SIM_USB_PORTS; i++)
+    {
+        SimUsbIn *in = &simUsb.m_in[i];
+        if (in->m_status == EP_TX_VALID && now >= in->m_time)
+        {
+            transmitSimUsbPacket(in);
+        }
+        isTxPending = isTxPending || in->m_isPending;
+    }
+
+    if (simUsb.m_isFramePending || simUsb.m_isRxPending || isTxPending || simUsb.m_isLineStatePending)
+    {
+        raiseSimInterrupt(USB_LP_CAN1_RX0_IRQn);
+    }
+}
+
+//----------------------------------------------------------------//
+//      Обработчик прерывания USB: порядок флагов как в USB_Istr  //
+//----------------------------------------------------------------//
+void USB_Istr(void)
+{
+    if (simUsb.m_isLineStatePending == true)
+    {
+        simUsb.m_isLineStatePending = false;
+        simUsb.m_isDtr[0] = true;
+        simUsb.m_isDtr[1] = isSimTelemetryOpened(getSimTime());
+        for (uint32_t i = 0; i < SIM_USB_PORTS; i++)
+        {
+            sendSimControlLineState(sim_port_interfaces[i], simUsb.m_isDtr[i] == true ? 0x0003 : 0);
+        }
+    }
+
+    if (simUsb.m_in[0].m_isPending == true)
+    {
+        simUsb.m_in[0].m_isPending = false;
+        EP1_IN_Callback();
+    }
+
+    if (simUsb.m_in[1].m_isPending == true)
+    {
+        simUsb.m_in[1].m_isPending = false;
+        EP4_IN_Callback();
+    }
+
+    if (simUsb.m_isRxPending == true)
+    {
+        simUsb.m_isRxPending = false;
+        EP3_OUT_Callback();
+    }
+
+    if (simUsb.m_isFramePending == true)
+    {
+        simUsb.m_isFramePending = false;
+        SOF_Callback();
+    }
+}
+
+void USB_Init(void)
+{
+    bDeviceState = UNCONNECTED;
+}
+
+//----------------------------------------------------------------//
+//                Обмен с буферами конечных точек                 //
+//----------------------------------------------------------------//
+uint32_t USB_SIL_Write(uint8_t bEpAddr, uint8_t *pBufferPointer, uint32_t wBufferSize)
+{
+    SimUsbIn *in = getSimUsbIn(bEpAddr & 0x7F);
+    if ((bEpAddr & 0x80) == 0 || in == 0)
+    {
+        return 0;
+    }
+
+    wBufferSize = wBufferSize < VIRTUAL_COM_PORT_DATA_SIZE ? wBufferSize : VIRTUAL_COM_PORT_DATA_SIZE;
+    memcpy(in->m_packet, pBufferPointer, wBufferSize);
+    in->m_size = wBufferSize;
+    return 0;
+}
+
+uint32_t USB_SIL_Read(uint8_t bEpAddr, uint8_t *pBufferPointer)
+{
+    if (bEpAddr != EP3_OUT)
+    {
+        return 0;
+    }
+
+    memcpy(pBufferPointer, simUsb.m_rxPacket, simUsb.m_rxSize);
+    return simUsb.m_rxSize;
+}
+
+void UserToPMABufferCopy(uint8_t *pbUsrBuf, uint16_t wPMABufAddr, uint16_t wNBytes)
+{
+    if ((uint32_t)wPMABufAddr + wNBytes <= sizeof(simPma))
+    {
+        memcpy(&simPma[wPMABufAddr], pbUsrBuf, wNBytes);
+    }
+}
+
+void PMAToUserBufferCopy(uint8_t *pbUsrBuf, uint16_t wPMABufAddr, uint16_t wNBytes)
+{
+    if ((uint32_t)wPMABufAddr + wNBytes <= sizeof(simPma))
+    {
+        memcpy(pbUsrBuf, &simPma[wPMABufAddr], wNBytes);
+    }
+}
+
+//----------------------------------------------------------------//
+//        Подстановка пакета EP3 OUT (для микробенчмарков)        //
+//----------------------------------------------------------------//
+void injectSimUsbPacket(const uint8_t *packet, const uint32_t packetSize)
+{
+    simUsb.m_rxSize = packetSize < VIRTUAL_COM_PORT_DATA_SIZE ? packetSize : VIRTUAL_COM_PORT_DATA_SIZE;
+    memcpy(simUsb.m_rxPacket, packet, simUsb.m_rxSize);
+}
+
+void SetEPTxValid(uint8_t bEpNum)
+{
+    SimUsbIn *in = getSimUsbIn(bEpNum);
+    if (in == 0 || bDeviceState != CONFIGURED)
+    {
+        return;
+    }
+
+    in->m_status = EP_TX_VALID;
+    in->m_time = getSimTime() + (in->m_size + sim_packet_overhead) * 8 * sim_bit_cycles;
+}
+
+void SetEPRxValid(uint8_t bEpNum)
+{
+    if (bEpNum == ENDP3)
+    {
+        simUsb.m_isRxValid = true;
+    }
+}
+
+uint16_t GetEPTxStatus(uint8_t bEpNum)
+{
+    SimUsbIn *in = getSimUsbIn(bEpNum);
+    return in != 0 ? in->m_status : EP_TX_DIS;
+}
+
+// Номер кадра идёт от шины, а не от устройства: начальное значение
+// задаётся временем подключения, как у хоста, включённого раньше платы
+uint16_t GetFNR(void)
+{
+    return simUsb.m_frameNumber;
+}
+
+void reportSimUsb(const double seconds)
+{
+    SimUsbStatistics *statistics = &simUsbStatistics;
+    double span = simCyclesToMilliseconds(statistics->lastSample - statistics->firstSample) / 1000.0;
+
+    fprintf(stderr, "sim: usb bytes=%llu lines=%u naks=%u\n",
+            (unsigned long long)statistics->bytes, statistics->lines, statistics->naks);
+
+    if (statistics->samples == 0)
+    {
+        fprintf(stderr, "sim: no samples in %.3f s\n", seconds);
+        return;
+    }
+
+    fprintf(stderr, "sim: samples=%u rate=%.3f samples/s latency ms min=%.3f avg=%.3f max=%.3f\n",
+            statistics->samples, span > 0 ? (statistics->samples - 1) / span : 0,
+            statistics->latencyMin, statistics->latencySum / statistics->samples, statistics->latencyMax);
+}
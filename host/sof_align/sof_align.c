@@ -0,0 +1,510 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <math.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+//----------------------------------------------------------------//
+//             Перевод меток кадров USB в часы хоста              //
+//----------------------------------------------------------------//
+// Прошивка дописывает к строке телеметрии метку " sof=<кадр>+<мкс>":
+// номер кадра последнего SOF (11 бит) и время от него
+// (src/main/usb.h). Номер кадра задаёт контроллер хоста, и он общий
+// для всех плат на одной шине. Инструмент раз в --interval мс
+// отправляет каждой плате "sof" и засекает отправку и приём ответа:
+// метка ответа лежит между ними. По ответам с наименьшей задержкой
+// из последних --window строится прямая "кадр -> мкс хоста" (наклон -
+// уход кварца хоста относительно шины), по ней метки отсчётов
+// переводятся в CLOCK_REALTIME. Плата задаётся путём управляющего
+// порта и, через запятую, порта телеметрии (src/main/usb.h): запросы
+// и ответы идут по первому, строки отсчётов - по второму; без второго
+// пути отсчёты ищутся в управляющем порту. Отсчёты выводятся в
+// stdout как CSV "host_us,board,name,celsius,frame,offset_us,
+// latency_us", где latency_us - от метки до приёма строки хостом.
+// Итог сверки по каждой плате - в stderr.
+
+#define ALIGN_MAX_BOARDS   8
+#define ALIGN_MAX_WINDOW   1024
+#define ALIGN_FRAME_COUNT  2048
+#define ALIGN_FRAME_TIME   1000.0
+
+typedef struct AlignOptions
+{
+    uint32_t interval;     // пауза между запросами метки, мс
+    uint32_t window;       // запросов в окне подгонки
+    uint32_t duration;     // с, 0 - до SIGINT
+    uint32_t timeout;      // ожидание ответа, мс
+} AlignOptions;
+
+static AlignOptions alignOptions = { 100, 64, 0, 1000 };
+
+// Ответ на запрос метки: момент по номеру кадра и середина запроса
+typedef struct AlignPoint
+{
+    double frame;          // развёрнутый номер кадра с долей кадра
+    double time;           // мкс CLOCK_MONOTONIC
+    uint32_t rtt;          // мкс от отправки до ответа
+} AlignPoint;
+
+// Порт платы: управляющий или телеметрии
+typedef struct AlignPort
+{
+    const char *m_path;
+    int m_fd;                  // -1 - порт не задан
+    char m_buffer[4096];
+    uint32_t m_size;
+} AlignPort;
+
+typedef struct AlignBoard
+{
+    const char *m_path;
+    AlignPort m_control;
+    AlignPort m_telemetry;
+
+    uint64_t m_pingTime;   // отправка текущего запроса, 0 - нет
+    uint64_t m_nextPing;
+    AlignPoint m_points[ALIGN_MAX_WINDOW];
+    uint32_t m_pointCount;
+    uint32_t m_pointNext;
+
+    // time = m_offset + m_slope * (frame - m_base)
+    bool m_isFitted;
+    double m_base;
+    double m_offset;
+    double m_slope;
+    double m_residual;     // СКО середин отобранных запросов от прямой, мкс
+    uint32_t m_used;
+
+    uint64_t m_pings;
+    uint64_t m_replies;
+    uint64_t m_samples;
+    uint64_t m_skipped;    // отсчёты без метки или до первой подгонки
+} AlignBoard;
+
+static AlignBoard alignBoards[ALIGN_MAX_BOARDS];
+static uint32_t alignBoardCount = 0;
+static volatile sig_atomic_t isAlignStopped = 0;
+// CLOCK_REALTIME - CLOCK_MONOTONIC на момент запуска, мкс
+static int64_t alignRealtimeOffset = 0;
+
+static uint64_t getAlignTime(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+}
+
+static void stopAlign(int signalNumber)
+{
+    (void)signalNumber;
+    isAlignStopped = 1;
+}
+
+//----------------------------------------------------------------//
+//                  Открытие устройств и запросы                  //
+//----------------------------------------------------------------//
+static int openAlignDevice(const char *path)
+{
+    int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0)
+    {
+        fprintf(stderr, "sof_align: %s: %s\n", path, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    struct termios settings;
+    if (tcgetattr(fd, &settings) == 0)
+    {
+        cfmakeraw(&settings);
+        tcsetattr(fd, TCSANOW, &settings);
+        tcflush(fd, TCIOFLUSH);
+    }
+
+    return fd;
+}
+
+static void sendAlignPing(AlignBoard *board, const uint64_t now)
+{
+    // Строка из 4 байт уходит одним пакетом OUT; при заполненном
+    // буфере запрос пропускается до следующего интервала
+    if (write(board->m_control.m_fd, "sof\n", 4) == 4)
+    {
+        board->m_pingTime = now;
+        board->m_pings++;
+    }
+    board->m_nextPing = now + (uint64_t)alignOptions.interval * 1000;
+}
+
+//----------------------------------------------------------------//
+//               Развёртка 11-битного номера кадра                //
+//----------------------------------------------------------------//
+// Номер повторяется каждые 2,048 с. Из кандидатов frame + k * 2048
+// выбирается ближайший к кадру, который по прямой (или, до первой
+// подгонки, по последнему ответу) соответствует моменту time
+static double unwrapAlignFrame(const AlignBoard *board, const uint32_t frame, const double time)
+{
+    double expected = 0;
+    if (board->m_isFitted == true)
+    {
+        expected = board->m_base + (time - board->m_offset) / board->m_slope;
+    }
+    else if (board->m_pointCount > 0)
+    {
+        const AlignPoint *last = &board->m_points[(board->m_pointNext + ALIGN_MAX_WINDOW - 1) % ALIGN_MAX_WINDOW];
+        expected = last->frame + (time - last->time) / ALIGN_FRAME_TIME;
+    }
+    else
+    {
+        return frame;
+    }
+
+    double turns = floor((expected - frame) / ALIGN_FRAME_COUNT + 0.5);
+    return frame + turns * ALIGN_FRAME_COUNT;
+}
+
+//----------------------------------------------------------------//
+//          Подгонка прямой по ответам с малой задержкой          //
+//----------------------------------------------------------------//
+// Задержка ответа складывается из ожидания кадров на шине и
+// планирования на хосте; середина запроса точна до половины задержки.
+// Берутся ответы не дольше минимальной в окне плюс 500 мкс
+static void fitAlignBoard(AlignBoard *board)
+{
+    uint32_t count = board->m_pointCount < alignOptions.window ? board->m_pointCount : alignOptions.window;
+    uint32_t first = (board->m_pointNext + ALIGN_MAX_WINDOW - count) % ALIGN_MAX_WINDOW;
+
+    uint32_t minRtt = UINT32_MAX;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const AlignPoint *point = &board->m_points[(first + i) % ALIGN_MAX_WINDOW];
+        minRtt = point->rtt < minRtt ? point->rtt : minRtt;
+    }
+
+    // Отсчёт от первой точки окна: иначе мкс с загрузки хоста в
+    // квадрате теряют точность double
+    double base = board->m_points[first].frame;
+    double baseTime = board->m_points[first].time;
+    double sumX = 0, sumY = 0, sumXX = 0, sumXY = 0, minX = 0, maxX = 0;
+    uint32_t used = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const AlignPoint *point = &board->m_points[(first + i) % ALIGN_MAX_WINDOW];
+        if (point->rtt > minRtt + 500)
+        {
+            continue;
+        }
+
+        double x = point->frame - base;
+        double y = point->time - baseTime;
+        minX = used == 0 || x < minX ? x : minX;
+        maxX = used == 0 || x > maxX ? x : maxX;
+        sumX += x;
+        sumY += y;
+        sumXX += x * x;
+        sumXY += x * y;
+        used++;
+    }
+
+    // Пока окно короче 100 кадров, наклон берётся номинальным
+    double slope = ALIGN_FRAME_TIME;
+    double meanX = sumX / used;
+    double meanY = sumY / used;
+    if (used >= 2 && maxX - minX >= 100)
+    {
+        slope = (sumXY - used * meanX * meanY) / (sumXX - used * meanX * meanX);
+    }
+
+    board->m_base = base;
+    board->m_slope = slope;
+    board->m_offset = baseTime + meanY - slope * meanX;
+    board->m_used = used;
+    board->m_isFitted = true;
+
+    double sumSquares = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const AlignPoint *point = &board->m_points[(first + i) % ALIGN_MAX_WINDOW];
+        if (point->rtt <= minRtt + 500)
+        {
+            double error = point->time - (board->m_offset + slope * (point->frame - base));
+            sumSquares += error * error;
+        }
+    }
+    board->m_residual = sqrt(sumSquares / used);
+}
+
+//----------------------------------------------------------------//
+//                     Разбор строк от платы                      //
+//----------------------------------------------------------------//
+static void addAlignReply(AlignBoard *board, const uint32_t frame, const uint32_t offset, const uint64_t now)
+{
+    if (board->m_pingTime == 0)
+    {
+        return;
+    }
+
+    AlignPoint point;
+    point.rtt = (uint32_t)(now - board->m_pingTime);
+    point.time = (board->m_pingTime + now) / 2.0;
+    point.frame = unwrapAlignFrame(board, frame, point.time) + offset / ALIGN_FRAME_TIME;
+    board->m_pingTime = 0;
+    board->m_replies++;
+
+    board->m_points[board->m_pointNext] = point;
+    board->m_pointNext = (board->m_pointNext + 1) % ALIGN_MAX_WINDOW;
+    board->m_pointCount += board->m_pointCount < ALIGN_MAX_WINDOW ? 1 : 0;
+    fitAlignBoard(board);
+}
+
+static void addAlignSample(AlignBoard *board, const char *line, const uint64_t now)
+{
+    // '<имя>': T = <градусы> *C sof=<кадр>+<мкс>[ t=<мс>]
+    const char *nameEnd = strstr(line, "': T = ");
+    const char *stamp = strstr(line, " sof=");
+    uint32_t frame = 0, offset = 0;
+    if (line[0] != '\'' || nameEnd == 0 || stamp == 0 || board->m_isFitted == false ||
+        sscanf(stamp, " sof=%" SCNu32 "+%" SCNu32, &frame, &offset) != 2 || offset > ALIGN_FRAME_TIME)
+    {
+        board->m_skipped++;
+        return;
+    }
+
+    // Метка не позже приёма: кадр ищется по моменту приёма
+    double unwrapped = unwrapAlignFrame(board, frame, (double)now) + offset / ALIGN_FRAME_TIME;
+    double time = board->m_offset + board->m_slope * (unwrapped - board->m_base);
+
+    char celsius[16] = { 0 };
+    sscanf(nameEnd + 7, "%15s", celsius);
+
+    printf("%" PRIi64 ",%u,%.*s,%s,%" PRIu32 ",%" PRIu32 ",%" PRIi64 "\n",
+           (int64_t)llround(time) + alignRealtimeOffset, (unsigned)(board - alignBoards),
+           (int)(nameEnd - line - 1), line + 1, celsius, frame, offset, (int64_t)llround(now - time));
+    board->m_samples++;
+}
+
+static void readAlignPort(AlignBoard *board, AlignPort *port)
+{
+    ssize_t received = read(port->m_fd, port->m_buffer + port->m_size, sizeof(port->m_buffer) - port->m_size);
+    uint64_t now = getAlignTime();
+    if (received <= 0)
+    {
+        if (received == 0 || (errno != EAGAIN && errno != EINTR))
+        {
+            fprintf(stderr, "sof_align: %s closed\n", port->m_path);
+            exit(EXIT_FAILURE);
+        }
+        return;
+    }
+    port->m_size += (uint32_t)received;
+
+    char *line = port->m_buffer;
+    char *end = 0;
+    while ((end = memchr(line, '\n', port->m_size - (uint32_t)(line - port->m_buffer))) != 0)
+    {
+        *end = '\0';
+
+        uint32_t frame = 0, offset = 0;
+        if (sscanf(line, "sof: %" SCNu32 "+%" SCNu32, &frame, &offset) == 2)
+        {
+            addAlignReply(board, frame, offset, now);
+        }
+        else if (strstr(line, ": T = ") != 0)
+        {
+            addAlignSample(board, line, now);
+        }
+        line = end + 1;
+    }
+
+    port->m_size -= (uint32_t)(line - port->m_buffer);
+    memmove(port->m_buffer, line, port->m_size);
+    if (port->m_size == sizeof(port->m_buffer))
+    {
+        // Строка длиннее буфера: отбрасываем накопленное
+        port->m_size = 0;
+    }
+}
+
+//----------------------------------------------------------------//
+//                      Итог сверки в stderr                      //
+//----------------------------------------------------------------//
+static void reportAlign(void)
+{
+    uint64_t now = getAlignTime();
+
+    for (uint32_t i = 0; i < alignBoardCount; i++)
+    {
+        const AlignBoard *board = &alignBoards[i];
+        fprintf(stderr, "sof_align: [%u] %s pings=%" PRIu64 " replies=%" PRIu64 " samples=%" PRIu64
+                " skipped=%" PRIu64 "\n", i, board->m_path, board->m_pings, board->m_replies,
+                board->m_samples, board->m_skipped);
+        if (board->m_isFitted == false)
+        {
+            continue;
+        }
+
+        // Текущий кадр по прямой: у плат на одной шине совпадает
+        double frame = board->m_base + (now - board->m_offset) / board->m_slope;
+        fprintf(stderr, "  fit: used=%u skew=%.1f ppm residual=%.0f us frame_now=%.3f\n",
+                board->m_used, (board->m_slope / ALIGN_FRAME_TIME - 1) * 1e6, board->m_residual,
+                fmod(frame, ALIGN_FRAME_COUNT));
+    }
+}
+
+//----------------------------------------------------------------//
+//                   Разбор параметров и запуск                   //
+//----------------------------------------------------------------//
+static void parseAlignOptions(int argc, char **argv)
+{
+    static const struct option options[] =
+    {
+        { "interval", required_argument, 0, 'i' },
+        { "window", required_argument, 0, 'w' },
+        { "duration", required_argument, 0, 'd' },
+        { "timeout", required_argument, 0, 't' },
+        { "help", no_argument, 0, 'h' },
+        { 0, 0, 0, 0 }
+    };
+
+    int option = 0;
+    while ((option = getopt_long(argc, argv, "h", options, 0)) != -1)
+    {
+        switch (option)
+        {
+            case 'i': alignOptions.interval = (uint32_t)atoi(optarg); break;
+            case 'w': alignOptions.window = (uint32_t)atoi(optarg); break;
+            case 'd': alignOptions.duration = (uint32_t)atoi(optarg); break;
+            case 't': alignOptions.timeout = (uint32_t)atoi(optarg); break;
+            default:
+                fprintf(stderr,
+                        "usage: %s [--interval MS] [--window N] [--duration S] [--timeout MS] BOARD...\n"
+                        "  BOARD is CONTROL[,TELEMETRY]: the two /dev/ttyACM* ports of a board or the\n"
+                        "  pty links of firmware_sim --link and --telemetry-link, up to %u boards;\n"
+                        "  CSV host_us,board,name,celsius,frame,offset_us,latency_us on stdout\n",
+                        argv[0], ALIGN_MAX_BOARDS);
+                exit(option == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+
+    if (optind == argc || argc - optind > ALIGN_MAX_BOARDS)
+    {
+        fprintf(stderr, "sof_align: 1 to %u devices are required\n", ALIGN_MAX_BOARDS);
+        exit(EXIT_FAILURE);
+    }
+    if (alignOptions.window < 2 || alignOptions.window > ALIGN_MAX_WINDOW || alignOptions.interval == 0)
+    {
+        fprintf(stderr, "sof_align: --window must be 2..%u, --interval positive\n", ALIGN_MAX_WINDOW);
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = optind; i < argc; i++)
+    {
+        AlignBoard *board = &alignBoards[alignBoardCount++];
+        board->m_path = argv[i];
+
+        char *telemetry = strchr(argv[i], ',');
+        if (telemetry != 0)
+        {
+            board->m_path = strndup(argv[i], (size_t)(telemetry - argv[i]));
+            board->m_telemetry.m_path = telemetry + 1;
+            board->m_telemetry.m_fd = openAlignDevice(telemetry + 1);
+        }
+        else
+        {
+            board->m_telemetry.m_fd = -1;
+        }
+        board->m_control.m_path = board->m_path;
+        board->m_control.m_fd = openAlignDevice(board->m_path);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    parseAlignOptions(argc, argv);
+
+    signal(SIGINT, stopAlign);
+    signal(SIGTERM, stopAlign);
+
+    struct timespec realtime;
+    clock_gettime(CLOCK_REALTIME, &realtime);
+    uint64_t start = getAlignTime();
+    alignRealtimeOffset = (int64_t)realtime.tv_sec * 1000000 + realtime.tv_nsec / 1000 - (int64_t)start;
+
+    struct pollfd requests[ALIGN_MAX_BOARDS * 2];
+    while (isAlignStopped == 0)
+    {
+        uint64_t now = getAlignTime();
+        if (alignOptions.duration != 0 && now - start >= (uint64_t)alignOptions.duration * 1000000)
+        {
+            break;
+        }
+
+        uint64_t nextPing = UINT64_MAX;
+        for (uint32_t i = 0; i < alignBoardCount; i++)
+        {
+            AlignBoard *board = &alignBoards[i];
+            if (board->m_pingTime != 0 && now - board->m_pingTime > (uint64_t)alignOptions.timeout * 1000)
+            {
+                // Ответ потерян: следующий запрос по расписанию
+                board->m_pingTime = 0;
+            }
+            if (board->m_pingTime == 0 && now >= board->m_nextPing)
+            {
+                sendAlignPing(board, now);
+            }
+            uint64_t wakeTime = board->m_pingTime != 0 ? board->m_pingTime + (uint64_t)alignOptions.timeout * 1000
+                                                       : board->m_nextPing;
+            nextPing = wakeTime < nextPing ? wakeTime : nextPing;
+
+            // Порт телеметрии без пути: отрицательный fd poll пропускает
+            requests[i * 2].fd = board->m_control.m_fd;
+            requests[i * 2 + 1].fd = board->m_telemetry.m_fd;
+            for (uint32_t j = i * 2; j < i * 2 + 2; j++)
+            {
+                requests[j].events = POLLIN;
+                requests[j].revents = 0;
+            }
+        }
+
+        int timeout = nextPing > now ? (int)((nextPing - now + 999) / 1000) : 0;
+        if (poll(requests, alignBoardCount * 2, timeout) <= 0)
+        {
+            continue;
+        }
+
+        for (uint32_t i = 0; i < alignBoardCount; i++)
+        {
+            if ((requests[i * 2].revents & (POLLIN | POLLHUP | POLLERR)) != 0)
+            {
+                readAlignPort(&alignBoards[i], &alignBoards[i].m_control);
+            }
+            if ((requests[i * 2 + 1].revents & (POLLIN | POLLHUP | POLLERR)) != 0)
+            {
+                readAlignPort(&alignBoards[i], &alignBoards[i].m_telemetry);
+            }
+        }
+        fflush(stdout);
+    }
+
+    reportAlign();
+    for (uint32_t i = 0; i < alignBoardCount; i++)
+    {
+        close(alignBoards[i].m_control.m_fd);
+        if (alignBoards[i].m_telemetry.m_fd >= 0)
+        {
+            close(alignBoards[i].m_telemetry.m_fd);
+        }
+    }
+    return EXIT_SUCCESS;
+}
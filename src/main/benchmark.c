@@ -0,0 +1,386 @@
+#include "benchmark.h"
+
+#if defined(BENCHMARK_FIRMWARE)
+
+#include "mcu_support_package/inc/stm32f10x.h"
+
+#include "crc.h"
+#include "pool.h"
+#include "usb.h"
+#include "one_wire.h"
+#include "thermometer.h"
+#include "cycle_counter.h"
+#include "ram_code.h"
+#include "usb_lib.h"
+#include "usb_desc.h"
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+//----------------------------------------------------------------//
+//                    Описание случая замеров                     //
+//----------------------------------------------------------------//
+typedef struct BenchmarkCase
+{
+    const char *m_name;
+    void (*m_run)(void);
+    uint32_t m_iterations;
+} BenchmarkCase;
+
+typedef struct BenchmarkResult
+{
+    uint32_t minimum;
+    uint32_t maximum;
+    uint64_t sum;
+} BenchmarkResult;
+
+// Свободная часть PMA (512 байт) за последним буфером конечных точек -
+// уведомлениями EP5 порта телеметрии (src/usb/inc/usb_conf.h)
+static const uint16_t benchmark_pma_address = ENDP5_TXADDR + VIRTUAL_COM_PORT_INT_SIZE;
+static const uint32_t benchmark_pma_size = 512 - (ENDP5_TXADDR + VIRTUAL_COM_PORT_INT_SIZE);
+
+// Программное прерывание для замера входа и выхода из обработчика
+static const IRQn_Type benchmark_irq = EXTI4_IRQn;
+
+//----------------------------------------------------------------//
+//                     Входные данные случаев                     //
+//----------------------------------------------------------------//
+// Блокнот DS18B20 с +25.0625 *C и верной CRC
+static const uint8_t benchmark_scratchpad[NUMBER_OF_REGISTERS] =
+{
+    0x91, 0x01, 0x19, 0x0F, 0x7F, 0xFF, 0x0F, 0x10, 0x7F
+};
+
+static const ThermometerName benchmark_name = "thermometer_1";
+
+static uint8_t benchmarkBlock[64];
+static volatile uint32_t benchmarkSink = 0;
+static volatile uint32_t benchmarkIsrCount = 0;
+
+//----------------------------------------------------------------//
+//             Табличные варианты CRC-8 для сравнения             //
+//----------------------------------------------------------------//
+// Полином 0x8C (отражённый 0x31), как у crc8() из crc.c. Таблица на
+// 256 байт читается из flash, таблица на 16 - по две выборки на байт
+static const uint8_t crc8_table[256] =
+{
+    0x00, 0x5E, 0xBC, 0xE2, 0x61, 0x3F, 0xDD, 0x83, 0xC2, 0x9C, 0x7E, 0x20, 0xA3, 0xFD, 0x1F, 0x41,
+    0x9D, 0xC3, 0x21, 0x7F, 0xFC, 0xA2, 0x40, 0x1E, 0x5F, 0x01, 0xE3, 0xBD, 0x3E, 0x60, 0x82, 0xDC,
+    0x23, 0x7D, 0x9F, 0xC1, 0x42, 0x1C, 0xFE, 0xA0, 0xE1, 0xBF, 0x5D, 0x03, 0x80, 0xDE, 0x3C, 0x62,
+    0xBE, 0xE0, 0x02, 0x5C, 0xDF, 0x81, 0x63, 0x3D, 0x7C, 0x22, 0xC0, 0x9E, 0x1D, 0x43, 0xA1, 0xFF,
+    0x46, 0x18, 0xFA, 0xA4, 0x27, 0x79, 0x9B, 0xC5, 0x84, 0xDA, 0x38, 0x66, 0xE5, 0xBB, 0x59, 0x07,
+    0xDB, 0x85, 0x67, 0x39, 0xBA, 0xE4, 0x06, 0x58, 0x19, 0x47, 0xA5, 0xFB, 0x78, 0x26, 0xC4, 0x9A,
+    0x65, 0x3B, 0xD9, 0x87, 0x04, 0x5A, 0xB8, 0xE6, 0xA7, 0xF9, 0x1B, 0x45, 0xC6, 0x98, 0x7A, 0x24,
+    0xF8, 0xA6, 0x44, 0x1A, 0x99, 0xC7, 0x25, 0x7B, 0x3A, 0x64, 0x86, 0xD8, 0x5B, 0x05, 0xE7, 0xB9,
+    0x8C, 0xD2, 0x30, 0x6E, 0xED, 0xB3, 0x51, 0x0F, 0x4E, 0x10, 0xF2, 0xAC, 0x2F, 0x71, 0x93, 0xCD,
+    0x11, 0x4F, 0xAD, 0xF3, 0x70, 0x2E, 0xCC, 0x92, 0xD3, 0x8D, 0x6F, 0x31, 0xB2, 0xEC, 0x0E, 0x50,
+    0xAF, 0xF1, 0x13, 0x4D, 0xCE, 0x90, 0x72, 0x2C, 0x6D, 0x33, 0xD1, 0x8F, 0x0C, 0x52, 0xB0, 0xEE,
+    0x32, 0x6C, 0x8E, 0xD0, 0x53, 0x0D, 0xEF, 0xB1, 0xF0, 0xAE, 0x4C, 0x12, 0x91, 0xCF, 0x2D, 0x73,
+    0xCA, 0x94, 0x76, 0x28, 0xAB, 0xF5, 0x17, 0x49, 0x08, 0x56, 0xB4, 0xEA, 0x69, 0x37, 0xD5, 0x8B,
+    0x57, 0x09, 0xEB, 0xB5, 0x36, 0x68, 0x8A, 0xD4, 0x95, 0xCB, 0x29, 0x77, 0xF4, 0xAA, 0x48, 0x16,
+    0xE9, 0xB7, 0x55, 0x0B, 0x88, 0xD6, 0x34, 0x6A, 0x2B, 0x75, 0x97, 0xC9, 0x4A, 0x14, 0xF6, 0xA8,
+    0x74, 0x2A, 0xC8, 0x96, 0x15, 0x4B, 0xA9, 0xF7, 0xB6, 0xE8, 0x0A, 0x54, 0xD7, 0x89, 0x6B, 0x35
+};
+
+static const uint8_t crc8_nibble_table[16] =
+{
+    0x00, 0x9D, 0x23, 0xBE, 0x46, 0xDB, 0x65, 0xF8, 0x8C, 0x11, 0xAF, 0x32, 0xCA, 0x57, 0xE9, 0x74
+};
+
+static uint8_t crc8Table(const uint8_t *data, const uint32_t dataSize)
+{
+    uint8_t crc = 0;
+
+    for (uint32_t i = 0; i < dataSize; i++)
+    {
+        crc = crc8_table[crc ^ data[i]];
+    }
+
+    return crc;
+}
+
+static uint8_t crc8Nibble(const uint8_t *data, const uint32_t dataSize)
+{
+    uint8_t crc = 0;
+
+    for (uint32_t i = 0; i < dataSize; i++)
+    {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ crc8_nibble_table[crc & 0x0F];
+        crc = (crc >> 4) ^ crc8_nibble_table[crc & 0x0F];
+    }
+
+    return crc;
+}
+
+//----------------------------------------------------------------//
+//                         Случаи замеров                         //
+//----------------------------------------------------------------//
+static void runEmpty(void)
+{
+}
+
+static void runCrc8Scratchpad(void)
+{
+    benchmarkSink = crc8((const char *)benchmark_scratchpad, sizeof(benchmark_scratchpad));
+}
+
+static void runCrc8Block(void)
+{
+    benchmarkSink = crc8((const char *)benchmarkBlock, sizeof(benchmarkBlock));
+}
+
+static void runCrc8TableBlock(void)
+{
+    benchmarkSink = crc8Table(benchmarkBlock, sizeof(benchmarkBlock));
+}
+
+static void runCrc8NibbleBlock(void)
+{
+    benchmarkSink = crc8Nibble(benchmarkBlock, sizeof(benchmarkBlock));
+}
+
+static void runFormatTemperature(void)
+{
+    char message[POOL_BLOCK_SIZE];
+    benchmarkSink = formatThermometerMessage(message, sizeof(message), benchmark_name, 0x0191);
+}
+
+static void runPoolAllocateRelease(void)
+{
+    BufferHandle buffer = allocateBuffer(0);
+    releaseBuffer(buffer);
+}
+
+static void runQueuePushPop(void)
+{
+    static BufferQueue queue = { { 0 }, 0, 0, 0 };
+    pushBufferQueue(&queue, 0);
+    benchmarkSink = popBufferQueue(&queue);
+}
+
+static void runPmaWrite(void)
+{
+    UserToPMABufferCopy(benchmarkBlock, benchmark_pma_address, benchmark_pma_size);
+}
+
+static void runPmaRead(void)
+{
+    PMAToUserBufferCopy(benchmarkBlock, benchmark_pma_address, benchmark_pma_size);
+}
+
+static void runOneWireTransaction(void)
+{
+    // Шина открывается на время обмена, как в модуле термометра. На
+    // свободной шине это сброс с повторами без импульса присутствия
+    char data = 0;
+    getOneWire()->open();
+    benchmarkSink = getOneWire()->makeTransaction(SKIP_ROM, 0, READ_POWER_SUPPLY, &data, sizeof(data));
+    getOneWire()->close();
+}
+
+static void runIsrRoundTrip(void)
+{
+    uint32_t count = benchmarkIsrCount;
+    NVIC_SetPendingIRQ(benchmark_irq);
+    while (benchmarkIsrCount == count) { }
+}
+
+//----------------------------------------------------------------//
+//                        Таблица случаев                         //
+//----------------------------------------------------------------//
+static const BenchmarkCase benchmark_cases[] =
+{
+    { "crc8/scratchpad",      runCrc8Scratchpad,       1000 },
+    { "crc8/block64",         runCrc8Block,            1000 },
+    { "crc8_table/block64",   runCrc8TableBlock,       1000 },
+    { "crc8_nibble/block64",  runCrc8NibbleBlock,      1000 },
+    { "format/temperature",   runFormatTemperature,    1000 },
+    { "pool/alloc_release",   runPoolAllocateRelease,  1000 },
+    { "queue/push_pop",       runQueuePushPop,         1000 },
+    { "pma/write40",          runPmaWrite,             1000 },
+    { "pma/read40",           runPmaRead,              1000 },
+    { "one_wire/transaction", runOneWireTransaction,     16 },
+    { "isr/round_trip",       runIsrRoundTrip,         1000 }
+};
+
+//----------------------------------------------------------------//
+//                  Пустой обработчик прерывания                  //
+//----------------------------------------------------------------//
+RAM_FUNCTION void EXTI4_IRQHandler(void)
+{
+    benchmarkIsrCount++;
+}
+
+static void configBenchmarkInterrupt(void)
+{
+    NVIC_InitTypeDef interrupt;
+
+    interrupt.NVIC_IRQChannel = benchmark_irq;
+    interrupt.NVIC_IRQChannelPreemptionPriority = 3;
+    interrupt.NVIC_IRQChannelSubPriority = 0;
+    interrupt.NVIC_IRQChannelCmd = ENABLE;
+    NVIC_Init(&interrupt);
+}
+
+//----------------------------------------------------------------//
+//                      Прогон одного случая                      //
+//----------------------------------------------------------------//
+// Каждый вызов замеряется отдельно; прерывания не запрещаются, поэтому
+// устойчивая оценка - минимум, а максимум показывает помехи от ISR
+static void runBenchmarkCase(const BenchmarkCase *benchmarkCase, const uint32_t overhead,
+                             BenchmarkResult *result)
+{
+    result->minimum = UINT32_MAX;
+    result->maximum = 0;
+    result->sum = 0;
+
+    for (uint32_t i = 0; i < benchmarkCase->m_iterations; i++)
+    {
+        uint32_t startTime = getCycleCounter();
+        benchmarkCase->m_run();
+        uint32_t cycles = getCycleCounter() - startTime;
+
+        cycles = cycles > overhead ? cycles - overhead : 0;
+        result->minimum = cycles < result->minimum ? cycles : result->minimum;
+        result->maximum = cycles > result->maximum ? cycles : result->maximum;
+        result->sum += cycles;
+    }
+}
+
+//----------------------------------------------------------------//
+//                       Вывод результатов                        //
+//----------------------------------------------------------------//
+// В отличие от write() строки не теряются: ждём, пока передача по USB
+// освободит блок пула
+static bool writeBenchmarkLine(const char *format, ...)
+{
+    BufferHandle buffer = getUsb()->allocate();
+    while (buffer == NO_BUFFER)
+    {
+        if (getUsb()->isOpened() == false)
+        {
+            return false;
+        }
+        // Блок освободится в прерывании USB по завершении передачи
+        __WFI();
+        buffer = getUsb()->allocate();
+    }
+
+    va_list arguments;
+    va_start(arguments, format);
+    int size = vsnprintf(getBufferData(buffer), MAX_MESSAGE_SIZE + 1, format, arguments);
+    va_end(arguments);
+
+    size = size < 0 ? 0 : size;
+    setBufferSize(buffer, (uint32_t)size < MAX_MESSAGE_SIZE ? (uint32_t)size : MAX_MESSAGE_SIZE);
+    getUsb()->send(buffer);
+    return true;
+}
+
+static void getCompilerInfo(char *text, const uint32_t textSize)
+{
+#if defined(__CC_ARM)
+#if defined(__OPTIMISE_SPACE)
+    static const char optimization[] = "space";
+#else
+    static const char optimization[] = "time";
+#endif
+    snprintf(text, textSize, "armcc %u O%u %s", (unsigned)__ARMCC_VERSION, (unsigned)__OPTIMISE_LEVEL,
+             optimization);
+#elif defined(__GNUC__)
+#if defined(__OPTIMIZE_SIZE__)
+    static const char optimization[] = "-Os";
+#elif defined(__OPTIMIZE__)
+    static const char optimization[] = "-O";
+#else
+    static const char optimization[] = "-O0";
+#endif
+#if defined(__clang__)
+    static const char compiler[] = "clang";
+#else
+    static const char compiler[] = "gcc";
+#endif
+    snprintf(text, textSize, "%s %.32s %s", compiler, __VERSION__, optimization);
+#else
+    snprintf(text, textSize, "unknown");
+#endif
+}
+
+static void reportBenchmarks(void)
+{
+    static const BenchmarkCase empty_case = { "empty", runEmpty, 1000 };
+
+    for (uint32_t i = 0; i < sizeof(benchmarkBlock); i++)
+    {
+        benchmarkBlock[i] = (uint8_t)(i * 37 + 11);
+    }
+
+    BenchmarkResult result;
+    runBenchmarkCase(&empty_case, 0, &result);
+    uint32_t overhead = result.minimum;
+
+    char compiler[48];
+    getCompilerInfo(compiler, sizeof(compiler));
+
+#if defined(USE_STATIC_DISPATCH)
+    static const char dispatch[] = "static";
+#else
+    static const char dispatch[] = "dynamic";
+#endif //USE_STATIC_DISPATCH
+
+    writeBenchmarkLine("# clock=%" PRIu32 " dispatch=%s overhead=%" PRIu32 "\n",
+                       SystemCoreClock, dispatch, overhead);
+    writeBenchmarkLine("# compiler=%s\n", compiler);
+    writeBenchmarkLine("benchmark,iterations,cycles_min,cycles_mean,cycles_max\n");
+
+    for (uint32_t i = 0; i < sizeof(benchmark_cases) / sizeof(benchmark_cases[0]); i++)
+    {
+        const BenchmarkCase *benchmarkCase = &benchmark_cases[i];
+        runBenchmarkCase(benchmarkCase, overhead, &result);
+
+        bool isWritten = writeBenchmarkLine("%s,%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 "\n",
+                                            benchmarkCase->m_name, benchmarkCase->m_iterations,
+                                            result.minimum,
+                                            (uint32_t)(result.sum / benchmarkCase->m_iterations),
+                                            result.maximum);
+        if (isWritten == false)
+        {
+            return;
+        }
+    }
+
+    writeBenchmarkLine("# end\n");
+}
+
+//----------------------------------------------------------------//
+//                Программа замеров на целевом МК                 //
+//----------------------------------------------------------------//
+void runBenchmarkProgram(void)
+{
+    enableCycleCounter();
+    configBenchmarkInterrupt();
+    getUsb()->open();
+
+    while (1)
+    {
+        BufferHandle buffer = getUsb()->receive();
+        if (buffer == NO_BUFFER)
+        {
+            __WFI();
+            continue;
+        }
+
+        bool isRun = strcmp(getBufferData(buffer), "run") == 0;
+        releaseBuffer(buffer);
+
+        if (isRun == true)
+        {
+            reportBenchmarks();
+        }
+    }
+}
+
+#endif //BENCHMARK_FIRMWARE
@@ -0,0 +1,23 @@
+#pragma once
+
+//----------------------------------------------------------------//
+//                Образ прошивки для замеров на МК                //
+//----------------------------------------------------------------//
+// Цель сборки Benchmark определяет BENCHMARK_FIRMWARE: после
+// инициализации модулей main() передаёт управление программе замеров
+// вместо главного цикла. Программа ждёт строку "run" по USB, прогоняет
+// фиксированный набор случаев (CRC, форматирование, пул, PMA,
+// транзакция 1-Wire, пустое прерывание), замеряя каждый вызов по DWT
+// CYCCNT, и печатает результаты в CSV:
+//   # clock=<Гц> dispatch=<static|dynamic> overhead=<такты>
+//   # compiler=<компилятор, версия, оптимизация>
+//   benchmark,iterations,cycles_min,cycles_mean,cycles_max
+//   <случай>,<N>,<min>,<mean>,<max>
+//   # end
+// Из тактов вычтены накладные расходы самого замера (overhead).
+// Сравнение прогонов: tools/bench_compare.py old.csv new.csv
+//#define BENCHMARK_FIRMWARE
+
+#if defined(BENCHMARK_FIRMWARE)
+void runBenchmarkProgram(void);
+#endif //BENCHMARK_FIRMWARE
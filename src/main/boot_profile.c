@@ -0,0 +1,42 @@
+#include "boot_profile.h"
+
+#include "cycle_counter.h"
+
+static const char *milestone_names[BOOT_MILESTONE_COUNT] =
+{
+    "main", "thermometer", "conversion", "peripherals", "loop", "usb", "sample"
+};
+
+//----------------------------------------------------------------//
+//               Отметки времени загрузки прошивки                //
+//----------------------------------------------------------------//
+typedef struct BootProfile
+{
+    uint32_t m_reached;
+    uint32_t m_cycles[BOOT_MILESTONE_COUNT];
+} BootProfile;
+
+static BootProfile bootProfile = { 0, { 0 } };
+
+void markBootMilestone(const BootMilestone milestone)
+{
+    uint32_t mask = 1UL << milestone;
+    if ((bootProfile.m_reached & mask) != 0)
+    {
+        return;
+    }
+
+    bootProfile.m_cycles[milestone] = getCycleCounter();
+    bootProfile.m_reached |= mask;
+}
+
+bool getBootMilestone(const BootMilestone milestone, uint32_t *cycles)
+{
+    *cycles = bootProfile.m_cycles[milestone];
+    return (bootProfile.m_reached & (1UL << milestone)) != 0;
+}
+
+const char *getBootMilestoneName(const BootMilestone milestone)
+{
+    return milestone_names[milestone];
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//----------------------------------------------------------------//
+//               Отметки времени загрузки прошивки                //
+//----------------------------------------------------------------//
+// Время отметок - такты DWT CYCCNT от входа в main(): счётчик
+// включается первым делом, до него идут только SystemInit (запуск PLL)
+// и разметка памяти. Каждая отметка запоминается один раз; отметки
+// позже ~59 с (переполнение CYCCNT на 72 МГц) недостоверны.
+// Главная метрика - BOOT_FIRST_SAMPLE: первая достоверная температура.
+typedef enum BootMilestone
+{
+    BOOT_MAIN,               // вход в main()
+    BOOT_THERMOMETER,        // термометр создан (ROM и параметры)
+    BOOT_FIRST_CONVERSION,   // первое преобразование запущено
+    BOOT_PERIPHERALS,        // светодиод, кнопка и USB настроены
+    BOOT_LOOP,               // вход в главный цикл
+    BOOT_USB_CONFIGURED,     // хост выбрал конфигурацию USB
+    BOOT_FIRST_SAMPLE,       // прочитана первая температура
+    BOOT_MILESTONE_COUNT
+} BootMilestone;
+
+void markBootMilestone(const BootMilestone milestone);
+
+// Возвращает false, если отметка ещё не пройдена
+bool getBootMilestone(const BootMilestone milestone, uint32_t *cycles);
+const char *getBootMilestoneName(const BootMilestone milestone);
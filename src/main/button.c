@@ -2,6 +2,8 @@
 
 #include "button.h"
 #include "timer.h"
+#include "hal.h"
+#include "dispatch.h"
 
 //----------------------------------------------------------------//
 //                          Класс кнопки                          //
@@ -10,7 +12,9 @@ typedef struct
 ClassButton
 {
 /*public:*/
+#if !defined(USE_STATIC_DISPATCH)
     Button m_button;
+#endif
 /*private:*/
     uint32_t m_apb2Periph;
     GPIO_TypeDef *m_gpioPort;
@@ -27,26 +31,30 @@ static const uint32_t button_debounce_timeout = 100;
 //----------------------------------------------------------------//
 //                      Методы класса кнопки                      //
 //----------------------------------------------------------------//
-static bool isButtonPressed(void);
-static bool isButtonReleased(void);
-static bool isButtonClicked(void);
+DISPATCH_METHOD bool isButtonPressed(void);
+DISPATCH_METHOD bool isButtonReleased(void);
+DISPATCH_METHOD bool isButtonClicked(void);
 
 //----------------------------------------------------------------//
 //              Указатель на экземпляр класса кнопки              //
 //----------------------------------------------------------------//
+#if !defined(USE_STATIC_DISPATCH)
 static Button *buttonPtr = 0;
+#endif
 
 //----------------------------------------------------------------//
 //                   Инициализация класса кнопки                  //
 //----------------------------------------------------------------//
 static ClassButton button =
 {
+#if !defined(USE_STATIC_DISPATCH)
     .m_button = 
     {
         .isPressed = isButtonPressed,
         .isReleased = isButtonReleased,
         .isClicked = isButtonClicked
     },
+#endif
     .m_apb2Periph = RCC_APB2Periph_GPIOA,
     .m_gpioPort = GPIOA,
     .m_gpioPin = GPIO_Pin_0,
@@ -76,6 +84,7 @@ static void initButton(ClassButton *button)
 //----------------------------------------------------------------//
 //          Геттер указателя на экземпляр класса кнопки           //
 //----------------------------------------------------------------//
+#if !defined(USE_STATIC_DISPATCH)
 const Button *getButton(void)
 {
     if (buttonPtr == 0)
@@ -86,15 +95,21 @@ const Button *getButton(void)
     
     return buttonPtr;
 }
+#else
+void initButtonModule(void)
+{
+    initButton(&button);
+}
+#endif //USE_STATIC_DISPATCH
 
 //----------------------------------------------------------------//
 //                 Геттеры состояния класса кнопки                //
 //----------------------------------------------------------------//
-static bool isButtonPressed(void)
+DISPATCH_METHOD bool isButtonPressed(void)
 {
     static uint32_t pressTime = 0;
     
-    bool isPressed = GPIO_ReadInputDataBit(button.m_gpioPort, button.m_gpioPin);
+    bool isPressed = readGpioPin(button.m_gpioPort, button.m_gpioPin);
     uint32_t currentTime = getButtonTimer()->getTime();
     
     if (currentTime - pressTime < button_debounce_timeout)
@@ -105,12 +120,12 @@ static bool isButtonPressed(void)
     return button.m_isPressed = isPressed;;
 }
 
-static bool isButtonReleased(void)
+DISPATCH_METHOD bool isButtonReleased(void)
 {
     return !isButtonPressed();
 }
 
-static bool isButtonClicked(void)
+DISPATCH_METHOD bool isButtonClicked(void)
 {
     static bool isClicked = false;
     
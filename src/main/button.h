@@ -1,5 +1,7 @@
 #pragma once
 
+#include "dispatch.h"
+
 #include <stdbool.h>
 
 typedef struct
@@ -10,4 +12,23 @@ typedef struct
     bool (*isClicked)(void);
 } Button;
 
+#if defined(USE_STATIC_DISPATCH)
+bool isButtonPressed(void);
+bool isButtonReleased(void);
+bool isButtonClicked(void);
+
+static inline const Button *getButton(void)
+{
+    static const Button button =
+    {
+        .isPressed = isButtonPressed,
+        .isReleased = isButtonReleased,
+        .isClicked = isButtonClicked
+    };
+    return &button;
+}
+
+void initButtonModule(void);
+#else
 const Button *getButton(void);
+#endif //USE_STATIC_DISPATCH
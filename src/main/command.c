@@ -0,0 +1,640 @@
+#include "command.h"
+
+#include "one_wire.h"
+#include "thermometer.h"
+#include "stack_monitor.h"
+#include "link_test.h"
+#include "resolution_policy.h"
+#include "config_store.h"
+#include "boot_profile.h"
+#include "rollup.h"
+#include "history.h"
+#include "cycle_counter.h"
+#include "wall_clock.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//----------------------------------------------------------------//
+//                     Описание команды по USB                    //
+//----------------------------------------------------------------//
+typedef struct Command
+{
+    const char *m_name;
+    void (*m_execute)(const char *arguments);
+} Command;
+
+static void reportStatistics(const char *arguments);
+static void reportStackUsage(const char *arguments);
+static void reportLoopCycles(const char *arguments);
+static void selectLinkTest(const char *arguments);
+static void selectResolutionPolicy(const char *arguments);
+static void saveParameters(const char *arguments);
+static void selectReadMode(const char *arguments);
+static void reportBootProfile(const char *arguments);
+static void reportRollup(const char *arguments);
+static void selectHistory(const char *arguments);
+static void reportFrameStamp(const char *arguments);
+static void selectWallClock(const char *arguments);
+static void selectUsbTxPolicy(const char *arguments);
+
+//----------------------------------------------------------------//
+//                        Таблица команд                          //
+//----------------------------------------------------------------//
+static const Command commands[] =
+{
+    { "stats", reportStatistics },
+    { "stack", reportStackUsage },
+    { "loop", reportLoopCycles },
+    { "link", selectLinkTest },
+    { "policy", selectResolutionPolicy },
+    { "save", saveParameters },
+    { "read", selectReadMode },
+    { "boot", reportBootProfile },
+    { "rollup", reportRollup },
+    { "history", selectHistory },
+    { "sof", reportFrameStamp },
+    { "time", selectWallClock },
+    { "usb", selectUsbTxPolicy }
+};
+
+bool executeCommand(const Message message)
+{
+    for (uint32_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++)
+    {
+        uint32_t nameSize = strlen(commands[i].m_name);
+        if (strncmp(message, commands[i].m_name, nameSize) != 0)
+        {
+            continue;
+        }
+        if (message[nameSize] != '\0' && message[nameSize] != ' ')
+        {
+            continue;
+        }
+
+        const char *arguments = message + nameSize;
+        while (*arguments == ' ')
+        {
+            arguments++;
+        }
+
+        commands[i].m_execute(arguments);
+        return true;
+    }
+
+    return false;
+}
+
+//----------------------------------------------------------------//
+//       Многострочный ответ: строка на свободный блок пула       //
+//----------------------------------------------------------------//
+// Ответ длиннее числа блоков, доступных передаче ("stats" - 16 строк
+// при 14 блоках), выдаётся так же, как сводки rollup: строка
+// формируется прямо в блоке пула, а если блока нет, выдача
+// продолжается на следующей итерации главного цикла
+// (checkCommandReport). Новый отчёт прерывает незаконченный
+typedef struct CommandReport
+{
+    void (*m_format)(const uint32_t line, char *message, const uint32_t messageSize);
+    uint32_t m_lineCount;
+    uint32_t m_line;
+} CommandReport;
+
+static CommandReport report = { 0, 0, 0 };
+
+static void startReport(void (*format)(const uint32_t, char *, const uint32_t), const uint32_t lineCount)
+{
+    report.m_format = format;
+    report.m_lineCount = lineCount;
+    report.m_line = 0;
+    checkCommandReport();
+}
+
+void checkCommandReport(void)
+{
+    if (getUsb()->isOpened() == false)
+    {
+        report.m_line = report.m_lineCount;
+        return;
+    }
+
+    while (report.m_line < report.m_lineCount)
+    {
+        BufferHandle buffer = getUsb()->allocate();
+        if (buffer == NO_BUFFER)
+        {
+            return;
+        }
+
+        char *message = getBufferData(buffer);
+        report.m_format(report.m_line, message, MAX_MESSAGE_SIZE + 1);
+        setBufferSize(buffer, strlen(message));
+        getUsb()->send(buffer);
+        report.m_line++;
+    }
+}
+
+//----------------------------------------------------------------//
+//             Вывод гистограммы строками по 8 корзин             //
+//----------------------------------------------------------------//
+static const uint32_t histogram_lines = 1 + HISTOGRAM_SIZE / 8;
+
+// Строка 0 - заголовок, далее строки корзин
+static void formatHistogramLine(const char *name, const Histogram *histogram, const uint32_t line,
+                                char *message, const uint32_t messageSize)
+{
+    if (line == 0)
+    {
+        snprintf(message, messageSize, "%s: n=%" PRIu32 " max=%" PRIu32 "\n",
+                 name, histogram->count, histogram->max);
+        return;
+    }
+
+    uint32_t i = (line - 1) * 8;
+    const uint32_t *buckets = &histogram->buckets[i];
+    snprintf(message, messageSize,
+             " [%02" PRIu32 "] %" PRIu32 " %" PRIu32 " %" PRIu32 " %" PRIu32
+             " %" PRIu32 " %" PRIu32 " %" PRIu32 " %" PRIu32 "\n", i,
+             buckets[0], buckets[1], buckets[2], buckets[3],
+             buckets[4], buckets[5], buckets[6], buckets[7]);
+}
+
+//----------------------------------------------------------------//
+//              Счётчики состояния шины и термометров             //
+//----------------------------------------------------------------//
+static const uint32_t statistics_counter_lines = 4;
+
+static void formatStatisticsLine(const uint32_t line, char *message, const uint32_t messageSize)
+{
+    const OneWireStatistics *bus = getOneWire()->getStatistics();
+    const ThermometerStatistics *sensor = getThermometer()->getStatistics();
+
+    if (line == 0)
+    {
+        snprintf(message, messageSize,
+                 "bus: tx=%" PRIu32 " nopres=%" PRIu32 " retry=%" PRIu32 "\n",
+                 bus->transactions, bus->presenceFailures, bus->retries);
+    }
+    else if (line == 1)
+    {
+        ThermometerName name = { 0 };
+        getThermometer()->getName(name);
+        snprintf(message, messageSize, "'%s':\n", name);
+    }
+    else if (line == 2)
+    {
+        snprintf(message, messageSize,
+                 " n=%" PRIu32 " nopres=%" PRIu32 " crc=%" PRIu32 " busy=%" PRIu32
+                 " retry=%" PRIu32 " stale=%" PRIu32 "\n",
+                 sensor->samples, sensor->presenceFailures, sensor->crcErrors,
+                 sensor->busySkips, sensor->retries, sensor->staleReads);
+    }
+    else if (line == 3)
+    {
+        snprintf(message, messageSize,
+                 " cfg=%" PRIu32 " eeprom=%" PRIu32 " fast=%" PRIu32 " full=%" PRIu32
+                 " odd=%" PRIu32 "\n",
+                 sensor->configWrites, sensor->eepromWrites, sensor->fastReads,
+                 sensor->verifiedReads, sensor->anomalies);
+    }
+    else
+    {
+#if defined(USE_ONE_WIRE_BYTE_PROFILE)
+        const char *names[] = { "tx_us", "byte_cyc", "age_ms" };
+        const Histogram *histograms[] = { &bus->transactionTime, &bus->byteCycles, &sensor->sampleAge };
+#else
+        const char *names[] = { "tx_us", "age_ms" };
+        const Histogram *histograms[] = { &bus->transactionTime, &sensor->sampleAge };
+#endif //USE_ONE_WIRE_BYTE_PROFILE
+        uint32_t histogramLine = line - statistics_counter_lines;
+        formatHistogramLine(names[histogramLine / histogram_lines], histograms[histogramLine / histogram_lines],
+                            histogramLine % histogram_lines, message, messageSize);
+    }
+}
+
+static void reportStatistics(const char *arguments)
+{
+    (void)arguments;
+
+#if defined(USE_ONE_WIRE_BYTE_PROFILE)
+    startReport(formatStatisticsLine, statistics_counter_lines + 3 * histogram_lines);
+#else
+    startReport(formatStatisticsLine, statistics_counter_lines + 2 * histogram_lines);
+#endif //USE_ONE_WIRE_BYTE_PROFILE
+}
+
+//----------------------------------------------------------------//
+//              Глубина стека и статическая память                //
+//----------------------------------------------------------------//
+static void reportStackUsage(const char *arguments)
+{
+    (void)arguments;
+
+    StackUsage usage = { 0 };
+    getStackUsage(&usage);
+
+    Message message = { 0 };
+    snprintf(message, sizeof(message),
+             "stack: size=%" PRIu32 " used=%" PRIu32 " free=%" PRIu32 "%s\n",
+             usage.stackSize, usage.stackUsed, usage.stackSize - usage.stackUsed,
+             isStackHeadroomLow() == true ? " LOW" : "");
+    getUsb()->write(message);
+
+    snprintf(message, sizeof(message), "ram: data=%" PRIu32 " bss=%" PRIu32 " code=%" PRIu32 "\n",
+             usage.staticData, usage.staticZero, usage.ramCode);
+    getUsb()->write(message);
+}
+
+//----------------------------------------------------------------//
+//          Длительность итерации главного цикла и режим          //
+//----------------------------------------------------------------//
+static void formatLoopCyclesLine(const uint32_t line, char *message, const uint32_t messageSize)
+{
+    if (line == 0)
+    {
+#if defined(USE_STATIC_DISPATCH)
+        snprintf(message, messageSize, "dispatch: static\n");
+#else
+        snprintf(message, messageSize, "dispatch: dynamic\n");
+#endif //USE_STATIC_DISPATCH
+        return;
+    }
+
+    formatHistogramLine("loop_cyc", &loopCycles, line - 1, message, messageSize);
+}
+
+static void reportLoopCycles(const char *arguments)
+{
+    (void)arguments;
+
+    startReport(formatLoopCyclesLine, 1 + histogram_lines);
+}
+
+//----------------------------------------------------------------//
+//                   Режим проверки канала USB                    //
+//----------------------------------------------------------------//
+static void selectLinkTest(const char *arguments)
+{
+    if (strncmp(arguments, "stream", 6) == 0)
+    {
+        // Длительность потока в секундах, 0 - по умолчанию
+        uint32_t duration = strtoul(arguments + 6, 0, 10) * 1000;
+        getUsb()->write("link: stream\n");
+        startLinkTest(LINK_TEST_STREAM, duration);
+    }
+    else if (strcmp(arguments, "ping") == 0)
+    {
+        startLinkTest(LINK_TEST_PING, 0);
+        getUsb()->write("link: ping\n");
+    }
+    else if (strcmp(arguments, "off") == 0)
+    {
+        startLinkTest(LINK_TEST_OFF, 0);
+        getUsb()->write("link: off\n");
+    }
+    else
+    {
+        getUsb()->write("usage: link stream [s] | ping | off\n");
+    }
+}
+
+//----------------------------------------------------------------//
+//                 Политика разрешения термометра                 //
+//----------------------------------------------------------------//
+static void reportResolutionPolicy(void)
+{
+    static const char *mode_names[] = { "fixed", "adaptive", "rate" };
+
+    PolicyStatistics statistics;
+    getResolutionPolicyStatistics(&statistics);
+
+    // Эффективная частота отсчётов в сотых долях герца
+    uint32_t rate = statistics.elapsed != 0
+                  ? (uint32_t)((uint64_t)statistics.samples * 100000 / statistics.elapsed) : 0;
+
+    Message message = { 0 };
+    snprintf(message, sizeof(message),
+             "policy: %s res=%" PRIu32 " changes=%" PRIu32 " slope=%" PRIu32 " mC/s\n",
+             mode_names[getResolutionPolicy()], (getThermometer()->getResolution() >> 5) + 9,
+             statistics.changes, statistics.slope);
+    getUsb()->write(message);
+
+    snprintf(message, sizeof(message),
+             " n=%" PRIu32 " ms=%" PRIu32 " rate=%" PRIu32 ".%02" PRIu32 "/s err=%" PRIu32
+             " err12=%" PRIu32 " mC\n",
+             statistics.samples, statistics.elapsed, rate / 100, rate % 100,
+             statistics.meanError, statistics.meanFixedError);
+    getUsb()->write(message);
+
+    snprintf(message, sizeof(message),
+             " res9=%" PRIu32 " res10=%" PRIu32 " res11=%" PRIu32 " res12=%" PRIu32 "\n",
+             statistics.resolutionSamples[0], statistics.resolutionSamples[1],
+             statistics.resolutionSamples[2], statistics.resolutionSamples[3]);
+    getUsb()->write(message);
+}
+
+static void selectResolutionPolicy(const char *arguments)
+{
+    if (strncmp(arguments, "fixed", 5) == 0)
+    {
+        // Разрешение в битах: 9..12, без значения - текущее
+        uint32_t bits = strtoul(arguments + 5, 0, 10);
+        uint32_t resolution = bits >= 9 && bits <= 12 ? (((bits - 9) << 5) | 0x1FUL) : 0;
+        setResolutionPolicy(POLICY_FIXED, resolution);
+    }
+    else if (strcmp(arguments, "adaptive") == 0)
+    {
+        setResolutionPolicy(POLICY_ADAPTIVE, 0);
+    }
+    else if (strncmp(arguments, "rate", 4) == 0)
+    {
+        setResolutionPolicy(POLICY_RATE, strtoul(arguments + 4, 0, 10));
+    }
+    else if (*arguments != '\0')
+    {
+        getUsb()->write("usage: policy [fixed [9-12] | adaptive | rate <samples/s>]\n");
+        return;
+    }
+
+    reportResolutionPolicy();
+}
+
+//----------------------------------------------------------------//
+//             Сохранение параметров в EEPROM датчика             //
+//----------------------------------------------------------------//
+// Разрешение и пороги тревоги переживут сброс питания датчика, а вместе
+// с наименованием и серийным номером - и сброс МК (config_store.h)
+static void saveParameters(const char *arguments)
+{
+    (void)arguments;
+
+    getThermometer()->saveParameters();
+
+    ConfigStoreStatus status;
+    getConfigStoreStatus(&status);
+
+    Message message = { 0 };
+    snprintf(message, sizeof(message),
+             "save: eeprom=%" PRIu32 " flash=%" PRIu32 "/%u B gen=%" PRIu32 " n=%" PRIu32 "\n",
+             getThermometer()->getStatistics()->eepromWrites, status.used, CONFIG_STORE_PAGE_SIZE,
+             status.generation, status.records);
+    getUsb()->write(message);
+}
+
+//----------------------------------------------------------------//
+//                 Режим чтения блокнота датчика                  //
+//----------------------------------------------------------------//
+static void selectReadMode(const char *arguments)
+{
+    if (strncmp(arguments, "fast", 4) == 0)
+    {
+        // Период перепроверки: каждое n-е чтение полное, без значения - 16
+        getThermometer()->setReadMode(READ_FAST, strtoul(arguments + 4, 0, 10));
+    }
+    else if (strcmp(arguments, "verified") == 0)
+    {
+        getThermometer()->setReadMode(READ_VERIFIED, 0);
+    }
+    else if (*arguments != '\0')
+    {
+        getUsb()->write("usage: read [fast [n] | verified]\n");
+        return;
+    }
+
+    const ThermometerStatistics *sensor = getThermometer()->getStatistics();
+
+    Message message = { 0 };
+    snprintf(message, sizeof(message),
+             "read: %s fast=%" PRIu32 " full=%" PRIu32 " odd=%" PRIu32 " crc=%" PRIu32 "\n",
+             getThermometer()->getReadMode() == READ_FAST ? "fast" : "verified",
+             sensor->fastReads, sensor->verifiedReads, sensor->anomalies, sensor->crcErrors);
+    getUsb()->write(message);
+}
+
+//----------------------------------------------------------------//
+//                 Отметки времени загрузки, мкс                  //
+//----------------------------------------------------------------//
+static void reportBootProfile(const char *arguments)
+{
+    (void)arguments;
+
+    Message message = { 0 };
+    for (uint32_t i = 0; i < BOOT_MILESTONE_COUNT; i++)
+    {
+        uint32_t cycles = 0;
+        if (getBootMilestone((BootMilestone)i, &cycles) == false)
+        {
+            snprintf(message, sizeof(message), "boot: %s -\n", getBootMilestoneName((BootMilestone)i));
+        }
+        else
+        {
+            snprintf(message, sizeof(message), "boot: %s %" PRIu32 " us\n",
+                     getBootMilestoneName((BootMilestone)i), cyclesToMicroseconds(cycles));
+        }
+        getUsb()->write(message);
+    }
+}
+
+//----------------------------------------------------------------//
+//             Сводки температуры за 1 с, 1 мин и 1 ч             //
+//----------------------------------------------------------------//
+// Строки уходят из главного цикла (checkRollupQuery) по мере
+// освобождения блоков пула
+static void reportRollup(const char *arguments)
+{
+    static const char level_names[ROLLUP_LEVEL_COUNT] = { 's', 'm', 'h' };
+
+    for (uint32_t level = 0; level < ROLLUP_LEVEL_COUNT; level++)
+    {
+        if (arguments[0] == level_names[level] && (arguments[1] == '\0' || arguments[1] == ' '))
+        {
+            // Число последних периодов, без значения - всё кольцо
+            startRollupQuery((RollupLevel)level, strtoul(arguments + 1, 0, 10));
+            return;
+        }
+    }
+
+    getUsb()->write("usage: rollup s | m | h [n]\n");
+}
+
+//----------------------------------------------------------------//
+//              Журнал отсчётов во встроенной flash               //
+//----------------------------------------------------------------//
+static void selectHistory(const char *arguments)
+{
+    bool isDump = strncmp(arguments, "dump", 4) == 0;
+    bool isBinary = strncmp(arguments, "bin", 3) == 0;
+    bool isRange = strncmp(arguments, "range", 5) == 0;
+    if (isDump == false && isBinary == false && isRange == false && *arguments != '\0')
+    {
+        getUsb()->write("usage: history [dump [seq] | bin [seq] | range from [to] [bin]]\n");
+        return;
+    }
+
+    HistoryStatus status;
+    getHistoryStatus(&status);
+
+    Message message = { 0 };
+    snprintf(message, sizeof(message),
+             "history: seq=%" PRIu32 "..%" PRIu32 " pages=%" PRIu32 "/%u ram=%" PRIu32 "\n",
+             status.oldest, status.next, status.pages, HISTORY_PAGE_COUNT, status.buffered);
+    getUsb()->write(message);
+
+    if (isDump == true || isBinary == true)
+    {
+        // Номер первого отсчёта, без значения - самый старый
+        startHistoryDump(strtoul(arguments + (isDump == true ? 4 : 3), 0, 10), isBinary);
+        return;
+    }
+
+    if (isRange == true)
+    {
+        // Границы - секунды Unix включительно, без конца - до последнего
+        char *end = 0;
+        uint64_t from = strtoul(arguments + 5, &end, 10);
+        uint64_t to = strtoul(end, &end, 10);
+        to = to != 0 ? to : UINT32_MAX;
+        startHistoryRange(from * 1000, to * 1000 + 999, strstr(end, "bin") != 0);
+        return;
+    }
+
+    // Средний размер сжатого отсчёта в сотых долях байта
+    uint32_t sampleSize = status.stored != 0 ? status.storedBytes * 100 / status.stored : 0;
+    snprintf(message, sizeof(message),
+             " erases=%" PRIu32 " programs=%" PRIu32 " step=%" PRIu32 " us B/n=%" PRIu32 ".%02" PRIu32 "\n",
+             status.erases, status.programs, cyclesToMicroseconds(status.maxStepCycles),
+             sampleSize / 100, sampleSize % 100);
+    getUsb()->write(message);
+}
+
+//----------------------------------------------------------------//
+//             Метка кадра USB для сверки часов хоста             //
+//----------------------------------------------------------------//
+// Хост (host/sof_align) запрашивает метку и засекает время отправки
+// запроса и приёма ответа: метка лежит между ними. По ответам с
+// наименьшей задержкой строится перевод номеров кадров в часы хоста
+static void reportFrameStamp(const char *arguments)
+{
+    (void)arguments;
+
+    UsbFrameStamp stamp = { 0 };
+    getUsbFrameStamp(&stamp);
+
+    Message message = { 0 };
+    snprintf(message, sizeof(message), "sof: %u+%u\n", stamp.frame, stamp.offset);
+    getUsb()->write(message);
+}
+
+//----------------------------------------------------------------//
+//         Часы реального времени: установка и подстройка         //
+//----------------------------------------------------------------//
+// "time set <мс Unix>" - шаг без оценки ухода, "time sync <мс Unix>" -
+// шаг и подстройка хода по сумме шагов не реже раза в минуту:
+//   echo "time sync $(date +%s%3N)" > /dev/ttyACM0
+static void printPartsPerMillion(char *text, const uint32_t textSize, const int32_t value)
+{
+    uint32_t magnitude = (uint32_t)(value < 0 ? -value : value);
+    snprintf(text, textSize, "%c%" PRIu32 ".%" PRIu32, value < 0 ? '-' : '+', magnitude / 10, magnitude % 10);
+}
+
+static void selectWallClock(const char *arguments)
+{
+    bool isSet = strncmp(arguments, "set", 3) == 0;
+    bool isSync = strncmp(arguments, "sync", 4) == 0;
+    if (isSet == false && isSync == false && *arguments != '\0')
+    {
+        getUsb()->write("usage: time [set ms | sync ms]\n");
+        return;
+    }
+
+    if (isSet == true || isSync == true)
+    {
+        uint64_t milliseconds = strtoull(arguments + (isSet == true ? 3 : 4), 0, 10);
+        bool isDone = isSet == true ? setWallClock(milliseconds) : syncWallClock(milliseconds);
+        if (isDone == false)
+        {
+            getUsb()->write("time: rtc is not running\n");
+            return;
+        }
+    }
+
+    WallClockStatus status;
+    getWallClockStatus(&status);
+    uint64_t now = getWallClockMilliseconds();
+
+    Message message = { 0 };
+    snprintf(message, sizeof(message), "time: %" PRIu32 ".%03" PRIu32 " src=%s set=%u\n",
+             (uint32_t)(now / 1000), (uint32_t)(now % 1000),
+             status.isRunning == false ? "none" : status.isLse == true ? "lse" : "lsi", status.isSet == true);
+    getUsb()->write(message);
+
+    char trim[16] = { 0 };
+    char drift[16] = { 0 };
+    printPartsPerMillion(trim, sizeof(trim), status.trim);
+    printPartsPerMillion(drift, sizeof(drift), status.drift);
+    snprintf(message, sizeof(message), " trim=%s ppm drift=%s ppm syncs=%" PRIu32 " interval=%" PRIu32 " s\n",
+             trim, drift, status.syncs, status.syncInterval);
+    getUsb()->write(message);
+}
+
+//----------------------------------------------------------------//
+//   Политики очереди телеметрии, DTR портов и счётчики потерь    //
+//----------------------------------------------------------------//
+static void selectUsbTxPolicy(const char *arguments)
+{
+    static const char *policy_names[] = { "newest", "oldest", "coalesce" };
+    static const char *attach_names[] = { "flush", "replay" };
+
+    if (*arguments != '\0')
+    {
+        uint32_t i = 0;
+        while (i < sizeof(policy_names) / sizeof(policy_names[0]) && strcmp(arguments, policy_names[i]) != 0)
+        {
+            i++;
+        }
+        uint32_t j = 0;
+        while (j < sizeof(attach_names) / sizeof(attach_names[0]) && strcmp(arguments, attach_names[j]) != 0)
+        {
+            j++;
+        }
+
+        if (i < sizeof(policy_names) / sizeof(policy_names[0]))
+        {
+            setUsbTxPolicy((UsbTxPolicy)i);
+        }
+        else if (j < sizeof(attach_names) / sizeof(attach_names[0]))
+        {
+            setUsbAttachPolicy((UsbAttachPolicy)j);
+        }
+        else
+        {
+            getUsb()->write("usage: usb [newest | oldest | coalesce | flush | replay]\n");
+            return;
+        }
+    }
+
+    UsbTxStatistics statistics;
+    getUsbTxStatistics(&statistics);
+
+    // Имя политики - что отбрасывается при заполнении очереди
+    Message message = { 0 };
+    snprintf(message, sizeof(message),
+             "usb: drop=%s ctl=%" PRIu32 " tlm=%" PRIu32 " free=%" PRIu32 " n=%" PRIu32 "\n",
+             policy_names[getUsbTxPolicy()], getUsbControlQueueCount(), getUsbTelemetryQueueCount(),
+             getFreeBufferCount(), statistics.telemetryQueued);
+    getUsb()->write(message);
+
+    snprintf(message, sizeof(message),
+             " newest=%" PRIu32 " oldest=%" PRIu32 " coalesced=%" PRIu32 " ctl=%" PRIu32 "\n",
+             statistics.droppedNewest, statistics.droppedOldest, statistics.coalesced,
+             statistics.controlDropped);
+    getUsb()->write(message);
+
+    snprintf(message, sizeof(message),
+             " dtr ctl=%u tlm=%u attach=%s opens=%" PRIu32 " flushed=%" PRIu32 "\n",
+             isUsbControlDtr() == true, isUsbTelemetryDtr() == true, attach_names[getUsbAttachPolicy()],
+             statistics.attaches, statistics.flushed);
+    getUsb()->write(message);
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "usb.h"
+#include "histogram.h"
+
+#include <stdbool.h>
+
+// Длительность итерации главного цикла (main.c)
+extern Histogram loopCycles;
+
+// Выполнение команды, принятой по USB. Возвращает false, если команда неизвестна
+bool executeCommand(const Message message);
+
+// Вызывается из главного цикла: отправляет строки многострочного
+// ответа ("stats", "loop"), пока есть блоки пула
+void checkCommandReport(void);
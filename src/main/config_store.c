@@ -0,0 +1,337 @@
+#include "config_store.h"
+
+#include "hal.h"
+#include "crc.h"
+
+#include <string.h>
+
+//----------------------------------------------------------------//
+//                    Формат страницы и записи                    //
+//----------------------------------------------------------------//
+// Страница: поколение (2 байта), признак 0x4B56 (2 байта), затем записи.
+// Признак пишется последним, поэтому недописанная при уплотнении
+// страница не считается действующей.
+// Запись: ключ и размер (2 байта), значение с выравниванием до
+// полуслова, 0x5A00 | CRC-8 ключа, размера и значения (2 байта).
+static const uint16_t page_magic          = 0x4B56;
+static const uint16_t record_commit_mark  = 0x5A00;
+static const uint16_t erased_halfword     = 0xFFFF;
+static const uint32_t page_header_size    = 4;
+static const uint32_t record_header_size  = 2;
+static const uint32_t record_trailer_size = 2;
+static const int32_t no_page              = -1;
+
+typedef struct ConfigStore
+{
+    bool m_isMounted;
+    int32_t m_activePage;
+    uint16_t m_generation;
+    uint32_t m_freeOffset;
+    uint32_t m_records;
+    uint32_t m_compactions;
+} ConfigStore;
+
+static ConfigStore store = { false, -1, 0, 0, 0, 0 };
+
+static uint32_t getPageAddress(const int32_t page)
+{
+    return CONFIG_STORE_ADDRESS + (uint32_t)page * CONFIG_STORE_PAGE_SIZE;
+}
+
+static uint16_t readHalfWord(const int32_t page, const uint32_t offset)
+{
+    const uint8_t *bytes = getFlashPointer(getPageAddress(page) + offset);
+    return (uint16_t)(bytes[0] | (bytes[1] << 8));
+}
+
+static uint32_t getRecordSize(const uint32_t valueSize)
+{
+    return record_header_size + ((valueSize + 1) & ~1UL) + record_trailer_size;
+}
+
+//----------------------------------------------------------------//
+//                    Разбор записей журнала                      //
+//----------------------------------------------------------------//
+// Возвращает размер записи по смещению offset; 0 - конец журнала
+// (стёртая ячейка или повреждённый заголовок)
+static uint32_t getRecordAt(const int32_t page, const uint32_t offset, uint32_t *key, uint32_t *valueSize)
+{
+    if (offset + record_header_size > CONFIG_STORE_PAGE_SIZE)
+    {
+        return 0;
+    }
+
+    uint16_t header = readHalfWord(page, offset);
+    *key = header & 0xFF;
+    *valueSize = header >> 8;
+    if (header == erased_halfword || *valueSize > CONFIG_STORE_MAX_SIZE ||
+        offset + getRecordSize(*valueSize) > CONFIG_STORE_PAGE_SIZE)
+    {
+        return 0;
+    }
+
+    return getRecordSize(*valueSize);
+}
+
+// Запись считается действующей, только если дописан её CRC
+static bool isRecordCommitted(const int32_t page, const uint32_t offset, const uint32_t valueSize)
+{
+    uint16_t trailer = readHalfWord(page, offset + getRecordSize(valueSize) - record_trailer_size);
+    const char *record = (const char *)getFlashPointer(getPageAddress(page) + offset);
+
+    return trailer == (record_commit_mark | crc8(record, record_header_size + valueSize));
+}
+
+// Смещение последней действующей записи ключа; 0 - ключа нет
+static uint32_t findConfigRecord(const int32_t page, const uint32_t key, uint32_t *valueSize)
+{
+    uint32_t found = 0;
+    uint32_t recordKey = 0;
+    uint32_t recordValueSize = 0;
+
+    uint32_t offset = page_header_size;
+    for (uint32_t size = getRecordAt(page, offset, &recordKey, &recordValueSize); size != 0;
+         offset += size, size = getRecordAt(page, offset, &recordKey, &recordValueSize))
+    {
+        if (recordKey == key && isRecordCommitted(page, offset, recordValueSize) == true)
+        {
+            found = offset;
+            *valueSize = recordValueSize;
+        }
+    }
+
+    return found;
+}
+
+//----------------------------------------------------------------//
+//                     Запись во flash (SPL)                      //
+//----------------------------------------------------------------//
+static bool programFlash(const uint32_t address, const uint8_t *data, const uint32_t dataSize)
+{
+    bool isProgrammed = true;
+
+    FLASH_Unlock();
+    for (uint32_t i = 0; i < dataSize && isProgrammed == true; i += 2)
+    {
+        uint16_t halfWord = (uint16_t)(data[i] | (data[i + 1] << 8));
+        isProgrammed = FLASH_ProgramHalfWord(address + i, halfWord) == FLASH_COMPLETE;
+    }
+    FLASH_Lock();
+
+    return isProgrammed;
+}
+
+static bool erasePage(const int32_t page)
+{
+    FLASH_Unlock();
+    bool isErased = FLASH_ErasePage(getPageAddress(page)) == FLASH_COMPLETE;
+    FLASH_Lock();
+
+    return isErased;
+}
+
+// Поколение до признака: признак на странице означает, что она дописана
+static bool writePageHeader(const int32_t page, const uint16_t generation)
+{
+    uint8_t header[] =
+    {
+        (uint8_t)generation, (uint8_t)(generation >> 8),
+        (uint8_t)page_magic, (uint8_t)(page_magic >> 8)
+    };
+
+    return programFlash(getPageAddress(page), header, sizeof(header));
+}
+
+//----------------------------------------------------------------//
+//                 Выбор действующей страницы                     //
+//----------------------------------------------------------------//
+static void mountConfigStore(void)
+{
+    bool isValid[CONFIG_STORE_PAGE_COUNT];
+    for (int32_t page = 0; page < CONFIG_STORE_PAGE_COUNT; page++)
+    {
+        isValid[page] = readHalfWord(page, 2) == page_magic;
+    }
+
+    store.m_activePage = no_page;
+    if (isValid[0] == true && isValid[1] == true)
+    {
+        // Уплотнение прервано после записи признака: новая страница уже полная
+        int16_t age = (int16_t)(readHalfWord(1, 0) - readHalfWord(0, 0));
+        store.m_activePage = age > 0 ? 1 : 0;
+        erasePage(1 - store.m_activePage);
+    }
+    else if (isValid[0] == true || isValid[1] == true)
+    {
+        store.m_activePage = isValid[0] == true ? 0 : 1;
+    }
+
+    store.m_isMounted = true;
+    if (store.m_activePage == no_page)
+    {
+        return;
+    }
+
+    store.m_generation = readHalfWord(store.m_activePage, 0);
+    store.m_records = 0;
+
+    uint32_t key = 0;
+    uint32_t valueSize = 0;
+    uint32_t offset = page_header_size;
+    for (uint32_t size = getRecordAt(store.m_activePage, offset, &key, &valueSize); size != 0;
+         offset += size, size = getRecordAt(store.m_activePage, offset, &key, &valueSize))
+    {
+        store.m_records++;
+    }
+
+    // За повреждённым заголовком дописывать нельзя: следующая запись уплотнит страницу
+    store.m_freeOffset = offset;
+    if (offset + record_header_size <= CONFIG_STORE_PAGE_SIZE && readHalfWord(store.m_activePage, offset) != erased_halfword)
+    {
+        store.m_freeOffset = CONFIG_STORE_PAGE_SIZE;
+    }
+}
+
+//----------------------------------------------------------------//
+//                  Уплотнение во вторую страницу                 //
+//----------------------------------------------------------------//
+// Переносит последние значения всех ключей, кроме ключа новой записи
+// record, и дописывает её саму до признака страницы: сброс питания до
+// стирания старой страницы оставляет либо старое значение, либо новое
+static bool compactConfigStore(const uint8_t *record, const uint32_t recordSize)
+{
+    uint32_t skippedKey = record[0];
+    int32_t target = store.m_activePage == no_page ? 0 : 1 - store.m_activePage;
+    if (erasePage(target) == false)
+    {
+        return false;
+    }
+
+    uint32_t targetOffset = page_header_size;
+    uint32_t records = 0;
+    if (store.m_activePage != no_page)
+    {
+        uint32_t key = 0;
+        uint32_t valueSize = 0;
+        uint32_t offset = page_header_size;
+        for (uint32_t size = getRecordAt(store.m_activePage, offset, &key, &valueSize); size != 0;
+             offset += size, size = getRecordAt(store.m_activePage, offset, &key, &valueSize))
+        {
+            uint32_t latestValueSize = 0;
+            if (key == skippedKey || findConfigRecord(store.m_activePage, key, &latestValueSize) != offset)
+            {
+                continue;
+            }
+
+            uint8_t image[CONFIG_STORE_MAX_SIZE + 4];
+            memcpy(image, getFlashPointer(getPageAddress(store.m_activePage) + offset), size);
+            if (programFlash(getPageAddress(target) + targetOffset, image, size) == false)
+            {
+                return false;
+            }
+            targetOffset += size;
+            records++;
+        }
+    }
+
+    if (targetOffset + recordSize > CONFIG_STORE_PAGE_SIZE ||
+        programFlash(getPageAddress(target) + targetOffset, record, recordSize) == false)
+    {
+        return false;
+    }
+    targetOffset += recordSize;
+    records++;
+
+    uint16_t generation = store.m_activePage == no_page ? 0 : (uint16_t)(store.m_generation + 1);
+    if (writePageHeader(target, generation) == false)
+    {
+        return false;
+    }
+
+    if (store.m_activePage != no_page)
+    {
+        erasePage(store.m_activePage);
+    }
+
+    store.m_activePage = target;
+    store.m_generation = generation;
+    store.m_freeOffset = targetOffset;
+    store.m_records = records;
+    store.m_compactions++;
+    return true;
+}
+
+//----------------------------------------------------------------//
+//                   Чтение и запись значений                     //
+//----------------------------------------------------------------//
+uint32_t readConfigValue(const uint32_t key, void *data, const uint32_t dataSize)
+{
+    if (store.m_isMounted == false)
+    {
+        mountConfigStore();
+    }
+    if (store.m_activePage == no_page)
+    {
+        return 0;
+    }
+
+    uint32_t valueSize = 0;
+    uint32_t offset = findConfigRecord(store.m_activePage, key, &valueSize);
+    if (offset == 0 || valueSize > dataSize)
+    {
+        return 0;
+    }
+
+    memcpy(data, getFlashPointer(getPageAddress(store.m_activePage) + offset + record_header_size), valueSize);
+    return valueSize;
+}
+
+bool writeConfigValue(const uint32_t key, const void *data, const uint32_t dataSize)
+{
+    if (key > 0xFE || dataSize > CONFIG_STORE_MAX_SIZE)
+    {
+        return false;
+    }
+
+    uint8_t current[CONFIG_STORE_MAX_SIZE];
+    if (readConfigValue(key, current, sizeof(current)) == dataSize && memcmp(current, data, dataSize) == 0)
+    {
+        return true;
+    }
+
+    uint32_t size = getRecordSize(dataSize);
+    uint8_t record[CONFIG_STORE_MAX_SIZE + 4];
+    memset(record, 0xFF, sizeof(record));
+    record[0] = (uint8_t)key;
+    record[1] = (uint8_t)dataSize;
+    memcpy(&record[record_header_size], data, dataSize);
+
+    uint16_t trailer = record_commit_mark | crc8((const char *)record, record_header_size + dataSize);
+    record[size - 2] = (uint8_t)trailer;
+    record[size - 1] = (uint8_t)(trailer >> 8);
+
+    if (store.m_activePage == no_page || store.m_freeOffset + size > CONFIG_STORE_PAGE_SIZE)
+    {
+        return compactConfigStore(record, size);
+    }
+
+    // Даже при ошибке место занято: дописывать поверх нельзя
+    uint32_t address = getPageAddress(store.m_activePage) + store.m_freeOffset;
+    store.m_freeOffset += size;
+    store.m_records++;
+
+    return programFlash(address, record, size);
+}
+
+void getConfigStoreStatus(ConfigStoreStatus *status)
+{
+    if (store.m_isMounted == false)
+    {
+        mountConfigStore();
+    }
+
+    status->generation = store.m_generation;
+    status->used = store.m_activePage == no_page ? 0 : store.m_freeOffset;
+    status->records = store.m_records;
+    status->compactions = store.m_compactions;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//----------------------------------------------------------------//
+//        Хранилище конфигурации в последних страницах flash      //
+//----------------------------------------------------------------//
+// Журнал записей "ключ - значение" в одной из двух страниц по 1 КБ в
+// конце flash (область исключена из образа в stack_protection.sct и
+// STM32F10x.ld). Новое значение дописывается в конец журнала, старое
+// остаётся до уплотнения: когда страница заполнена, последние значения
+// вместе с новой записью переносятся во вторую страницу с увеличенным
+// поколением, и только затем первая стирается. Так одна страница стирается раз в несколько десятков
+// сохранений. Запись без завершающего CRC (сброс питания во время
+// записи) при чтении пропускается.
+#define CONFIG_STORE_ADDRESS    0x0801F800UL
+#define CONFIG_STORE_PAGE_SIZE  1024
+#define CONFIG_STORE_PAGE_COUNT 2
+#define CONFIG_STORE_MAX_SIZE   32
+
+// Ключ - тип значения плюс номер датчика на шине (0..15)
+typedef enum ConfigKey
+{
+    CONFIG_ROM_ID     = 0x10, // серийный номер, 8 байт
+    CONFIG_NAME       = 0x20, // наименование с завершающим нулём
+    CONFIG_PARAMETERS = 0x30  // TH, TL и регистр конфигурации, 3 байта
+} ConfigKey;
+
+// Состояние хранилища для отчёта по USB
+typedef struct ConfigStoreStatus
+{
+    uint32_t generation;  // номер уплотнения активной страницы
+    uint32_t used;        // занято байт в активной странице
+    uint32_t records;     // записей в журнале, включая устаревшие
+    uint32_t compactions; // уплотнений с момента запуска
+} ConfigStoreStatus;
+
+// Возвращает размер значения; 0 - значения нет или оно длиннее dataSize
+uint32_t readConfigValue(const uint32_t key, void *data, const uint32_t dataSize);
+
+// Значение, равное сохранённому, повторно не записывается
+bool writeConfigValue(const uint32_t key, const void *data, const uint32_t dataSize);
+
+void getConfigStoreStatus(ConfigStoreStatus *status);
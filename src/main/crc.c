@@ -6,6 +6,7 @@
 static const bool crc8_revert     = true;
 static const uint8_t crc8_init    = 0x00;
 static const uint8_t crc8_poly    = 0x31;
+static const uint8_t crc8_poly_r  = 0x8C; // отражённый полином 0x31 (Dallas/Maxim)
 static const uint8_t crc8_xor_out = 0x00;
 
 uint8_t crc8(const char *data, const uint32_t dataSize)
@@ -17,10 +18,38 @@ uint8_t crc8(const char *data, const uint32_t dataSize)
         crc8 ^= (uint8_t)data[i];
         for (uint8_t j = 0; j < CHAR_BIT; j++)
         {
-            crc8 = crc8 & 0x80 ? (crc8 << 1) ^ crc8_poly : (crc8 << 1);
+            if (crc8_revert == true)
+            {
+                crc8 = crc8 & 0x01 ? (crc8 >> 1) ^ crc8_poly_r : (crc8 >> 1);
+            }
+            else
+            {
+                crc8 = crc8 & 0x80 ? (crc8 << 1) ^ crc8_poly : (crc8 << 1);
+            }
         }
 	}
     
     crc8 ^= crc8_xor_out;
 	return crc8;
 }
+
+static const uint16_t crc16_init    = 0x0000;
+static const uint16_t crc16_poly_r  = 0xA001; // отражённый полином 0x8005 (CRC-16/MAXIM)
+static const uint16_t crc16_xor_out = 0xFFFF;
+
+uint16_t crc16(const char *data, const uint32_t dataSize)
+{
+    uint16_t crc16 = crc16_init;
+
+    for (uint32_t i = 0; i < dataSize; i++)
+    {
+        crc16 ^= (uint8_t)data[i];
+        for (uint8_t j = 0; j < CHAR_BIT; j++)
+        {
+            crc16 = crc16 & 0x0001 ? (crc16 >> 1) ^ crc16_poly_r : (crc16 >> 1);
+        }
+    }
+
+    crc16 ^= crc16_xor_out;
+    return crc16;
+}
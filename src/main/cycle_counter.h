@@ -0,0 +1,30 @@
+#pragma once
+
+#include "mcu_support_package/inc/stm32f10x.h"
+
+#include <stdint.h>
+
+//----------------------------------------------------------------//
+//          Счётчик тактов ядра (DWT CYCCNT) для замеров          //
+//----------------------------------------------------------------//
+static inline void enableCycleCounter(void)
+{
+    if ((DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) != 0)
+    {
+        return;
+    }
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+static inline uint32_t getCycleCounter(void)
+{
+    return DWT->CYCCNT;
+}
+
+static inline uint32_t cyclesToMicroseconds(const uint32_t cycles)
+{
+    return cycles / (SystemCoreClock / 1000000);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+//----------------------------------------------------------------//
+//       Режим статической диспетчеризации методов классов        //
+//----------------------------------------------------------------//
+// По умолчанию экземпляры Led, Button, Timer, Usb, OneWire и Thermometer
+// создаются при первом вызове getX() и вызываются через таблицы указателей
+// в RAM. С USE_STATIC_DISPATCH модули инициализируются явно один раз
+// (initXModule() в начале main), getX() становится static inline и
+// возвращает константную таблицу, известную при компиляции, - компилятор
+// заменяет вызовы getX()->method() прямыми вызовами и может их встраивать.
+// Исходный код вызовов в обоих режимах одинаков.
+//#define USE_STATIC_DISPATCH
+
+#if defined(USE_STATIC_DISPATCH)
+#define DISPATCH_METHOD
+#else
+#define DISPATCH_METHOD static
+#endif
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "mcu_support_package/inc/stm32f10x.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//----------------------------------------------------------------//
+//     Прямой доступ к регистрам для горячих участков кода.       //
+//   SPL с assert_param остаётся только для однократной настройки //
+//----------------------------------------------------------------//
+
+//----------------------------------------------------------------//
+//                            GPIO                                //
+//----------------------------------------------------------------//
+static inline void setGpioPins(GPIO_TypeDef *gpioPort, const uint16_t gpioPins)
+{
+    gpioPort->BSRR = gpioPins;
+}
+
+static inline void resetGpioPins(GPIO_TypeDef *gpioPort, const uint16_t gpioPins)
+{
+    gpioPort->BRR = gpioPins;
+}
+
+static inline bool readGpioPin(const GPIO_TypeDef *gpioPort, const uint16_t gpioPin)
+{
+    return (gpioPort->IDR & gpioPin) != 0;
+}
+
+//----------------------------------------------------------------//
+//                            USART                               //
+//----------------------------------------------------------------//
+#if defined(HOST_SIMULATOR)
+// Симулятор (host/sim) моделирует кадр и эхо линии по записи в DR
+void writeUsartData(USART_TypeDef *usartN, const uint16_t data);
+#else
+static inline void writeUsartData(USART_TypeDef *usartN, const uint16_t data)
+{
+    usartN->DR = data & 0x01FF;
+}
+#endif //HOST_SIMULATOR
+
+static inline uint16_t readUsartData(const USART_TypeDef *usartN)
+{
+    return usartN->DR & 0x01FF;
+}
+
+static inline bool isUsartTransmitted(const USART_TypeDef *usartN)
+{
+    return (usartN->SR & USART_SR_TC) != 0;
+}
+
+static inline void clearUsartTransmitted(USART_TypeDef *usartN)
+{
+    usartN->SR = (uint16_t)~USART_SR_TC;
+}
+
+static inline void setUsartBaudRate(USART_TypeDef *usartN, const uint16_t baudRateRegister)
+{
+    usartN->BRR = baudRateRegister;
+}
+
+// Значение BRR вычисляется так же, как в USART_Init, но один раз при настройке
+static inline uint16_t getUsartBaudRateRegister(const uint32_t apbClock, const uint32_t baudRate)
+{
+    uint32_t integerDivider = (25 * apbClock) / (4 * baudRate);
+    uint32_t mantissa = integerDivider / 100;
+    uint32_t fraction = ((integerDivider - 100 * mantissa) * 16 + 50) / 100;
+
+    return (uint16_t)((mantissa << 4) | (fraction & 0x0F));
+}
+
+//----------------------------------------------------------------//
+//                            TIM                                 //
+//----------------------------------------------------------------//
+static inline bool isTimerUpdated(const TIM_TypeDef *timerN)
+{
+    return (timerN->SR & TIM_SR_UIF) != 0 && (timerN->DIER & TIM_DIER_UIE) != 0;
+}
+
+static inline void clearTimerUpdate(TIM_TypeDef *timerN)
+{
+    timerN->SR = (uint16_t)~TIM_SR_UIF;
+}
+
+//----------------------------------------------------------------//
+//                            FLASH                               //
+//----------------------------------------------------------------//
+#if defined(HOST_SIMULATOR)
+// Симулятор (host/sim) хранит образ flash в памяти процесса
+const uint8_t *getFlashPointer(const uint32_t address);
+#else
+static inline const uint8_t *getFlashPointer(const uint32_t address)
+{
+    return (const uint8_t *)address;
+}
+#endif //HOST_SIMULATOR
@@ -0,0 +1,30 @@
+#include "mcu_support_package/inc/stm32f10x.h"
+
+#include "histogram.h"
+
+#include <string.h>
+
+//----------------------------------------------------------------//
+//         Добавление отсчёта в логарифмическую гистограмму       //
+//----------------------------------------------------------------//
+void addHistogramSample(Histogram *histogram, const uint32_t value)
+{
+    uint32_t bucket = 32 - __CLZ(value);
+    if (bucket >= HISTOGRAM_SIZE)
+    {
+        bucket = HISTOGRAM_SIZE - 1;
+    }
+
+    histogram->buckets[bucket]++;
+    histogram->count++;
+
+    if (value > histogram->max)
+    {
+        histogram->max = value;
+    }
+}
+
+void clearHistogram(Histogram *histogram)
+{
+    memset(histogram, 0, sizeof(Histogram));
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stdint.h>
+
+// Количество корзин гистограммы: корзина k содержит значения [2^(k-1), 2^k)
+#define HISTOGRAM_SIZE 24
+
+typedef struct Histogram
+{
+    uint32_t buckets[HISTOGRAM_SIZE];
+    uint32_t count;
+    uint32_t max;
+} Histogram;
+
+void addHistogramSample(Histogram *histogram, const uint32_t value);
+void clearHistogram(Histogram *histogram);
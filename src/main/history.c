@@ -0,0 +1,625 @@
+#include "history.h"
+
+#include "hal.h"
+#include "crc.h"
+#include "usb.h"
+#include "sample_codec.h"
+#include "cycle_counter.h"
+#include "wall_clock.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+static const uint32_t no_page  = 0xFFFFFFFFUL;
+// Номер страницы, которая ещё заполняется в RAM
+static const uint32_t ram_page = HISTORY_PAGE_COUNT;
+
+// Строки выдачи собираются в блоки размером с пакет EP1 IN
+static const uint32_t history_dump_block_size = HISTORY_FRAME_SIZE;
+
+//----------------------------------------------------------------//
+//                       Состояние журнала                        //
+//----------------------------------------------------------------//
+typedef struct History
+{
+    bool m_isMounted;
+    uint32_t m_writePage;
+    bool m_isWritePageErased;
+    uint32_t m_nextSequence;
+    HistoryPageHeader m_header;   // заголовок страницы в RAM
+    uint8_t m_data[HISTORY_PAGE_DATA_SIZE];
+    SampleCodec m_codec;
+    uint64_t m_lastTime;          // мс Unix последнего отсчёта страницы RAM
+    uint32_t m_sampleTime;
+    bool m_hasSample;
+    uint32_t m_erases;
+    uint32_t m_programs;
+    uint32_t m_maxStepCycles;
+} History;
+
+typedef struct HistorySample
+{
+    uint32_t sequence;
+    uint32_t time;
+    uint64_t fullTime;            // мс Unix
+    int16_t temperature;
+    uint8_t sensor;
+} HistorySample;
+
+// Позиция чтения: страница, смещение в сжатых данных и состояние декодера
+typedef struct HistoryCursor
+{
+    uint32_t m_page;
+    HistoryPageHeader m_header;
+    uint32_t m_sequence;          // номер следующего отсчёта
+    uint32_t m_offset;
+    SampleCodec m_codec;
+    uint32_t m_timeHigh;          // старшие биты времени прочитанного отсчёта
+    uint32_t m_lastTime;
+} HistoryCursor;
+
+typedef struct HistoryDump
+{
+    bool m_isActive;
+    bool m_isBinary;
+    uint32_t m_end;               // номер следующего отсчёта на момент команды
+    bool m_isRange;
+    uint64_t m_from;
+    uint64_t m_to;
+    HistoryCursor m_cursor;
+    HistorySample m_pending;      // отсчёт, не поместившийся в прошлый блок
+    bool m_hasPending;
+} HistoryDump;
+
+static History history = { .m_isMounted = false, .m_writePage = 0 };
+static HistoryDump dump = { .m_isActive = false };
+
+static uint32_t getPageAddress(const uint32_t page)
+{
+    return HISTORY_ADDRESS + page * HISTORY_PAGE_SIZE;
+}
+
+// Возвращает false, если страница пуста или недописана
+static bool readPageHeader(const uint32_t page, HistoryPageHeader *header)
+{
+    if (page == ram_page)
+    {
+        *header = history.m_header;
+        return header->count != 0;
+    }
+
+    memcpy(header, getFlashPointer(getPageAddress(page)), sizeof(*header));
+    return header->magic == HISTORY_PAGE_MAGIC && header->count != 0 && header->size <= HISTORY_PAGE_DATA_SIZE;
+}
+
+static const uint8_t *getPageData(const uint32_t page)
+{
+    return page == ram_page ? history.m_data : getFlashPointer(getPageAddress(page) + sizeof(HistoryPageHeader));
+}
+
+static bool isPageErased(const uint32_t page)
+{
+    const uint8_t *bytes = getFlashPointer(getPageAddress(page));
+    for (uint32_t i = 0; i < HISTORY_PAGE_SIZE; i++)
+    {
+        if (bytes[i] != 0xFF)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//----------------------------------------------------------------//
+//                      Подключение журнала                       //
+//----------------------------------------------------------------//
+// Запись продолжается со страницы, следующей за самой новой
+static void mountHistory(void)
+{
+    uint32_t newestPage = no_page;
+    HistoryPageHeader newest = { 0 };
+
+    for (uint32_t page = 0; page < HISTORY_PAGE_COUNT; page++)
+    {
+        HistoryPageHeader header;
+        if (readPageHeader(page, &header) == true &&
+            (newestPage == no_page || header.firstSequence > newest.firstSequence))
+        {
+            newestPage = page;
+            newest = header;
+        }
+    }
+
+    history.m_writePage = newestPage == no_page ? 0 : (newestPage + 1) % HISTORY_PAGE_COUNT;
+    history.m_nextSequence = newestPage == no_page ? 0 : newest.firstSequence + newest.count;
+    history.m_isWritePageErased = isPageErased(history.m_writePage);
+    history.m_header.count = 0;
+    history.m_isMounted = true;
+}
+
+//----------------------------------------------------------------//
+//                        Операции с flash                        //
+//----------------------------------------------------------------//
+static bool programHistory(const uint32_t address, const void *data, const uint32_t dataSize)
+{
+    const uint8_t *bytes = data;
+    bool isProgrammed = true;
+
+    for (uint32_t i = 0; i < dataSize && isProgrammed == true; i += 2)
+    {
+        isProgrammed = FLASH_ProgramHalfWord(address + i, (uint16_t)(bytes[i] | (bytes[i + 1] << 8))) == FLASH_COMPLETE;
+    }
+
+    return isProgrammed;
+}
+
+static void eraseWritePage(void)
+{
+    FLASH_Unlock();
+    FLASH_ErasePage(getPageAddress(history.m_writePage));
+    FLASH_Lock();
+
+    history.m_isWritePageErased = true;
+    history.m_erases++;
+}
+
+// Сжатые данные, затем заголовок без признака и признак последним
+static void programWritePage(void)
+{
+    HistoryPageHeader *header = &history.m_header;
+    header->magic = HISTORY_PAGE_MAGIC;
+    header->crc = crc16((const char *)history.m_data, header->size);
+
+    uint32_t address = getPageAddress(history.m_writePage);
+    uint32_t dataSize = (header->size + 1UL) & ~1UL;
+
+    FLASH_Unlock();
+    if (programHistory(address + sizeof(*header), history.m_data, dataSize) == true &&
+        programHistory(address + sizeof(header->magic), &header->count, sizeof(*header) - sizeof(header->magic)) == true)
+    {
+        programHistory(address, &header->magic, sizeof(header->magic));
+    }
+    FLASH_Lock();
+
+    // Страница с ошибкой записи останется без признака и будет пропущена
+    history.m_writePage = (history.m_writePage + 1) % HISTORY_PAGE_COUNT;
+    history.m_isWritePageErased = isPageErased(history.m_writePage);
+    header->count = 0;
+    history.m_programs++;
+}
+
+//----------------------------------------------------------------//
+//                       Добавление отсчёта                       //
+//----------------------------------------------------------------//
+static uint64_t getFullTime(const uint32_t timestamp)
+{
+    return ((uint64_t)getWallClockTimeHigh(timestamp) << 32) | timestamp;
+}
+
+// Страница RAM заполнена, если в неё может не поместиться ещё один
+// отсчёт, или отсчёт другого датчика, или часы переставлены назад или
+// далеко вперёд и старшие биты времени не восстановить по заголовку
+static bool isRamPageFull(const uint32_t sensor, const uint32_t timestamp)
+{
+    return history.m_header.count != 0 &&
+           (sensor != history.m_header.sensor || history.m_header.size + SAMPLE_CODEC_MAX_SIZE > (int)HISTORY_PAGE_DATA_SIZE ||
+            getFullTime(timestamp) - history.m_lastTime >= 0x80000000UL);
+}
+
+static void appendHistorySample(const uint32_t sensor, const uint16_t temperature, const uint32_t timestamp)
+{
+    HistoryPageHeader *header = &history.m_header;
+    if (header->count == 0)
+    {
+        header->firstSequence = history.m_nextSequence;
+        header->size = 0;
+        header->sensor = (uint8_t)sensor;
+        header->timeHigh = (uint16_t)getWallClockTimeHigh(timestamp);
+        initSampleCodec(&history.m_codec, 0);
+    }
+    history.m_lastTime = getFullTime(timestamp);
+
+    header->size += encodeSample(&history.m_codec, timestamp, (int16_t)temperature, &history.m_data[header->size]);
+    header->count++;
+    history.m_nextSequence++;
+}
+
+void addHistorySample(const uint32_t sensor, const uint16_t temperature, const uint32_t sampleTime,
+                      const uint32_t timestamp)
+{
+    if (history.m_isMounted == false)
+    {
+        mountHistory();
+    }
+
+    // Нулевое время - термометр ещё не прочитан, температура по умолчанию
+    if (sampleTime == 0 || (history.m_hasSample == true && sampleTime == history.m_sampleTime))
+    {
+        return;
+    }
+    history.m_sampleTime = sampleTime;
+    history.m_hasSample = true;
+
+    // Не больше одной операции с flash за отсчёт: запись заполненной
+    // страницы или стирание следующей (самой старой страницы кольца).
+    // Отсчёт теряется, только если следующую страницу не удалось стереть
+    uint32_t startTime = getCycleCounter();
+    bool isStepped = false;
+
+    if (isRamPageFull(sensor, timestamp) == true && history.m_isWritePageErased == true)
+    {
+        programWritePage();
+        isStepped = true;
+    }
+
+    if (isRamPageFull(sensor, timestamp) == false)
+    {
+        appendHistorySample(sensor, temperature, timestamp);
+    }
+
+    if (isStepped == false && history.m_isWritePageErased == false)
+    {
+        eraseWritePage();
+        isStepped = true;
+    }
+
+    if (isStepped == true)
+    {
+        uint32_t cycles = getCycleCounter() - startTime;
+        history.m_maxStepCycles = cycles > history.m_maxStepCycles ? cycles : history.m_maxStepCycles;
+    }
+}
+
+void getHistoryStatus(HistoryStatus *status)
+{
+    if (history.m_isMounted == false)
+    {
+        mountHistory();
+    }
+
+    status->oldest = history.m_nextSequence - history.m_header.count;
+    status->pages = 0;
+    status->stored = 0;
+    status->storedBytes = 0;
+    for (uint32_t page = 0; page < HISTORY_PAGE_COUNT; page++)
+    {
+        HistoryPageHeader header;
+        if (readPageHeader(page, &header) == true)
+        {
+            status->oldest = header.firstSequence < status->oldest ? header.firstSequence : status->oldest;
+            status->pages++;
+            status->stored += header.count;
+            status->storedBytes += header.size;
+        }
+    }
+
+    status->next = history.m_nextSequence;
+    status->buffered = history.m_header.count;
+    status->erases = history.m_erases;
+    status->programs = history.m_programs;
+    status->maxStepCycles = history.m_maxStepCycles;
+}
+
+//----------------------------------------------------------------//
+//                    Чтение отсчётов по номеру                   //
+//----------------------------------------------------------------//
+// Страница с отсчётом sequence, а если он стёрт или страница
+// повреждена - ближайшая более новая
+static bool findHistoryPage(const uint32_t sequence, uint32_t *foundPage, HistoryPageHeader *found)
+{
+    bool isFound = false;
+
+    for (uint32_t page = 0; page <= ram_page; page++)
+    {
+        HistoryPageHeader header;
+        if (readPageHeader(page, &header) == false)
+        {
+            continue;
+        }
+
+        if (sequence - header.firstSequence < header.count)
+        {
+            // CRC проверяется один раз, при открытии страницы
+            if (page == ram_page || header.crc == crc16((const char *)getPageData(page), header.size))
+            {
+                *foundPage = page;
+                *found = header;
+                return true;
+            }
+        }
+        else if ((int32_t)(header.firstSequence - sequence) > 0 &&
+                 (isFound == false || header.firstSequence < found->firstSequence))
+        {
+            *foundPage = page;
+            *found = header;
+            isFound = true;
+        }
+    }
+
+    return isFound;
+}
+
+// Полное время отсчёта: младшие биты убывают только при переполнении
+// (шаг назад при переводе часов меньше 2^31 мс)
+static uint64_t expandCursorTime(HistoryCursor *cursor, const uint32_t time)
+{
+    if (time < cursor->m_lastTime && (int32_t)(time - cursor->m_lastTime) > 0)
+    {
+        cursor->m_timeHigh++;
+    }
+    cursor->m_lastTime = time;
+
+    return ((uint64_t)cursor->m_timeHigh << 32) | time;
+}
+
+// Страница могла быть стёрта, а страница RAM - записана во flash
+static bool isCursorValid(const HistoryCursor *cursor)
+{
+    HistoryPageHeader header;
+    return cursor->m_page != no_page && readPageHeader(cursor->m_page, &header) == true &&
+           header.firstSequence == cursor->m_header.firstSequence &&
+           cursor->m_sequence - header.firstSequence < header.count;
+}
+
+static bool openHistoryCursor(HistoryCursor *cursor)
+{
+    if (findHistoryPage(cursor->m_sequence, &cursor->m_page, &cursor->m_header) == false)
+    {
+        cursor->m_page = no_page;
+        return false;
+    }
+
+    // Отсчёты до нужного декодируются и пропускаются
+    uint32_t target = cursor->m_sequence;
+    cursor->m_sequence = cursor->m_header.firstSequence;
+    cursor->m_offset = 0;
+    cursor->m_timeHigh = cursor->m_header.timeHigh;
+    cursor->m_lastTime = 0;
+    initSampleCodec(&cursor->m_codec, 0);
+    while ((int32_t)(target - cursor->m_sequence) > 0)
+    {
+        uint32_t time = 0;
+        int16_t temperature = 0;
+        uint32_t size = decodeSample(&cursor->m_codec, getPageData(cursor->m_page) + cursor->m_offset,
+                                     cursor->m_header.size - cursor->m_offset, &time, &temperature);
+        if (size == 0)
+        {
+            break;
+        }
+        expandCursorTime(cursor, time);
+        cursor->m_offset += size;
+        cursor->m_sequence++;
+    }
+
+    return true;
+}
+
+// Возвращает false, если отсчётов с номером не меньше m_sequence нет
+static bool readHistorySample(HistoryCursor *cursor, HistorySample *sample)
+{
+    for (;;)
+    {
+        if (isCursorValid(cursor) == false && openHistoryCursor(cursor) == false)
+        {
+            return false;
+        }
+
+        // Длина страницы в RAM растёт: берётся из текущего заголовка
+        HistoryPageHeader header;
+        readPageHeader(cursor->m_page, &header);
+
+        uint32_t size = decodeSample(&cursor->m_codec, getPageData(cursor->m_page) + cursor->m_offset,
+                                     header.size - cursor->m_offset, &sample->time, &sample->temperature);
+        if (size != 0)
+        {
+            sample->fullTime = expandCursorTime(cursor, sample->time);
+            sample->sequence = cursor->m_sequence++;
+            sample->sensor = header.sensor;
+            cursor->m_offset += size;
+            return true;
+        }
+
+        // Остаток повреждённой страницы пропускается
+        cursor->m_sequence = header.firstSequence + header.count;
+        cursor->m_page = no_page;
+    }
+}
+
+//----------------------------------------------------------------//
+//                     Выдача журнала по USB                      //
+//----------------------------------------------------------------//
+void startHistoryDump(const uint32_t sequence, const bool isBinary)
+{
+    HistoryStatus status;
+    getHistoryStatus(&status);
+
+    // Стёртые отсчёты пропускаются, номер из будущего даёт пустую выдачу
+    uint32_t first = sequence > status.oldest ? sequence : status.oldest;
+    dump.m_cursor.m_sequence = first < status.next ? first : status.next;
+    dump.m_cursor.m_page = no_page;
+    dump.m_end = status.next;
+    dump.m_isBinary = isBinary;
+    dump.m_isRange = false;
+    dump.m_hasPending = false;
+    dump.m_isActive = true;
+}
+
+// Время опорного отсчёта, которым начинается страница
+static uint64_t getPageFirstTime(const uint32_t page, const HistoryPageHeader *header)
+{
+    SampleCodec codec;
+    initSampleCodec(&codec, 0);
+
+    uint32_t time = 0;
+    int16_t temperature = 0;
+    decodeSample(&codec, getPageData(page), header->size, &time, &temperature);
+    return ((uint64_t)header->timeHigh << 32) | time;
+}
+
+// Выдача начинается со страницы с самым поздним первым отсчётом не
+// позже from; отсчёты до from внутри неё пропускаются при выдаче
+void startHistoryRange(const uint64_t from, const uint64_t to, const bool isBinary)
+{
+    uint32_t sequence = 0;
+    uint64_t startTime = 0;
+    bool isFound = false;
+
+    for (uint32_t page = 0; page <= ram_page; page++)
+    {
+        HistoryPageHeader header;
+        if (readPageHeader(page, &header) == false)
+        {
+            continue;
+        }
+
+        uint64_t firstTime = getPageFirstTime(page, &header);
+        if (firstTime <= from && (isFound == false || firstTime > startTime))
+        {
+            sequence = header.firstSequence;
+            startTime = firstTime;
+            isFound = true;
+        }
+    }
+
+    startHistoryDump(sequence, isBinary);
+    dump.m_isRange = true;
+    dump.m_from = from;
+    dump.m_to = to;
+}
+
+static bool getDumpSample(HistorySample *sample)
+{
+    if (dump.m_hasPending == true)
+    {
+        *sample = dump.m_pending;
+        dump.m_hasPending = false;
+        return true;
+    }
+
+    while ((int32_t)(dump.m_end - dump.m_cursor.m_sequence) > 0 &&
+           readHistorySample(&dump.m_cursor, sample) == true &&
+           (int32_t)(dump.m_end - sample->sequence) > 0)
+    {
+        if (dump.m_isRange == false || (sample->fullTime >= dump.m_from && sample->fullTime <= dump.m_to))
+        {
+            return true;
+        }
+
+        // Отсчёты идут по времени: первый поздний завершает выдачу
+        if (sample->fullTime > dump.m_to)
+        {
+            dump.m_end = sample->sequence;
+            return false;
+        }
+    }
+
+    return false;
+}
+
+static void putDumpSample(const HistorySample *sample)
+{
+    dump.m_pending = *sample;
+    dump.m_hasPending = true;
+}
+
+static uint32_t fillTextBlock(uint8_t *data)
+{
+    uint32_t size = 0;
+    HistorySample sample;
+    while (getDumpSample(&sample) == true)
+    {
+        char line[48];
+        int lineSize = snprintf(line, sizeof(line), "%" PRIu32 " %" PRIu32 " %u %" PRIi32 "\n",
+                                sample.sequence, sample.time, sample.sensor,
+                                (int32_t)sample.temperature * 125 / 2);
+        if (lineSize <= 0 || size + (uint32_t)lineSize > history_dump_block_size)
+        {
+            putDumpSample(&sample);
+            break;
+        }
+
+        memcpy(data + size, line, (uint32_t)lineSize);
+        size += (uint32_t)lineSize;
+    }
+
+    return size;
+}
+
+// Кадр начинается опорным отсчётом и декодируется независимо от других
+static uint32_t fillBinaryBlock(uint8_t *data)
+{
+    SampleCodec codec;
+    initSampleCodec(&codec, 0);
+
+    uint32_t size = HISTORY_FRAME_HEADER_SIZE;
+    uint32_t count = 0;
+    HistorySample sample;
+    while (count < UINT8_MAX && getDumpSample(&sample) == true)
+    {
+        if (count == 0)
+        {
+            data[2] = sample.sensor;
+            data[4] = (uint8_t)sample.sequence;
+            data[5] = (uint8_t)(sample.sequence >> 8);
+            data[6] = (uint8_t)(sample.sequence >> 16);
+            data[7] = (uint8_t)(sample.sequence >> 24);
+        }
+        else if (sample.sensor != data[2] || size + SAMPLE_CODEC_MAX_SIZE > HISTORY_FRAME_SIZE)
+        {
+            putDumpSample(&sample);
+            break;
+        }
+
+        size += encodeSample(&codec, sample.time, sample.temperature, data + size);
+        count++;
+    }
+
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    data[0] = HISTORY_FRAME_MARK;
+    data[1] = (uint8_t)(size - HISTORY_FRAME_HEADER_SIZE);
+    data[3] = (uint8_t)count;
+    return size;
+}
+
+void checkHistoryDump(void)
+{
+    if (dump.m_isActive == false)
+    {
+        return;
+    }
+
+    if (getUsb()->isOpened() == false)
+    {
+        dump.m_isActive = false;
+        return;
+    }
+
+    // Очередь передачи заполняется до резерва пула, оставленного для приёма
+    BufferHandle buffer = getUsb()->allocate();
+    while (buffer != NO_BUFFER)
+    {
+        uint8_t *data = (uint8_t *)getBufferData(buffer);
+        uint32_t size = dump.m_isBinary == true ? fillBinaryBlock(data) : fillTextBlock(data);
+        if (size == 0)
+        {
+            // Хост продолжает выдачу командой "history dump <next>"
+            int endSize = snprintf((char *)data, POOL_BLOCK_SIZE, "history: end next=%" PRIu32 "\n", dump.m_end);
+            setBufferSize(buffer, endSize > 0 ? (uint32_t)endSize : 0);
+            getUsb()->send(buffer);
+
+            dump.m_isActive = false;
+            return;
+        }
+
+        setBufferSize(buffer, size);
+        getUsb()->send(buffer);
+
+        buffer = getUsb()->allocate();
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//----------------------------------------------------------------//
+//              Журнал отсчётов во встроенной flash               //
+//----------------------------------------------------------------//
+// Отсчёты накапливаются в странице в RAM и записываются во flash целой
+// страницей; страницы образуют кольцо из HISTORY_PAGE_COUNT страниц
+// под хранилищем конфигурации (область исключена из образа в
+// stack_protection.sct). Каждый отсчёт получает сквозной номер, по
+// которому хост дозапрашивает пропуски: "history dump [номер]".
+// Ядро STM32F1 на время стирания (~20 мс) и записи страницы (~27 мс)
+// останавливается, поэтому за один отсчёт выполняется не больше одной
+// операции и только сразу после чтения датчика: следующее
+// преобразование длится не меньше 94 мс и опрос не сдвигается.
+// Страница стирается заранее, на отсчёт позже записи предыдущей.
+// При сбросе МК теряется только несохранённая страница в RAM.
+#define HISTORY_ADDRESS    0x08017800UL
+#define HISTORY_PAGE_SIZE  1024
+#define HISTORY_PAGE_COUNT 32
+
+// Страница: заголовок, затем отсчёты одного датчика, сжатые
+// sample_codec.h (первый отсчёт опорный). Признак пишется последним,
+// поэтому страница, запись которой прервал сброс, считается пустой.
+// Время отсчёта - младшие 32 бита мс Unix по часам RTC
+// (src/main/wall_clock.h), старшие биты первого отсчёта хранит
+// заголовок; переполнение младших внутри страницы восстанавливается
+// по убыванию времени.
+#define HISTORY_PAGE_MAGIC 0x4C48
+
+typedef struct HistoryPageHeader
+{
+    uint16_t magic;
+    uint16_t count;          // отсчётов в странице
+    uint32_t firstSequence;
+    uint16_t size;           // байт сжатых данных
+    uint16_t crc;            // CRC-16 сжатых данных
+    uint8_t sensor;
+    uint8_t reserved;
+    uint16_t timeHigh;       // старшие биты мс Unix первого отсчёта
+} HistoryPageHeader;
+
+#define HISTORY_PAGE_DATA_SIZE (HISTORY_PAGE_SIZE - sizeof(HistoryPageHeader))
+
+// Кадр двоичной выдачи ("history bin") занимает один пакет EP1 IN:
+// метка, размер сжатых данных, датчик, число отсчётов, номер первого
+// отсчёта (4 байта, младший первым), затем отсчёты sample_codec.h.
+// Метка не встречается в строках телеметрии и ответах на команды
+#define HISTORY_FRAME_MARK        0x1E
+#define HISTORY_FRAME_HEADER_SIZE 8
+#define HISTORY_FRAME_SIZE        64
+
+// Состояние журнала для отчёта по USB
+typedef struct HistoryStatus
+{
+    uint32_t oldest;        // номер самого старого отсчёта во flash
+    uint32_t next;          // номер следующего отсчёта
+    uint32_t buffered;      // отсчётов в странице RAM
+    uint32_t pages;         // записанных страниц во flash
+    uint32_t stored;        // отсчётов в записанных страницах
+    uint32_t storedBytes;   // их сжатый размер
+    uint32_t erases;        // стираний с момента запуска
+    uint32_t programs;      // записей страниц с момента запуска
+    uint32_t maxStepCycles; // самая долгая операция с flash, такты
+} HistoryStatus;
+
+// Вызывается после каждого опроса термометра; повторный отсчёт с тем же
+// временем чтения sampleTime не учитывается. timestamp - метка
+// getWallClockTime(), снятая при опросе
+void addHistorySample(const uint32_t sensor, const uint16_t temperature, const uint32_t sampleTime,
+                      const uint32_t timestamp);
+
+void getHistoryStatus(HistoryStatus *status);
+
+// Выдача журнала с номера sequence (или с самого старого отсчёта):
+// строками "<номер> <мс> <датчик> <м°C>" по нескольку в блоке пула или,
+// при isBinary, кадрами HISTORY_FRAME_MARK (декодер: host/history_decode).
+// <мс> - младшие 32 бита мс Unix
+void startHistoryDump(const uint32_t sequence, const bool isBinary);
+
+// Выдача отсчётов с временем в [from, to], мс Unix. Начало ищется по
+// времени первых отсчётов страниц, выдача заканчивается на первом
+// отсчёте позже to: после перевода часов назад более ранние отсчёты
+// из диапазона могут быть пропущены
+void startHistoryRange(const uint64_t from, const uint64_t to, const bool isBinary);
+
+// Вызывается из главного цикла: заполняет передачу, пока есть блоки пула
+void checkHistoryDump(void);
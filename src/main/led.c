@@ -2,6 +2,8 @@
 
 #include "led.h"
 #include "timer.h"
+#include "hal.h"
+#include "dispatch.h"
 //----------------------------------------------------------------//
 //                        Класс светодиода                        //
 //----------------------------------------------------------------//
@@ -9,7 +11,9 @@ typedef struct
 ClassLed
 {
 /*public*/
+#if !defined(USE_STATIC_DISPATCH)
     Led m_led;
+#endif
 /*private:*/
     uint32_t m_apb2Periph;
     GPIO_TypeDef *m_gpioPort;
@@ -19,23 +23,26 @@ ClassLed
 //----------------------------------------------------------------//
 //              Прототипы методов класса светодиода               //
 //----------------------------------------------------------------//
-static void turnOnLed(void);
-static void turnOffLed(void);
-static void startLedBlinking(const uint32_t milliseconds);
-static void stopLedBlinking(void);
-static bool isLedOn(void);
-static bool isLedOff(void);
+DISPATCH_METHOD void turnOnLed(void);
+DISPATCH_METHOD void turnOffLed(void);
+DISPATCH_METHOD void startLedBlinking(const uint32_t milliseconds);
+DISPATCH_METHOD void stopLedBlinking(void);
+DISPATCH_METHOD bool isLedOn(void);
+DISPATCH_METHOD bool isLedOff(void);
 
 //----------------------------------------------------------------//
 //            Указатель на экземпляр класса светодиода            //
 //----------------------------------------------------------------//
+#if !defined(USE_STATIC_DISPATCH)
 static const Led *ledPtr = 0;
+#endif
 
 //----------------------------------------------------------------//
 //                 Инициализация класса светодиода                //
 //----------------------------------------------------------------//
 static ClassLed led =
 {
+#if !defined(USE_STATIC_DISPATCH)
     .m_led =
     {
         .turnOn = turnOnLed,
@@ -45,6 +52,7 @@ static ClassLed led =
         .isOn = isLedOn,
         .isOff = isLedOff
     },
+#endif
     .m_apb2Periph = RCC_APB2Periph_GPIOC,
     .m_gpioPort = GPIOC,
     .m_gpioPin = GPIO_Pin_12
@@ -73,6 +81,7 @@ static void initLed(ClassLed *led)
 //----------------------------------------------------------------//
 //        Геттер указателя на экземпляр класс светодиода          //
 //----------------------------------------------------------------//
+#if !defined(USE_STATIC_DISPATCH)
 const Led *getLed(void)
 {
     if (ledPtr == 0)
@@ -83,44 +92,50 @@ const Led *getLed(void)
     
     return ledPtr;
 }
+#else
+void initLedModule(void)
+{
+    initLed(&led);
+}
+#endif //USE_STATIC_DISPATCH
 
 //----------------------------------------------------------------//
 //               Включение и выключения светодиода                //
 //----------------------------------------------------------------//
-static void turnOnLed(void)
+DISPATCH_METHOD void turnOnLed(void)
 {
-    GPIO_ResetBits(led.m_gpioPort, led.m_gpioPin);
+    resetGpioPins(led.m_gpioPort, led.m_gpioPin);
 }
 
-static void turnOffLed(void)
+DISPATCH_METHOD void turnOffLed(void)
 {
-    GPIO_SetBits(led.m_gpioPort, led.m_gpioPin);
+    setGpioPins(led.m_gpioPort, led.m_gpioPin);
 }
 
 //----------------------------------------------------------------//
 //        Включение и выключение режима мигания светодиода        //
 //----------------------------------------------------------------//
-static void startLedBlinking(const uint32_t milliseconds)
+DISPATCH_METHOD void startLedBlinking(const uint32_t milliseconds)
 {
-    ledPtr->turnOff();
+    turnOffLed();
     getLedTimer()->start(milliseconds);
 }
 
-static void stopLedBlinking(void)
+DISPATCH_METHOD void stopLedBlinking(void)
 {
-    ledPtr->turnOff();
+    turnOffLed();
     getLedTimer()->stop();
 }
 
 //----------------------------------------------------------------//
 //                  Геттеры состояния светодиода                  //
 //----------------------------------------------------------------//
-static bool isLedOn(void)
+DISPATCH_METHOD bool isLedOn(void)
 {
-    return GPIO_ReadInputDataBit(led.m_gpioPort, led.m_gpioPin) == 0;
+    return readGpioPin(led.m_gpioPort, led.m_gpioPin) == false;
 }
 
-static bool isLedOff(void)
+DISPATCH_METHOD bool isLedOff(void)
 {
     return !isLedOn();
 }
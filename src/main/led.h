@@ -1,5 +1,7 @@
 #pragma once
 
+#include "dispatch.h"
+
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -15,4 +17,29 @@ typedef struct
     bool (*isOff)(void);
 } Led;
 
+#if defined(USE_STATIC_DISPATCH)
+void turnOnLed(void);
+void turnOffLed(void);
+void startLedBlinking(const uint32_t milliseconds);
+void stopLedBlinking(void);
+bool isLedOn(void);
+bool isLedOff(void);
+
+static inline const Led *getLed(void)
+{
+    static const Led led =
+    {
+        .turnOn = turnOnLed,
+        .turnOff = turnOffLed,
+        .startBlinking = startLedBlinking,
+        .stopBlinking = stopLedBlinking,
+        .isOn = isLedOn,
+        .isOff = isLedOff
+    };
+    return &led;
+}
+
+void initLedModule(void);
+#else
 const Led *getLed(void);
+#endif //USE_STATIC_DISPATCH
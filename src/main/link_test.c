@@ -0,0 +1,143 @@
+#include "link_test.h"
+
+#include "usb.h"
+#include "timer.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+// Длительность потока, если она не задана командой, мс
+static const uint32_t link_test_default_duration = 10000;
+
+//----------------------------------------------------------------//
+//                     Режим проверки канала                      //
+//----------------------------------------------------------------//
+typedef struct LinkTest
+{
+    LinkTestMode m_mode;
+    uint32_t m_startTime;
+    uint32_t m_duration;
+    uint32_t m_sequence;
+    bool m_isExpired;
+} LinkTest;
+
+static LinkTest linkTest = { LINK_TEST_OFF, 0, 0, 0, false };
+
+void startLinkTest(const LinkTestMode mode, const uint32_t duration)
+{
+    linkTest.m_mode = mode;
+    linkTest.m_startTime = getOneWireTimer()->getTime();
+    linkTest.m_duration = duration != 0 ? duration : link_test_default_duration;
+    linkTest.m_sequence = 0;
+    linkTest.m_isExpired = false;
+}
+
+LinkTestMode getLinkTestMode(void)
+{
+    return linkTest.m_mode;
+}
+
+//----------------------------------------------------------------//
+//                    Заполнение строки потока                    //
+//----------------------------------------------------------------//
+// Шаблон зависит от номера строки, поэтому хост видит и пропуски,
+// и порчу данных внутри строки
+static void fillLinkTestLine(char *line, const uint32_t sequence)
+{
+    static const char hex_digits[] = "0123456789ABCDEF";
+
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        line[i] = hex_digits[(sequence >> (28 - 4 * i)) & 0x0F];
+    }
+    line[8] = ' ';
+
+    for (uint32_t i = 0; i < LINK_TEST_PATTERN_SIZE; i++)
+    {
+        line[9 + i] = (char)('A' + (sequence + i) % 26);
+    }
+    line[LINK_TEST_LINE_SIZE - 1] = '\n';
+}
+
+//----------------------------------------------------------------//
+//                   Поток блоков со счётчиком                    //
+//----------------------------------------------------------------//
+static void finishLinkTestStream(void)
+{
+    BufferHandle buffer = getUsb()->allocate();
+    if (buffer == NO_BUFFER)
+    {
+        // Строка итога ждёт, пока передача освободит блок
+        return;
+    }
+
+    char *message = getBufferData(buffer);
+    int size = snprintf(message, POOL_BLOCK_SIZE, "link: done n=%" PRIu32 " ms=%" PRIu32 "\n",
+                        linkTest.m_sequence, getOneWireTimer()->getTime() - linkTest.m_startTime);
+    setBufferSize(buffer, size > 0 ? (uint32_t)size : 0);
+    getUsb()->send(buffer);
+
+    linkTest.m_mode = LINK_TEST_OFF;
+}
+
+void checkLinkTest(void)
+{
+    if (linkTest.m_mode != LINK_TEST_STREAM)
+    {
+        return;
+    }
+
+    if (getUsb()->isOpened() == false)
+    {
+        linkTest.m_mode = LINK_TEST_OFF;
+        return;
+    }
+
+    if (linkTest.m_isExpired == false &&
+        getOneWireTimer()->getTime() - linkTest.m_startTime >= linkTest.m_duration)
+    {
+        linkTest.m_isExpired = true;
+    }
+
+    if (linkTest.m_isExpired == true)
+    {
+        finishLinkTestStream();
+        return;
+    }
+
+    // Очередь передачи заполняется до резерва пула, оставленного для приёма
+    BufferHandle buffer = getUsb()->allocate();
+    while (buffer != NO_BUFFER)
+    {
+        fillLinkTestLine(getBufferData(buffer), linkTest.m_sequence++);
+        setBufferSize(buffer, LINK_TEST_LINE_SIZE);
+        getUsb()->send(buffer);
+
+        buffer = getUsb()->allocate();
+    }
+}
+
+//----------------------------------------------------------------//
+//                     Отражение эхо-запросов                     //
+//----------------------------------------------------------------//
+bool reflectLinkTestPing(const BufferHandle buffer)
+{
+    static const char ping_prefix[] = "ping";
+
+    char *message = getBufferData(buffer);
+    if (linkTest.m_mode != LINK_TEST_PING || strncmp(message, ping_prefix, sizeof(ping_prefix) - 1) != 0)
+    {
+        return false;
+    }
+
+    // Ответ собирается в том же блоке: "pong <поля запроса> <время МК, мс>"
+    message[1] = 'o';
+    uint32_t size = getBufferSize(buffer);
+    int suffixSize = snprintf(message + size, POOL_BLOCK_SIZE - size, " %" PRIu32 "\n",
+                              getOneWireTimer()->getTime());
+    setBufferSize(buffer, size + (suffixSize > 0 ? (uint32_t)suffixSize : 0));
+
+    getUsb()->send(buffer);
+    return true;
+}
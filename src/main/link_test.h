@@ -0,0 +1,38 @@
+#pragma once
+
+#include "pool.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//----------------------------------------------------------------//
+//         Проверка пропускной способности и задержки USB         //
+//----------------------------------------------------------------//
+// Команда "link stream [с]" заполняет передачу блоками по 64 байта
+// (размер пакета EP1 IN) со сквозным счётчиком, пока не истечёт время
+// (по умолчанию 10 с), и завершает поток строкой "link: done".
+// Команда "link ping" включает отражение строк "ping ...": в ответ уходит
+// та же строка с "pong" и временем МК в мс. "link off" - обычный режим.
+// Пока проверка идёт, телеметрия термометров не передаётся.
+// Измеритель на хосте: host/link_test (make -C host link-test).
+
+// Строка потока: 8 hex-цифр счётчика, пробел, шаблон и '\n'
+#define LINK_TEST_LINE_SIZE    64
+#define LINK_TEST_PATTERN_SIZE (LINK_TEST_LINE_SIZE - 10)
+
+typedef enum LinkTestMode
+{
+    LINK_TEST_OFF,
+    LINK_TEST_STREAM,
+    LINK_TEST_PING
+} LinkTestMode;
+
+void startLinkTest(const LinkTestMode mode, const uint32_t duration);
+LinkTestMode getLinkTestMode(void);
+
+// Вызывается из главного цикла: дозаполняет поток, завершает его по времени
+void checkLinkTest(void);
+
+// Превращает принятую строку "ping ..." в ответ и отправляет тот же блок.
+// Возвращает false, если строка не эхо-запрос или режим не LINK_TEST_PING
+bool reflectLinkTestPing(const BufferHandle buffer);
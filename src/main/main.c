@@ -3,19 +3,73 @@
 #include "led.h"
 #include "button.h"
 #include "thermometer.h"
+#include "one_wire.h"
 #include "timer.h"
 #include "usb.h"
+#include "command.h"
+#include "stack_monitor.h"
+#include "cycle_counter.h"
+#include "benchmark.h"
+#include "link_test.h"
+#include "resolution_policy.h"
+#include "boot_profile.h"
+#include "ram_code.h"
+#include "rollup.h"
+#include "history.h"
+#include "wall_clock.h"
 
 #include <stdio.h>
 #include <string.h>
+#include <inttypes.h>
 
 void checkLed(void);
 void checkButton(void);
 void checkUsbMessages(void);
 void checkThermometers(void);
+void checkStack(void);
+
+// Длительность итерации главного цикла, такты ядра
+Histogram loopCycles = { { 0 }, 0, 0 };
 
 int main(void)
 {
+    // Закрашиваем свободную часть стека для оценки его глубины
+    paintStack();
+    enableCycleCounter();
+    relocateVectorTable();
+    markBootMilestone(BOOT_MAIN);
+    
+    // Термометр подключается первым: его преобразование идёт, пока
+    // настраиваются светодиод, кнопка и USB
+#if defined(USE_STATIC_DISPATCH)
+    // Явная однократная инициализация вместо ленивой в getX()
+    initTimerModule();
+    initOneWireModule();
+    initThermometerModule();
+#endif //USE_STATIC_DISPATCH
+    
+    // Подключаем термометр
+    const Thermometer *thermometer = getThermometer();
+    // Пороги по умолчанию только для датчика без сохранённых параметров,
+    // иначе они затирали бы загруженные из хранилища
+    if (thermometer->hasSavedParameters() == false)
+    {
+        thermometer->setLowAlarmTrigger(15);
+        thermometer->setHighAlarmTrigger(25);
+    }
+    markBootMilestone(BOOT_THERMOMETER);
+    
+    // Первый отсчёт с 9 битами готов через 94 мс вместо 750,
+    // следующие идут с настроенным разрешением
+    thermometer->startConversion(RES_9BITS);
+    markBootMilestone(BOOT_FIRST_CONVERSION);
+    
+#if defined(USE_STATIC_DISPATCH)
+    initLedModule();
+    initButtonModule();
+    initUsbModule();
+#endif //USE_STATIC_DISPATCH
+    
     // Подключаем светодиод
 	const Led *led = getLed();
     
@@ -25,17 +79,32 @@ int main(void)
     // Подключаем USB
     const Usb *usb = getUsb();
     
-    // Подключаем термометр
-    const Thermometer *thermometer = getThermometer();
-    thermometer->setLowAlarmTrigger(15);
-    thermometer->setHighAlarmTrigger(25);
+    // Часы реального времени: кварц LSE запускается, пока идёт цикл
+    initWallClock();
+    markBootMilestone(BOOT_PERIPHERALS);
+    
+#if defined(BENCHMARK_FIRMWARE)
+    // Образ для замеров: вместо главного цикла выполняется программа замеров
+    runBenchmarkProgram();
+#endif //BENCHMARK_FIRMWARE
     
+    markBootMilestone(BOOT_LOOP);
 	while(1)
     {
+        uint32_t startTime = getCycleCounter();
+        
         checkLed();
         checkButton();
         checkUsbMessages();
+        checkWallClock();
+        checkLinkTest();
+        checkCommandReport();
+        checkRollupQuery();
+        checkHistoryDump();
         checkThermometers();
+        checkStack();
+        
+        addHistogramSample(&loopCycles, getCycleCounter() - startTime);
     }
 	
 	return 0;
@@ -45,7 +114,7 @@ void checkLed(void)
 {
     if (getUsb()->isOpened() == true)
     {
-        if (getThermometer()->isTriggered() == true)
+        if (getLinkTestMode() == LINK_TEST_OFF && getThermometer()->isTriggered() == true)
         {
             getLed()->startBlinking(1000);
             return;
@@ -79,39 +148,118 @@ void checkButton(void)
 
 void checkUsbMessages(void)
 {
-    Message message = { 0 };
-    getUsb()->read(message);
-    while (strlen(message) > 0)
-    {      
-        getUsb()->write(message);
-        getUsb()->read(message);
+    if (getUsb()->isOpened() == true)
+    {
+        markBootMilestone(BOOT_USB_CONFIGURED);
+    }
+    
+    BufferHandle buffer = getUsb()->receive();
+    while (buffer != NO_BUFFER)
+    {
+        if (executeCommand(getBufferData(buffer)) == true)
+        {
+            releaseBuffer(buffer);
+        }
+        else if (reflectLinkTestPing(buffer) == false)
+        {
+            // Эхо отправляет принятый блок без копирования
+            getUsb()->send(buffer);
+        }
+        buffer = getUsb()->receive();
     }
 }
 
 void checkThermometers(void)
 {
-    static uint32_t previousTime = 0;
-    uint32_t currentTime = getOneWireTimer()->getTime();
+    // Обмен по 1-Wire блокирует цикл и исказил бы замер канала USB
+    if (getLinkTestMode() != LINK_TEST_OFF)
+    {
+        return;
+    }
     
-    if (currentTime - previousTime > getThermometer()->getConversionTime())
+    // Датчик опрашивается, как только истёк срок его преобразования
+    if (getThermometer()->isReady() == true)
     {
+        // Метка кадра USB снимается до обмена по 1-Wire: его длительность
+        // зависит от разрешения и повторов
+        UsbFrameStamp stamp = { 0 };
+        getUsbFrameStamp(&stamp);
+        uint32_t timestamp = getWallClockTime();
+        
+        uint32_t previousSampleTime = getThermometer()->getSampleTime();
         uint16_t temperature = getThermometer()->getTemperature();
-    
-        int8_t integer = (int8_t)(temperature >> 4);
-        uint16_t fractional = (temperature & 0x0F) * 10000 / 16;
         
-        ThermometerName name = { 0 };
-        getThermometer()->getName(name);
-    
-        Message message = { 0 };
-        sprintf(message, "'%s': T = %i.%04i *C\n", name, integer, fractional);
+        // Чтение не прошло (датчик не ответил, ошибка CRC): прежнее
+        // значение не выдаётся за новый отсчёт ни в телеметрию, ни в журнал
+        if (getThermometer()->getSampleTime() == previousSampleTime)
+        {
+            return;
+        }
+        markBootMilestone(BOOT_FIRST_SAMPLE);
+        updateResolutionPolicy(temperature, getThermometer()->getSampleTime());
+        addRollupSample(0, temperature, getThermometer()->getSampleTime());
         
-        if (getUsb()->isOpened() == true)
+        // Пока порт телеметрии никто не открыл, строка не формируется
+        // и не занимает блок пула
+        if (getUsb()->isTelemetryOpened() == true)
         {
-            getUsb()->write(message);
+            BufferHandle buffer = getUsb()->allocateTelemetry();
+            if (buffer != NO_BUFFER)
+            {
+                ThermometerName name = { 0 };
+                getThermometer()->getName(name);
+                
+                // Сообщение формируется сразу в блоке пула
+                char *message = getBufferData(buffer);
+                uint32_t messageSize = formatThermometerMessage(message, POOL_BLOCK_SIZE, name, temperature);
+                
+                // Метки дописываются вместо перевода строки:
+                // " sof=<кадр>+<мкс> t=<мс Unix, младшие 32 бита>"; при
+                // длинном имени время не помещается в блок и опускается
+                if (messageSize != 0)
+                {
+                    uint32_t stampSize = snprintf(message + messageSize - 1, POOL_BLOCK_SIZE - messageSize + 1,
+                                                  " sof=%u+%u t=%" PRIu32 "\n", stamp.frame, stamp.offset, timestamp);
+                    if (messageSize - 1 + stampSize >= POOL_BLOCK_SIZE)
+                    {
+                        stampSize = snprintf(message + messageSize - 1, POOL_BLOCK_SIZE - messageSize + 1,
+                                             " sof=%u+%u\n", stamp.frame, stamp.offset);
+                    }
+                    messageSize += stampSize - 1;
+                }
+                setBufferSize(buffer, messageSize < POOL_BLOCK_SIZE ? messageSize : POOL_BLOCK_SIZE - 1);
+                getUsb()->sendTelemetry(buffer, 0);
+            }
         }
+        
+        // Журнал пишется и при закрытом USB, после отправки строки:
+        // операция с flash останавливает ядро на десятки мс
+        addHistorySample(0, temperature, getThermometer()->getSampleTime(), timestamp);
+    }
+}
 
-        previousTime = currentTime;        
+void checkStack(void)
+{
+    static const uint32_t stack_check_period = 1000;
+    static uint32_t previousTime = 0;
+    static bool isWarned = false;
+    uint32_t currentTime = getOneWireTimer()->getTime();
+    
+    if (isWarned == true || currentTime - previousTime < stack_check_period)
+    {
+        return;
+    }
+    previousTime = currentTime;
+    
+    if (isStackHeadroomLow() == true && getUsb()->isOpened() == true)
+    {
+        StackUsage usage = { 0 };
+        getStackUsage(&usage);
+        
+        Message message = { 0 };
+        sprintf(message, "warning: stack headroom %i bytes\n", (int)(usage.stackSize - usage.stackUsed));
+        getUsb()->write(message);
+        isWarned = true;
     }
 }
 
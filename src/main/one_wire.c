@@ -1,56 +1,76 @@
 #include "mcu_support_package/inc/stm32f10x.h"
 
 #include "one_wire.h"
+#include "one_wire_slots.h"
 #include "timer.h"
+#include "cycle_counter.h"
+#include "hal.h"
+#include "dispatch.h"
+#include "ram_code.h"
 
 #include <limits.h>
 
 typedef struct
 ClassOneWire
 {
+#if !defined(USE_STATIC_DISPATCH)
     OneWire m_oneWire;
+#endif
 /*private:*/
     uint32_t m_apb1Periph;
     uint32_t m_apb2Periph;
     USART_TypeDef *m_usartN;
     GPIO_TypeDef *m_gpioPort;
     uint16_t m_gpioPin;
+    uint16_t m_resetBaudRate;
+    uint16_t m_standartBaudRate;
+    OneWireStatistics m_statistics;
 } ClassOneWire;
 
 static const uint16_t no_pulse                    = 0x00UL;
 static const uint16_t reset_pulse                 = 0xF0UL;
-static const uint16_t zero_bit_pulse              = 0x00UL;
-static const uint16_t one_bit_pulse               = 0xFFUL;
-static const uint16_t read_slot                   = 0xFFUL;
 static const uint32_t one_wire_reset_baud_rate    = 9600;
 static const uint32_t one_wire_standart_baud_rate = 115200;
+static const uint32_t one_wire_reset_retries      = 2;
 
-static void openOneWire(void);
-static void closeOneWire(void);
-static bool isOneWireBusy(void);
+DISPATCH_METHOD void openOneWire(void);
+DISPATCH_METHOD void closeOneWire(void);
+DISPATCH_METHOD bool isOneWireBusy(void);
 static bool makeOneWireResetPulse(void);
 static void sendOneWireData(const char *data, const uint32_t dataSize);
 static void receiveOneWireData(char *data, const uint32_t dataSize);
 static void searchOneWireDevices(uint64_t *serialNumber);
-static void makeOneWireTransaction(const RomCommand romCommand, const uint64_t serialNumber,
-                                   const FunctionCommand functionCommand, char *data);
+static void processOneWireTransaction(const RomCommand romCommand, const uint64_t serialNumber,
+                                      const FunctionCommand functionCommand, char *data,
+                                      const uint32_t dataSize);
+DISPATCH_METHOD bool makeOneWireTransaction(const RomCommand romCommand, const uint64_t serialNumber,
+                                   const FunctionCommand functionCommand, char *data, const uint32_t dataSize);
+DISPATCH_METHOD const OneWireStatistics *getOneWireStatistics(void);
 
+#if !defined(USE_STATIC_DISPATCH)
 static OneWire *oneWirePtr = 0;
+#endif
 
 static ClassOneWire oneWire = 
 {
+#if !defined(USE_STATIC_DISPATCH)
     .m_oneWire =
     {
         .open = openOneWire,
         .close = closeOneWire,
         .isBusy = isOneWireBusy,
-        .makeTransaction = makeOneWireTransaction
+        .makeTransaction = makeOneWireTransaction,
+        .getStatistics = getOneWireStatistics
     },
+#endif
     .m_apb1Periph = RCC_APB1Periph_USART3,
     .m_apb2Periph = RCC_APB2Periph_GPIOB | RCC_APB2Periph_AFIO,
     .m_usartN = USART3,
     .m_gpioPort = GPIOB,
-    .m_gpioPin = GPIO_Pin_10
+    .m_gpioPin = GPIO_Pin_10,
+    .m_resetBaudRate = 0,
+    .m_standartBaudRate = 0,
+    .m_statistics = { 0 }
 };
 
 static void initOneWire(ClassOneWire *oneWire)
@@ -82,9 +102,18 @@ static void initOneWire(ClassOneWire *oneWire)
     
     USART_Init(oneWire->m_usartN, &newOneWire);
     
+    // Значения BRR для переключения скоростей при импульсе сброса
+    RCC_ClocksTypeDef clocks;
+    RCC_GetClocksFreq(&clocks);
+    uint32_t apbClock = oneWire->m_usartN == USART1 ? clocks.PCLK2_Frequency : clocks.PCLK1_Frequency;
+    oneWire->m_resetBaudRate = getUsartBaudRateRegister(apbClock, one_wire_reset_baud_rate);
+    oneWire->m_standartBaudRate = getUsartBaudRateRegister(apbClock, one_wire_standart_baud_rate);
+    
     getOneWireTimer()->start(1);
+    enableCycleCounter();
 }
 
+#if !defined(USE_STATIC_DISPATCH)
 const OneWire *getOneWire(void)
 {
     if (oneWirePtr == 0)
@@ -95,20 +124,26 @@ const OneWire *getOneWire(void)
     
     return oneWirePtr;
 }
+#else
+void initOneWireModule(void)
+{
+    initOneWire(&oneWire);
+}
+#endif //USE_STATIC_DISPATCH
 
-static void openOneWire(void)
+DISPATCH_METHOD void openOneWire(void)
 {
     USART_HalfDuplexCmd(oneWire.m_usartN, ENABLE);
     USART_Cmd(oneWire.m_usartN, ENABLE);
 }
 
-static void closeOneWire(void)
+DISPATCH_METHOD void closeOneWire(void)
 {
     USART_HalfDuplexCmd(oneWire.m_usartN, DISABLE);
     USART_Cmd(oneWire.m_usartN, DISABLE);
 }
 
-static bool isOneWireBusy(void)
+DISPATCH_METHOD bool isOneWireBusy(void)
 {
     uint8_t data = one_bit_pulse;
     receiveOneWireData((char *)&data, 1);
@@ -117,24 +152,19 @@ static bool isOneWireBusy(void)
 
 static bool makeOneWireResetPulse(void)
 {
-    if (GPIO_ReadInputDataBit(oneWire.m_gpioPort, oneWire.m_gpioPin) == 0)
+    if (readGpioPin(oneWire.m_gpioPort, oneWire.m_gpioPin) == false)
     {
         return false;
     }
     
-    USART_InitTypeDef newOneWire;
-    USART_StructInit(&newOneWire);
-    
-    newOneWire.USART_BaudRate = one_wire_reset_baud_rate;
-    USART_Init(oneWire.m_usartN, &newOneWire);
+    setUsartBaudRate(oneWire.m_usartN, oneWire.m_resetBaudRate);
     
-    USART_ClearFlag(oneWire.m_usartN, USART_FLAG_TC);
-	USART_SendData(oneWire.m_usartN, reset_pulse);
-	while (USART_GetFlagStatus(oneWire.m_usartN, USART_FLAG_TC) == RESET) { }
-    uint16_t callback = USART_ReceiveData(oneWire.m_usartN);
+    clearUsartTransmitted(oneWire.m_usartN);
+    writeUsartData(oneWire.m_usartN, reset_pulse);
+    while (isUsartTransmitted(oneWire.m_usartN) == false) { }
+    uint16_t callback = readUsartData(oneWire.m_usartN);
     
-    newOneWire.USART_BaudRate = one_wire_standart_baud_rate;
-    USART_Init(oneWire.m_usartN, &newOneWire);
+    setUsartBaudRate(oneWire.m_usartN, oneWire.m_standartBaudRate);
     
     if (callback != reset_pulse && callback != no_pulse)
     {
@@ -144,38 +174,49 @@ static bool makeOneWireResetPulse(void)
     return false;
 }
 
-static void sendOneWireData(const char *data, const uint32_t dataSize)
+RAM_FUNCTION static void sendOneWireData(const char *data, const uint32_t dataSize)
 {
     for (uint32_t i = 0; i < dataSize; i++)
     {
+#if defined(USE_ONE_WIRE_BYTE_PROFILE)
+        uint32_t startTime = getCycleCounter();
+#endif //USE_ONE_WIRE_BYTE_PROFILE
+        
+        uint16_t slots[CHAR_BIT];
+        encodeOneWireSlots((uint8_t)data[i], slots);
+        
         for (uint32_t j = 0; j < CHAR_BIT; j++)
         {
-            uint16_t bit = data[i] & (1 << j) ? one_bit_pulse : zero_bit_pulse;
-            USART_SendData(oneWire.m_usartN, bit);
-            while (USART_GetFlagStatus(oneWire.m_usartN, USART_FLAG_TC) == RESET) { }
+            writeUsartData(oneWire.m_usartN, slots[j]);
+            while (isUsartTransmitted(oneWire.m_usartN) == false) { }
         }
+        
+#if defined(USE_ONE_WIRE_BYTE_PROFILE)
+        addHistogramSample(&oneWire.m_statistics.byteCycles, getCycleCounter() - startTime);
+#endif //USE_ONE_WIRE_BYTE_PROFILE
     }
 }
 
-static void receiveOneWireData(char *data, const uint32_t dataSize)
+RAM_FUNCTION static void receiveOneWireData(char *data, const uint32_t dataSize)
 {
     for (uint32_t i = 0; i < dataSize; i++)
     {
-        uint8_t byte = 0;
+        uint16_t echoes[CHAR_BIT];
+#if defined(USE_ONE_WIRE_BYTE_PROFILE)
+        uint32_t startTime = getCycleCounter();
+#endif //USE_ONE_WIRE_BYTE_PROFILE
         
         for (uint32_t j = 0; j < CHAR_BIT; j++)
         {
-            USART_SendData(oneWire.m_usartN, read_slot);
-            while (USART_GetFlagStatus(oneWire.m_usartN, USART_FLAG_TC) == RESET) { }
-            uint16_t bit = USART_ReceiveData(oneWire.m_usartN);
-            
-            if (bit == one_bit_pulse)
-            {
-                byte |= (1 << j);
-            }
+            writeUsartData(oneWire.m_usartN, read_slot);
+            while (isUsartTransmitted(oneWire.m_usartN) == false) { }
+            echoes[j] = readUsartData(oneWire.m_usartN);
         }
         
-        data[i] = (char)byte;
+        data[i] = (char)decodeOneWireSlots(echoes);
+#if defined(USE_ONE_WIRE_BYTE_PROFILE)
+        addHistogramSample(&oneWire.m_statistics.byteCycles, getCycleCounter() - startTime);
+#endif //USE_ONE_WIRE_BYTE_PROFILE
     }
 }
 
@@ -209,14 +250,10 @@ static void searchOneWireDevices(uint64_t *serialNumber)
     }*/
 }
 
-static void makeOneWireTransaction(const RomCommand romCommand, const uint64_t serialNumber,
-                                   const FunctionCommand functionCommand, char *data)
-{   
-    if (makeOneWireResetPulse() == false)
-    {
-        return;
-    }
-    
+static void processOneWireTransaction(const RomCommand romCommand, const uint64_t serialNumber,
+                                      const FunctionCommand functionCommand, char *data,
+                                      const uint32_t dataSize)
+{
     sendOneWireData((const char *)&romCommand, 1);
     switch (romCommand)
     {
@@ -245,12 +282,12 @@ static void makeOneWireTransaction(const RomCommand romCommand, const uint64_t s
                 }
                 case WRITE_SCRATCHPAD:
                 {
-                    sendOneWireData(data, 3);
+                    sendOneWireData(data, dataSize);
                     return;
                 }
                 case READ_SCRATCHPAD:
                 {
-                    receiveOneWireData(data, 8);
+                    receiveOneWireData(data, dataSize < NUMBER_OF_REGISTERS ? dataSize : NUMBER_OF_REGISTERS);
                     return;
                 }
                 case COPY_SCRATCHPAD:
@@ -269,3 +306,37 @@ static void makeOneWireTransaction(const RomCommand romCommand, const uint64_t s
         }
     }
 }                             
+
+//----------------------------------------------------------------//
+//         Транзакция OneWire с повтором сброса и замером         //
+//----------------------------------------------------------------//
+DISPATCH_METHOD bool makeOneWireTransaction(const RomCommand romCommand, const uint64_t serialNumber,
+                                   const FunctionCommand functionCommand, char *data, const uint32_t dataSize)
+{
+    uint32_t startTime = getCycleCounter();
+    oneWire.m_statistics.transactions++;
+
+    bool isPresent = makeOneWireResetPulse();
+    for (uint32_t i = 0; i < one_wire_reset_retries && isPresent == false; i++)
+    {
+        oneWire.m_statistics.retries++;
+        isPresent = makeOneWireResetPulse();
+    }
+
+    if (isPresent == false)
+    {
+        oneWire.m_statistics.presenceFailures++;
+        return false;
+    }
+
+    processOneWireTransaction(romCommand, serialNumber, functionCommand, data, dataSize);
+
+    uint32_t transactionTime = cyclesToMicroseconds(getCycleCounter() - startTime);
+    addHistogramSample(&oneWire.m_statistics.transactionTime, transactionTime);
+    return true;
+}
+
+DISPATCH_METHOD const OneWireStatistics *getOneWireStatistics(void)
+{
+    return &oneWire.m_statistics;
+}
@@ -1,9 +1,16 @@
 #pragma once
 
 #include "thermometer.h"
+#include "histogram.h"
+#include "dispatch.h"
 
 #include <stdbool.h>
 
+// Гистограмма тактов ядра на байт в циклах слотов (byte_cyc в "stats").
+// Замер добавляет вызов addHistogramSample на каждый байт в горячем
+// пути, поэтому включается только для сравнения сборок на плате
+//#define USE_ONE_WIRE_BYTE_PROFILE
+
 typedef enum RomCommand
 {
     SEARCH_ROM   = 0xF0UL,
@@ -13,13 +20,54 @@ typedef enum RomCommand
     ALARM_SEARCH = 0xECUL
 } RomCommand;
 
+// Счётчики состояния шины OneWire
+typedef struct OneWireStatistics
+{
+    uint32_t transactions;
+    uint32_t presenceFailures;
+    uint32_t retries;
+    Histogram transactionTime; // мкс
+#if defined(USE_ONE_WIRE_BYTE_PROFILE)
+    Histogram byteCycles;      // такты ядра на байт (слоты + ожидание TC)
+#endif //USE_ONE_WIRE_BYTE_PROFILE
+} OneWireStatistics;
+
+// dataSize - длина data функциональной команды: сколько байт записать
+// (WRITE_SCRATCHPAD) или прочитать из блокнота (READ_SCRATCHPAD, не
+// больше NUMBER_OF_REGISTERS). Чтение короче блокнота обрывается сбросом
+// следующей транзакции. Команды ROM передают 8 байт номера
 typedef struct OneWire
 {
     void (*open)(void);
     void (*close)(void);
     bool (*isBusy)(void);
-    void (*makeTransaction)(const RomCommand romCommand, const uint64_t serialNumber, 
-                            const FunctionCommand functionCommand, char *data);
+    bool (*makeTransaction)(const RomCommand romCommand, const uint64_t serialNumber, 
+                            const FunctionCommand functionCommand, char *data, const uint32_t dataSize);
+    const OneWireStatistics *(*getStatistics)(void);
 } OneWire;
 
+#if defined(USE_STATIC_DISPATCH)
+void openOneWire(void);
+void closeOneWire(void);
+bool isOneWireBusy(void);
+bool makeOneWireTransaction(const RomCommand romCommand, const uint64_t serialNumber,
+                            const FunctionCommand functionCommand, char *data, const uint32_t dataSize);
+const OneWireStatistics *getOneWireStatistics(void);
+
+static inline const OneWire *getOneWire(void)
+{
+    static const OneWire oneWire =
+    {
+        .open = openOneWire,
+        .close = closeOneWire,
+        .isBusy = isOneWireBusy,
+        .makeTransaction = makeOneWireTransaction,
+        .getStatistics = getOneWireStatistics
+    };
+    return &oneWire;
+}
+
+void initOneWireModule(void);
+#else
 const OneWire *getOneWire(void);
+#endif //USE_STATIC_DISPATCH
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+#include <limits.h>
+
+//----------------------------------------------------------------//
+//        Кодирование битов 1-Wire в кадры USART и обратно        //
+//----------------------------------------------------------------//
+// Кадр 0x00 - слот записи 0, кадр 0xFF - слот записи 1 или чтения.
+// При чтении датчик удерживает линию, и эхо кадра отличается от 0xFF.
+static const uint16_t zero_bit_pulse = 0x00UL;
+static const uint16_t one_bit_pulse  = 0xFFUL;
+static const uint16_t read_slot      = 0xFFUL;
+
+static inline void encodeOneWireSlots(const uint8_t byte, uint16_t *slots)
+{
+    for (uint32_t j = 0; j < CHAR_BIT; j++)
+    {
+        slots[j] = byte & (1 << j) ? one_bit_pulse : zero_bit_pulse;
+    }
+}
+
+static inline uint8_t decodeOneWireSlots(const uint16_t *echoes)
+{
+    uint8_t byte = 0;
+
+    for (uint32_t j = 0; j < CHAR_BIT; j++)
+    {
+        if (echoes[j] == one_bit_pulse)
+        {
+            byte |= (1 << j);
+        }
+    }
+
+    return byte;
+}
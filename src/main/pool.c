@@ -0,0 +1,195 @@
+#include "mcu_support_package/inc/stm32f10x.h"
+
+#include "pool.h"
+
+//----------------------------------------------------------------//
+//                       Блок пула буферов                        //
+//----------------------------------------------------------------//
+typedef struct
+Block
+{
+    BufferHandle m_next;
+    uint8_t m_references;
+    uint8_t m_size;
+    char m_data[POOL_BLOCK_SIZE];
+} Block;
+
+//----------------------------------------------------------------//
+//         Блоки пула и список свободных блоков (стек LIFO)       //
+//----------------------------------------------------------------//
+static Block blocks[POOL_BLOCK_COUNT];
+static BufferHandle freeList = NO_BUFFER;
+static uint32_t freeCount = 0;
+static bool isPoolInitialized = false;
+
+//----------------------------------------------------------------//
+//       Критическая секция: пул доступен из прерываний USB       //
+//----------------------------------------------------------------//
+static inline uint32_t enterCriticalSection(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    return primask;
+}
+
+static inline void leaveCriticalSection(const uint32_t primask)
+{
+    __set_PRIMASK(primask);
+}
+
+static void initPool(void)
+{
+    for (uint32_t i = 0; i < POOL_BLOCK_COUNT; i++)
+    {
+        blocks[i].m_next = (i + 1 < POOL_BLOCK_COUNT) ? (BufferHandle)(i + 1) : NO_BUFFER;
+        blocks[i].m_references = 0;
+    }
+
+    freeList = 0;
+    freeCount = POOL_BLOCK_COUNT;
+    isPoolInitialized = true;
+}
+
+//----------------------------------------------------------------//
+//     Выделение блока; reserve блоков остаются другим клиентам   //
+//----------------------------------------------------------------//
+BufferHandle allocateBuffer(const uint32_t reserve)
+{
+    uint32_t primask = enterCriticalSection();
+
+    if (isPoolInitialized == false)
+    {
+        initPool();
+    }
+
+    if (freeCount <= reserve)
+    {
+        leaveCriticalSection(primask);
+        return NO_BUFFER;
+    }
+
+    BufferHandle buffer = freeList;
+    freeList = blocks[buffer].m_next;
+    freeCount--;
+
+    blocks[buffer].m_next = NO_BUFFER;
+    blocks[buffer].m_references = 1;
+    blocks[buffer].m_size = 0;
+    blocks[buffer].m_data[0] = '\0';
+
+    leaveCriticalSection(primask);
+    return buffer;
+}
+
+void retainBuffer(const BufferHandle buffer)
+{
+    uint32_t primask = enterCriticalSection();
+    blocks[buffer].m_references++;
+    leaveCriticalSection(primask);
+}
+
+void releaseBuffer(const BufferHandle buffer)
+{
+    if (buffer == NO_BUFFER)
+    {
+        return;
+    }
+
+    uint32_t primask = enterCriticalSection();
+
+    if (--blocks[buffer].m_references == 0)
+    {
+        blocks[buffer].m_next = freeList;
+        freeList = buffer;
+        freeCount++;
+    }
+
+    leaveCriticalSection(primask);
+}
+
+char *getBufferData(const BufferHandle buffer)
+{
+    return blocks[buffer].m_data;
+}
+
+uint32_t getBufferSize(const BufferHandle buffer)
+{
+    return blocks[buffer].m_size;
+}
+
+void setBufferSize(const BufferHandle buffer, const uint32_t size)
+{
+    blocks[buffer].m_size = size < POOL_BLOCK_SIZE ? size : POOL_BLOCK_SIZE - 1;
+    blocks[buffer].m_data[blocks[buffer].m_size] = '\0';
+}
+
+uint32_t getFreeBufferCount(void)
+{
+    return isPoolInitialized == true ? freeCount : POOL_BLOCK_COUNT;
+}
+
+//----------------------------------------------------------------//
+//                  Очередь номеров блоков пула                   //
+//----------------------------------------------------------------//
+bool pushBufferQueue(BufferQueue *queue, const BufferHandle buffer)
+{
+    uint32_t primask = enterCriticalSection();
+
+    if (queue->m_count == POOL_BLOCK_COUNT)
+    {
+        leaveCriticalSection(primask);
+        return false;
+    }
+
+    queue->m_handles[queue->m_tail] = buffer;
+    queue->m_tail = (queue->m_tail + 1) % POOL_BLOCK_COUNT;
+    queue->m_count++;
+
+    leaveCriticalSection(primask);
+    return true;
+}
+
+BufferHandle popBufferQueue(BufferQueue *queue)
+{
+    uint32_t primask = enterCriticalSection();
+
+    if (queue->m_count == 0)
+    {
+        leaveCriticalSection(primask);
+        return NO_BUFFER;
+    }
+
+    BufferHandle buffer = queue->m_handles[queue->m_head];
+    queue->m_head = (queue->m_head + 1) % POOL_BLOCK_COUNT;
+    queue->m_count--;
+
+    leaveCriticalSection(primask);
+    return buffer;
+}
+
+uint32_t getBufferQueueCount(const BufferQueue *queue)
+{
+    return queue->m_count;
+}
+
+BufferHandle replaceBufferQueue(BufferQueue *queue, const BufferHandle buffer,
+                                bool (*isMatch)(const BufferHandle queued, const BufferHandle buffer))
+{
+    uint32_t primask = enterCriticalSection();
+
+    // С конца очереди: заменяется самый свежий из подходящих блоков
+    for (uint32_t i = queue->m_count; i > 0; i--)
+    {
+        uint32_t index = (queue->m_head + i - 1) % POOL_BLOCK_COUNT;
+        BufferHandle queued = queue->m_handles[index];
+        if (isMatch(queued, buffer) == true)
+        {
+            queue->m_handles[index] = buffer;
+            leaveCriticalSection(primask);
+            return queued;
+        }
+    }
+
+    leaveCriticalSection(primask);
+    return NO_BUFFER;
+}
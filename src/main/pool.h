@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Размер данных блока: сообщение USB целиком вместе с завершающим нулём
+#define POOL_BLOCK_SIZE  72
+// Общее число блоков, которое делят между собой приём и передача
+#define POOL_BLOCK_COUNT 16
+
+// Номер блока в пуле. Передаётся между производителями и USB вместо копий
+typedef uint8_t BufferHandle;
+
+#define NO_BUFFER ((BufferHandle)0xFF)
+
+// Очередь номеров блоков (кольцевой буфер)
+typedef struct BufferQueue
+{
+    BufferHandle m_handles[POOL_BLOCK_COUNT];
+    uint8_t m_head;
+    uint8_t m_tail;
+    uint8_t m_count;
+} BufferQueue;
+
+BufferHandle allocateBuffer(const uint32_t reserve);
+void retainBuffer(const BufferHandle buffer);
+void releaseBuffer(const BufferHandle buffer);
+char *getBufferData(const BufferHandle buffer);
+uint32_t getBufferSize(const BufferHandle buffer);
+void setBufferSize(const BufferHandle buffer, const uint32_t size);
+uint32_t getFreeBufferCount(void);
+
+bool pushBufferQueue(BufferQueue *queue, const BufferHandle buffer);
+BufferHandle popBufferQueue(BufferQueue *queue);
+uint32_t getBufferQueueCount(const BufferQueue *queue);
+
+// Заменяет в очереди последний блок, для которого isMatch(queued, buffer)
+// истинно, на buffer и возвращает заменённый (NO_BUFFER - совпадения
+// нет, очередь не изменена). Поиск и замена идут в одной критической
+// секции: прерывание не заберёт блок между ними
+BufferHandle replaceBufferQueue(BufferQueue *queue, const BufferHandle buffer,
+                                bool (*isMatch)(const BufferHandle queued, const BufferHandle buffer));
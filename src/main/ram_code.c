@@ -0,0 +1,32 @@
+#include "ram_code.h"
+
+#include "mcu_support_package/inc/stm32f10x.h"
+
+#include <string.h>
+
+//----------------------------------------------------------------//
+//                   Таблица векторов в RAM                       //
+//----------------------------------------------------------------//
+#if defined(USE_RAM_VECTOR_TABLE) && !defined(HOST_SIMULATOR)
+// STM32F103 MD: 16 системных векторов и 43 прерывания. VTOR требует
+// выравнивания на степень двойки не меньше размера таблицы - 256 байт
+#define VECTOR_TABLE_SIZE (16 + 43)
+
+static uint32_t ramVectorTable[VECTOR_TABLE_SIZE] __attribute__((aligned(256)));
+
+// Маска прерываний вызывающего восстанавливается, а не снимается
+void relocateVectorTable(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    memcpy(ramVectorTable, (const void *)FLASH_BASE, sizeof(ramVectorTable));
+
+    __disable_irq();
+    SCB->VTOR = (uint32_t)ramVectorTable;
+    __DSB();
+    __set_PRIMASK(primask);
+}
+#else
+void relocateVectorTable(void)
+{
+}
+#endif //USE_RAM_VECTOR_TABLE
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+
+//----------------------------------------------------------------//
+//            Исполнение горячего кода из RAM (SRAM)              //
+//----------------------------------------------------------------//
+// На 72 МГц flash работает с двумя тактами ожидания; буфер предвыборки
+// скрывает их на линейном коде, но не на переходах в коротких циклах и
+// при входе в прерывание. С USE_RAM_CODE функции, помеченные
+// RAM_FUNCTION, попадают в секцию .ram_code и копируются в RAM при
+// старте вместе с .data: в stack_protection.sct - областью RW_IRAM1
+// (там же при USE_RAM_CODE целиком лежат usb_istr.o, usb_int.o и
+// usb_mem.o из библиотеки USB), в STM32F10x.ld - секцией .data.
+// Выигрыш не гарантирован: код из SRAM выбирается по системной шине
+// наравне с данными и стеком, поэтому решение принимается по замерам
+// образа замеров (benchmark.h) с USE_RAM_CODE и без него.
+// Определение USE_RAM_CODE в stack_protection.sct должно совпадать.
+//#define USE_RAM_CODE
+
+// Таблица векторов в RAM (SCB->VTOR): вектор выбирается без тактов
+// ожидания flash, но по той же шине, что и сохранение контекста в стек
+//#define USE_RAM_VECTOR_TABLE
+
+#if defined(USE_RAM_CODE) && !defined(HOST_SIMULATOR)
+#define RAM_FUNCTION __attribute__((section(".ram_code"), noinline))
+#else
+#define RAM_FUNCTION
+#endif
+
+// Вызывается в начале main(); без USE_RAM_VECTOR_TABLE ничего не делает
+void relocateVectorTable(void);
@@ -0,0 +1,191 @@
+#include "resolution_policy.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+// Минимальный интервал между перезаписями разрешения, мс
+static const uint32_t resolution_policy_dwell_time = 1000;
+// Расстояние до порога тревоги, ближе которого нужен быстрый опрос, м°C
+static const int32_t alarm_proximity_margin = 1000;
+// Самое медленное разрешение рядом с порогом тревоги
+static const uint32_t alarm_resolution_index = 1;
+// Сглаживание оценки скорости изменения: вес нового значения 1/4
+static const uint32_t slope_smoothing_shift = 2;
+// Значение блокнота DS18B20 до первого преобразования (+85 °C)
+static const uint16_t power_on_temperature = 0x0550;
+
+//----------------------------------------------------------------//
+//                 Политика разрешения термометра                 //
+//----------------------------------------------------------------//
+typedef struct ResolutionPolicy
+{
+    PolicyMode m_mode;
+    uint32_t m_targetRate;
+    uint16_t m_temperature;
+    uint32_t m_sampleTime;
+    bool m_hasSample;
+    int32_t m_slope;
+    uint32_t m_startTime;
+    uint32_t m_changeTime;
+    uint64_t m_errorSum;
+    uint64_t m_fixedErrorSum;
+    PolicyStatistics m_statistics;
+} ResolutionPolicy;
+
+// С NUMBER_OF_THERMOMETERS == 1 политика одна, как и экземпляр термометра
+static ResolutionPolicy policy = { .m_mode = POLICY_FIXED };
+
+static Resolution getResolutionByIndex(const uint32_t index)
+{
+    return (Resolution)((index << 5) | 0x1FUL);
+}
+
+// 93.75 мс для 9 бит, удваивается с каждым битом
+static uint32_t getIndexConversionTime(const uint32_t index)
+{
+    return 750 >> (3 - index);
+}
+
+//----------------------------------------------------------------//
+//                   Оценка погрешности отсчёта                   //
+//----------------------------------------------------------------//
+static uint32_t estimateSampleError(const uint32_t index, const int32_t slope)
+{
+    // Половина шага квантования: 250 м°C для 9 бит ... 31 м°C для 12 бит
+    uint32_t quantization = 250 >> index;
+    return quantization + (uint32_t)slope * getIndexConversionTime(index) / 1000;
+}
+
+static int32_t toMillidegrees(const uint16_t temperature)
+{
+    return (int32_t)(int16_t)temperature * 125 / 2;
+}
+
+//----------------------------------------------------------------//
+//                        Выбор разрешения                        //
+//----------------------------------------------------------------//
+static uint32_t chooseResolutionIndex(void)
+{
+    if (policy.m_mode == POLICY_RATE)
+    {
+        uint32_t period = 1000 / policy.m_targetRate;
+        uint32_t index = 3;
+        while (index > 0 && getIndexConversionTime(index) > period)
+        {
+            index--;
+        }
+        return index;
+    }
+
+    uint32_t bestIndex = 3;
+    for (uint32_t index = 0; index < 3; index++)
+    {
+        if (estimateSampleError(index, policy.m_slope) < estimateSampleError(bestIndex, policy.m_slope))
+        {
+            bestIndex = index;
+        }
+    }
+
+    int32_t temperature = toMillidegrees(policy.m_temperature);
+    int32_t lowAlarm = (int32_t)getThermometer()->getLowAlarmTrigger() * 1000;
+    int32_t highAlarm = (int32_t)getThermometer()->getHighAlarmTrigger() * 1000;
+    bool isNearAlarm = temperature - lowAlarm < alarm_proximity_margin ||
+                       highAlarm - temperature < alarm_proximity_margin;
+    if (isNearAlarm == true && bestIndex > alarm_resolution_index)
+    {
+        bestIndex = alarm_resolution_index;
+    }
+
+    return bestIndex;
+}
+
+//----------------------------------------------------------------//
+//                Учёт отсчёта и смена разрешения                 //
+//----------------------------------------------------------------//
+// parameter: разрешение (Resolution) для POLICY_FIXED, отсчётов в секунду
+// для POLICY_RATE; для POLICY_ADAPTIVE не используется
+void setResolutionPolicy(const PolicyMode mode, const uint32_t parameter)
+{
+    memset(&policy, 0, sizeof(policy));
+    policy.m_mode = mode;
+
+    if (mode == POLICY_RATE)
+    {
+        policy.m_targetRate = parameter != 0 ? parameter : 1;
+    }
+    else if (mode == POLICY_FIXED && parameter != 0)
+    {
+        getThermometer()->setResolution((Resolution)parameter);
+    }
+}
+
+PolicyMode getResolutionPolicy(void)
+{
+    return policy.m_mode;
+}
+
+void updateResolutionPolicy(const uint16_t temperature, const uint32_t sampleTime)
+{
+    // Нулевое время - термометр ещё не прочитан, температура по умолчанию
+    if (sampleTime == 0 || (policy.m_hasSample == true && sampleTime == policy.m_sampleTime))
+    {
+        return;
+    }
+    if (policy.m_hasSample == false && temperature == power_on_temperature)
+    {
+        return;
+    }
+
+    uint32_t index = getThermometer()->getResolution() >> 5;
+    if (policy.m_hasSample == true)
+    {
+        // Изменение в пределах шага квантования - шум, а не наклон сигнала
+        int32_t change = toMillidegrees(temperature) - toMillidegrees(policy.m_temperature);
+        change = (change < 0 ? -change : change) - (int32_t)(500 >> index);
+        int32_t rate = change > 0 ? change * 1000 / (int32_t)(sampleTime - policy.m_sampleTime) : 0;
+        policy.m_slope += (rate - policy.m_slope) >> slope_smoothing_shift;
+    }
+    else
+    {
+        policy.m_startTime = sampleTime;
+        policy.m_changeTime = sampleTime - resolution_policy_dwell_time;
+    }
+
+    policy.m_temperature = temperature;
+    policy.m_sampleTime = sampleTime;
+    policy.m_hasSample = true;
+
+    policy.m_statistics.samples++;
+    policy.m_statistics.resolutionSamples[index]++;
+    policy.m_errorSum += estimateSampleError(index, policy.m_slope);
+    policy.m_fixedErrorSum += estimateSampleError(3, policy.m_slope);
+
+    if (policy.m_mode == POLICY_FIXED || sampleTime - policy.m_changeTime < resolution_policy_dwell_time)
+    {
+        return;
+    }
+
+    uint32_t nextIndex = chooseResolutionIndex();
+    if (nextIndex != index)
+    {
+        getThermometer()->setResolution(getResolutionByIndex(nextIndex));
+        policy.m_changeTime = sampleTime;
+        policy.m_statistics.changes++;
+    }
+}
+
+//----------------------------------------------------------------//
+//                     Итоги работы политики                      //
+//----------------------------------------------------------------//
+void getResolutionPolicyStatistics(PolicyStatistics *statistics)
+{
+    *statistics = policy.m_statistics;
+    statistics->elapsed = policy.m_sampleTime - policy.m_startTime;
+    statistics->slope = (uint32_t)policy.m_slope;
+
+    if (policy.m_statistics.samples != 0)
+    {
+        statistics->meanError = (uint32_t)(policy.m_errorSum / policy.m_statistics.samples);
+        statistics->meanFixedError = (uint32_t)(policy.m_fixedErrorSum / policy.m_statistics.samples);
+    }
+}
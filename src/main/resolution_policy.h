@@ -0,0 +1,45 @@
+#pragma once
+
+#include "thermometer.h"
+
+#include <stdint.h>
+
+//----------------------------------------------------------------//
+//          Выбор разрешения датчика по характеру сигнала         //
+//----------------------------------------------------------------//
+// Погрешность отсчёта оценивается как половина шага квантования плюс
+// изменение температуры за время преобразования: q/2 + |dT/dt| * t_conv.
+// В режиме POLICY_ADAPTIVE выбирается разрешение с наименьшей оценкой
+// (при медленном сигнале - 12 бит, при быстром - 9 бит), а рядом с
+// порогами тревоги - не медленнее RES_10BITS. В режиме POLICY_RATE
+// выбирается наибольшее разрешение, которое успевает за частотой,
+// запрошенной хостом. Регистр конфигурации перезаписывается только при
+// смене разрешения и не чаще, чем раз в resolution_policy_dwell_time.
+
+typedef enum PolicyMode
+{
+    POLICY_FIXED,
+    POLICY_ADAPTIVE,
+    POLICY_RATE
+} PolicyMode;
+
+// Итоги работы политики с момента выбора режима
+typedef struct PolicyStatistics
+{
+    uint32_t samples;                // новые отсчёты
+    uint32_t elapsed;                // мс
+    uint32_t changes;                // перезаписи разрешения
+    uint32_t resolutionSamples[4];   // отсчёты по разрешениям 9..12 бит
+    uint32_t slope;                  // сглаженная |dT/dt|, м°C/с
+    uint32_t meanError;              // средняя оценка погрешности, м°C
+    uint32_t meanFixedError;         // та же оценка при постоянных 12 битах
+} PolicyStatistics;
+
+void setResolutionPolicy(const PolicyMode mode, const uint32_t parameter);
+PolicyMode getResolutionPolicy(void);
+
+// Вызывается после каждого опроса термометра; повторный отсчёт с тем же
+// временем чтения не учитывается
+void updateResolutionPolicy(const uint16_t temperature, const uint32_t sampleTime);
+
+void getResolutionPolicyStatistics(PolicyStatistics *statistics);
@@ -0,0 +1,253 @@
+#include "rollup.h"
+
+#include "usb.h"
+#include "timer.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+// Значение регистра температуры после включения датчика (85 °C)
+static const uint16_t power_on_temperature = 0x0550;
+
+// Длительность периода уровня, мс
+static const uint32_t rollup_period[ROLLUP_LEVEL_COUNT] = { 1000, 60000, 3600000 };
+static const char rollup_level_names[ROLLUP_LEVEL_COUNT] = { 's', 'm', 'h' };
+
+#define ROLLUP_BUCKETS (ROLLUP_SECOND_BUCKETS + ROLLUP_MINUTE_BUCKETS + ROLLUP_HOUR_BUCKETS)
+
+// Проверка бюджета при сборке: при превышении размер массива отрицательный
+typedef char RollupRamBudgetCheck[(sizeof(RollupBucket) * ROLLUP_BUCKETS * NUMBER_OF_THERMOMETERS
+                                   <= ROLLUP_RAM_BUDGET) ? 1 : -1];
+
+//----------------------------------------------------------------//
+//                      Кольца корзин датчика                     //
+//----------------------------------------------------------------//
+typedef struct RollupSensor
+{
+    RollupBucket m_seconds[ROLLUP_SECOND_BUCKETS];
+    RollupBucket m_minutes[ROLLUP_MINUTE_BUCKETS];
+    RollupBucket m_hours[ROLLUP_HOUR_BUCKETS];
+    uint32_t m_sampleTime;
+    bool m_hasSample;
+} RollupSensor;
+
+typedef struct RollupQuery
+{
+    bool m_isActive;
+    RollupLevel m_level;
+    uint32_t m_period;  // текущий период на момент команды
+    uint32_t m_count;
+    uint32_t m_sensor;
+    uint32_t m_ago;
+    uint32_t m_lines;
+    bool m_isHeaderSent;
+} RollupQuery;
+
+static RollupSensor sensors[NUMBER_OF_THERMOMETERS];
+static RollupQuery query = { false, ROLLUP_SECONDS, 0, 0, 0, 0, 0, false };
+
+static RollupBucket *getRing(const uint32_t sensor, const RollupLevel level)
+{
+    switch (level)
+    {
+        case ROLLUP_MINUTES:
+            return sensors[sensor].m_minutes;
+        case ROLLUP_HOURS:
+            return sensors[sensor].m_hours;
+        default:
+            return sensors[sensor].m_seconds;
+    }
+}
+
+uint32_t getRollupDepth(const RollupLevel level)
+{
+    static const uint32_t depth[ROLLUP_LEVEL_COUNT] =
+    {
+        ROLLUP_SECOND_BUCKETS, ROLLUP_MINUTE_BUCKETS, ROLLUP_HOUR_BUCKETS
+    };
+
+    return depth[level];
+}
+
+//----------------------------------------------------------------//
+//                   Обновление сводок отсчётом                   //
+//----------------------------------------------------------------//
+static void addBucketSample(RollupBucket *bucket, const uint32_t period, const int16_t temperature)
+{
+    if (bucket->period != period || bucket->count == 0)
+    {
+        bucket->period = period;
+        bucket->count = 0;
+        bucket->sum = 0;
+        bucket->min = temperature;
+        bucket->max = temperature;
+    }
+
+    bucket->count++;
+    bucket->sum += temperature;
+    bucket->min = temperature < bucket->min ? temperature : bucket->min;
+    bucket->max = temperature > bucket->max ? temperature : bucket->max;
+    bucket->last = temperature;
+}
+
+void addRollupSample(const uint32_t sensor, const uint16_t temperature, const uint32_t sampleTime)
+{
+    if (sensor >= NUMBER_OF_THERMOMETERS)
+    {
+        return;
+    }
+
+    // Нулевое время - термометр ещё не прочитан, температура по умолчанию
+    RollupSensor *rollup = &sensors[sensor];
+    if (sampleTime == 0 || (rollup->m_hasSample == true && sampleTime == rollup->m_sampleTime))
+    {
+        return;
+    }
+    if (rollup->m_hasSample == false && temperature == power_on_temperature)
+    {
+        return;
+    }
+
+    rollup->m_sampleTime = sampleTime;
+    rollup->m_hasSample = true;
+
+    for (uint32_t level = 0; level < ROLLUP_LEVEL_COUNT; level++)
+    {
+        uint32_t period = sampleTime / rollup_period[level];
+        RollupBucket *ring = getRing(sensor, (RollupLevel)level);
+        addBucketSample(&ring[period % getRollupDepth((RollupLevel)level)], period, (int16_t)temperature);
+    }
+}
+
+//----------------------------------------------------------------//
+//                         Чтение корзины                         //
+//----------------------------------------------------------------//
+static bool getBucketAt(const uint32_t sensor, const RollupLevel level, const uint32_t period,
+                        const uint32_t ago, RollupBucket *bucket)
+{
+    if (sensor >= NUMBER_OF_THERMOMETERS || ago >= getRollupDepth(level) || ago > period)
+    {
+        return false;
+    }
+
+    // Ячейка могла быть занята более старым периодом, ещё не перезаписанным
+    const RollupBucket *ring = getRing(sensor, level);
+    const RollupBucket *stored = &ring[(period - ago) % getRollupDepth(level)];
+    if (stored->count == 0 || stored->period != period - ago)
+    {
+        return false;
+    }
+
+    *bucket = *stored;
+    return true;
+}
+
+bool getRollupBucket(const uint32_t sensor, const RollupLevel level, const uint32_t ago, RollupBucket *bucket)
+{
+    return getBucketAt(sensor, level, getOneWireTimer()->getTime() / rollup_period[level], ago, bucket);
+}
+
+//----------------------------------------------------------------//
+//                      Выдача сводок по USB                      //
+//----------------------------------------------------------------//
+static int32_t toMillidegrees(const int32_t temperature)
+{
+    return temperature * 125 / 2;
+}
+
+void startRollupQuery(const RollupLevel level, const uint32_t count)
+{
+    uint32_t depth = getRollupDepth(level);
+
+    query.m_level = level;
+    query.m_period = getOneWireTimer()->getTime() / rollup_period[level];
+    query.m_count = count != 0 && count < depth ? count : depth;
+    query.m_sensor = 0;
+    query.m_ago = 0;
+    query.m_lines = 0;
+    query.m_isHeaderSent = false;
+    query.m_isActive = true;
+}
+
+// Пустые периоды пропускаются без строк; каждая строка ждёт свободный
+// блок пула, поэтому выдача кольца растягивается на несколько итераций
+// главного цикла, но не теряет строк
+static bool writeRollupLine(const RollupBucket *bucket)
+{
+    BufferHandle buffer = getUsb()->allocate();
+    if (buffer == NO_BUFFER)
+    {
+        return false;
+    }
+
+    char *message = getBufferData(buffer);
+    int size = 0;
+    if (bucket == 0)
+    {
+        size = query.m_isHeaderSent == false
+             ? snprintf(message, POOL_BLOCK_SIZE, "rollup: %c n=%" PRIu32 " period=%" PRIu32 " ms\n",
+                        rollup_level_names[query.m_level], query.m_count, rollup_period[query.m_level])
+             : snprintf(message, POOL_BLOCK_SIZE, "rollup: end lines=%" PRIu32 "\n", query.m_lines);
+    }
+    else
+    {
+        // Сумма часа в м°C не помещается в 32 бита
+        int32_t average = (int32_t)((int64_t)bucket->sum * 125 / 2 / (int64_t)bucket->count);
+        size = snprintf(message, POOL_BLOCK_SIZE,
+                        "%" PRIu32 " %c -%" PRIu32 " n=%" PRIu32 " min=%" PRIi32 " max=%" PRIi32
+                        " avg=%" PRIi32 " last=%" PRIi32 "\n",
+                        query.m_sensor, rollup_level_names[query.m_level], query.m_ago, bucket->count,
+                        toMillidegrees(bucket->min), toMillidegrees(bucket->max), average,
+                        toMillidegrees(bucket->last));
+    }
+    setBufferSize(buffer, size > 0 ? (uint32_t)size : 0);
+    getUsb()->send(buffer);
+    return true;
+}
+
+void checkRollupQuery(void)
+{
+    if (query.m_isActive == false)
+    {
+        return;
+    }
+
+    if (getUsb()->isOpened() == false)
+    {
+        query.m_isActive = false;
+        return;
+    }
+
+    if (query.m_isHeaderSent == false)
+    {
+        if (writeRollupLine(0) == false)
+        {
+            return;
+        }
+        query.m_isHeaderSent = true;
+    }
+
+    while (query.m_sensor < NUMBER_OF_THERMOMETERS)
+    {
+        RollupBucket bucket;
+        if (getBucketAt(query.m_sensor, query.m_level, query.m_period, query.m_ago, &bucket) == true)
+        {
+            if (writeRollupLine(&bucket) == false)
+            {
+                return;
+            }
+            query.m_lines++;
+        }
+
+        if (++query.m_ago >= query.m_count)
+        {
+            query.m_ago = 0;
+            query.m_sensor++;
+        }
+    }
+
+    if (writeRollupLine(0) == true)
+    {
+        query.m_isActive = false;
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "thermometer.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//----------------------------------------------------------------//
+//             Сводки температуры за 1 с, 1 мин и 1 ч             //
+//----------------------------------------------------------------//
+// Для каждого датчика и уровня хранится кольцо корзин: минимум,
+// максимум, сумма, число и последнее значение (в 1/16 °C). Корзина
+// помечена номером периода (время / длительность уровня) и лежит в
+// ячейке period % N; устаревшая корзина сбрасывается, когда в её ячейку
+// попадает отсчёт нового периода, поэтому добавление отсчёта - O(1) на
+// уровень без обхода кольца. Хост после обрыва связи забирает сводки
+// командой "rollup s|m|h [n]" вместо потока отдельных отсчётов.
+// Глубина колец задаётся при сборке; объём всех колец не должен
+// превышать ROLLUP_RAM_BUDGET байт, иначе сборка прерывается.
+#ifndef ROLLUP_SECOND_BUCKETS
+#define ROLLUP_SECOND_BUCKETS 60
+#endif
+#ifndef ROLLUP_MINUTE_BUCKETS
+#define ROLLUP_MINUTE_BUCKETS 60
+#endif
+#ifndef ROLLUP_HOUR_BUCKETS
+#define ROLLUP_HOUR_BUCKETS   24
+#endif
+#ifndef ROLLUP_RAM_BUDGET
+#define ROLLUP_RAM_BUDGET     3072
+#endif
+
+typedef enum RollupLevel
+{
+    ROLLUP_SECONDS,
+    ROLLUP_MINUTES,
+    ROLLUP_HOURS,
+    ROLLUP_LEVEL_COUNT
+} RollupLevel;
+
+// Корзина одного периода
+typedef struct RollupBucket
+{
+    uint32_t period; // номер периода от запуска МК
+    uint32_t count;
+    int32_t sum;
+    int16_t min;
+    int16_t max;
+    int16_t last;
+} RollupBucket;
+
+// Вызывается после каждого опроса термометра; повторный отсчёт с тем же
+// временем чтения не учитывается
+void addRollupSample(const uint32_t sensor, const uint16_t temperature, const uint32_t sampleTime);
+
+// Корзина ago периодов назад от текущего (0 - текущий период).
+// Возвращает false, если в периоде не было отсчётов или он вышел из кольца
+bool getRollupBucket(const uint32_t sensor, const RollupLevel level, const uint32_t ago, RollupBucket *bucket);
+uint32_t getRollupDepth(const RollupLevel level);
+
+// Выдача count последних периодов уровня (0 - всё кольцо) строками
+// "<датчик> <уровень> -<ago> n= min= max= avg= last=" в м°C
+void startRollupQuery(const RollupLevel level, const uint32_t count);
+
+// Вызывается из главного цикла: отправляет строки, пока есть блоки пула
+void checkRollupQuery(void);
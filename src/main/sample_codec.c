@@ -0,0 +1,140 @@
+#include "sample_codec.h"
+
+#include <stdbool.h>
+
+//----------------------------------------------------------------//
+//                    Zigzag и varint (LEB128)                    //
+//----------------------------------------------------------------//
+// Zigzag переводит малые по модулю числа обоих знаков в малые
+// беззнаковые: 0, -1, 1, -2 ... -> 0, 1, 2, 3 ...
+static inline uint32_t toZigzag(const int32_t value)
+{
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static inline int32_t fromZigzag(const uint32_t value)
+{
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+// По 7 бит, младшие первыми; старший бит байта - продолжение
+static uint32_t writeVarint(uint32_t value, uint8_t *data)
+{
+    uint32_t size = 0;
+    while (value >= 0x80)
+    {
+        data[size++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    data[size++] = (uint8_t)value;
+
+    return size;
+}
+
+static uint32_t readVarint(const uint8_t *data, const uint32_t dataSize, uint32_t *value)
+{
+    *value = 0;
+    for (uint32_t i = 0; i < dataSize && i < 5; i++)
+    {
+        *value |= (uint32_t)(data[i] & 0x7F) << (7 * i);
+        if ((data[i] & 0x80) == 0)
+        {
+            return i + 1;
+        }
+    }
+
+    return 0;
+}
+
+static bool isKeyframe(const SampleCodec *codec)
+{
+    return codec->count == 0 || (codec->keyframePeriod != 0 && codec->count % codec->keyframePeriod == 0);
+}
+
+//----------------------------------------------------------------//
+//                      Кодирование отсчёта                       //
+//----------------------------------------------------------------//
+void initSampleCodec(SampleCodec *codec, const uint32_t keyframePeriod)
+{
+    codec->time = 0;
+    codec->timeDelta = 0;
+    codec->value = 0;
+    codec->valueDelta = 0;
+    codec->count = 0;
+    codec->keyframePeriod = keyframePeriod;
+}
+
+uint32_t encodeSample(SampleCodec *codec, const uint32_t time, const int16_t value, uint8_t *data)
+{
+    uint32_t size = 0;
+
+    if (isKeyframe(codec) == true)
+    {
+        size += writeVarint(time, data);
+        size += writeVarint(toZigzag(value), data + size);
+        codec->timeDelta = 0;
+        codec->valueDelta = 0;
+    }
+    else
+    {
+        // Время в мс переполняется через 49 суток: разности по модулю 2^32
+        int32_t timeDelta = (int32_t)(time - codec->time);
+        int32_t valueDelta = value - codec->value;
+        size += writeVarint(toZigzag(timeDelta - codec->timeDelta), data);
+        size += writeVarint(toZigzag(valueDelta - codec->valueDelta), data + size);
+        codec->timeDelta = timeDelta;
+        codec->valueDelta = valueDelta;
+    }
+
+    codec->time = time;
+    codec->value = value;
+    codec->count++;
+    return size;
+}
+
+//----------------------------------------------------------------//
+//                     Декодирование отсчёта                      //
+//----------------------------------------------------------------//
+uint32_t decodeSample(SampleCodec *codec, const uint8_t *data, const uint32_t dataSize,
+                      uint32_t *time, int16_t *value)
+{
+    uint32_t first = 0;
+    uint32_t second = 0;
+
+    uint32_t firstSize = readVarint(data, dataSize, &first);
+    if (firstSize == 0)
+    {
+        return 0;
+    }
+    uint32_t secondSize = readVarint(data + firstSize, dataSize - firstSize, &second);
+    if (secondSize == 0)
+    {
+        return 0;
+    }
+
+    if (isKeyframe(codec) == true)
+    {
+        codec->time = first;
+        codec->value = fromZigzag(second);
+        codec->timeDelta = 0;
+        codec->valueDelta = 0;
+    }
+    else
+    {
+        codec->timeDelta += fromZigzag(first);
+        codec->valueDelta += fromZigzag(second);
+        codec->time += (uint32_t)codec->timeDelta;
+        codec->value += codec->valueDelta;
+    }
+
+    // Температура вне int16 - признак повреждённых данных
+    if (codec->value < INT16_MIN || codec->value > INT16_MAX)
+    {
+        return 0;
+    }
+
+    codec->count++;
+    *time = codec->time;
+    *value = (int16_t)codec->value;
+    return firstSize + secondSize;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+
+//----------------------------------------------------------------//
+//         Сжатие ряда отсчётов: delta-of-delta и varint          //
+//----------------------------------------------------------------//
+// Отсчёт - время в мс и температура в 1/16 °C. Опорный отсчёт
+// (keyframe) записывается целиком: время varint, температура zigzag
+// varint. Остальные - разностями вторых порядков: изменение интервала
+// между отсчётами и изменение шага температуры, каждое zigzag varint.
+// При ровном опросе и медленном сигнале обе разности почти всегда
+// укладываются в 7 бит, и отсчёт занимает 2 байта вместо 8 в записи
+// или ~30 в строке телеметрии. Опорным отсчётом начинается каждая
+// страница журнала и каждый кадр выдачи, поэтому они декодируются
+// независимо; keyframePeriod добавляет опорные отсчёты внутри ряда.
+// Модуль не зависит от периферии и собирается декодером на хосте
+// (host/history_decode).
+
+// Наибольший размер одного отсчёта: 5 байт времени и 3 температуры
+#define SAMPLE_CODEC_MAX_SIZE 8
+
+// Состояние кодера или декодера одного ряда
+typedef struct SampleCodec
+{
+    uint32_t time;
+    int32_t timeDelta;
+    int32_t value;
+    int32_t valueDelta;
+    uint32_t count;
+    uint32_t keyframePeriod; // 0 - только первый отсчёт опорный
+} SampleCodec;
+
+void initSampleCodec(SampleCodec *codec, const uint32_t keyframePeriod);
+
+// Возвращает размер записанного отсчёта; data - не меньше SAMPLE_CODEC_MAX_SIZE
+uint32_t encodeSample(SampleCodec *codec, const uint32_t time, const int16_t value, uint8_t *data);
+
+// Возвращает число прочитанных байт; 0 - данные оборваны или повреждены
+uint32_t decodeSample(SampleCodec *codec, const uint8_t *data, const uint32_t dataSize,
+                      uint32_t *time, int16_t *value);
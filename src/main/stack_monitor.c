@@ -0,0 +1,84 @@
+#include "mcu_support_package/inc/stm32f10x.h"
+
+#include "stack_monitor.h"
+
+//----------------------------------------------------------------//
+//     Границы стека и статических данных из скрипта линкера      //
+//----------------------------------------------------------------//
+#if defined(__CC_ARM) || defined(__ARMCC_VERSION)
+// stack_protection.sct: стек расположен в начале RAM, ниже .data и .bss
+extern uint32_t Image$$REGION_STACK$$ZI$$Base;
+extern uint32_t Image$$REGION_STACK$$ZI$$Limit;
+extern uint32_t Image$$RW_IRAM1$$RW$$Length;
+extern uint32_t Image$$RW_IRAM1$$ZI$$Length;
+extern uint32_t Image$$RW_IRAM1$$RO$$Length;
+
+#define STACK_BOTTOM      ((uint32_t *)&Image$$REGION_STACK$$ZI$$Base)
+#define STACK_TOP         ((uint32_t *)&Image$$REGION_STACK$$ZI$$Limit)
+#define STATIC_DATA_SIZE  ((uint32_t)&Image$$RW_IRAM1$$RW$$Length)
+#define STATIC_ZERO_SIZE  ((uint32_t)&Image$$RW_IRAM1$$ZI$$Length)
+#define RAM_CODE_SIZE     ((uint32_t)&Image$$RW_IRAM1$$RO$$Length)
+#else
+// STM32F10x.ld: стек растёт от конца RAM вниз, к концу .bss
+extern uint32_t _estack;
+extern uint32_t _sdata;
+extern uint32_t _edata;
+extern uint32_t _sbss;
+extern uint32_t _ebss;
+extern uint32_t _sram_code;
+extern uint32_t _eram_code;
+extern uint32_t end;
+
+#define STACK_BOTTOM      ((uint32_t *)&end)
+#define STACK_TOP         ((uint32_t *)&_estack)
+// Код из RAM копируется вместе с .data и входит в её размер
+#define RAM_CODE_SIZE     ((uint32_t)&_eram_code - (uint32_t)&_sram_code)
+#define STATIC_DATA_SIZE  ((uint32_t)&_edata - (uint32_t)&_sdata - RAM_CODE_SIZE)
+#define STATIC_ZERO_SIZE  ((uint32_t)&_ebss - (uint32_t)&_sbss)
+#endif
+
+static const uint32_t stack_paint_pattern = 0xDEADBEEFUL;
+
+//----------------------------------------------------------------//
+//       Закраска свободной части стека при старте программы      //
+//----------------------------------------------------------------//
+void paintStack(void)
+{
+    // Всё, что ниже текущей вершины, ещё не использовалось
+    uint32_t *stackPtr = (uint32_t *)__get_MSP();
+
+    for (uint32_t *word = STACK_BOTTOM; word < stackPtr; word++)
+    {
+        *word = stack_paint_pattern;
+    }
+}
+
+//----------------------------------------------------------------//
+//       Максимальная глубина стека по нетронутой закраске        //
+//----------------------------------------------------------------//
+static uint32_t getStackHighWaterMark(void)
+{
+    uint32_t *word = STACK_BOTTOM;
+
+    while (word < STACK_TOP && *word == stack_paint_pattern)
+    {
+        word++;
+    }
+
+    return (uint32_t)STACK_TOP - (uint32_t)word;
+}
+
+void getStackUsage(StackUsage *usage)
+{
+    usage->stackSize = (uint32_t)STACK_TOP - (uint32_t)STACK_BOTTOM;
+    usage->stackUsed = getStackHighWaterMark();
+    usage->staticData = STATIC_DATA_SIZE;
+    usage->staticZero = STATIC_ZERO_SIZE;
+    usage->ramCode = RAM_CODE_SIZE;
+}
+
+bool isStackHeadroomLow(void)
+{
+    uint32_t stackSize = (uint32_t)STACK_TOP - (uint32_t)STACK_BOTTOM;
+    return stackSize - getStackHighWaterMark() < STACK_HEADROOM_THRESHOLD;
+}
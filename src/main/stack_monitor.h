@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Порог свободного места в стеке, при котором выдаётся предупреждение, байт
+#define STACK_HEADROOM_THRESHOLD 128
+
+// Занятость стека и статической памяти
+typedef struct StackUsage
+{
+    uint32_t stackSize;
+    uint32_t stackUsed;    // максимальная глубина с момента закраски
+    uint32_t staticData;   // RW (.data)
+    uint32_t staticZero;   // ZI (.bss)
+    uint32_t ramCode;      // код, скопированный в RAM (ram_code.h)
+} StackUsage;
+
+void paintStack(void);
+void getStackUsage(StackUsage *usage);
+bool isStackHeadroomLow(void);
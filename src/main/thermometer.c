@@ -1,7 +1,10 @@
 #include "thermometer.h"
 
 #include "one_wire.h"
+#include "config_store.h"
+#include "timer.h"
 #include "crc.h"
+#include "dispatch.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -13,7 +16,9 @@ typedef struct
 ClassThermometer
 {
 /*public:*/
+#if !defined(USE_STATIC_DISPATCH)
     Thermometer m_thermometer;
+#endif
 /*private:*/
     uint8_t m_lowAlarmTrigger;
     uint8_t m_highAlarmTrigger;
@@ -21,6 +26,18 @@ ClassThermometer
     uint64_t m_serialNumber;
     Resolution m_resolution;
     ThermometerName m_name;
+    uint32_t m_sampleTime;
+    bool m_isDirty;
+    bool m_isConverting;
+    bool m_isRetryPending;       // CONVERT_T не прошёл, срок - повтор
+    uint32_t m_conversionDeadline;
+    ReadMode m_readMode;
+    uint32_t m_verifyPeriod;
+    uint32_t m_fastReadCounter;
+    bool m_isConfigVerified;
+    bool m_isConfigStored;
+    bool m_isRomVerified;        // номер из flash сверен с датчиком на шине
+    ThermometerStatistics m_statistics;
 } ClassThermometer;
 
 //----------------------------------------------------------------//
@@ -33,6 +50,12 @@ static const uint64_t no_serial_number          = 0;
 static const Resolution default_resolution      = RES_12BITS;
 static const ThermometerName default_name       = "thermometer";
 static const uint32_t conversion_time[]         = { 94, 188, 375, 750 };
+static const uint32_t thermometer_read_retries  = 1;
+static const ReadMode default_read_mode         = READ_FAST;
+static const uint32_t default_verify_period     = 16;
+// Скачок между быстрыми чтениями, после которого значение перепроверяется
+// полным чтением с CRC: 8 °C в единицах 1/16 °C
+static const uint16_t max_fast_read_step        = 8 * 16;
 
 //----------------------------------------------------------------//
 //                   Методы класса термометра                     //
@@ -40,6 +63,9 @@ static const uint32_t conversion_time[]         = { 94, 188, 375, 750 };
 uint16_t getThermometerTemperature(void);
 uint64_t getThermometerSerialNumber(void);
 uint32_t getThermometerConversionTime(void);
+uint32_t getThermometerSampleTime(void);
+bool isThermometerReady(void);
+void startThermometerConversion(const Resolution resolution);
 bool isThermometerTriggered(void);
 void setThermometerName(const ThermometerName name);
 void getThermometerName(ThermometerName name);
@@ -49,22 +75,34 @@ void setThermometerHighAlarmTrigger(const int8_t highAlarmTrigger);
 int8_t getThermometerHighAlarmTrigger(void);
 void setThermometerResolution(const Resolution resolution);
 Resolution getThermometerResolution(void);
-void updateThermometerParameters(void);
+void saveThermometerParameters(void);
+void setThermometerReadMode(const ReadMode mode, const uint32_t verifyPeriod);
+ReadMode getThermometerReadMode(void);
+const ThermometerStatistics *getThermometerStatistics(void);
+bool hasThermometerSavedParameters(void);
+static bool writeThermometerParameters(const Resolution resolution);
+static void flushThermometerParameters(void);
 
 //----------------------------------------------------------------//
 //             Счётчик экземпляров класса термометра              //
 //----------------------------------------------------------------//
 static uint32_t thermometerCounter = 0;
 
+#if !defined(USE_STATIC_DISPATCH)
 static Thermometer *thermometerPtr = 0;
+#endif
 
 static ClassThermometer thermometer = 
 {
+#if !defined(USE_STATIC_DISPATCH)
     .m_thermometer = 
     {
         .getTemperature = getThermometerTemperature,
         .getSerialNumber = getThermometerSerialNumber,
         .getConversionTime = getThermometerConversionTime,
+        .getSampleTime = getThermometerSampleTime,
+        .isReady = isThermometerReady,
+        .startConversion = startThermometerConversion,
         .isTriggered = isThermometerTriggered,
         .setName = setThermometerName,
         .getName = getThermometerName,
@@ -74,22 +112,100 @@ static ClassThermometer thermometer =
         .getHighAlarmTrigger = getThermometerHighAlarmTrigger,
         .setResolution = setThermometerResolution,
         .getResolution = getThermometerResolution,
+        .saveParameters = saveThermometerParameters,
+        .setReadMode = setThermometerReadMode,
+        .getReadMode = getThermometerReadMode,
+        .getStatistics = getThermometerStatistics,
+        .hasSavedParameters = hasThermometerSavedParameters
     },
+#endif
     .m_lowAlarmTrigger = default_low_alarm_trigger,
     .m_highAlarmTrigger = default_high_alarm_trigger,
     .m_temperature = default_temperature,
     .m_serialNumber = no_serial_number,
-    .m_resolution = default_resolution
+    .m_resolution = default_resolution,
+    .m_sampleTime = 0,
+    .m_isDirty = false,
+    .m_isConverting = false,
+    .m_isRetryPending = false,
+    .m_conversionDeadline = 0,
+    .m_readMode = default_read_mode,
+    .m_verifyPeriod = default_verify_period,
+    .m_fastReadCounter = 0,
+    .m_isConfigVerified = true,
+    .m_isConfigStored = false,
+    .m_isRomVerified = true,
+    .m_statistics = { 0 }
 };
 
+//----------------------------------------------------------------//
+//           Загрузка конфигурации из flash при запуске           //
+//----------------------------------------------------------------//
+// Известный датчик не требует READ_ROM и записи параметров: сохранённые
+// параметры сверяются с блокнотом при первом полном чтении, и только
+// при расхождении записываются в датчик
+static void loadThermometerConfig(ClassThermometer *thermometer, const uint32_t index)
+{
+    // Сохранённый номер сверяется с шиной не здесь, а после первого
+    // отсчёта (verifyThermometerRom): READ_ROM не задерживает запуск
+    uint64_t serialNumber = no_serial_number;
+    if (readConfigValue(CONFIG_ROM_ID + index, &serialNumber, sizeof(serialNumber)) == sizeof(serialNumber))
+    {
+        thermometer->m_serialNumber = serialNumber;
+        thermometer->m_isRomVerified = false;
+    }
+    else if (getThermometerSerialNumber() != no_serial_number)
+    {
+        writeConfigValue(CONFIG_ROM_ID + index, &thermometer->m_serialNumber, sizeof(serialNumber));
+    }
+
+    if (readConfigValue(CONFIG_NAME + index, thermometer->m_name, sizeof(thermometer->m_name)) == 0)
+    {
+        sprintf(thermometer->m_name, "%s_%i", default_name, index + 1);
+    }
+    thermometer->m_name[MAX_NAME_SIZE] = '\0';
+
+    uint8_t parameters[3] = { 0 };
+    if (readConfigValue(CONFIG_PARAMETERS + index, parameters, sizeof(parameters)) == sizeof(parameters) &&
+        (parameters[2] & ~RES_12BITS) == 0)
+    {
+        thermometer->m_highAlarmTrigger = parameters[0];
+        thermometer->m_lowAlarmTrigger = parameters[1];
+        thermometer->m_resolution = (Resolution)parameters[2];
+        thermometer->m_isConfigVerified = false;
+        thermometer->m_isConfigStored = true;
+    }
+    else
+    {
+        // Параметры уйдут в датчик вместе с первым запуском преобразования
+        thermometer->m_isDirty = true;
+    }
+}
+
+static void saveThermometerConfig(const uint32_t index)
+{
+    uint8_t parameters[] =
+    {
+        thermometer.m_highAlarmTrigger,
+        thermometer.m_lowAlarmTrigger,
+        thermometer.m_resolution
+    };
+
+    writeConfigValue(CONFIG_PARAMETERS + index, parameters, sizeof(parameters));
+    writeConfigValue(CONFIG_NAME + index, thermometer.m_name, strlen(thermometer.m_name) + 1);
+    if (thermometer.m_serialNumber != no_serial_number)
+    {
+        writeConfigValue(CONFIG_ROM_ID + index, &thermometer.m_serialNumber, sizeof(thermometer.m_serialNumber));
+    }
+}
+
 static void initThermometer(ClassThermometer *thermometer)
 {   
     thermometerCounter++;
-    sprintf(thermometer->m_name, "%s_%i", default_name, thermometerCounter);
-    getThermometerSerialNumber();
-    updateThermometerParameters();
+    loadThermometerConfig(thermometer, thermometerCounter - 1);
 }
 
+#if !defined(USE_STATIC_DISPATCH)
 const Thermometer *getThermometer(void)
 {
     if (thermometerPtr == 0)
@@ -100,36 +216,312 @@ const Thermometer *getThermometer(void)
     
     return thermometerPtr;
 }
+#else
+void initThermometerModule(void)
+{
+    initThermometer(&thermometer);
+}
+#endif //USE_STATIC_DISPATCH
 
 //----------------------------------------------------------------//
-//                 Геттер температуры термометра                  //
+//             Чтение блокнота термометра с повтором              //
 //----------------------------------------------------------------//
-uint16_t getThermometerTemperature(void)
+// Молчащий датчик оставляет шину в 1, и каждый слот чтения даёт 1
+static bool isScratchpadEmpty(const uint8_t *data)
 {
-    getOneWire()->open();
-    if (getOneWire()->isBusy() == true)
+    for (uint32_t i = 0; i < NUMBER_OF_REGISTERS; i++)
     {
-        getOneWire()->close();
-        return thermometer.m_temperature;
+        if (data[i] != 0xFF)
+        {
+            return false;
+        }
     }
+    return true;
+}
 
-    uint8_t data[NUMBER_OF_REGISTERS] = { 0 };
-#if (NUMBER_OF_THERMOMETERS == 1)
-    getOneWire()->makeTransaction(SKIP_ROM, no_serial_number, READ_SCRATCHPAD, (char *)&data);
-    
+static bool readThermometerScratchpad(uint8_t *data)
+{
+    for (uint32_t i = 0; i <= thermometer_read_retries; i++)
+    {
+        if (i > 0)
+        {
+            thermometer.m_statistics.retries++;
+        }
+
+        if (getOneWire()->makeTransaction(SKIP_ROM, no_serial_number, READ_SCRATCHPAD, (char *)data,
+                                          NUMBER_OF_REGISTERS) == false)
+        {
+            thermometer.m_statistics.presenceFailures++;
+            continue;
+        }
+
+        // Ошибки CRC учитываются всегда, но отбрасывают данные только с USE_CRC8.
+        // Блокнот из одних единиц с неверным CRC - датчик пропал с шины
+        // после импульса присутствия: такие данные не принимаются никогда
+        bool isCorrupted = crc8((char *)data, NUMBER_OF_REGISTERS) != 0;
+        if (isCorrupted == true && isScratchpadEmpty(data) == true)
+        {
+            thermometer.m_statistics.presenceFailures++;
+            continue;
+        }
+        if (isCorrupted == true)
+        {
+            thermometer.m_statistics.crcErrors++;
 #if defined(USE_CRC8)
-    if (crc8((char *)&data, 9) == 0)
+            continue;
 #endif
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+//----------------------------------------------------------------//
+//          Чтение температуры: быстрое или с проверкой CRC       //
+//----------------------------------------------------------------//
+// Быстрое чтение занимает шину на 2 байта вместо 9. Подозрительное
+// значение (резкий скачок) не принимается, а сразу перечитывается
+// целиком с проверкой CRC. Отсутствие датчика видно по импульсу
+// присутствия; 0xFFFF - обычный отсчёт -0,0625 °C, а пропажу датчика
+// после сброса отсекает скачок и CRC полного чтения
+static bool isFastReadSuspicious(const uint16_t temperature)
+{
+    if (thermometer.m_sampleTime == 0)
     {
-        uint16_t temperature = (data[TEMPERATURE_MSB] << 8) | data[TEMPERATURE_LSB];
-        thermometer.m_temperature = temperature;
-    }    
-    
-    getOneWire()->makeTransaction(SKIP_ROM, no_serial_number, CONVERT_T, 0);
+        return false;
+    }
+
+    int32_t step = (int32_t)(int16_t)temperature - (int32_t)(int16_t)thermometer.m_temperature;
+    return step > max_fast_read_step || step < -max_fast_read_step;
+}
+
+static bool readThermometerTemperature(uint16_t *temperature)
+{
+    // Первое полное чтение после запуска заодно сверяет параметры из flash
+    bool isFullRead = thermometer.m_readMode == READ_VERIFIED || thermometer.m_isConfigVerified == false;
+    if (isFullRead == false && ++thermometer.m_fastReadCounter >= thermometer.m_verifyPeriod)
+    {
+        thermometer.m_fastReadCounter = 0;
+        isFullRead = true;
+    }
+
+    if (isFullRead == false)
+    {
+        uint8_t data[2] = { 0 };
+        if (getOneWire()->makeTransaction(SKIP_ROM, no_serial_number, READ_SCRATCHPAD, (char *)data,
+                                              sizeof(data)) == false)
+        {
+            thermometer.m_statistics.presenceFailures++;
+        }
+        else
+        {
+            thermometer.m_statistics.fastReads++;
+
+            uint16_t fastTemperature = (data[TEMPERATURE_MSB] << 8) | data[TEMPERATURE_LSB];
+            if (isFastReadSuspicious(fastTemperature) == false)
+            {
+                *temperature = fastTemperature;
+                return true;
+            }
+            thermometer.m_statistics.anomalies++;
+        }
+    }
+
+    uint8_t data[NUMBER_OF_REGISTERS] = { 0 };
+    if (readThermometerScratchpad(data) == false)
+    {
+        return false;
+    }
+
+    thermometer.m_statistics.verifiedReads++;
+    if (thermometer.m_isConfigVerified == false)
+    {
+        thermometer.m_isDirty = data[TH_REGISTER] != thermometer.m_highAlarmTrigger ||
+                                data[TL_REGISTER] != thermometer.m_lowAlarmTrigger ||
+                                data[CFG_REGISTER] != thermometer.m_resolution;
+        thermometer.m_isConfigVerified = true;
+    }
+    *temperature = (data[TEMPERATURE_MSB] << 8) | data[TEMPERATURE_LSB];
+    return true;
+}
+
+//----------------------------------------------------------------//
+//              Срок окончания преобразования датчика             //
+//----------------------------------------------------------------//
+// Срок считается по разрешению, с которым запущено преобразование. Если
+// запись параметров не прошла, разрешение датчика неизвестно и берётся
+// наибольшее время. Лишняя миллисекунда покрывает дискретность таймера.
+// Разрешение, отличное от настроенного, действует на одно преобразование:
+// теневая копия остаётся изменённой и вернётся в датчик перед следующим
+static void beginThermometerConversion(const Resolution resolution)
+{
+    Resolution sensorResolution = resolution;
+    if (resolution != thermometer.m_resolution)
+    {
+        thermometer.m_isDirty = true;
+        if (writeThermometerParameters(resolution) == false)
+        {
+            sensorResolution = RES_12BITS;
+        }
+    }
+    else
+    {
+        // Изменённые параметры действуют начиная с этого преобразования
+        flushThermometerParameters();
+        if (thermometer.m_isDirty == true)
+        {
+            sensorResolution = RES_12BITS;
+        }
+    }
+
+    // Без ответа датчика следующая попытка - через то же время, что и
+    // преобразование: отключённый датчик не занимает шину сбросами в
+    // каждой итерации цикла
+    uint32_t conversionTime = conversion_time[sensorResolution >> 5];
+    thermometer.m_conversionDeadline = getOneWireTimer()->getTime() + conversionTime + 1;
+    thermometer.m_isConverting = true;
+    thermometer.m_isRetryPending = false;
+
+    if (getOneWire()->makeTransaction(SKIP_ROM, no_serial_number, CONVERT_T, 0, 0) == false)
+    {
+        thermometer.m_statistics.presenceFailures++;
+        thermometer.m_isRetryPending = true;
+    }
+}
+
+// Запуск преобразования без чтения: при загрузке первый отсчёт готов к
+// первому опросу, а не через время преобразования после него
+void startThermometerConversion(const Resolution resolution)
+{
+    if (isThermometerReady() == false)
+    {
+        return;
+    }
+
+#if (NUMBER_OF_THERMOMETERS == 1)
+    getOneWire()->open();
+    beginThermometerConversion(resolution);
     getOneWire()->close();
+#endif //NUMBER_OF_THERMOMETERS
+}
+
+// Готов ли датчик к чтению: до срока шина не трогается, кроме режима
+// USE_CONVERSION_POLLING, где готовность проверяется слотом чтения
+bool isThermometerReady(void)
+{
+    if (thermometer.m_isConverting == false)
+    {
+        return true;
+    }
+
+    if ((int32_t)(getOneWireTimer()->getTime() - thermometer.m_conversionDeadline) >= 0)
+    {
+        thermometer.m_isConverting = false;
+        thermometer.m_isRetryPending = false;
+        return true;
+    }
+
+#if defined(USE_CONVERSION_POLLING)
+    // Пустая шина читается как "преобразование закончено": срок повтора
+    // выдерживается целиком
+    if (thermometer.m_isRetryPending == true)
+    {
+        return false;
+    }
+
+    getOneWire()->open();
+    bool isBusy = getOneWire()->isBusy();
+    getOneWire()->close();
+    if (isBusy == false)
+    {
+        thermometer.m_isConverting = false;
+        return true;
+    }
+#endif //USE_CONVERSION_POLLING
+
+    return false;
+}
+
+//----------------------------------------------------------------//
+//           Сверка номера из flash с датчиком на шине            //
+//----------------------------------------------------------------//
+// Выполняется один раз со второго опроса, когда первый отсчёт уже
+// выдан. Другой номер с верным CRC - датчик заменён: номер сохраняется,
+// а параметры слота записываются в новый датчик с ближайшим
+// преобразованием. Без ответа или при ошибке CRC сверка повторяется
+// при следующем опросе
+static void verifyThermometerRom(void)
+{
+    uint64_t serialNumber = no_serial_number;
+    if (getOneWire()->makeTransaction(READ_ROM, no_serial_number, NONE, (char *)&serialNumber,
+                                      sizeof(serialNumber)) == false)
+    {
+        thermometer.m_statistics.presenceFailures++;
+        return;
+    }
+
+    if (serialNumber == no_serial_number || crc8((char *)&serialNumber, 8) != 0)
+    {
+        thermometer.m_statistics.crcErrors++;
+        return;
+    }
+
+    thermometer.m_isRomVerified = true;
+    if (serialNumber != thermometer.m_serialNumber)
+    {
+        thermometer.m_serialNumber = serialNumber;
+        thermometer.m_isDirty = true;
+        writeConfigValue(CONFIG_ROM_ID + thermometerCounter - 1, &serialNumber, sizeof(serialNumber));
+    }
+}
+
+//----------------------------------------------------------------//
+//                 Геттер температуры термометра                  //
+//----------------------------------------------------------------//
+uint16_t getThermometerTemperature(void)
+{
+    uint32_t currentTime = getOneWireTimer()->getTime();
+    bool isUpdated = false;
+
+    if (isThermometerReady() == false)
+    {
+        thermometer.m_statistics.busySkips++;
+    }
+    else
+    {
+        uint16_t temperature = 0;
+#if (NUMBER_OF_THERMOMETERS == 1)
+        getOneWire()->open();
+        if (thermometer.m_isRomVerified == false && thermometer.m_sampleTime != 0)
+        {
+            verifyThermometerRom();
+        }
+        if (readThermometerTemperature(&temperature) == true)
+        {
+            thermometer.m_temperature = temperature;
+            thermometer.m_sampleTime = currentTime;
+            isUpdated = true;
+        }
+
+        beginThermometerConversion(thermometer.m_resolution);
+        getOneWire()->close();
 #else
-    
+
 #endif //NUMBER_OF_THERMOMETERS
+    }
+
+    thermometer.m_statistics.samples++;
+    if (isUpdated == false)
+    {
+        thermometer.m_statistics.staleReads++;
+    }
+    // До первого удачного чтения возраста отсчёта нет
+    if (thermometer.m_sampleTime != 0)
+    {
+        addHistogramSample(&thermometer.m_statistics.sampleAge, currentTime - thermometer.m_sampleTime);
+    }
 
     return thermometer.m_temperature;
 }
@@ -144,18 +536,26 @@ uint64_t getThermometerSerialNumber(void)
         return thermometer.m_serialNumber;
     }
 
-    getOneWire()->open();
-    if (getOneWire()->isBusy() == true)
+    if (isThermometerReady() == false)
     {
-        getOneWire()->close();
+        thermometer.m_statistics.busySkips++;
         return thermometer.m_serialNumber;
     }
 
     uint64_t serialNumber = 0;
 #if (NUMBER_OF_THERMOMETERS == 1)
     getOneWire()->open();
-    getOneWire()->makeTransaction(READ_ROM, no_serial_number, NONE, (char *)&serialNumber);
+    if (getOneWire()->makeTransaction(READ_ROM, no_serial_number, NONE, (char *)&serialNumber,
+                                      sizeof(serialNumber)) == false)
+    {
+        thermometer.m_statistics.presenceFailures++;
+    }
     getOneWire()->close();
+
+    if (crc8((char *)&serialNumber, 8) != 0)
+    {
+        thermometer.m_statistics.crcErrors++;
+    }
 #if defined(USE_CRC8)
     if (crc8((char *)&serialNumber, 8) == 0)
 #endif
@@ -177,33 +577,32 @@ uint32_t getThermometerConversionTime(void)
     return conversion_time[thermometer.m_resolution >> 5];
 }
 
-bool isThermometerTriggered(void)
+// Время последнего успешного чтения температуры, мс таймера OneWire;
+// 0 - температура ещё не читалась
+uint32_t getThermometerSampleTime(void)
 {
-    static bool isTriggered = false;
+    return thermometer.m_sampleTime;
+}
 
-    getOneWire()->open();
-    if (getOneWire()->isBusy() == true)
+bool isThermometerTriggered(void)
+{
+    // Тревога определяется по последней прочитанной температуре и порогам
+    // Th/Tl без обращения к шине: проверка из главного цикла не тратит
+    // слоты и не забирает готовность преобразования у getTemperature.
+    // До первого чтения в m_temperature значение сброса (85 °C)
+    if (thermometer.m_sampleTime == 0)
     {
-        getOneWire()->close();
-        return isTriggered;
+        return false;
     }
     
 //    uint64_t serialNumber = no_serial_number;
+//    getOneWire()->open();
 //    getOneWire()->makeTransaction(ALARM_SEARCH, no_serial_number, NONE, (char *)&serialNumber);
 //    getOneWire()->close();
 //    
 //    if (serialNumber != thermometer.m_serialNumber)
-    if ((int8_t)(thermometer.m_temperature >> 4) > (int8_t)thermometer.m_lowAlarmTrigger &&
-        (int8_t)(thermometer.m_temperature >> 4) < (int8_t)thermometer.m_highAlarmTrigger)
-    {
-        isTriggered = false;
-    }
-    else
-    {
-        isTriggered = true;
-    }
-    
-    return isTriggered;
+    return (int8_t)(thermometer.m_temperature >> 4) <= (int8_t)thermometer.m_lowAlarmTrigger ||
+           (int8_t)(thermometer.m_temperature >> 4) >= (int8_t)thermometer.m_highAlarmTrigger;
 }
 
 //----------------------------------------------------------------//
@@ -229,7 +628,7 @@ void setThermometerLowAlarmTrigger(const int8_t lowAlarmTrigger)
     if ((uint8_t)lowAlarmTrigger != thermometer.m_lowAlarmTrigger)
     {
         thermometer.m_lowAlarmTrigger = (uint8_t)lowAlarmTrigger;
-        updateThermometerParameters();
+        thermometer.m_isDirty = true;
     }
 }
 
@@ -246,7 +645,7 @@ void setThermometerHighAlarmTrigger(const int8_t highAlarmTrigger)
     if ((uint8_t)highAlarmTrigger != thermometer.m_highAlarmTrigger)
     {
         thermometer.m_highAlarmTrigger = (uint8_t)highAlarmTrigger;
-        updateThermometerParameters();
+        thermometer.m_isDirty = true;
     }
 }
 
@@ -270,7 +669,7 @@ void setThermometerResolution(const Resolution resolution)
             if (resolution != thermometer.m_resolution)
             {
                 thermometer.m_resolution = resolution;
-                updateThermometerParameters();
+                thermometer.m_isDirty = true;
             }
         }
     }
@@ -281,18 +680,102 @@ Resolution getThermometerResolution(void)
     return thermometer.m_resolution;
 }
 
-void updateThermometerParameters(void)
+//----------------------------------------------------------------//
+//             Сеттер и геттер режима чтения блокнота             //
+//----------------------------------------------------------------//
+// verifyPeriod: каждое какое быстрое чтение заменяется полным, 0 - по умолчанию
+void setThermometerReadMode(const ReadMode mode, const uint32_t verifyPeriod)
+{
+    thermometer.m_readMode = mode;
+    thermometer.m_verifyPeriod = verifyPeriod != 0 ? verifyPeriod : default_verify_period;
+    thermometer.m_fastReadCounter = 0;
+}
+
+ReadMode getThermometerReadMode(void)
+{
+    return thermometer.m_readMode;
+}
+
+//----------------------------------------------------------------//
+//             Геттер счётчиков состояния термометра              //
+//----------------------------------------------------------------//
+const ThermometerStatistics *getThermometerStatistics(void)
+{
+    return &thermometer.m_statistics;
+}
+
+//----------------------------------------------------------------//
+//          Признак параметров, загруженных из хранилища          //
+//----------------------------------------------------------------//
+bool hasThermometerSavedParameters(void)
+{
+    return thermometer.m_isConfigStored;
+}
+
+//----------------------------------------------------------------//
+//               Форматирование строки телеметрии                 //
+//----------------------------------------------------------------//
+uint32_t formatThermometerMessage(char *message, const uint32_t messageSize,
+                                  const ThermometerName name, const uint16_t temperature)
+{
+    int8_t integer = (int8_t)(temperature >> 4);
+    uint16_t fractional = (temperature & 0x0F) * 10000 / 16;
+    
+    int messageLength = snprintf(message, messageSize, "'%s': T = %i.%04i *C\n", name, integer, fractional);
+    if (messageLength < 0)
+    {
+        return 0;
+    }
+    
+    return (uint32_t)messageLength < messageSize ? (uint32_t)messageLength : messageSize - 1;
+}
+
+//----------------------------------------------------------------//
+//              Запись параметров в блокнот и EEPROM              //
+//----------------------------------------------------------------//
+// Сеттеры меняют только теневую копию. Она записывается в блокнот датчика
+// одной транзакцией при следующем опросе (шина уже открыта), а в EEPROM
+// датчика и flash МК - только по явному saveParameters(): запись EEPROM
+// занимает шину на 10 мс и расходует ресурс датчика
+static bool writeThermometerParameters(const Resolution resolution)
 {
     uint8_t parameters[] =
     {
         thermometer.m_highAlarmTrigger,
         thermometer.m_lowAlarmTrigger,
-        thermometer.m_resolution
+        resolution
     };
+#if (NUMBER_OF_THERMOMETERS == 1)
+    if (getOneWire()->makeTransaction(SKIP_ROM, no_serial_number, WRITE_SCRATCHPAD, (char *)&parameters,
+                                      sizeof(parameters)) == true)
+    {
+        thermometer.m_statistics.configWrites++;
+        return true;
+    }
+#endif //NUMBER_OF_THERMOMETERS
+    return false;
+}
+
+static void flushThermometerParameters(void)
+{
+    if (thermometer.m_isDirty == true && writeThermometerParameters(thermometer.m_resolution) == true)
+    {
+        thermometer.m_isDirty = false;
+    }
+}
+
+void saveThermometerParameters(void)
+{
 #if (NUMBER_OF_THERMOMETERS == 1)
     getOneWire()->open();
-    getOneWire()->makeTransaction(SKIP_ROM, no_serial_number, WRITE_SCRATCHPAD, (char *)&parameters);
-    getOneWire()->makeTransaction(SKIP_ROM, no_serial_number, COPY_SCRATCHPAD, 0);
+    flushThermometerParameters();
+    if (thermometer.m_isDirty == false &&
+        getOneWire()->makeTransaction(SKIP_ROM, no_serial_number, COPY_SCRATCHPAD, 0, 0) == true)
+    {
+        thermometer.m_statistics.eepromWrites++;
+    }
     getOneWire()->close();
+
+    saveThermometerConfig(0);
 #endif //NUMBER_OF_THERMOMETERS
 }
@@ -1,5 +1,8 @@
 #pragma once
 
+#include "histogram.h"
+#include "dispatch.h"
+
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -7,6 +10,10 @@
 #define NUMBER_OF_REGISTERS    9
 #define MAX_NAME_SIZE          30
 //#define USE_CRC8
+// Досрочное завершение преобразования по опросу шины (слот чтения
+// возвращает 1, когда датчик закончил). Без него шина не трогается
+// до истечения времени преобразования для текущего разрешения
+//#define USE_CONVERSION_POLLING
 
 // Команды датчику температуры
 typedef enum FunctionCommand
@@ -45,6 +52,32 @@ typedef enum Resulution
     RES_12BITS = (3UL << 5) | 0x1FUL
 } Resolution;
 
+// Чтение блокнота: READ_FAST - только температура (2 байта из 9), каждое
+// N-е чтение и любое подозрительное значение перепроверяются полным
+// чтением с CRC; READ_VERIFIED - всегда 9 байт с CRC
+typedef enum ReadMode
+{
+    READ_VERIFIED,
+    READ_FAST
+} ReadMode;
+
+// Счётчики состояния датчика температуры
+typedef struct ThermometerStatistics
+{
+    uint32_t samples;
+    uint32_t presenceFailures;
+    uint32_t crcErrors;
+    uint32_t busySkips;     // опрос до окончания преобразования
+    uint32_t retries;
+    uint32_t staleReads;
+    uint32_t configWrites;  // WRITE_SCRATCHPAD
+    uint32_t eepromWrites;  // COPY_SCRATCHPAD
+    uint32_t fastReads;     // 2 байта температуры
+    uint32_t verifiedReads; // 9 байт с CRC
+    uint32_t anomalies;     // быстрые чтения, отправленные на перепроверку
+    Histogram sampleAge; // мс
+} ThermometerStatistics;
+
 // Описание датчика темпераруты
 typedef struct
 /*class*/ Thermometer
@@ -53,6 +86,9 @@ typedef struct
     uint16_t (*getTemperature)(void);
     uint64_t (*getSerialNumber)(void);
     uint32_t (*getConversionTime)(void);
+    uint32_t (*getSampleTime)(void);
+    bool (*isReady)(void);
+    void (*startConversion)(const Resolution resolution);
     bool (*isTriggered)(void);
     void (*setName)(const ThermometerName name);
     void (*getName)(ThermometerName name);
@@ -62,6 +98,68 @@ typedef struct
     int8_t (*getHighAlarmTrigger)(void);
     void (*setResolution)(const Resolution resulution);
     Resolution (*getResolution)(void);
+    void (*saveParameters)(void);
+    void (*setReadMode)(const ReadMode mode, const uint32_t verifyPeriod);
+    ReadMode (*getReadMode)(void);
+    const ThermometerStatistics *(*getStatistics)(void);
+    bool (*hasSavedParameters)(void);
 } Thermometer;
 
+#if defined(USE_STATIC_DISPATCH)
+uint16_t getThermometerTemperature(void);
+uint64_t getThermometerSerialNumber(void);
+uint32_t getThermometerConversionTime(void);
+uint32_t getThermometerSampleTime(void);
+bool isThermometerReady(void);
+void startThermometerConversion(const Resolution resolution);
+bool isThermometerTriggered(void);
+void setThermometerName(const ThermometerName name);
+void getThermometerName(ThermometerName name);
+void setThermometerLowAlarmTrigger(const int8_t lowAlarmTrigger);
+int8_t getThermometerLowAlarmTrigger(void);
+void setThermometerHighAlarmTrigger(const int8_t highAlarmTrigger);
+int8_t getThermometerHighAlarmTrigger(void);
+void setThermometerResolution(const Resolution resolution);
+Resolution getThermometerResolution(void);
+void saveThermometerParameters(void);
+void setThermometerReadMode(const ReadMode mode, const uint32_t verifyPeriod);
+ReadMode getThermometerReadMode(void);
+const ThermometerStatistics *getThermometerStatistics(void);
+bool hasThermometerSavedParameters(void);
+
+static inline const Thermometer *getThermometer(void)
+{
+    static const Thermometer thermometer =
+    {
+        .getTemperature = getThermometerTemperature,
+        .getSerialNumber = getThermometerSerialNumber,
+        .getConversionTime = getThermometerConversionTime,
+        .getSampleTime = getThermometerSampleTime,
+        .isReady = isThermometerReady,
+        .startConversion = startThermometerConversion,
+        .isTriggered = isThermometerTriggered,
+        .setName = setThermometerName,
+        .getName = getThermometerName,
+        .setLowAlarmTrigger = setThermometerLowAlarmTrigger,
+        .getLowAlarmTrigger = getThermometerLowAlarmTrigger,
+        .setHighAlarmTrigger = setThermometerHighAlarmTrigger,
+        .getHighAlarmTrigger = getThermometerHighAlarmTrigger,
+        .setResolution = setThermometerResolution,
+        .getResolution = getThermometerResolution,
+        .saveParameters = saveThermometerParameters,
+        .setReadMode = setThermometerReadMode,
+        .getReadMode = getThermometerReadMode,
+        .getStatistics = getThermometerStatistics,
+        .hasSavedParameters = hasThermometerSavedParameters
+    };
+    return &thermometer;
+}
+
+void initThermometerModule(void);
+#else
 const Thermometer *getThermometer(void);
+#endif //USE_STATIC_DISPATCH
+
+// Строка телеметрии "'name': T = 22.5000 *C\n"; возвращает её длину
+uint32_t formatThermometerMessage(char *message, const uint32_t messageSize,
+                                  const ThermometerName name, const uint16_t temperature);
@@ -2,6 +2,9 @@
 
 #include "timer.h"
 #include "led.h"
+#include "hal.h"
+#include "dispatch.h"
+#include "ram_code.h"
 
 #include <math.h>
 
@@ -12,7 +15,9 @@ typedef struct
 ClassTimer
 {
 /*public:*/
+#if !defined(USE_STATIC_DISPATCH)
     Timer m_timer;
+#endif
 /*private:*/
     uint32_t m_apb1Periph;
     uint32_t m_apb2Periph;
@@ -41,29 +46,30 @@ const uint32_t one_wire_timer_frequency = 1000;
 //----------------------------------------------------------------//
 //                   Прототипы методов таймеров                   //
 //----------------------------------------------------------------//
-static void setLedTimerTimeout(const uint32_t milliseconds);
-static uint32_t getLedTimerTimeout(void);
-static void startLedTimer(const uint32_t milliseconds);
-static void stopLedTimer(void);
-static uint32_t getLedTimerTime(void);
-
-static void setButtonTimerTimeout(const uint32_t milliseconds);
-static uint32_t getButtonTimerTimeout(void);
-static void startButtonTimer(const uint32_t milliseconds);
-static void stopButtonTimer(void);
-static uint32_t getButtonTimerTime(void);
-
-static void setOneWireTimerTimeout(const uint32_t milliseconds);
-static uint32_t getOneWireTimerTimeout(void);
-static void startOneWireTimer(const uint32_t milliseconds);
-static void stopOneWireTimer(void);
-static uint32_t getOneWireTimerTime(void);
+DISPATCH_METHOD void setLedTimerTimeout(const uint32_t milliseconds);
+DISPATCH_METHOD uint32_t getLedTimerTimeout(void);
+DISPATCH_METHOD void startLedTimer(const uint32_t milliseconds);
+DISPATCH_METHOD void stopLedTimer(void);
+DISPATCH_METHOD uint32_t getLedTimerTime(void);
+
+DISPATCH_METHOD void setButtonTimerTimeout(const uint32_t milliseconds);
+DISPATCH_METHOD uint32_t getButtonTimerTimeout(void);
+DISPATCH_METHOD void startButtonTimer(const uint32_t milliseconds);
+DISPATCH_METHOD void stopButtonTimer(void);
+DISPATCH_METHOD uint32_t getButtonTimerTime(void);
+
+DISPATCH_METHOD void setOneWireTimerTimeout(const uint32_t milliseconds);
+DISPATCH_METHOD uint32_t getOneWireTimerTimeout(void);
+DISPATCH_METHOD void startOneWireTimer(const uint32_t milliseconds);
+DISPATCH_METHOD void stopOneWireTimer(void);
+DISPATCH_METHOD uint32_t getOneWireTimerTime(void);
 
 //----------------------------------------------------------------//
 //                     Инициализация таймеров                     //
 //----------------------------------------------------------------//
 static ClassTimer ledTimer =
 {
+#if !defined(USE_STATIC_DISPATCH)
     .m_timer = 
     {
         .setTimeout = setLedTimerTimeout,
@@ -72,6 +78,7 @@ static ClassTimer ledTimer =
         .stop = stopLedTimer,
         .getTime = getLedTimerTime,
     },
+#endif
     .m_apb1Periph = RCC_APB1Periph_TIM2,
     .m_apb2Periph = 0,
     .m_timerN = TIM2,
@@ -84,6 +91,7 @@ static ClassTimer ledTimer =
 
 static ClassTimer buttonTimer =
 {
+#if !defined(USE_STATIC_DISPATCH)
     .m_timer = 
     {
         .setTimeout = setButtonTimerTimeout,
@@ -92,6 +100,7 @@ static ClassTimer buttonTimer =
         .stop = stopButtonTimer,
         .getTime = getButtonTimerTime
     },
+#endif
     .m_apb1Periph = RCC_APB1Periph_TIM3,
     .m_apb2Periph = 0,
     .m_timerN = TIM3,
@@ -104,6 +113,7 @@ static ClassTimer buttonTimer =
 
 static ClassTimer oneWireTimer =
 {
+#if !defined(USE_STATIC_DISPATCH)
     .m_timer = 
     {
         .setTimeout = setOneWireTimerTimeout,
@@ -112,6 +122,7 @@ static ClassTimer oneWireTimer =
         .stop = stopOneWireTimer,
         .getTime = getOneWireTimerTime
     },
+#endif
     .m_apb1Periph = RCC_APB1Periph_TIM4,
     .m_apb2Periph = 0,
     .m_timerN = TIM4,
@@ -127,9 +138,11 @@ static uint8_t signal[SIGNAL_RESOLUTION] = {0};
 //----------------------------------------------------------------//
 //             Указатели на экземпляры класса таймера             //
 //----------------------------------------------------------------//
+#if !defined(USE_STATIC_DISPATCH)
 static const Timer *ledTimerPtr     = 0;
 static const Timer *buttonTimerPtr  = 0;
 static const Timer *oneWireTimerPtr = 0;
+#endif
 
 void configSignal(void)
 {
@@ -173,6 +186,7 @@ static void initTimer(ClassTimer *timer)
 //----------------------------------------------------------------//
 //         Геттеры указателей на экземпляры класса таймера        //
 //----------------------------------------------------------------//
+#if !defined(USE_STATIC_DISPATCH)
 const Timer *getLedTimer(void)
 {
     if (ledTimerPtr == 0)
@@ -205,11 +219,19 @@ const Timer *getOneWireTimer(void)
     
     return oneWireTimerPtr;
 }
+#else
+void initTimerModule(void)
+{
+    initTimer(&ledTimer);
+    initTimer(&buttonTimer);
+    initTimer(&oneWireTimer);
+}
+#endif //USE_STATIC_DISPATCH
 
 //----------------------------------------------------------------//
 //                    Методы таймера светодиода                   //
 //----------------------------------------------------------------//
-static void setLedTimerTimeout(const uint32_t milliseconds)
+DISPATCH_METHOD void setLedTimerTimeout(const uint32_t milliseconds)
 {
     if (milliseconds == 0)
     {
@@ -219,25 +241,25 @@ static void setLedTimerTimeout(const uint32_t milliseconds)
     ledTimer.m_timeout = milliseconds;
 }
 
-static uint32_t getLedTimerTimeout(void)
+DISPATCH_METHOD uint32_t getLedTimerTimeout(void)
 {
     return ledTimer.m_timeout;
 }
 
-static void startLedTimer(const uint32_t milliseconds)
+DISPATCH_METHOD void startLedTimer(const uint32_t milliseconds)
 {
     setLedTimerTimeout(milliseconds);
     TIM_Cmd(ledTimer.m_timerN, ENABLE);
 	NVIC_EnableIRQ(ledTimer.m_timerIRQ);
 }
 
-static void stopLedTimer(void)
+DISPATCH_METHOD void stopLedTimer(void)
 {
     TIM_Cmd(ledTimer.m_timerN, DISABLE);
     NVIC_DisableIRQ(ledTimer.m_timerIRQ);
 }
 
-static uint32_t getLedTimerTime(void)
+DISPATCH_METHOD uint32_t getLedTimerTime(void)
 {   
     return ledTimer.m_counter / (led_timer_frequency / 1000);
 }
@@ -245,7 +267,7 @@ static uint32_t getLedTimerTime(void)
 //----------------------------------------------------------------//
 //                      Методы таймера кнопки                     //
 //----------------------------------------------------------------//
-static void setButtonTimerTimeout(const uint32_t milliseconds)
+DISPATCH_METHOD void setButtonTimerTimeout(const uint32_t milliseconds)
 {
     if (milliseconds == 0)
     {
@@ -255,25 +277,25 @@ static void setButtonTimerTimeout(const uint32_t milliseconds)
     buttonTimer.m_timeout = milliseconds;
 }
 
-static uint32_t getButtonTimerTimeout(void)
+DISPATCH_METHOD uint32_t getButtonTimerTimeout(void)
 {
     return buttonTimer.m_timeout;
 }
 
-static void startButtonTimer(const uint32_t milliseconds)
+DISPATCH_METHOD void startButtonTimer(const uint32_t milliseconds)
 {
     setButtonTimerTimeout(milliseconds);
     TIM_Cmd(buttonTimer.m_timerN, ENABLE);
     NVIC_EnableIRQ(buttonTimer.m_timerIRQ);
 }
 
-static void stopButtonTimer(void)
+DISPATCH_METHOD void stopButtonTimer(void)
 {
     TIM_Cmd(buttonTimer.m_timerN, DISABLE);
     NVIC_DisableIRQ(buttonTimer.m_timerIRQ);
 }
 
-static uint32_t getButtonTimerTime(void)
+DISPATCH_METHOD uint32_t getButtonTimerTime(void)
 {   
     return buttonTimer.m_counter / (button_timer_frequency / 1000);
 }
@@ -281,7 +303,7 @@ static uint32_t getButtonTimerTime(void)
 //----------------------------------------------------------------//
 //               Методы таймера интерфейса OneWire                //
 //----------------------------------------------------------------//
-static void setOneWireTimerTimeout(const uint32_t milliseconds)
+DISPATCH_METHOD void setOneWireTimerTimeout(const uint32_t milliseconds)
 {
     if (milliseconds == 0)
     {
@@ -291,25 +313,25 @@ static void setOneWireTimerTimeout(const uint32_t milliseconds)
     ledTimer.m_timeout = milliseconds;
 }
 
-static uint32_t getOneWireTimerTimeout(void)
+DISPATCH_METHOD uint32_t getOneWireTimerTimeout(void)
 {
     return ledTimer.m_timeout;
 }
 
-static void startOneWireTimer(const uint32_t milliseconds)
+DISPATCH_METHOD void startOneWireTimer(const uint32_t milliseconds)
 {
     setLedTimerTimeout(milliseconds);
     TIM_Cmd(oneWireTimer.m_timerN, ENABLE);
 	NVIC_EnableIRQ(oneWireTimer.m_timerIRQ);
 }
 
-static void stopOneWireTimer(void)
+DISPATCH_METHOD void stopOneWireTimer(void)
 {
     TIM_Cmd(oneWireTimer.m_timerN, DISABLE);
     NVIC_DisableIRQ(oneWireTimer.m_timerIRQ);
 }
 
-static uint32_t getOneWireTimerTime(void)
+DISPATCH_METHOD uint32_t getOneWireTimerTime(void)
 {   
     return oneWireTimer.m_counter / (one_wire_timer_frequency / 1000);
 }
@@ -317,9 +339,9 @@ static uint32_t getOneWireTimerTime(void)
 //----------------------------------------------------------------//
 //                 Обработчики прерываний таймеров                //
 //----------------------------------------------------------------//
-void TIM2_IRQHandler(void)
+RAM_FUNCTION void TIM2_IRQHandler(void)
 {
-	if (TIM_GetITStatus(ledTimer.m_timerN, TIM_IT_Update) == SET)
+	if (isTimerUpdated(ledTimer.m_timerN) == true)
 	{
         uint32_t period = ledTimer.m_timeout;
         
@@ -335,26 +357,26 @@ void TIM2_IRQHandler(void)
             getLed()->turnOn();
         }
         
-		TIM_ClearITPendingBit(ledTimer.m_timerN, TIM_IT_Update);
+		clearTimerUpdate(ledTimer.m_timerN);
 	}
 }
 
-void TIM3_IRQHandler(void)
+RAM_FUNCTION void TIM3_IRQHandler(void)
 {
-    if (TIM_GetITStatus(buttonTimer.m_timerN, TIM_IT_Update) == SET)
+    if (isTimerUpdated(buttonTimer.m_timerN) == true)
     {
         buttonTimer.m_counter++;
     
-        TIM_ClearITPendingBit(buttonTimer.m_timerN, TIM_IT_Update);
+        clearTimerUpdate(buttonTimer.m_timerN);
     } 
 }
 
-void TIM4_IRQHandler(void)
+RAM_FUNCTION void TIM4_IRQHandler(void)
 {
-    if (TIM_GetITStatus(oneWireTimer.m_timerN, TIM_IT_Update) == SET)
+    if (isTimerUpdated(oneWireTimer.m_timerN) == true)
     {
         oneWireTimer.m_counter++;
     
-        TIM_ClearITPendingBit(oneWireTimer.m_timerN, TIM_IT_Update);
+        clearTimerUpdate(oneWireTimer.m_timerN);
     }
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "dispatch.h"
+
 #include <stdint.h>
 
 // По какой-то причине в math.h не содержатся математические константы
@@ -20,6 +22,67 @@ typedef struct Timer
 
 void configSignal(void);
 
+#if defined(USE_STATIC_DISPATCH)
+void setLedTimerTimeout(const uint32_t milliseconds);
+uint32_t getLedTimerTimeout(void);
+void startLedTimer(const uint32_t milliseconds);
+void stopLedTimer(void);
+uint32_t getLedTimerTime(void);
+
+void setButtonTimerTimeout(const uint32_t milliseconds);
+uint32_t getButtonTimerTimeout(void);
+void startButtonTimer(const uint32_t milliseconds);
+void stopButtonTimer(void);
+uint32_t getButtonTimerTime(void);
+
+void setOneWireTimerTimeout(const uint32_t milliseconds);
+uint32_t getOneWireTimerTimeout(void);
+void startOneWireTimer(const uint32_t milliseconds);
+void stopOneWireTimer(void);
+uint32_t getOneWireTimerTime(void);
+
+static inline const Timer *getLedTimer(void)
+{
+    static const Timer timer =
+    {
+        .setTimeout = setLedTimerTimeout,
+        .getTimeout = getLedTimerTimeout,
+        .start = startLedTimer,
+        .stop = stopLedTimer,
+        .getTime = getLedTimerTime
+    };
+    return &timer;
+}
+
+static inline const Timer *getButtonTimer(void)
+{
+    static const Timer timer =
+    {
+        .setTimeout = setButtonTimerTimeout,
+        .getTimeout = getButtonTimerTimeout,
+        .start = startButtonTimer,
+        .stop = stopButtonTimer,
+        .getTime = getButtonTimerTime
+    };
+    return &timer;
+}
+
+static inline const Timer *getOneWireTimer(void)
+{
+    static const Timer timer =
+    {
+        .setTimeout = setOneWireTimerTimeout,
+        .getTimeout = getOneWireTimerTimeout,
+        .start = startOneWireTimer,
+        .stop = stopOneWireTimer,
+        .getTime = getOneWireTimerTime
+    };
+    return &timer;
+}
+
+void initTimerModule(void);
+#else
 const Timer *getLedTimer(void);
 const Timer *getButtonTimer(void);
 const Timer *getOneWireTimer(void);
+#endif //USE_STATIC_DISPATCH
@@ -2,16 +2,30 @@
 
 #include "platform_config.h"
 #include "usb.h"
+#include "dispatch.h"
+#include "ram_code.h"
+#include "cycle_counter.h"
 #include "usb_lib.h"
 #include "usb_desc.h"
 #include "usb_istr.h"
 #include "usb_pwr.h"
 
 #include <string.h>
-#include <stdlib.h>
 
-#define USB_RX_BUFFER_SIZE 1024UL
-#define USB_TX_BUFFER_SIZE 1024UL
+// Блок пула должен вмещать сообщение целиком
+typedef char UsbBlockSizeCheck[(POOL_BLOCK_SIZE >= sizeof(Message)) ? 1 : -1];
+
+//----------------------------------------------------------------//
+//           Канал передачи: очередь блоков и конечная точка      //
+//----------------------------------------------------------------//
+typedef struct UsbTxChannel
+{
+    uint8_t m_endpoint;
+    uint8_t m_address;
+    BufferQueue m_queue;
+    BufferHandle m_buffer;       // передаваемый блок
+    uint32_t m_offset;           // переданная часть блока
+} UsbTxChannel;
 
 //----------------------------------------------------------------//
 //                      Класс интерфейса USB                      //
@@ -19,44 +33,76 @@
 typedef struct
 ClassUsb
 {
+#if !defined(USE_STATIC_DISPATCH)
     Usb m_usb;
+#endif
     uint32_t m_apb2Periph;
     GPIO_TypeDef *m_gpioPort;    
     uint16_t m_gpioPin;
-    char *m_rxBufferPtr;
-    char *m_txBufferPtr;
-    char *m_rxDataPtr;
-    char *m_txDataPtr;
-    uint32_t m_rxDataCounter;
-    uint32_t m_txDataCounter;
+    BufferQueue m_rxQueue;
+    BufferHandle m_rxBuffer;
+    UsbTxChannel m_control;      // EP1 IN: ответы на команды и эхо
+    UsbTxChannel m_telemetry;    // EP4 IN: строки отсчётов
+    UsbTxPolicy m_txPolicy;
+    UsbTxStatistics m_txStatistics;
+    bool m_isTelemetryReclaimed; // выделение вытеснило старую строку
+    uint8_t m_telemetrySensors[POOL_BLOCK_COUNT]; // датчик строки в блоке
+    UsbAttachPolicy m_attachPolicy;
+    // Пишутся в прерывании USB по SET_CONTROL_LINE_STATE
+    volatile bool m_isControlDtr;
+    volatile bool m_isTelemetryDtr;
+    // Пишутся в SOF_Callback; m_sofCount меняется последним
+    volatile uint16_t m_sofFrame;
+    volatile uint32_t m_sofCycles;
+    volatile uint32_t m_sofCount;
 } ClassUsb;
 
 //----------------------------------------------------------------//
-//             Буферы чтения и записи интерфейса USB              //
+//   Блоки пула, которые передача не может занять (для команд)    //
+//----------------------------------------------------------------//
+static const uint32_t usb_rx_reserve = 2;
+
+//----------------------------------------------------------------//
+//  Блоки пула, которые не может занять телеметрия (для ответов)  //
+//----------------------------------------------------------------//
+static const uint32_t usb_telemetry_reserve = 6;
+
+//----------------------------------------------------------------//
+//   SET_CONTROL_LINE_STATE: биты wValue и интерфейсы функций CDC  //
 //----------------------------------------------------------------//
-static char usbRxBuffer[USB_RX_BUFFER_SIZE] = { 0 };
-static char usbTxBuffer[USB_TX_BUFFER_SIZE] = { 0 };
+static const uint16_t usb_line_state_dtr = 0x0001;
+static const uint8_t usb_control_interface = 0;
+static const uint8_t usb_telemetry_interface = 2;
 
 //----------------------------------------------------------------//
 //             Протипы методов класса интерфейса USB              //
 //----------------------------------------------------------------//
-static void openUsb(void);
-static void closeUsb(void);
-static void readUsb(Message message);
-static void writeUsb(const Message message);
-static bool isUsbOpened(void);
-static bool isUsbClosed(void);
+DISPATCH_METHOD void openUsb(void);
+DISPATCH_METHOD void closeUsb(void);
+DISPATCH_METHOD void readUsb(Message message);
+DISPATCH_METHOD UsbTxStatus writeUsb(const Message message);
+DISPATCH_METHOD bool isUsbOpened(void);
+DISPATCH_METHOD bool isUsbClosed(void);
+DISPATCH_METHOD bool isUsbTelemetryOpened(void);
+DISPATCH_METHOD BufferHandle allocateUsbBuffer(void);
+DISPATCH_METHOD BufferHandle receiveUsb(void);
+DISPATCH_METHOD UsbTxStatus sendUsb(const BufferHandle buffer);
+DISPATCH_METHOD BufferHandle allocateUsbTelemetryBuffer(void);
+DISPATCH_METHOD UsbTxStatus sendUsbTelemetry(const BufferHandle buffer, const uint32_t sensor);
 
 //----------------------------------------------------------------//
 //         Указатель на экземпляр класса интерфейса USB           //
 //----------------------------------------------------------------//
+#if !defined(USE_STATIC_DISPATCH)
 static const Usb *usbPtr = 0;
+#endif
 
 //----------------------------------------------------------------//
 //                  Инициализация интерфейса USB                  //
 //----------------------------------------------------------------//
 static ClassUsb usb = 
 {
+#if !defined(USE_STATIC_DISPATCH)
     .m_usb =
     {
         .open = openUsb,
@@ -64,17 +110,32 @@ static ClassUsb usb =
         .read = readUsb,
         .write = writeUsb,
         .isOpened = isUsbOpened,
-        .isClosed = isUsbClosed
+        .isClosed = isUsbClosed,
+        .isTelemetryOpened = isUsbTelemetryOpened,
+        .allocate = allocateUsbBuffer,
+        .receive = receiveUsb,
+        .send = sendUsb,
+        .allocateTelemetry = allocateUsbTelemetryBuffer,
+        .sendTelemetry = sendUsbTelemetry
     },
+#endif
     .m_apb2Periph = RCC_APB2Periph_GPIOA,
     .m_gpioPort = GPIOA,     
     .m_gpioPin = GPIO_Pin_11 | GPIO_Pin_12,
-    .m_rxBufferPtr = usbRxBuffer,
-    .m_txBufferPtr = usbTxBuffer,
-    .m_rxDataPtr = usbRxBuffer,
-    .m_txDataPtr = usbTxBuffer,
-    .m_rxDataCounter = 0,
-    .m_txDataCounter = 0
+    .m_rxQueue = { { 0 }, 0, 0, 0 },
+    .m_rxBuffer = NO_BUFFER,
+    .m_control = { ENDP1, EP1_IN, { { 0 }, 0, 0, 0 }, NO_BUFFER, 0 },
+    .m_telemetry = { ENDP4, EP4_IN, { { 0 }, 0, 0, 0 }, NO_BUFFER, 0 },
+    .m_txPolicy = USB_TX_DROP_OLDEST,
+    .m_txStatistics = { 0 },
+    .m_isTelemetryReclaimed = false,
+    .m_telemetrySensors = { 0 },
+    .m_attachPolicy = USB_ATTACH_FLUSH,
+    .m_isControlDtr = false,
+    .m_isTelemetryDtr = false,
+    .m_sofFrame = 0,
+    .m_sofCycles = 0,
+    .m_sofCount = 0
 };
 
 //----------------------------------------------------------------//
@@ -117,6 +178,7 @@ void initUsb(ClassUsb *usb)
 //----------------------------------------------------------------//
 //      Геттер указателя на экземпляр класса интерфейса USB       //
 //----------------------------------------------------------------//
+#if !defined(USE_STATIC_DISPATCH)
 const Usb *getUsb(void)
 {
     if (usbPtr == 0)
@@ -127,16 +189,22 @@ const Usb *getUsb(void)
     
     return usbPtr;
 }
+#else
+void initUsbModule(void)
+{
+    initUsb(&usb);
+}
+#endif //USE_STATIC_DISPATCH
 
 //----------------------------------------------------------------//
 //               Открытие и закрытие интерфейса USB               //
 //----------------------------------------------------------------//
-static void openUsb(void)
+DISPATCH_METHOD void openUsb(void)
 {
     configUsbCable(ENABLE);
 }
 
-static void closeUsb(void)
+DISPATCH_METHOD void closeUsb(void)
 {
     bDeviceState = UNCONNECTED;
 
@@ -146,62 +214,236 @@ static void closeUsb(void)
 //----------------------------------------------------------------//
 //                    Чтение и запись сообщений                   //
 //----------------------------------------------------------------//
-static void readUsb(Message message)
+DISPATCH_METHOD void readUsb(Message message)
 {
-    memset(message, 0, MAX_MESSAGE_SIZE);
-    if (usb.m_rxDataCounter == 0)
+    memset(message, 0, MAX_MESSAGE_SIZE + 1);
+    
+    BufferHandle buffer = receiveUsb();
+    if (buffer == NO_BUFFER)
     {
         return;
     }
     
-    static uint32_t messageSize = 0;
-    messageSize = strlen(usb.m_rxBufferPtr);
-    messageSize = messageSize < MAX_MESSAGE_SIZE ? (messageSize + 1) : (MAX_MESSAGE_SIZE + 1);
+    strncpy(message, getBufferData(buffer), MAX_MESSAGE_SIZE);
+    releaseBuffer(buffer);
+}
+
+DISPATCH_METHOD UsbTxStatus writeUsb(const Message message)
+{
+    BufferHandle buffer = allocateUsbBuffer();
+    if (buffer == NO_BUFFER)
+    {
+        usb.m_txStatistics.controlDropped++;
+        return USB_TX_DROPPED;
+    }
     
-    strncpy(message, usb.m_rxBufferPtr, messageSize);
-    char *nextDataPtr = usb.m_rxBufferPtr + messageSize;
-    memmove(usb.m_rxBufferPtr, nextDataPtr, usb.m_rxDataPtr - nextDataPtr);
+    uint32_t messageSize = strlen(message);
+    messageSize = messageSize < MAX_MESSAGE_SIZE ? messageSize : MAX_MESSAGE_SIZE;
     
-    usb.m_rxDataPtr -= messageSize;
-    usb.m_rxDataCounter--;
+    memcpy(getBufferData(buffer), message, messageSize);
+    setBufferSize(buffer, messageSize);
+    return sendUsb(buffer);
+}
+
+//----------------------------------------------------------------//
+//         Обмен блоками пула без копирования сообщений           //
+//----------------------------------------------------------------//
+DISPATCH_METHOD BufferHandle allocateUsbBuffer(void)
+{
+    return allocateBuffer(usb_rx_reserve);
 }
 
-void writeUsb(const Message message)
+DISPATCH_METHOD BufferHandle receiveUsb(void)
 {
-    static uint32_t messageSize = 0;
-    messageSize = strlen(message);
-    messageSize = messageSize < MAX_MESSAGE_SIZE ? (messageSize + 1) : (MAX_MESSAGE_SIZE + 1);
+    return popBufferQueue(&usb.m_rxQueue);
+}
+
+// Блоки управляющего порта выделяет сам отправитель (allocate), и
+// нехватку блоков он видит раньше: выдача журнала ждёт следующей
+// итерации цикла. Очередь вмещает весь пул, поэтому здесь блок
+// теряется только при ошибке вызывающего
+DISPATCH_METHOD UsbTxStatus sendUsb(const BufferHandle buffer)
+{
+    if (pushBufferQueue(&usb.m_control.m_queue, buffer) == false)
+    {
+        releaseBuffer(buffer);
+        usb.m_txStatistics.controlDropped++;
+        return USB_TX_DROPPED;
+    }
     
-    strncpy(usb.m_txDataPtr, message, messageSize);
+    return USB_TX_QUEUED;
+}
+
+// Очередь телеметрии растёт, пока хост не читает порт телеметрии, но
+// не дальше резерва пула: ответы на команды по управляющему порту
+// всегда находят свободный блок. На границе резерва политика решает,
+// чья строка теряется: новая или самая старая в очереди
+DISPATCH_METHOD BufferHandle allocateUsbTelemetryBuffer(void)
+{
+    BufferHandle buffer = allocateBuffer(usb_telemetry_reserve);
+    if (buffer == NO_BUFFER && usb.m_txPolicy != USB_TX_DROP_NEWEST)
+    {
+        BufferHandle oldest = popBufferQueue(&usb.m_telemetry.m_queue);
+        if (oldest != NO_BUFFER)
+        {
+            releaseBuffer(oldest);
+            usb.m_txStatistics.droppedOldest++;
+            usb.m_isTelemetryReclaimed = true;
+            buffer = allocateBuffer(usb_telemetry_reserve);
+        }
+    }
     
-    usb.m_txDataPtr += messageSize;
-    usb.m_txDataCounter++;
+    if (buffer == NO_BUFFER)
+    {
+        usb.m_txStatistics.droppedNewest++;
+    }
+    return buffer;
+}
+
+static bool isSameTelemetrySensor(const BufferHandle queued, const BufferHandle buffer)
+{
+    return usb.m_telemetrySensors[queued] == usb.m_telemetrySensors[buffer];
+}
+
+DISPATCH_METHOD UsbTxStatus sendUsbTelemetry(const BufferHandle buffer, const uint32_t sensor)
+{
+    bool isReclaimed = usb.m_isTelemetryReclaimed;
+    usb.m_isTelemetryReclaimed = false;
     
+    // Ждущая строка того же датчика заменяется на месте: порядок
+    // датчиков в очереди сохраняется, устаревший отсчёт не уходит
+    usb.m_telemetrySensors[buffer] = (uint8_t)sensor;
+    if (usb.m_txPolicy == USB_TX_COALESCE)
+    {
+        BufferHandle replaced = replaceBufferQueue(&usb.m_telemetry.m_queue, buffer, isSameTelemetrySensor);
+        if (replaced != NO_BUFFER)
+        {
+            releaseBuffer(replaced);
+            usb.m_txStatistics.coalesced++;
+            return USB_TX_COALESCED;
+        }
+    }
     
-    if (usb.m_txDataPtr - usb.m_txBufferPtr > USB_TX_BUFFER_SIZE)
+    if (pushBufferQueue(&usb.m_telemetry.m_queue, buffer) == false)
     {
-        usb.m_txDataPtr = usb.m_txBufferPtr;
-        usb.m_txDataCounter = 0;
+        releaseBuffer(buffer);
+        usb.m_txStatistics.droppedNewest++;
+        return USB_TX_DROPPED;
+    }
+    
+    usb.m_txStatistics.telemetryQueued++;
+    return isReclaimed == true ? USB_TX_DROPPED_OLDEST : USB_TX_QUEUED;
+}
+
+//----------------------------------------------------------------//
+//           Политика и счётчики очередей передачи USB            //
+//----------------------------------------------------------------//
+void setUsbTxPolicy(const UsbTxPolicy policy)
+{
+    usb.m_txPolicy = policy;
+}
+
+UsbTxPolicy getUsbTxPolicy(void)
+{
+    return usb.m_txPolicy;
+}
+
+void getUsbTxStatistics(UsbTxStatistics *statistics)
+{
+    *statistics = usb.m_txStatistics;
+}
+
+uint32_t getUsbControlQueueCount(void)
+{
+    return getBufferQueueCount(&usb.m_control.m_queue);
+}
+
+uint32_t getUsbTelemetryQueueCount(void)
+{
+    return getBufferQueueCount(&usb.m_telemetry.m_queue);
+}
+
+void setUsbAttachPolicy(const UsbAttachPolicy policy)
+{
+    usb.m_attachPolicy = policy;
+}
+
+UsbAttachPolicy getUsbAttachPolicy(void)
+{
+    return usb.m_attachPolicy;
+}
+
+bool isUsbControlDtr(void)
+{
+    return usb.m_isControlDtr;
+}
+
+bool isUsbTelemetryDtr(void)
+{
+    return usb.m_isTelemetryDtr;
+}
+
+//----------------------------------------------------------------//
+//         Открытие и закрытие портов программой на хосте         //
+//----------------------------------------------------------------//
+// Драйвер CDC ACM хоста выставляет DTR при открытии порта и снимает
+// при закрытии, сброс шины снимает оба. Вызывается из usb_prop.c в
+// прерывании USB; блок, который уже передаётся, дописывается
+void setUsbControlLineState(uint8_t interface, uint16_t state)
+{
+    bool isDtr = (state & usb_line_state_dtr) != 0;
+    if (interface == usb_control_interface)
+    {
+        usb.m_isControlDtr = isDtr;
+        return;
+    }
+    if (interface != usb_telemetry_interface || isDtr == usb.m_isTelemetryDtr)
+    {
+        return;
+    }
+
+    usb.m_isTelemetryDtr = isDtr;
+    if (isDtr == true)
+    {
+        usb.m_txStatistics.attaches++;
+    }
+
+    // Сброс и при закрытии: блоки очереди возвращаются в пул сразу,
+    // а не при следующем открытии
+    if (usb.m_attachPolicy == USB_ATTACH_FLUSH)
+    {
+        BufferHandle buffer = popBufferQueue(&usb.m_telemetry.m_queue);
+        while (buffer != NO_BUFFER)
+        {
+            releaseBuffer(buffer);
+            usb.m_txStatistics.flushed++;
+            buffer = popBufferQueue(&usb.m_telemetry.m_queue);
+        }
     }
 }
 
 //----------------------------------------------------------------//
 //             Геттеры состояние класса интерфейса USB            //
 //----------------------------------------------------------------//
-static bool isUsbOpened(void)
+DISPATCH_METHOD bool isUsbOpened(void)
 {
     return bDeviceState == CONFIGURED;
 }
 
-static bool isUsbClosed(void)
+DISPATCH_METHOD bool isUsbClosed(void)
 {
     return !isUsbOpened();
 }
 
+DISPATCH_METHOD bool isUsbTelemetryOpened(void)
+{
+    return bDeviceState == CONFIGURED && usb.m_isTelemetryDtr == true;
+}
+
 //----------------------------------------------------------------//
 //              Обработчики прерываний интерфейса USB             //
 //----------------------------------------------------------------//
-void USB_LP_CAN1_RX0_IRQHandler(void)
+RAM_FUNCTION void USB_LP_CAN1_RX0_IRQHandler(void)
 {
     USB_Istr();
 }
@@ -211,71 +453,125 @@ void USBWakeUp_IRQHandler(void)
     EXTI_ClearITPendingBit(EXTI_Line18);
 }
 
-void Handle_USBAsynchXfer(void)
-{ 
-    if (usb.m_txDataCounter == 0)
+static void transmitUsbChannel(UsbTxChannel *channel)
+{
+    // Предыдущий пакет ещё не забран хостом
+    if (GetEPTxStatus(channel->m_endpoint) == EP_TX_VALID)
     {
         return;
     }
     
-    static uint32_t messageSize = 0;
-    messageSize = strlen(usb.m_txBufferPtr);
-    messageSize = messageSize < MAX_MESSAGE_SIZE ? messageSize : MAX_MESSAGE_SIZE;
+    if (channel->m_buffer == NO_BUFFER)
+    {
+        channel->m_buffer = popBufferQueue(&channel->m_queue);
+        channel->m_offset = 0;
+        
+        if (channel->m_buffer == NO_BUFFER)
+        {
+            return;
+        }
+    }
     
-    USB_SIL_Write(EP1_IN, (uint8_t *)usb.m_txBufferPtr, messageSize);
-    SetEPTxValid(ENDP1);
+    // Сообщение длиннее пакета уходит за несколько транзакций
+    uint32_t messageSize = getBufferSize(channel->m_buffer) - channel->m_offset;
+    messageSize = messageSize < VIRTUAL_COM_PORT_DATA_SIZE ? messageSize : VIRTUAL_COM_PORT_DATA_SIZE;
     
-    messageSize++;
-    char *nextDataPtr = usb.m_txBufferPtr + messageSize;
-    memmove(usb.m_txBufferPtr, nextDataPtr, abs(usb.m_txDataPtr - nextDataPtr));
+    USB_SIL_Write(channel->m_address, (uint8_t *)getBufferData(channel->m_buffer) + channel->m_offset, messageSize);
+    SetEPTxValid(channel->m_endpoint);
+    
+    channel->m_offset += messageSize;
+    if (channel->m_offset >= getBufferSize(channel->m_buffer))
+    {
+        releaseBuffer(channel->m_buffer);
+        channel->m_buffer = NO_BUFFER;
+    }
+}
 
-    usb.m_txDataPtr -= messageSize;
-    usb.m_txDataCounter--; 
-}  
+// Каналы независимы: пакет телеметрии, который хост не забирает,
+// не задерживает ответы по управляющему порту
+void Handle_USBAsynchXfer(void)
+{
+    transmitUsbChannel(&usb.m_control);
+    transmitUsbChannel(&usb.m_telemetry);
+}
 
 //----------------------------------------------------------------//
 //                 Коллбэк-функции интерфейса USB                 //
 //----------------------------------------------------------------//
 void EP1_IN_Callback(void)
 {
-    Handle_USBAsynchXfer();
+    transmitUsbChannel(&usb.m_control);
 }
 
-void EP3_OUT_Callback(void)
+void EP4_IN_Callback(void)
 {
-    static uint32_t messageSize = 0;
+    transmitUsbChannel(&usb.m_telemetry);
+}
 
-    messageSize = USB_SIL_Read(EP3_OUT, (uint8_t *)usb.m_rxDataPtr);
-    SetEPRxValid(ENDP3);    
- 
-    usb.m_rxDataPtr += messageSize;
- 
-    if (*(usb.m_rxDataPtr - 1) == '\n')
-    {
-        usb.m_rxDataPtr++;
-        usb.m_rxDataCounter++;
-        *(usb.m_rxDataPtr - 1) = '\0';
-    }
-    
-    if (*(usb.m_rxDataPtr - 1) == '\r')
+// Порт телеметрии только передаёт: принятое отбрасывается
+void EP4_OUT_Callback(void)
+{
+    SetEPRxValid(ENDP4);
+}
+
+//----------------------------------------------------------------//
+//        Сборка строк из принятого пакета в блоки пула           //
+//----------------------------------------------------------------//
+static void completeUsbLine(void)
+{
+    if (getBufferSize(usb.m_rxBuffer) == 0)
     {
-        *(usb.m_rxDataPtr - 1) = '\0';
-        usb.m_rxDataPtr--;
+        return;
     }
     
-    if (strlen(usb.m_rxBufferPtr) > MAX_MESSAGE_SIZE)
-    {
-        char *nextDataPtr = usb.m_rxBufferPtr + (MAX_MESSAGE_SIZE + 1);
-        memmove(nextDataPtr + 1, nextDataPtr, abs(usb.m_rxDataPtr - nextDataPtr)); 
-        *(nextDataPtr - 1) = '\0';
-        usb.m_rxDataPtr++;
-        usb.m_rxDataCounter++;
-    }
+    // Пустые строки не передаются, очередь приёма не переполняется
+    pushBufferQueue(&usb.m_rxQueue, usb.m_rxBuffer);
+    usb.m_rxBuffer = NO_BUFFER;
+}
+
+void EP3_OUT_Callback(void)
+{
+    uint8_t packet[VIRTUAL_COM_PORT_DATA_SIZE];
+    uint32_t packetSize = USB_SIL_Read(EP3_OUT, packet);
+    SetEPRxValid(ENDP3);
     
-    while (USB_RX_BUFFER_SIZE - (usb.m_rxDataPtr - usb.m_rxBufferPtr) < MAX_MESSAGE_SIZE)
+    for (uint32_t i = 0; i < packetSize; i++)
     {
-        static Message message;
-        readUsb(message);
+        if (packet[i] == '\r')
+        {
+            continue;
+        }
+        
+        if (usb.m_rxBuffer == NO_BUFFER)
+        {
+            usb.m_rxBuffer = allocateBuffer(0);
+            if (usb.m_rxBuffer == NO_BUFFER)
+            {
+                // Пул исчерпан: отбрасываем самую старую непрочитанную строку
+                releaseBuffer(popBufferQueue(&usb.m_rxQueue));
+                usb.m_rxBuffer = allocateBuffer(0);
+            }
+            if (usb.m_rxBuffer == NO_BUFFER)
+            {
+                return;
+            }
+        }
+        
+        if (packet[i] == '\n')
+        {
+            completeUsbLine();
+            continue;
+        }
+        
+        uint32_t lineSize = getBufferSize(usb.m_rxBuffer);
+        getBufferData(usb.m_rxBuffer)[lineSize] = (char)packet[i];
+        setBufferSize(usb.m_rxBuffer, lineSize + 1);
+        
+        // Слишком длинная строка делится на сообщения максимальной длины
+        if (lineSize + 1 == MAX_MESSAGE_SIZE)
+        {
+            completeUsbLine();
+        }
     }
 }
 
@@ -283,6 +579,12 @@ void SOF_Callback(void)
 {
     static uint32_t frameCounter = 0;
 
+    // Метка снимается первой: задержка от SOF до этой строки почти
+    // постоянна и одинакова у плат с одной прошивкой
+    usb.m_sofCycles = getCycleCounter();
+    usb.m_sofFrame = _GetFNR() & FNR_FN;
+    usb.m_sofCount++;
+
     if (bDeviceState != CONFIGURED)
     {
         return;
@@ -296,6 +598,29 @@ void SOF_Callback(void)
     }   
 }
 
+//----------------------------------------------------------------//
+//                  Метка времени по кадрам USB                   //
+//----------------------------------------------------------------//
+void getUsbFrameStamp(UsbFrameStamp *stamp)
+{
+    uint32_t count = 0;
+    uint32_t cycles = 0;
+    uint16_t frame = 0;
+
+    // SOF между чтениями меняет счётчик кадров: читаем заново
+    do
+    {
+        count = usb.m_sofCount;
+        frame = usb.m_sofFrame;
+        cycles = usb.m_sofCycles;
+    }
+    while (count != usb.m_sofCount);
+
+    uint32_t offset = cyclesToMicroseconds(getCycleCounter() - cycles);
+    stamp->frame = frame;
+    stamp->offset = offset < UINT16_MAX ? (uint16_t)offset : UINT16_MAX;
+}
+
 void configUsbDisconnectPin(void)
 {
     RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIO_DISCONNECT, ENABLE);
@@ -1,5 +1,8 @@
 #pragma once
 
+#include "pool.h"
+#include "dispatch.h"
+
 #include <stdbool.h>
 
 /* Interval between sending IN packets in frame number (1 frame = 1ms) */
@@ -9,6 +12,74 @@
 
 typedef char Message[MAX_MESSAGE_SIZE + 1];
 
+// Метка времени отсчёта по кадрам USB: номер кадра последнего SOF
+// (11 бит, общий для всех устройств на шине хоста) и время от него
+// по счётчику тактов. Хост (host/sof_align) переводит метки в свои
+// часы, поэтому отсчёты нескольких плат сходятся с точностью до
+// задержки входа в прерывание без отдельной линии синхронизации.
+// offset больше 1000 - SOF пропущены (шина в suspend или отключена)
+typedef struct UsbFrameStamp
+{
+    uint16_t frame;
+    uint16_t offset;  // мкс от SOF кадра frame
+} UsbFrameStamp;
+
+// Результат постановки блока в очередь передачи. Блок переходит во
+// владение USB при любом результате
+typedef enum UsbTxStatus
+{
+    USB_TX_QUEUED,          // поставлен в конец очереди
+    USB_TX_COALESCED,       // заменил ждущую строку того же датчика
+    USB_TX_DROPPED_OLDEST,  // поставлен, самая старая строка отброшена
+    USB_TX_DROPPED          // отброшен сам блок
+} UsbTxStatus;
+
+// Поведение очереди телеметрии, когда хост читает медленнее, чем
+// приходят отсчёты. Очередь ограничена резервом пула (usb.c), и при
+// её заполнении новая строка отбрасывается (USB_TX_DROP_NEWEST),
+// вытесняет самую старую (USB_TX_DROP_OLDEST) или заменяет ещё не
+// отправленную строку того же датчика (USB_TX_COALESCE): хост получает
+// последний отсчёт каждого датчика без устаревшей очереди
+typedef enum UsbTxPolicy
+{
+    USB_TX_DROP_NEWEST,
+    USB_TX_DROP_OLDEST,
+    USB_TX_COALESCE
+} UsbTxPolicy;
+
+// Счётчики очередей передачи с момента запуска
+typedef struct UsbTxStatistics
+{
+    uint32_t telemetryQueued;   // строк телеметрии принято в очередь
+    uint32_t droppedNewest;     // новых строк отброшено
+    uint32_t droppedOldest;     // старых строк вытеснено
+    uint32_t coalesced;         // строк заменено более свежими
+    uint32_t controlDropped;    // сообщений write без свободного блока
+    uint32_t attaches;          // открытий порта телеметрии (DTR)
+    uint32_t flushed;           // строк сброшено при смене DTR
+} UsbTxStatistics;
+
+// Что делать со строками в очереди телеметрии, когда хост открывает
+// или закрывает порт (SET_CONTROL_LINE_STATE, бит DTR). Пока порт
+// закрыт, строки не формируются, но в очереди могут остаться
+// отправленные до закрытия: USB_ATTACH_FLUSH сбрасывает их, и новый
+// читатель получает только свежие отсчёты, USB_ATTACH_REPLAY
+// сохраняет и передаёт после открытия
+typedef enum UsbAttachPolicy
+{
+    USB_ATTACH_FLUSH,
+    USB_ATTACH_REPLAY
+} UsbAttachPolicy;
+
+// Составное устройство из двух функций CDC ACM (src/usb/src/usb_desc.c):
+// управляющий порт (интерфейсы 0, 1) принимает команды, и по нему
+// уходят ответы, эхо и выдача журнала (send); порт телеметрии
+// (интерфейсы 2, 3) передаёт строки отсчётов (sendTelemetry). У каждого
+// порта своя очередь и своя конечная точка IN, поэтому накопленная
+// телеметрия не задерживает ответы на команды. sendTelemetry помечает
+// строку номером датчика для политики USB_TX_COALESCE. isOpened - хост
+// выбрал конфигурацию, isTelemetryOpened - кроме того, программа на
+// хосте открыла порт телеметрии и выставила DTR
 typedef struct
 /*class*/ Usb
 {
@@ -16,9 +87,70 @@ typedef struct
     void (*open)(void);
     void (*close)(void);
     void (*read)(Message message);
-    void (*write)(const Message message);
+    UsbTxStatus (*write)(const Message message);
     bool (*isOpened)(void);
     bool (*isClosed)(void);
+    bool (*isTelemetryOpened)(void);
+    BufferHandle (*allocate)(void);
+    BufferHandle (*receive)(void);
+    UsbTxStatus (*send)(const BufferHandle buffer);
+    BufferHandle (*allocateTelemetry)(void);
+    UsbTxStatus (*sendTelemetry)(const BufferHandle buffer, const uint32_t sensor);
 } Usb;
 
+#if defined(USE_STATIC_DISPATCH)
+void openUsb(void);
+void closeUsb(void);
+void readUsb(Message message);
+UsbTxStatus writeUsb(const Message message);
+bool isUsbOpened(void);
+bool isUsbClosed(void);
+bool isUsbTelemetryOpened(void);
+BufferHandle allocateUsbBuffer(void);
+BufferHandle receiveUsb(void);
+UsbTxStatus sendUsb(const BufferHandle buffer);
+BufferHandle allocateUsbTelemetryBuffer(void);
+UsbTxStatus sendUsbTelemetry(const BufferHandle buffer, const uint32_t sensor);
+
+static inline const Usb *getUsb(void)
+{
+    static const Usb usb =
+    {
+        .open = openUsb,
+        .close = closeUsb,
+        .read = readUsb,
+        .write = writeUsb,
+        .isOpened = isUsbOpened,
+        .isClosed = isUsbClosed,
+        .isTelemetryOpened = isUsbTelemetryOpened,
+        .allocate = allocateUsbBuffer,
+        .receive = receiveUsb,
+        .send = sendUsb,
+        .allocateTelemetry = allocateUsbTelemetryBuffer,
+        .sendTelemetry = sendUsbTelemetry
+    };
+    return &usb;
+}
+
+void initUsbModule(void);
+#else
 const Usb *getUsb(void);
+#endif //USE_STATIC_DISPATCH
+
+// Метка текущего момента; вызывается из главного цикла
+void getUsbFrameStamp(UsbFrameStamp *stamp);
+
+// Политика очереди телеметрии (команда "usb", src/main/command.c)
+void setUsbTxPolicy(const UsbTxPolicy policy);
+UsbTxPolicy getUsbTxPolicy(void);
+void getUsbTxStatistics(UsbTxStatistics *statistics);
+void setUsbAttachPolicy(const UsbAttachPolicy policy);
+UsbAttachPolicy getUsbAttachPolicy(void);
+
+// Состояние DTR портов по последнему SET_CONTROL_LINE_STATE
+bool isUsbControlDtr(void);
+bool isUsbTelemetryDtr(void);
+
+// Длина очередей передачи, блоков: управляющий порт и телеметрия
+uint32_t getUsbControlQueueCount(void);
+uint32_t getUsbTelemetryQueueCount(void);
@@ -0,0 +1,330 @@
+#include "wall_clock.h"
+
+#include "mcu_support_package/inc/stm32f10x.h"
+
+//----------------------------------------------------------------//
+//                Регистры резервного домена (BKP)                //
+//----------------------------------------------------------------//
+// DR1 - признак настроенного RTC (пишется последним), DR2 - замедление
+// хода в 0,1 ppm (int16), DR3 - мс, добавляемые к секундам RTC,
+// DR4 - флаги
+static const uint16_t wall_clock_magic = 0x5743;
+static const uint16_t wall_clock_flag_set = 0x0001;
+static const uint16_t wall_clock_flag_lsi = 0x0002;
+
+static const uint32_t wall_clock_lse_timeout = 2000;          // мс
+static const uint32_t wall_clock_lse_prescaler = 32767;
+static const uint32_t wall_clock_lsi_prescaler = 39999;
+// Подстройка хода не чаще, чем раз в минуту: расхождение в 1 мс за
+// минуту - уже 17 ppm
+static const uint64_t wall_clock_min_drift_interval = 60000;  // мс
+// Расхождение больше 10 с - часы не были установлены, а не уход
+static const int64_t wall_clock_max_sync_error = 10000;       // мс
+
+typedef enum WallClockState
+{
+    WALL_CLOCK_STOPPED,
+    WALL_CLOCK_STARTING,   // ждём запуска LSE
+    WALL_CLOCK_RUNNING
+} WallClockState;
+
+//----------------------------------------------------------------//
+//                        Состояние часов                         //
+//----------------------------------------------------------------//
+typedef struct WallClock
+{
+    WallClockState m_state;
+    uint32_t m_startCycles;
+    uint32_t m_prescaler;       // делитель без подстройки
+    uint32_t m_seconds;         // секунда RTC в wallClockTick
+    uint32_t m_offset;          // мс к секундам RTC, 0..999
+    bool m_isLse;
+    bool m_isSet;
+    int32_t m_trim;
+    int32_t m_drift;
+    // Оценка ухода: сумма шагов с начала интервала и его начало
+    bool m_hasBaseline;
+    uint64_t m_baseline;
+    int64_t m_stepSum;
+    uint32_t m_syncs;
+    uint32_t m_syncInterval;
+} WallClock;
+
+volatile WallClockTick wallClockTick = { 0, 0, 0, 0, 0 };
+
+static WallClock wallClock = { .m_state = WALL_CLOCK_STOPPED };
+
+static void updateWallClockTick(const uint32_t seconds, const uint32_t cycles)
+{
+    uint64_t milliseconds = (uint64_t)seconds * 1000 + wallClock.m_offset;
+
+    wallClock.m_seconds = seconds;
+    wallClockTick.milliseconds = (uint32_t)milliseconds;
+    wallClockTick.millisecondsHigh = (uint32_t)(milliseconds >> 32);
+    wallClockTick.cycles = cycles;
+    wallClockTick.count++;
+}
+
+//----------------------------------------------------------------//
+//             Подстройка хода: делитель и калибровка             //
+//----------------------------------------------------------------//
+// Калибровка только замедляет RTC: пропускает до 127 импульсов из
+// 2^20. Для отстающего кварца делитель уменьшается на единицу
+// (+30,5 ppm для LSE), а калибровка возвращает лишнее
+static int32_t applyWallClockTrim(int32_t trim)
+{
+    int32_t fastStep = (int32_t)(10000000 / (wallClock.m_prescaler + 1));
+    int32_t maxSlow = 127 * 10000000 / 1048576;
+    trim = trim < -fastStep ? -fastStep : trim;
+    trim = trim > maxSlow ? maxSlow : trim;
+
+    uint32_t prescaler = wallClock.m_prescaler;
+    int32_t slow = trim;
+    if (trim < 0)
+    {
+        prescaler--;
+        slow += fastStep;
+    }
+    uint32_t calibration = ((uint32_t)slow * 1048576 + 5000000) / 10000000;
+
+    RTC_WaitForLastTask();
+    RTC_SetPrescaler(prescaler);
+    RTC_WaitForLastTask();
+    BKP_SetRTCCalibrationValue((uint8_t)(calibration < 127 ? calibration : 127));
+
+    return trim;
+}
+
+//----------------------------------------------------------------//
+//                       Запуск RTC от LSE                        //
+//----------------------------------------------------------------//
+static void startWallClockTicks(void)
+{
+    RTC_ITConfig(RTC_IT_SEC, ENABLE);
+    RTC_WaitForLastTask();
+
+    updateWallClockTick(RTC_GetCounter(), getCycleCounter());
+    NVIC_EnableIRQ(RTC_IRQn);
+    wallClock.m_state = WALL_CLOCK_RUNNING;
+}
+
+void initWallClock(void)
+{
+    // До первой секундной метки время идёт от сброса по тактам DWT
+    wallClockTick.scale = (uint32_t)((1000ULL << 32) / SystemCoreClock);
+
+    RCC_APB1PeriphClockCmd(RCC_APB1Periph_PWR | RCC_APB1Periph_BKP, ENABLE);
+    PWR_BackupAccessCmd(ENABLE);
+
+    // RTC уже идёт от VBAT: восстанавливаем настройки без остановки
+    if (BKP_ReadBackupRegister(BKP_DR1) == wall_clock_magic)
+    {
+        uint16_t flags = BKP_ReadBackupRegister(BKP_DR4);
+        wallClock.m_isLse = (flags & wall_clock_flag_lsi) == 0;
+        wallClock.m_isSet = (flags & wall_clock_flag_set) != 0;
+        wallClock.m_prescaler = wallClock.m_isLse == true ? wall_clock_lse_prescaler : wall_clock_lsi_prescaler;
+        wallClock.m_trim = (int16_t)BKP_ReadBackupRegister(BKP_DR2);
+        wallClock.m_offset = BKP_ReadBackupRegister(BKP_DR3) % 1000;
+
+        RTC_WaitForSynchro();
+        startWallClockTicks();
+        return;
+    }
+
+    // Источник RTC выбирается только после сброса резервного домена.
+    // Кварц запускается до ~1 с: ждём его в главном цикле
+    BKP_DeInit();
+    RCC_LSEConfig(RCC_LSE_ON);
+    wallClock.m_startCycles = getCycleCounter();
+    wallClock.m_state = WALL_CLOCK_STARTING;
+}
+
+static void configureWallClock(const bool isLse)
+{
+    if (isLse == false)
+    {
+        RCC_LSEConfig(RCC_LSE_OFF);
+        RCC_LSICmd(ENABLE);
+        while (RCC_GetFlagStatus(RCC_FLAG_LSIRDY) == RESET)
+        {
+        }
+    }
+
+    RCC_RTCCLKConfig(isLse == true ? RCC_RTCCLKSource_LSE : RCC_RTCCLKSource_LSI);
+    RCC_RTCCLKCmd(ENABLE);
+    RTC_WaitForSynchro();
+    RTC_WaitForLastTask();
+
+    wallClock.m_isLse = isLse;
+    wallClock.m_isSet = false;
+    wallClock.m_prescaler = isLse == true ? wall_clock_lse_prescaler : wall_clock_lsi_prescaler;
+    wallClock.m_trim = applyWallClockTrim(0);
+    wallClock.m_offset = 0;
+
+    BKP_WriteBackupRegister(BKP_DR2, 0);
+    BKP_WriteBackupRegister(BKP_DR3, 0);
+    BKP_WriteBackupRegister(BKP_DR4, isLse == true ? 0 : wall_clock_flag_lsi);
+    BKP_WriteBackupRegister(BKP_DR1, wall_clock_magic);
+
+    startWallClockTicks();
+}
+
+void checkWallClock(void)
+{
+    if (wallClock.m_state != WALL_CLOCK_STARTING)
+    {
+        return;
+    }
+
+    if (RCC_GetFlagStatus(RCC_FLAG_LSERDY) == SET)
+    {
+        configureWallClock(true);
+    }
+    else if (cyclesToMicroseconds(getCycleCounter() - wallClock.m_startCycles) > wall_clock_lse_timeout * 1000)
+    {
+        configureWallClock(false);
+    }
+}
+
+//----------------------------------------------------------------//
+//                      Секундная метка RTC                       //
+//----------------------------------------------------------------//
+void RTC_IRQHandler(void)
+{
+    if (RTC_GetITStatus(RTC_IT_SEC) != RESET)
+    {
+        uint32_t cycles = getCycleCounter();
+        updateWallClockTick(RTC_GetCounter(), cycles);
+
+        RTC_ClearITPendingBit(RTC_IT_SEC);
+        RTC_WaitForLastTask();
+    }
+}
+
+//----------------------------------------------------------------//
+//                     Чтение полного времени                     //
+//----------------------------------------------------------------//
+uint64_t getWallClockMilliseconds(void)
+{
+    uint32_t count = 0;
+    uint64_t milliseconds = 0;
+    uint32_t cycles = 0;
+
+    do
+    {
+        count = wallClockTick.count;
+        milliseconds = ((uint64_t)wallClockTick.millisecondsHigh << 32) | wallClockTick.milliseconds;
+        cycles = wallClockTick.cycles;
+    }
+    while (count != wallClockTick.count);
+
+    return milliseconds + (((uint64_t)(getCycleCounter() - cycles) * wallClockTick.scale) >> 32);
+}
+
+uint32_t getWallClockTimeHigh(const uint32_t time)
+{
+    uint64_t milliseconds = getWallClockMilliseconds();
+    uint32_t high = (uint32_t)(milliseconds >> 32);
+
+    // Младшие биты переполнились после снятия метки
+    return (uint32_t)milliseconds < time ? high - 1 : high;
+}
+
+//----------------------------------------------------------------//
+//                   Установка и синхронизация                    //
+//----------------------------------------------------------------//
+// Счётчик RTC сдвигается на целые секунды, доля секунды хранится в
+// DR3: делитель RTC при записи счётчика не сбрасывается
+static void stepWallClock(const uint64_t milliseconds)
+{
+    NVIC_DisableIRQ(RTC_IRQn);
+
+    int64_t step = (int64_t)(milliseconds - getWallClockMilliseconds());
+    uint64_t tick = (((uint64_t)wallClockTick.millisecondsHigh << 32) | wallClockTick.milliseconds) + step;
+    uint32_t seconds = (uint32_t)(tick / 1000);
+
+    // Секундная метка могла наступить, но ещё не обработана
+    RTC_WaitForLastTask();
+    RTC_SetCounter(RTC_GetCounter() + (seconds - wallClock.m_seconds));
+    RTC_WaitForLastTask();
+
+    wallClock.m_offset = (uint32_t)(tick % 1000);
+    wallClock.m_isSet = true;
+    BKP_WriteBackupRegister(BKP_DR3, (uint16_t)wallClock.m_offset);
+    BKP_WriteBackupRegister(BKP_DR4, wall_clock_flag_set | (wallClock.m_isLse == true ? 0 : wall_clock_flag_lsi));
+
+    updateWallClockTick(seconds, wallClockTick.cycles);
+    NVIC_EnableIRQ(RTC_IRQn);
+}
+
+bool setWallClock(const uint64_t milliseconds)
+{
+    if (wallClock.m_state != WALL_CLOCK_RUNNING)
+    {
+        return false;
+    }
+
+    // Только что выставленное время - начало интервала оценки ухода
+    stepWallClock(milliseconds);
+    wallClock.m_hasBaseline = true;
+    wallClock.m_baseline = milliseconds;
+    wallClock.m_stepSum = 0;
+    return true;
+}
+
+// Каждая синхронизация убирает накопленное расхождение, поэтому уход -
+// сумма шагов за интервал, делённая на его длину
+bool syncWallClock(const uint64_t milliseconds)
+{
+    if (wallClock.m_state != WALL_CLOCK_RUNNING)
+    {
+        return false;
+    }
+
+    int64_t error = (int64_t)(milliseconds - getWallClockMilliseconds());
+    if (wallClock.m_isSet == false || error > wall_clock_max_sync_error || error < -wall_clock_max_sync_error)
+    {
+        return setWallClock(milliseconds);
+    }
+
+    stepWallClock(milliseconds);
+    wallClock.m_syncs++;
+
+    // После перезагрузки время восстановлено из BKP, но шаги с прошлой
+    // синхронизации неизвестны: интервал начинается заново
+    if (wallClock.m_hasBaseline == false)
+    {
+        wallClock.m_hasBaseline = true;
+        wallClock.m_baseline = milliseconds;
+        wallClock.m_stepSum = 0;
+        return true;
+    }
+
+    wallClock.m_stepSum += error;
+    uint64_t interval = milliseconds - wallClock.m_baseline;
+    if (interval < wall_clock_min_drift_interval)
+    {
+        return true;
+    }
+
+    // Часы спешат - шаги отрицательные, замедление растёт
+    wallClock.m_drift = (int32_t)(-wallClock.m_stepSum * 10000000 / (int64_t)interval);
+    wallClock.m_trim = applyWallClockTrim(wallClock.m_trim + wallClock.m_drift);
+    wallClock.m_syncInterval = (uint32_t)(interval / 1000);
+    BKP_WriteBackupRegister(BKP_DR2, (uint16_t)wallClock.m_trim);
+
+    wallClock.m_baseline = milliseconds;
+    wallClock.m_stepSum = 0;
+    return true;
+}
+
+void getWallClockStatus(WallClockStatus *status)
+{
+    status->isRunning = wallClock.m_state == WALL_CLOCK_RUNNING;
+    status->isLse = wallClock.m_isLse;
+    status->isSet = wallClock.m_isSet;
+    status->trim = wallClock.m_trim;
+    status->drift = wallClock.m_drift;
+    status->syncs = wallClock.m_syncs;
+    status->syncInterval = wallClock.m_syncInterval;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "cycle_counter.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//----------------------------------------------------------------//
+//           Часы реального времени на RTC и кварце LSE           //
+//----------------------------------------------------------------//
+// RTC считает секунды Unix от LSE 32768 Гц и питается от VBAT, поэтому
+// время переживает сброс МК и отключение USB. Настройки хранятся в
+// регистрах резервного домена (BKP); если LSE не запустился за
+// wall_clock_lse_timeout мс, RTC тактируется от неточного LSI.
+// Время устанавливается и подстраивается хостом командой "time"
+// (src/main/command.c): уход кварца оценивается по расхождению между
+// двумя синхронизациями и компенсируется калибровкой RTC
+// (BKP_RTCCR, шаг ~0,95 ppm) и делителем на единицу меньше для
+// отстающего кварца.
+//
+// Метка отсчёта - младшие 32 бита миллисекунд Unix (повтор через
+// 49,7 суток): секунда RTC из прерывания плюс такты DWT от него.
+// Старшие биты хранит заголовок страницы журнала (src/main/history.h).
+
+// Последняя секундная метка RTC; count меняется последним
+typedef struct WallClockTick
+{
+    uint32_t milliseconds;      // младшие 32 бита мс Unix
+    uint32_t millisecondsHigh;  // старшие биты
+    uint32_t cycles;            // DWT CYCCNT в прерывании
+    uint32_t scale;             // 2^32 * 1000 / SystemCoreClock
+    uint32_t count;
+} WallClockTick;
+
+extern volatile WallClockTick wallClockTick;
+
+// Состояние часов для команды "time"
+typedef struct WallClockStatus
+{
+    bool isRunning;             // RTC тактируется и даёт секундные метки
+    bool isLse;                 // источник - LSE, иначе LSI
+    bool isSet;                 // время задано хостом
+    int32_t trim;               // замедление хода, 0,1 ppm
+    int32_t drift;              // уход по последней синхронизации, 0,1 ppm
+    uint32_t syncs;             // синхронизаций с момента запуска
+    uint32_t syncInterval;      // с от предыдущей синхронизации
+} WallClockStatus;
+
+// Запускает LSE и возвращает управление, не дожидаясь кварца
+void initWallClock(void);
+
+// Вызывается из главного цикла: настраивает RTC после запуска LSE
+void checkWallClock(void);
+
+// Текущее время, младшие 32 бита мс Unix: несколько загрузок, вычитание
+// и умножение, без обращения к RTC на шине APB1
+static inline uint32_t getWallClockTime(void)
+{
+    uint32_t count = 0;
+    uint32_t milliseconds = 0;
+    uint32_t cycles = 0;
+
+    // Секундная метка между чтениями: читаем заново
+    do
+    {
+        count = wallClockTick.count;
+        milliseconds = wallClockTick.milliseconds;
+        cycles = wallClockTick.cycles;
+    }
+    while (count != wallClockTick.count);
+
+    return milliseconds + (uint32_t)(((uint64_t)(getCycleCounter() - cycles) * wallClockTick.scale) >> 32);
+}
+
+// Полное время в мс Unix
+uint64_t getWallClockMilliseconds(void);
+
+// Старшие биты мс Unix для недавней метки time
+uint32_t getWallClockTimeHigh(const uint32_t time);
+
+// Установка времени (шаг без оценки ухода) и синхронизация: шаг и,
+// если с начала интервала оценки прошло не меньше минуты, подстройка
+// хода. Возвращают false, пока RTC не запущен
+bool setWallClock(const uint64_t milliseconds);
+bool syncWallClock(const uint64_t milliseconds);
+
+void getWallClockStatus(WallClockStatus *status);
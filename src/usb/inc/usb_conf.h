@@ -42,7 +42,7 @@
 /* defines how many endpoints are used by the device */
 /*-------------------------------------------------------------*/
 
-#define EP_NUM                          (4)
+#define EP_NUM                          (6)
 
 /*-------------------------------------------------------------*/
 /* --------------   Buffer Description Table  -----------------*/
@@ -56,12 +56,17 @@
 #define ENDP0_RXADDR        (0x40)
 #define ENDP0_TXADDR        (0x80)
 
-/* EP1  */
-/* tx buffer base address */
+/* Control CDC function: EP1 IN data, EP2 IN notification, EP3 OUT data */
 #define ENDP1_TXADDR        (0xC0)
 #define ENDP2_TXADDR        (0x100)
 #define ENDP3_RXADDR        (0x110)
 
+/* Telemetry CDC function: EP4 IN/OUT data, EP5 IN notification */
+/* (the last buffer ends at 0x1D8, below the 512-byte PMA limit) */
+#define ENDP4_TXADDR        (0x150)
+#define ENDP4_RXADDR        (0x190)
+#define ENDP5_TXADDR        (0x1D0)
+
 
 /*-------------------------------------------------------------*/
 /* -------------------   ISTR events  -------------------------*/
@@ -85,7 +90,7 @@
 /*#define  EP1_IN_Callback   NOP_Process*/
 #define  EP2_IN_Callback   NOP_Process
 #define  EP3_IN_Callback   NOP_Process
-#define  EP4_IN_Callback   NOP_Process
+/*#define  EP4_IN_Callback   NOP_Process*/
 #define  EP5_IN_Callback   NOP_Process
 #define  EP6_IN_Callback   NOP_Process
 #define  EP7_IN_Callback   NOP_Process
@@ -93,7 +98,7 @@
 #define  EP1_OUT_Callback   NOP_Process
 #define  EP2_OUT_Callback   NOP_Process
 /*#define  EP3_OUT_Callback   NOP_Process*/
-#define  EP4_OUT_Callback   NOP_Process
+/*#define  EP4_OUT_Callback   NOP_Process*/
 #define  EP5_OUT_Callback   NOP_Process
 #define  EP6_OUT_Callback   NOP_Process
 #define  EP7_OUT_Callback   NOP_Process
@@ -42,16 +42,24 @@
 #define USB_STRING_DESCRIPTOR_TYPE              0x03
 #define USB_INTERFACE_DESCRIPTOR_TYPE           0x04
 #define USB_ENDPOINT_DESCRIPTOR_TYPE            0x05
+#define USB_INTERFACE_ASSOCIATION_DESCRIPTOR_TYPE 0x0B
 
 #define VIRTUAL_COM_PORT_DATA_SIZE              64
 #define VIRTUAL_COM_PORT_INT_SIZE               8
 
 #define VIRTUAL_COM_PORT_SIZ_DEVICE_DESC        18
-#define VIRTUAL_COM_PORT_SIZ_CONFIG_DESC        67
+#define VIRTUAL_COM_PORT_SIZ_CONFIG_DESC        141
 #define VIRTUAL_COM_PORT_SIZ_STRING_LANGID      4
 #define VIRTUAL_COM_PORT_SIZ_STRING_VENDOR      38
 #define VIRTUAL_COM_PORT_SIZ_STRING_PRODUCT     50
 #define VIRTUAL_COM_PORT_SIZ_STRING_SERIAL      26
+#define VIRTUAL_COM_PORT_SIZ_STRING_CONTROL     16
+#define VIRTUAL_COM_PORT_SIZ_STRING_TELEMETRY   20
+
+/* String indexes of the function names (iFunction, iInterface) */
+#define VIRTUAL_COM_PORT_STRING_CONTROL         4
+#define VIRTUAL_COM_PORT_STRING_TELEMETRY       5
+#define VIRTUAL_COM_PORT_STRING_COUNT           6
 
 #define STANDARD_ENDPOINT_DESC_SIZE             0x09
 
@@ -63,6 +71,8 @@ extern const uint8_t Virtual_Com_Port_StringLangID[VIRTUAL_COM_PORT_SIZ_STRING_L
 extern const uint8_t Virtual_Com_Port_StringVendor[VIRTUAL_COM_PORT_SIZ_STRING_VENDOR];
 extern const uint8_t Virtual_Com_Port_StringProduct[VIRTUAL_COM_PORT_SIZ_STRING_PRODUCT];
 extern uint8_t Virtual_Com_Port_StringSerial[VIRTUAL_COM_PORT_SIZ_STRING_SERIAL];
+extern const uint8_t Virtual_Com_Port_StringControl[VIRTUAL_COM_PORT_SIZ_STRING_CONTROL];
+extern const uint8_t Virtual_Com_Port_StringTelemetry[VIRTUAL_COM_PORT_SIZ_STRING_TELEMETRY];
 
 #endif /* __USB_DESC_H */
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -166,6 +166,7 @@ void configUsbCable(FunctionalState NewState);
 void enterLowPowerMode(void);
 void leaveLowPowerMode(void);
 void getSerialNumber(void);
+void setUsbControlLineState(uint8_t interface, uint16_t state);
 void intToUnicode(uint32_t value, uint8_t *pbuf, uint8_t len);
 
 #endif /* __PLATFORM_CONFIG_H */
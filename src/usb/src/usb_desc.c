@@ -31,22 +31,26 @@
 #include "usb_desc.h"
 
 /* USB Standard Device Descriptor */
+/* Composite device: two CDC ACM functions grouped by Interface Association
+   Descriptors. The control function (interfaces 0, 1) carries commands and
+   their replies, the telemetry function (interfaces 2, 3) the sample stream,
+   so a telemetry backlog never delays a command reply */
 const uint8_t Virtual_Com_Port_DeviceDescriptor[] =
   {
     0x12,   /* bLength */
     USB_DEVICE_DESCRIPTOR_TYPE,     /* bDescriptorType */
     0x00,
     0x02,   /* bcdUSB = 2.00 */
-    0x02,   /* bDeviceClass: CDC */
-    0x00,   /* bDeviceSubClass */
-    0x00,   /* bDeviceProtocol */
+    0xEF,   /* bDeviceClass: Miscellaneous */
+    0x02,   /* bDeviceSubClass: Common Class */
+    0x01,   /* bDeviceProtocol: Interface Association Descriptor */
     0x40,   /* bMaxPacketSize0 */
     0x83,
     0x04,   /* idVendor = 0x0483 */
     0x40,
     0x57,   /* idProduct = 0x7540 */
     0x00,
-    0x02,   /* bcdDevice = 2.00 */
+    0x03,   /* bcdDevice = 3.00: the host must not reuse the single-port driver binding */
     1,              /* Index of string descriptor describing manufacturer */
     2,              /* Index of string descriptor describing product */
     3,              /* Index of string descriptor describing the device's serial number */
@@ -60,11 +64,20 @@ const uint8_t Virtual_Com_Port_ConfigDescriptor[] =
     USB_CONFIGURATION_DESCRIPTOR_TYPE,      /* bDescriptorType: Configuration */
     VIRTUAL_COM_PORT_SIZ_CONFIG_DESC,       /* wTotalLength:no of returned bytes */
     0x00,
-    0x02,   /* bNumInterfaces: 2 interface */
+    0x04,   /* bNumInterfaces: 4 interfaces */
     0x01,   /* bConfigurationValue: Configuration value */
     0x00,   /* iConfiguration: Index of string descriptor describing the configuration */
     0xC0,   /* bmAttributes: self powered */
     0x32,   /* MaxPower 0 mA */
+    /*Interface Association Descriptor: control function*/
+    0x08,   /* bLength: IAD size */
+    USB_INTERFACE_ASSOCIATION_DESCRIPTOR_TYPE,  /* bDescriptorType: IAD */
+    0x00,   /* bFirstInterface */
+    0x02,   /* bInterfaceCount */
+    0x02,   /* bFunctionClass: CDC */
+    0x02,   /* bFunctionSubClass: Abstract Control Model */
+    0x01,   /* bFunctionProtocol: Common AT commands */
+    VIRTUAL_COM_PORT_STRING_CONTROL,    /* iFunction */
     /*Interface Descriptor*/
     0x09,   /* bLength: Interface Descriptor size */
     USB_INTERFACE_DESCRIPTOR_TYPE,  /* bDescriptorType: Interface */
@@ -75,7 +88,7 @@ const uint8_t Virtual_Com_Port_ConfigDescriptor[] =
     0x02,   /* bInterfaceClass: Communication Interface Class */
     0x02,   /* bInterfaceSubClass: Abstract Control Model */
     0x01,   /* bInterfaceProtocol: Common AT commands */
-    0x00,   /* iInterface: */
+    VIRTUAL_COM_PORT_STRING_CONTROL,    /* iInterface: */
     /*Header Functional Descriptor*/
     0x05,   /* bLength: Endpoint Descriptor size */
     0x24,   /* bDescriptorType: CS_INTERFACE */
@@ -132,6 +145,83 @@ const uint8_t Virtual_Com_Port_ConfigDescriptor[] =
     0x02,   /* bmAttributes: Bulk */
     VIRTUAL_COM_PORT_DATA_SIZE,             /* wMaxPacketSize: */
     0x00,
+    0x00,   /* bInterval */
+    /*Interface Association Descriptor: telemetry function*/
+    0x08,   /* bLength: IAD size */
+    USB_INTERFACE_ASSOCIATION_DESCRIPTOR_TYPE,  /* bDescriptorType: IAD */
+    0x02,   /* bFirstInterface */
+    0x02,   /* bInterfaceCount */
+    0x02,   /* bFunctionClass: CDC */
+    0x02,   /* bFunctionSubClass: Abstract Control Model */
+    0x01,   /* bFunctionProtocol: Common AT commands */
+    VIRTUAL_COM_PORT_STRING_TELEMETRY,  /* iFunction */
+    /*Interface Descriptor*/
+    0x09,   /* bLength: Interface Descriptor size */
+    USB_INTERFACE_DESCRIPTOR_TYPE,  /* bDescriptorType: Interface */
+    /* Interface descriptor type */
+    0x02,   /* bInterfaceNumber: Number of Interface */
+    0x00,   /* bAlternateSetting: Alternate setting */
+    0x01,   /* bNumEndpoints: One endpoints used */
+    0x02,   /* bInterfaceClass: Communication Interface Class */
+    0x02,   /* bInterfaceSubClass: Abstract Control Model */
+    0x01,   /* bInterfaceProtocol: Common AT commands */
+    VIRTUAL_COM_PORT_STRING_TELEMETRY,  /* iInterface: */
+    /*Header Functional Descriptor*/
+    0x05,   /* bLength: Endpoint Descriptor size */
+    0x24,   /* bDescriptorType: CS_INTERFACE */
+    0x00,   /* bDescriptorSubtype: Header Func Desc */
+    0x10,   /* bcdCDC: spec release number */
+    0x01,
+    /*Call Management Functional Descriptor*/
+    0x05,   /* bFunctionLength */
+    0x24,   /* bDescriptorType: CS_INTERFACE */
+    0x01,   /* bDescriptorSubtype: Call Management Func Desc */
+    0x00,   /* bmCapabilities: D0+D1 */
+    0x03,   /* bDataInterface: 3 */
+    /*ACM Functional Descriptor*/
+    0x04,   /* bFunctionLength */
+    0x24,   /* bDescriptorType: CS_INTERFACE */
+    0x02,   /* bDescriptorSubtype: Abstract Control Management desc */
+    0x02,   /* bmCapabilities */
+    /*Union Functional Descriptor*/
+    0x05,   /* bFunctionLength */
+    0x24,   /* bDescriptorType: CS_INTERFACE */
+    0x06,   /* bDescriptorSubtype: Union func desc */
+    0x02,   /* bMasterInterface: Communication class interface */
+    0x03,   /* bSlaveInterface0: Data Class Interface */
+    /*Endpoint 5 Descriptor*/
+    0x07,   /* bLength: Endpoint Descriptor size */
+    USB_ENDPOINT_DESCRIPTOR_TYPE,   /* bDescriptorType: Endpoint */
+    0x85,   /* bEndpointAddress: (IN5) */
+    0x03,   /* bmAttributes: Interrupt */
+    VIRTUAL_COM_PORT_INT_SIZE,      /* wMaxPacketSize: */
+    0x00,
+    0xFF,   /* bInterval: */
+    /*Data class interface descriptor*/
+    0x09,   /* bLength: Endpoint Descriptor size */
+    USB_INTERFACE_DESCRIPTOR_TYPE,  /* bDescriptorType: */
+    0x03,   /* bInterfaceNumber: Number of Interface */
+    0x00,   /* bAlternateSetting: Alternate setting */
+    0x02,   /* bNumEndpoints: Two endpoints used */
+    0x0A,   /* bInterfaceClass: CDC */
+    0x00,   /* bInterfaceSubClass: */
+    0x00,   /* bInterfaceProtocol: */
+    0x00,   /* iInterface: */
+    /*Endpoint 4 Descriptor*/
+    0x07,   /* bLength: Endpoint Descriptor size */
+    USB_ENDPOINT_DESCRIPTOR_TYPE,   /* bDescriptorType: Endpoint */
+    0x04,   /* bEndpointAddress: (OUT4) */
+    0x02,   /* bmAttributes: Bulk */
+    VIRTUAL_COM_PORT_DATA_SIZE,             /* wMaxPacketSize: */
+    0x00,
+    0x00,   /* bInterval: ignore for Bulk transfer */
+    /*Endpoint 4 Descriptor*/
+    0x07,   /* bLength: Endpoint Descriptor size */
+    USB_ENDPOINT_DESCRIPTOR_TYPE,   /* bDescriptorType: Endpoint */
+    0x84,   /* bEndpointAddress: (IN4) */
+    0x02,   /* bmAttributes: Bulk */
+    VIRTUAL_COM_PORT_DATA_SIZE,             /* wMaxPacketSize: */
+    0x00,
     0x00    /* bInterval */
   };
 
@@ -164,6 +254,23 @@ const uint8_t Virtual_Com_Port_StringProduct[VIRTUAL_COM_PORT_SIZ_STRING_PRODUCT
     'M', 0, ' ', 0, 'P', 0, 'o', 0, 'r', 0, 't', 0, ' ', 0, ' ', 0
   };
 
+const uint8_t Virtual_Com_Port_StringControl[VIRTUAL_COM_PORT_SIZ_STRING_CONTROL] =
+  {
+    VIRTUAL_COM_PORT_SIZ_STRING_CONTROL,          /* bLength */
+    USB_STRING_DESCRIPTOR_TYPE,        /* bDescriptorType */
+    /* Interface name: "Control" */
+    'C', 0, 'o', 0, 'n', 0, 't', 0, 'r', 0, 'o', 0, 'l', 0
+  };
+
+const uint8_t Virtual_Com_Port_StringTelemetry[VIRTUAL_COM_PORT_SIZ_STRING_TELEMETRY] =
+  {
+    VIRTUAL_COM_PORT_SIZ_STRING_TELEMETRY,        /* bLength */
+    USB_STRING_DESCRIPTOR_TYPE,        /* bDescriptorType */
+    /* Interface name: "Telemetry" */
+    'T', 0, 'e', 0, 'l', 0, 'e', 0, 'm', 0, 'e', 0, 't', 0, 'r', 0,
+    'y', 0
+  };
+
 uint8_t Virtual_Com_Port_StringSerial[VIRTUAL_COM_PORT_SIZ_STRING_SERIAL] =
   {
     VIRTUAL_COM_PORT_SIZ_STRING_SERIAL,           /* bLength */
@@ -99,12 +99,14 @@ ONE_DESCRIPTOR Config_Descriptor =
     VIRTUAL_COM_PORT_SIZ_CONFIG_DESC
   };
 
-ONE_DESCRIPTOR String_Descriptor[4] =
+ONE_DESCRIPTOR String_Descriptor[VIRTUAL_COM_PORT_STRING_COUNT] =
   {
     {(uint8_t*)Virtual_Com_Port_StringLangID, VIRTUAL_COM_PORT_SIZ_STRING_LANGID},
     {(uint8_t*)Virtual_Com_Port_StringVendor, VIRTUAL_COM_PORT_SIZ_STRING_VENDOR},
     {(uint8_t*)Virtual_Com_Port_StringProduct, VIRTUAL_COM_PORT_SIZ_STRING_PRODUCT},
-    {(uint8_t*)Virtual_Com_Port_StringSerial, VIRTUAL_COM_PORT_SIZ_STRING_SERIAL}
+    {(uint8_t*)Virtual_Com_Port_StringSerial, VIRTUAL_COM_PORT_SIZ_STRING_SERIAL},
+    {(uint8_t*)Virtual_Com_Port_StringControl, VIRTUAL_COM_PORT_SIZ_STRING_CONTROL},
+    {(uint8_t*)Virtual_Com_Port_StringTelemetry, VIRTUAL_COM_PORT_SIZ_STRING_TELEMETRY}
   };
 
 /* Extern variables ----------------------------------------------------------*/
@@ -155,6 +157,10 @@ void Virtual_Com_Port_Reset(void)
   /* Set Virtual_Com_Port DEVICE with the default Interface*/
   pInformation->Current_Interface = 0;
 
+  /* Bus reset closes both ports until the host asserts DTR again */
+  setUsbControlLineState(0, 0);
+  setUsbControlLineState(2, 0);
+
   SetBTABLE(BTABLE_ADDRESS);
 
   /* Initialize Endpoint 0 */
@@ -185,6 +191,20 @@ void Virtual_Com_Port_Reset(void)
   SetEPRxStatus(ENDP3, EP_RX_VALID);
   SetEPTxStatus(ENDP3, EP_TX_DIS);
 
+  /* Initialize Endpoint 4: telemetry data IN and OUT */
+  SetEPType(ENDP4, EP_BULK);
+  SetEPTxAddr(ENDP4, ENDP4_TXADDR);
+  SetEPRxAddr(ENDP4, ENDP4_RXADDR);
+  SetEPRxCount(ENDP4, VIRTUAL_COM_PORT_DATA_SIZE);
+  SetEPRxStatus(ENDP4, EP_RX_VALID);
+  SetEPTxStatus(ENDP4, EP_TX_NAK);
+
+  /* Initialize Endpoint 5: telemetry notification */
+  SetEPType(ENDP5, EP_INTERRUPT);
+  SetEPTxAddr(ENDP5, ENDP5_TXADDR);
+  SetEPRxStatus(ENDP5, EP_RX_DIS);
+  SetEPTxStatus(ENDP5, EP_TX_NAK);
+
   /* Set this device to response on default address */
   SetDeviceAddress(0);
   
@@ -299,6 +319,9 @@ RESULT Virtual_Com_Port_NoData_Setup(uint8_t RequestNo)
     }
     else if (RequestNo == SET_CONTROL_LINE_STATE)
     {
+      /* wIndex: communication interface of the CDC function, wValue: DTR/RTS */
+      /* (Setup0_Process stores the words byte-swapped: take the low bytes) */
+      setUsbControlLineState(pInformation->USBwIndex0, pInformation->USBwValue0);
       return USB_SUCCESS;
     }
   }
@@ -340,7 +363,7 @@ uint8_t *Virtual_Com_Port_GetConfigDescriptor(uint16_t Length)
 uint8_t *Virtual_Com_Port_GetStringDescriptor(uint16_t Length)
 {
   uint8_t wValue0 = pInformation->USBwValue0;
-  if (wValue0 > 4)
+  if (wValue0 >= VIRTUAL_COM_PORT_STRING_COUNT)
   {
     return NULL;
   }
@@ -365,7 +388,7 @@ RESULT Virtual_Com_Port_Get_Interface_Setting(uint8_t Interface, uint8_t Alterna
   {
     return USB_UNSUPPORT;
   }
-  else if (Interface > 1)
+  else if (Interface > 3)
   {
     return USB_UNSUPPORT;
   }
@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+"""Compare two microbenchmark runs and flag regressions.
+
+Reads the CSV or JSON Lines output of host/build/firmware_bench and the
+CSV printed over USB by the on-target Benchmark image (lines starting
+with '#' are skipped), matches benchmarks by name and compares the
+median ns/op or, for the target, the minimum cycle count. Exits with
+status 1 when any benchmark got slower by more than --threshold percent.
+
+    python tools/bench_compare.py old.csv new.csv --threshold 5
+"""
+
+import argparse
+import csv
+import json
+import sys
+
+METRICS = ('ns_per_op_median', 'cycles_min')
+
+
+def load(path):
+    with open(path, encoding='utf-8') as resultFile:
+        text = resultFile.read()
+    lines = [line for line in text.splitlines() if line.strip() and not line.startswith('#')]
+    if lines and lines[0].startswith('{'):
+        rows = [json.loads(line) for line in lines]
+    else:
+        rows = list(csv.DictReader(lines))
+    if not rows:
+        return None, {}
+    metric = next((name for name in METRICS if name in rows[0]), None)
+    if metric is None:
+        return None, {}
+    return metric, {row['benchmark']: float(row[metric]) for row in rows}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('old')
+    parser.add_argument('new')
+    parser.add_argument('--threshold', type=float, default=5.0,
+                        help='report a regression above this many percent')
+    args = parser.parse_args()
+
+    old_metric, old = load(args.old)
+    new_metric, new = load(args.new)
+    if old_metric != new_metric:
+        print('bench_compare: %s and %s are different kinds of results' % (args.old, args.new),
+              file=sys.stderr)
+        return 1
+    names = [name for name in new if name in old]
+    if not names:
+        print('bench_compare: no common benchmarks', file=sys.stderr)
+        return 1
+
+    unit = 'ns/op' if new_metric == 'ns_per_op_median' else 'cycles'
+    print('%12s %12s %8s  %s' % ('old ' + unit, 'new ' + unit, 'change', 'Benchmark'))
+    regressions = 0
+    for name in names:
+        change = (new[name] - old[name]) / old[name] * 100.0 if old[name] else 0.0
+        mark = ''
+        if change > args.threshold:
+            mark = '  REGRESSION'
+            regressions += 1
+        print('%12.3f %12.3f %+7.1f%%  %s%s' % (old[name], new[name], change, name, mark))
+
+    for name in sorted(set(old) ^ set(new)):
+        print('%12s %12s %8s  %s (only in %s)' % ('-', '-', '-', name,
+                                                 'old' if name in old else 'new'))
+
+    if regressions:
+        print('warning: %d benchmark(s) slower by more than %.1f%%' % (regressions, args.threshold))
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,115 @@
+#!/usr/bin/env python3
+"""Per-module static RAM report built from a linker map file.
+
+Understands the armlink map produced by the Keil project (lst/dummy.map,
+"Image component sizes" table) and GNU ld maps (-Wl,-Map). Prints RW and
+ZI bytes per object, the totals and the RAM left over, and warns when the
+headroom drops below --threshold bytes.
+
+    python tools/ram_report.py lst/dummy.map --ram-size 20480 --threshold 1024
+"""
+
+import argparse
+import re
+import sys
+from collections import defaultdict
+
+ARMLINK_ROW = re.compile(
+    r'^\s*(\d+)\s+(\d+)\s+(\d+)\s+(\d+)\s+(\d+)\s+(\d+)\s+(\S.*?)\s*$')
+ARMLINK_STACK = re.compile(r'^\s*Stack_Mem\s+0x[0-9a-fA-F]+\s+Data\s+(\d+)')
+GNU_SECTION = re.compile(r'^ (\.(?:data|bss)\S*|COMMON)\s*(.*)$')
+GNU_SIZE = re.compile(r'^\s*0x[0-9a-fA-F]+\s+0x([0-9a-fA-F]+)\s+(\S+)')
+
+
+def parse_armlink(lines):
+    modules = defaultdict(lambda: [0, 0])
+    stack = 0
+    in_table = False
+    for line in lines:
+        match = ARMLINK_STACK.match(line)
+        if match:
+            stack = int(match.group(1))
+        if 'Image component sizes' in line:
+            in_table = True
+            continue
+        if not in_table:
+            continue
+        if 'Object Totals' in line or 'Library Totals' in line:
+            continue
+        match = ARMLINK_ROW.match(line)
+        if match:
+            name = match.group(7)
+            modules[name][0] += int(match.group(4))
+            modules[name][1] += int(match.group(5))
+    return modules, stack
+
+
+def parse_gnu(lines):
+    modules = defaultdict(lambda: [0, 0])
+    pending = None
+    in_ram = False
+    for line in lines:
+        if line.startswith('.data') or line.startswith('.bss'):
+            in_ram = True
+        elif line and not line[0].isspace():
+            in_ram = False
+        if not in_ram:
+            continue
+        match = GNU_SECTION.match(line)
+        if match:
+            pending = match.group(1)
+            line = match.group(2)
+            if not line.strip():
+                continue
+        if pending is None:
+            continue
+        match = GNU_SIZE.match(line)
+        if match:
+            size = int(match.group(1), 16)
+            index = 0 if pending.startswith('.data') else 1
+            modules[match.group(2).split('/')[-1]][index] += size
+        pending = None
+    return modules, 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('map')
+    parser.add_argument('--ram-size', type=int, default=20 * 1024)
+    parser.add_argument('--threshold', type=int, default=1024,
+                        help='warn when free RAM drops below this many bytes')
+    args = parser.parse_args()
+
+    with open(args.map, encoding='latin-1') as mapFile:
+        lines = mapFile.read().splitlines()
+
+    if any('Image component sizes' in line for line in lines):
+        modules, stack = parse_armlink(lines)
+    else:
+        modules, stack = parse_gnu(lines)
+
+    if not modules:
+        print('ram_report: no RAM sections found in %s' % args.map, file=sys.stderr)
+        return 1
+
+    print('%8s %8s %8s  %s' % ('RW', 'ZI', 'Total', 'Module'))
+    total_rw = total_zi = 0
+    for name, (rw, zi) in sorted(modules.items(), key=lambda item: -sum(item[1])):
+        if rw + zi == 0:
+            continue
+        total_rw += rw
+        total_zi += zi
+        print('%8d %8d %8d  %s' % (rw, zi, rw + zi, name))
+
+    used = total_rw + total_zi
+    free = args.ram_size - used
+    print('%8d %8d %8d  total (stack %d)' % (total_rw, total_zi, used, stack))
+    print('RAM: %d of %d bytes used, %d free' % (used, args.ram_size, free))
+
+    if free < args.threshold:
+        print('warning: RAM headroom %d bytes is below %d' % (free, args.threshold))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())